@@ -0,0 +1,29 @@
+#ifdef __STDC__
+#pragma once
+#endif
+
+#include "shader_base.glsl"
+
+// Passes of chunk_build.comp, recorded by chunk_gpu_build (src/chunk_gpu.c).
+#define CHUNK_BUILD_PASS_REDUCE 0
+#define CHUNK_BUILD_PASS_SCAN 1
+#define CHUNK_BUILD_PASS_EMIT 2
+
+#define CHUNK_BUILD_GROUP_SIZE 256
+
+// Scratch buffer, in 32-bit words: header (level start[] then count[]), dense parent masks of levels
+// 1..levels-1 (two words each), then their exclusive popcount scans (one word each).
+#define CHUNK_BUILD_MAX_LEVELS 8
+#define CHUNK_BUILD_HEADER_WORDS (2 * CHUNK_BUILD_MAX_LEVELS)
+
+SHARED_STRUCT(PushChunkBuild, 16){
+u32 pass;
+u32 level;
+u32 levels;
+u32 words;
+u32 bits_id;
+u32 scratch_id;
+u32 node_id;
+u32 child_id;
+u32 packed; // 1: node_id holds PackedNode {mask, first child, pad} and child_id is unused
+} ;
@@ -0,0 +1,33 @@
+#ifdef __STDC__
+#pragma once
+#endif
+
+#include "shader_base.glsl"
+
+// Empty-space distance field of a chunk, as uploaded by chunk_upload_distance (src/chunk_distance.c): one byte
+// per 4x4x4 brick (x fastest, then y, then z), four bricks per 32-bit word, lowest byte first. A brick at
+// distance k lies in an empty cube of 2k - 1 bricks centered on it; 0 means the brick holds voxels.
+#define CHUNK_DISTANCE_BRICK_SHIFT 2
+#define CHUNK_DISTANCE_BYTES_PER_WORD 4
+
+#ifndef __STDC__
+layout(std430, set = 0, binding = BINDING_STORAGE_BUFFER) readonly buffer ChunkDistanceBuffer
+{
+        uint words[];
+} chunk_distance_buffers[];
+
+uint chunk_brick_distance(uint distance_id, uvec3 brick, uint bricks_per_axis)
+{
+        uint i = (brick.z * bricks_per_axis + brick.y) * bricks_per_axis + brick.x;
+        return (chunk_distance_buffers[nonuniformEXT(distance_id)].words[i >> 2] >> (8u * (i & 3u))) & 0xffu;
+}
+
+// Voxel box [lo, hi) a ray at voxel v can cross without meeting a voxel (the brick of v must be empty).
+void chunk_empty_box(uint distance_id, uvec3 v, uint bricks_per_axis, out uvec3 lo, out uvec3 hi)
+{
+        uvec3 brick = v >> CHUNK_DISTANCE_BRICK_SHIFT;
+        uint r = chunk_brick_distance(distance_id, brick, bricks_per_axis) - 1u;
+        lo = (uvec3(max(ivec3(brick) - int(r), ivec3(0)))) << CHUNK_DISTANCE_BRICK_SHIFT;
+        hi = min(brick + r + 1u, uvec3(bricks_per_axis)) << CHUNK_DISTANCE_BRICK_SHIFT;
+}
+#endif
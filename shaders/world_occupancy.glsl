@@ -0,0 +1,41 @@
+#ifdef __STDC__
+#pragma once
+#endif
+
+#include "shader_base.glsl"
+
+// World occupancy tree, as uploaded by world_upload_occupancy (src/world_occupancy.c): 64-bit masks, masks[0] with
+// a bit per 4x4x4 block of window cells, masks[1 + b] with a bit per chunk of block b. Cells are counted from the
+// window origin (WorldOccupancy.origin), bits in the chunk trees' child slot order (x0 y0 z0 x1 y1 z1).
+#define WORLD_OCCUPANCY_BLOCK_DIM 4
+
+#ifndef __STDC__
+layout(std430, set = 0, binding = BINDING_STORAGE_BUFFER) readonly buffer WorldOccupancyBuffer
+{
+        uvec2 masks[];
+} world_occupancy_buffers[];
+
+uint world_cell_bit(uvec3 c)
+{
+        return (c.x & 1u) | ((c.y & 1u) << 1) | ((c.z & 1u) << 2) | ((c.x & 2u) << 2) | ((c.y & 2u) << 3) |
+               ((c.z & 2u) << 4);
+}
+
+bool world_mask_bit(uvec2 mask, uint bit)
+{
+        return ((bit < 32u ? mask.x >> bit : mask.y >> (bit - 32u)) & 1u) != 0u;
+}
+
+// false: the whole 4x4x4 block of chunks around cell can be crossed in one step
+bool world_block_occupied(uint occupancy_id, uvec3 cell)
+{
+        return world_mask_bit(world_occupancy_buffers[nonuniformEXT(occupancy_id)].masks[0], world_cell_bit(cell >> 2));
+}
+
+bool world_chunk_occupied(uint occupancy_id, uvec3 cell)
+{
+        uint block = world_cell_bit(cell >> 2);
+        return world_mask_bit(world_occupancy_buffers[nonuniformEXT(occupancy_id)].masks[1u + block],
+                              world_cell_bit(cell & 3u));
+}
+#endif
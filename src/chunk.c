@@ -1,33 +1,124 @@
 
 /* chunk.c */
 #include "chunk.h"
+#include "morton.h"
+#include "simd.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Allocator wrapper used by the tests to prove rebuilds stay off the heap.
 typedef struct {
-  int x, y, z;
-} Point;
+  uint32_t allocs;
+  uint32_t reallocs;
+} AllocCounter;
+
+// One dense node touched by an incremental rebuild.
+typedef struct {
+  uint32_t index;   // dense index within its level
+  uint64_t mask;    // mask after the edits
+  bool was_present; // node existed in the compact arrays before the edits
+} LevelEdit;
+
+// One non-empty node of the sparse rebuild pyramid.
+typedef struct {
+  uint32_t index; // dense index within its level
+  uint64_t mask;
+  const uint64_t *words; // level 1 only: the page holding this node's 64 leaf words
+} SparseNode;
+
+// Voxels of a 4x4x4 leaf word whose local coordinate on one axis equals v: SPAN_VALUE_MASK[axis][v].
+// Leaf bit layout is x0 y0 z0 x1 y1 z1, so each axis owns bits {a, a+3}.
+static const uint64_t SPAN_VALUE_MASK[AXIS_COUNT][4] = {
+    {0x0055005500550055ull, 0x00AA00AA00AA00AAull, 0x5500550055005500ull, 0xAA00AA00AA00AA00ull},
+    {0x0000333300003333ull, 0x0000CCCC0000CCCCull, 0x3333000033330000ull, 0xCCCC0000CCCC0000ull},
+    {0x000000000F0F0F0Full, 0x00000000F0F0F0F0ull, 0x0F0F0F0F00000000ull, 0xF0F0F0F000000000ull},
+};
+
+#define BULK_BATCH 512u
 
 // --- Private Prototypes ---
-static uint64_t split_by_3(uint32_t a);
-static uint64_t morton_encode(int x, int y, int z);
+static inline uint64_t morton_encode(int x, int y, int z);
 static bool traverse_svo(const ChunkTree *chunk, int x, int y, int z);
 static inline bool in_bounds(int v);
+static uint64_t *page_words(const ChunkTree *chunk, uint64_t w, bool create);
+static inline uint64_t load_word(const ChunkTree *chunk, uint64_t w);
+static inline void store_word(ChunkTree *chunk, uint64_t w, uint64_t value);
+static void drop_storage(ChunkTree *chunk, ChunkFill fill);
+static inline bool page_shared(const ChunkTree *chunk, uint32_t p);
+static void own_page(ChunkTree *chunk, uint32_t p);
+static void unshare(const ChunkTree *chunk);
+static uint64_t count_voxels(const ChunkTree *chunk);
+static uint32_t stamp_word(ChunkTree *chunk, uint64_t w, uint64_t src, ChunkStampOp op);
+static void copy_voxels(ChunkTree *dst, const ChunkTree *src);
+static bool voxels_equal(const ChunkTree *a, const ChunkTree *b);
+static void mark_word_dirty(ChunkTree *chunk, uint32_t w);
+static void clear_dirty_words(ChunkTree *chunk);
+static void mark_nodes_changed(ChunkTree *chunk, uint32_t begin, uint32_t end);
+static void mark_tail_changed(ChunkTree *chunk, uint32_t pos);
+static int cmp_u32(const void *a, const void *b);
+static bool find_node(const ChunkTree *chunk, uint32_t d, uint32_t index, uint32_t *out_pos);
+static void insert_node(ChunkTree *chunk, uint32_t d, uint32_t index, uint64_t mask);
+static void remove_node(ChunkTree *chunk, uint32_t d, uint32_t index);
+static bool chunk_trees_equal(const ChunkTree *a, const ChunkTree *b);
+static ChunkScratch *thread_scratch(void);
+static void thread_scratch_key_create(void);
+static void thread_scratch_free(void *scratch);
+static uint32_t apply_word(ChunkTree *chunk, uint64_t w, uint64_t mask, bool set_active);
+static void finish_batch(ChunkTree *chunk, uint32_t changed);
+static uint64_t span_mask(uint32_t axis, int lo, int hi);
+static int cmp_u64(const void *a, const void *b);
+static void *counting_alloc(size_t size, void *ctx);
+static void *counting_realloc(void *ptr, size_t old_size, size_t new_size, void *ctx);
+static void counting_free(void *ptr, void *ctx);
+static void rebuild_full(ChunkTree *chunk, ChunkScratch *scratch);
+static void rebuild_uniform(ChunkTree *chunk);
+static void rebuild_deferred(ChunkTree *chunk);
+static bool rebuild_incremental(ChunkTree *chunk);
+#if CHUNK_SPARSE_STORAGE
+static int cmp_sparse_node(const void *a, const void *b);
+#endif
 
 // -------------------- Public API --------------------
 void chunk_init(ChunkTree *chunk) {
   memset(chunk, 0, sizeof(*chunk));
   vec_init(&chunk->nodes, sizeof(Node), NULL);
   vec_init(&chunk->child_indices, sizeof(ChildIndex), NULL);
-  // bits[] already zero from memset
+#if CHUNK_NODE_LAYOUT != CHUNK_LAYOUT_SPLIT
+  vec_init(&chunk->packed, sizeof(PackedNode), NULL);
+#endif
+#if CHUNK_SPARSE_STORAGE
+  chunk_pages_init(&chunk->pages);
+#endif
+#if CHUNK_LOD_COUNT > 0
+  for (uint32_t k = 0; k < CHUNK_LOD_COUNT; k++) {
+    vec_init(&chunk->lods[k].nodes, sizeof(Node), NULL);
+    vec_init(&chunk->lods[k].child_indices, sizeof(ChildIndex), NULL);
+  }
+#endif
+  chunk->lod_rule = CHUNK_LOD_OR;
+  chunk->upload_all = true;
+  // fill is CHUNK_FILL_EMPTY from memset: no storage until the first voxel is set
 }
 
 void chunk_destroy(ChunkTree *chunk) {
-  if (chunk->nodes.data)
-    free(chunk->nodes.data);
-  if (chunk->child_indices.data)
-    free(chunk->child_indices.data);
+  chunk_concurrent_end(chunk);
+  drop_storage(chunk, CHUNK_FILL_EMPTY);
+  vec_destroy(&chunk->nodes);
+  vec_destroy(&chunk->child_indices);
+#if CHUNK_NODE_LAYOUT != CHUNK_LAYOUT_SPLIT
+  vec_destroy(&chunk->packed);
+#endif
+#if CHUNK_SPARSE_STORAGE
+  chunk_pages_destroy(&chunk->pages);
+#endif
+#if CHUNK_LOD_COUNT > 0
+  for (uint32_t k = 0; k < CHUNK_LOD_COUNT; k++) {
+    vec_destroy(&chunk->lods[k].nodes);
+    vec_destroy(&chunk->lods[k].child_indices);
+  }
+#endif
   memset(chunk, 0, sizeof(*chunk));
 }
 
@@ -38,7 +129,7 @@ bool chunk_get_voxel(const ChunkTree *chunk, int x, int y, int z) {
   uint64_t code = morton_encode(x, y, z);
   uint64_t w = BITSET_WORD(code);
   uint32_t b = BITSET_BIT(code);
-  return (chunk->bits[w] & BIT_MASK_U64(b)) != 0ull;
+  return (load_word(chunk, w) & BIT_MASK_U64(b)) != 0ull;
 }
 
 void chunk_set_voxel(ChunkTree *chunk, int x, int y, int z, bool set_active) {
@@ -50,160 +141,491 @@ void chunk_set_voxel(ChunkTree *chunk, int x, int y, int z, bool set_active) {
   uint32_t b = BITSET_BIT(code);
   uint64_t m = BIT_MASK_U64(b);
 
-  uint64_t before = chunk->bits[w];
+  uint64_t before = load_word(chunk, w);
   uint64_t after = set_active ? (before | m) : (before & ~m);
 
   if (before != after) {
-    chunk->bits[w] = after;
+    store_word(chunk, w, after);
     chunk->is_dirty = true;
     chunk->pending_edits++;
+    mark_word_dirty(chunk, (uint32_t)w);
   }
 }
 
-void chunk_rebuild_if_needed(ChunkTree *chunk, uint32_t threshold) {
-  if (!chunk->is_dirty)
-    return;
-  if (chunk->pending_edits < threshold)
-    return;
-  chunk_rebuild(chunk);
-  chunk->pending_edits = 0;
-}
+void chunk_set_voxels(ChunkTree *chunk, const VoxelCoord *coords, uint32_t count, bool set_active) {
+  uint64_t codes[BULK_BATCH];
+  uint32_t changed = 0;
 
-void chunk_rebuild(ChunkTree *chunk) {
-  if (!chunk->is_dirty)
-    return;
+  for (uint32_t base = 0; base < count; base += BULK_BATCH) {
+    uint32_t n = 0;
+    uint32_t end = base + BULK_BATCH < count ? base + BULK_BATCH : count;
 
-  vec_clear(&chunk->nodes);
-  vec_clear(&chunk->child_indices);
+    for (uint32_t i = base; i < end; i++) {
+      const VoxelCoord *c = &coords[i];
+      if (in_bounds(c->x) && in_bounds(c->y) && in_bounds(c->z))
+        codes[n++] = morton_encode(c->x, c->y, c->z);
+    }
 
-  // Level 0: WORDS_PER_CHUNK leaf masks (each is exactly chunk->bits[i])
-  // Level 1: WORDS_PER_CHUNK/64 parent masks
-  // ...
-  // Level (TREE_LEVELS-1): root mask count = 1
-  //
-  // We build a bottom-up dense mask pyramid, then flatten sparsely in BFS order.
+    // sorted codes put every voxel of one leaf word next to each other
+    qsort(codes, n, sizeof(uint64_t), cmp_u64);
 
-  uint32_t level_count = (uint32_t)TREE_LEVELS;
+    for (uint32_t i = 0; i < n;) {
+      uint64_t w = BITSET_WORD(codes[i]);
+      uint64_t mask = 0;
+      for (; i < n && BITSET_WORD(codes[i]) == w; i++)
+        mask |= BIT_MASK_U64(BITSET_BIT(codes[i]));
+      changed += apply_word(chunk, w, mask, set_active);
+    }
+  }
 
-  uint64_t *level_masks[TREE_LEVELS];
-  uint32_t level_node_count[TREE_LEVELS];
+  finish_batch(chunk, changed);
+}
 
-  // allocate per-level dense arrays
-  uint64_t current = (uint64_t)WORDS_PER_CHUNK; // leaf "node" count
-  for (uint32_t d = 0; d < level_count; d++) {
-    level_node_count[d] = (uint32_t)current;
-    level_masks[d] = (uint64_t *)calloc(1, (size_t)current * sizeof(uint64_t));
-    memset(level_masks[d], 0, (size_t)current * sizeof(uint64_t));
+void chunk_fill_box(ChunkTree *chunk, VoxelCoord min, VoxelCoord max, bool set_active) {
+  int lo[AXIS_COUNT] = {min.x, min.y, min.z};
+  int hi[AXIS_COUNT] = {max.x, max.y, max.z};
+
+  for (uint32_t a = 0; a < AXIS_COUNT; a++) {
+    if (lo[a] < 0)
+      lo[a] = 0;
+    if (hi[a] > (int)CHUNK_SIZE - 1)
+      hi[a] = (int)CHUNK_SIZE - 1;
+    if (lo[a] > hi[a])
+      return;
+  }
 
-    // next parent level groups 64 children into 1 parent
-    current = (current + 63ull) / 64ull; // ceil divide to be safe
-    if (current == 0)
-      current = 1;
+  // the whole chunk: no need to touch (or even have) the words
+  if (lo[0] == 0 && lo[1] == 0 && lo[2] == 0 && hi[0] == (int)CHUNK_SIZE - 1 && hi[1] == (int)CHUNK_SIZE - 1 &&
+      hi[2] == (int)CHUNK_SIZE - 1) {
+    chunk_fill(chunk, set_active);
+    return;
   }
 
-  // fill leaves from bits
-  for (uint32_t i = 0; i < level_node_count[0]; i++) {
-    level_masks[0][i] = chunk->bits[i];
+  uint32_t changed = 0;
+  for (int bz = lo[2] >> 2; bz <= hi[2] >> 2; bz++) {
+    uint64_t mz = span_mask(2, lo[2] - bz * 4, hi[2] - bz * 4);
+    for (int by = lo[1] >> 2; by <= hi[1] >> 2; by++) {
+      uint64_t myz = mz & span_mask(1, lo[1] - by * 4, hi[1] - by * 4);
+      for (int bx = lo[0] >> 2; bx <= hi[0] >> 2; bx++) {
+        // interior bricks come out as ~0 and are written as whole words
+        uint64_t mask = myz & span_mask(0, lo[0] - bx * 4, hi[0] - bx * 4);
+        changed += apply_word(chunk, morton_encode(bx, by, bz), mask, set_active);
+      }
+    }
   }
 
-  // build parents: bit c set if child mask non-zero
-  for (uint32_t d = 1; d < level_count; d++) {
-    uint32_t child_count = level_node_count[d - 1];
-    uint32_t parent_count = level_node_count[d];
+  finish_batch(chunk, changed);
+}
 
-    for (uint32_t p = 0; p < parent_count; p++) {
-      uint64_t mask = 0;
-      uint32_t base = p * 64u;
+void chunk_fill_sphere(ChunkTree *chunk, VoxelCoord center, int radius, bool set_active) {
+  if (radius < 0)
+    return;
 
-      uint32_t limit = 64u;
-      if (base + limit > child_count)
-        limit = child_count - base;
+  int lo[AXIS_COUNT] = {center.x - radius, center.y - radius, center.z - radius};
+  int hi[AXIS_COUNT] = {center.x + radius, center.y + radius, center.z + radius};
+  int c[AXIS_COUNT] = {center.x, center.y, center.z};
+  int64_t r2 = (int64_t)radius * radius;
+
+  for (uint32_t a = 0; a < AXIS_COUNT; a++) {
+    if (lo[a] < 0)
+      lo[a] = 0;
+    if (hi[a] > (int)CHUNK_SIZE - 1)
+      hi[a] = (int)CHUNK_SIZE - 1;
+    if (lo[a] > hi[a])
+      return;
+  }
 
-      for (uint32_t c = 0; c < limit; c++) {
-        if (level_masks[d - 1][base + c] != 0ull) {
-          mask |= (1ull << c);
+  uint32_t changed = 0;
+  for (int bz = lo[2] >> 2; bz <= hi[2] >> 2; bz++) {
+    for (int by = lo[1] >> 2; by <= hi[1] >> 2; by++) {
+      for (int bx = lo[0] >> 2; bx <= hi[0] >> 2; bx++) {
+        int b[AXIS_COUNT] = {bx * 4, by * 4, bz * 4};
+
+        // nearest and farthest voxel of the brick from the centre, per axis
+        int64_t near2 = 0, far2 = 0;
+        for (uint32_t a = 0; a < AXIS_COUNT; a++) {
+          int d_lo = b[a] - c[a];
+          int d_hi = b[a] + 3 - c[a];
+          int64_t n = d_lo > 0 ? d_lo : (d_hi < 0 ? -d_hi : 0);
+          int64_t f = (-d_lo > d_hi) ? -d_lo : d_hi;
+          near2 += n * n;
+          far2 += f * f;
+        }
+
+        if (near2 > r2)
+          continue;
+
+        uint64_t mask = ~0ull;
+        if (far2 > r2) {
+          // boundary brick: test each voxel, bit index is the local Morton code
+          mask = 0;
+          for (uint32_t bit = 0; bit < 64u; bit++) {
+            int64_t dx = b[0] + (int)((bit & 1u) | ((bit >> 2) & 2u)) - c[0];
+            int64_t dy = b[1] + (int)(((bit >> 1) & 1u) | ((bit >> 3) & 2u)) - c[1];
+            int64_t dz = b[2] + (int)(((bit >> 2) & 1u) | ((bit >> 4) & 2u)) - c[2];
+            if (dx * dx + dy * dy + dz * dz <= r2)
+              mask |= 1ull << bit;
+          }
         }
+
+        // voxels of the brick outside the clipped range (chunk border) are dropped
+        mask &= span_mask(0, lo[0] - b[0], hi[0] - b[0]) & span_mask(1, lo[1] - b[1], hi[1] - b[1]) &
+                span_mask(2, lo[2] - b[2], hi[2] - b[2]);
+        changed += apply_word(chunk, morton_encode(bx, by, bz), mask, set_active);
       }
-      level_masks[d][p] = mask;
     }
   }
 
-  // flatten BFS from top level down
-  uint32_t level_start[TREE_LEVELS] = {0};
-  uint32_t active_count[TREE_LEVELS] = {0};
+  finish_batch(chunk, changed);
+}
 
-  uint32_t total_active = 0;
-  for (int d = (int)level_count - 1; d >= 0; d--) {
-    level_start[d] = total_active;
+void chunk_stamp(ChunkTree *chunk, const ChunkTree *src, ChunkStampOp op) {
+  // a uniform source either leaves the chunk alone or makes it uniform too
+  if (src->fill != CHUNK_FILL_MIXED) {
+    bool solid = src->fill == CHUNK_FILL_SOLID;
+    if (op == CHUNK_STAMP_REPLACE || (op == CHUNK_STAMP_UNION && solid))
+      chunk_fill(chunk, solid);
+    else if ((op == CHUNK_STAMP_SUBTRACT && solid) || (op == CHUNK_STAMP_INTERSECT && !solid))
+      chunk_fill(chunk, false);
+    return;
+  }
 
-    uint32_t count = 0;
-    for (uint32_t i = 0; i < level_node_count[d]; i++) {
-      if (level_masks[d][i] != 0ull)
-        count++;
+  uint32_t changed = 0;
+  unshare(src);
+  unshare(chunk);
+
+#if CHUNK_SPARSE_STORAGE
+  // the dst pass below walks dst pages, which a solid chunk does not have yet
+  if (chunk->fill == CHUNK_FILL_SOLID && (op == CHUNK_STAMP_INTERSECT || op == CHUNK_STAMP_REPLACE))
+    chunk_materialize(chunk);
+
+  // src pages hold every word that can turn voxels on; dst pages every word INTERSECT/REPLACE can turn off
+  const ChunkPageTable *src_pages = &src->pages;
+  if (op != CHUNK_STAMP_INTERSECT) {
+    for (uint32_t i = 0; i < src_pages->capacity; i++) {
+      uint32_t key = src_pages->keys[i];
+      if (key == CHUNK_PAGE_EMPTY)
+        continue;
+      const uint64_t *words = chunk_pages_at(src_pages, src_pages->values[i])->words;
+      for (uint32_t k = 0; k < CHUNK_PAGE_WORDS; k++)
+        changed += stamp_word(chunk, (uint64_t)key * CHUNK_PAGE_WORDS + k, words[k], op);
     }
+  }
 
-    // always keep root as node 0
-    if (d == (int)level_count - 1 && count == 0)
-      count = 1;
-
-    active_count[d] = count;
-    total_active += count;
+  if (op == CHUNK_STAMP_INTERSECT || op == CHUNK_STAMP_REPLACE) {
+    // only clears words, so the dst table is never resized while it is walked
+    const ChunkPageTable *dst_pages = &chunk->pages;
+    for (uint32_t i = 0; i < dst_pages->capacity; i++) {
+      uint32_t key = dst_pages->keys[i];
+      if (key == CHUNK_PAGE_EMPTY || chunk_pages_find(src_pages, key))
+        continue;
+      for (uint32_t k = 0; k < CHUNK_PAGE_WORDS; k++)
+        changed += stamp_word(chunk, (uint64_t)key * CHUNK_PAGE_WORDS + k, 0ull, op);
+    }
   }
+#else
+  for (uint64_t w = 0; w < WORDS_PER_CHUNK; w++)
+    changed += stamp_word(chunk, w, src->bits[w], op);
+#endif
 
-  vec_realloc_capacity(&chunk->nodes, total_active);
-  vec_realloc_capacity(&chunk->child_indices, total_active);
+  finish_batch(chunk, changed);
+}
 
-  for (int d = (int)level_count - 1; d >= 0; d--) {
-    uint32_t next_level_ptr = (d > 0) ? level_start[d - 1] : 0;
-    bool root_forced = (d == (int)level_count - 1);
+uint64_t chunk_get_word(const ChunkTree *chunk, uint64_t w) {
+  if (w >= WORDS_PER_CHUNK)
+    return 0ull;
+  return load_word(chunk, w);
+}
 
-    for (uint32_t i = 0; i < level_node_count[d]; i++) {
-      uint64_t mask = level_masks[d][i];
+void chunk_set_word(ChunkTree *chunk, uint64_t w, uint64_t value) {
+  if (w >= WORDS_PER_CHUNK)
+    return;
+  finish_batch(chunk, stamp_word(chunk, w, value, CHUNK_STAMP_REPLACE));
+}
 
-      if (mask == 0ull && !root_forced)
-        continue;
+void chunk_set_words(ChunkTree *chunk, uint64_t first, const uint64_t *words, uint32_t count) {
+  uint32_t changed = 0;
+  for (uint32_t i = 0; i < count && first + i < WORDS_PER_CHUNK; i++)
+    changed += stamp_word(chunk, first + i, words[i], CHUNK_STAMP_REPLACE);
+  finish_batch(chunk, changed);
+}
 
-      Node n = {.mask = mask};
-      ChildIndex c = {.first_child_index = (d > 0 && mask != 0ull) ? next_level_ptr : 0};
+void chunk_clear(ChunkTree *chunk) {
+#if CHUNK_SPARSE_STORAGE
+  if (chunk->fill != CHUNK_FILL_SOLID && chunk->pages.count == 0 && !chunk->snapshot)
+    return;
+#endif
+  drop_storage(chunk, CHUNK_FILL_EMPTY);
 
-      vec_push(&chunk->nodes, &n);
-      vec_push(&chunk->child_indices, &c);
+  // every word may have changed: only a full rebuild can catch up
+  chunk->is_dirty = true;
+  chunk->pending_edits++;
+  chunk->dirty_overflow = true;
+}
 
-      if (d > 0) {
-        next_level_ptr += (uint32_t)__builtin_popcountll(mask);
-      }
+void chunk_fill(ChunkTree *chunk, bool solid) {
+  ChunkFill fill = solid ? CHUNK_FILL_SOLID : CHUNK_FILL_EMPTY;
+  if (chunk->fill == fill)
+    return;
 
-      if (root_forced) {
-        // if we forced an empty root, only emit one node
-        if (mask == 0ull)
-          break;
-        root_forced = false;
-      }
-    }
+  uint64_t set = count_voxels(chunk);
+  uint64_t changed = solid ? VOXELS_PER_CHUNK - set : set;
+  drop_storage(chunk, fill);
+  if (changed == 0)
+    return;
+
+  chunk->is_dirty = true;
+  chunk->pending_edits += changed > UINT32_MAX - chunk->pending_edits ? UINT32_MAX - chunk->pending_edits
+                                                                       : (uint32_t)changed;
+  chunk->dirty_overflow = true;
+}
+
+void chunk_compact(ChunkTree *chunk) {
+  if (chunk->fill != CHUNK_FILL_MIXED || chunk->is_dirty || chunk->frozen || chunk->nodes.length == 0)
+    return;
+
+  // the root is kept even when empty; a solid tree has every leaf, all full
+  const Node *nodes = (const Node *)chunk->nodes.data;
+  if (nodes[0].mask == 0ull) {
+    drop_storage(chunk, CHUNK_FILL_EMPTY);
+    return;
+  }
+  if (chunk->level_count[0] != WORDS_PER_CHUNK)
+    return;
+  const Node *leaves = nodes + chunk->level_start[0];
+  for (uint32_t i = 0; i < chunk->level_count[0]; i++) {
+    if (leaves[i].mask != ~0ull)
+      return;
   }
+  drop_storage(chunk, CHUNK_FILL_SOLID);
+}
 
-  for (uint32_t d = 0; d < level_count; d++) {
-    free(level_masks[d]);
+void chunk_materialize(ChunkTree *chunk) {
+  if (chunk->fill == CHUNK_FILL_MIXED)
+    return;
+  bool solid = chunk->fill == CHUNK_FILL_SOLID;
+#if CHUNK_SPARSE_STORAGE
+  for (uint32_t p = 0; p < PAGES_PER_CHUNK && solid; p++)
+    memset(chunk_pages_get_or_create(&chunk->pages, p), 0xFF, sizeof(ChunkPage));
+#else
+  chunk->bits = chunk_pool_acquire();
+  memset(chunk->bits, solid ? 0xFF : 0x00, BYTES_PER_CHUNK_BITSET);
+#endif
+  chunk->fill = CHUNK_FILL_MIXED;
+}
+
+size_t chunk_storage_bytes(const ChunkTree *chunk) {
+#if CHUNK_SPARSE_STORAGE
+  return chunk_pages_bytes(&chunk->pages);
+#else
+  return chunk->bits ? BYTES_PER_CHUNK_BITSET : 0u;
+#endif
+}
+
+void chunk_rebuild_if_needed(ChunkTree *chunk, uint32_t threshold) {
+  chunk_concurrent_flush(chunk);
+  if (!chunk->is_dirty || chunk->snapshot)
+    return;
+  if (chunk->pending_edits < threshold)
+    return;
+  chunk_rebuild_incremental(chunk);
+  chunk->pending_edits = 0;
+}
+
+bool chunk_uses_gpu_build(const ChunkTree *chunk) {
+#if CHUNK_SPARSE_STORAGE || CHUNK_NODE_LAYOUT == CHUNK_LAYOUT_DFS
+  (void)chunk;
+  return false;
+#else
+  return chunk->build_mode == CHUNK_BUILD_GPU && chunk->fill == CHUNK_FILL_MIXED;
+#endif
+}
+
+void chunk_rebuild(ChunkTree *chunk) { chunk_rebuild_with(chunk, thread_scratch(), false); }
+
+void chunk_rebuild_incremental(ChunkTree *chunk) { chunk_rebuild_with(chunk, thread_scratch(), true); }
+
+void chunk_rebuild_with(ChunkTree *chunk, ChunkScratch *scratch, bool incremental) {
+  chunk_concurrent_flush(chunk);
+  // with a snapshot in flight, its rebuild brings the tree up to the take; later edits wait for the next one
+  if (!chunk->is_dirty || chunk->snapshot)
+    return;
+
+  // before the dirty words are consumed: they tell which bricks to patch
+  chunk_build_distance(chunk);
+
+  // the tree is built on the GPU from the uploaded words; nothing to compact or truncate here
+  if (chunk_uses_gpu_build(chunk)) {
+    rebuild_deferred(chunk);
+    return;
   }
 
-  chunk->is_dirty = false;
-  chunk->need_upload = true;
+  if (chunk->fill != CHUNK_FILL_MIXED)
+    rebuild_uniform(chunk);
+  else if (!incremental || !rebuild_incremental(chunk))
+    rebuild_full(chunk, scratch);
+
+  chunk_compact(chunk);
+  chunk_build_lods(chunk);
+  chunk_build_layout(chunk);
+
+  // compaction and emptied pages took storage the concurrent writers still need
+  if (chunk->concurrent)
+    chunk_concurrent_begin(chunk);
+}
+
+ChunkScratch *chunk_scratch_create(void) {
+  ChunkScratch *scratch = (ChunkScratch *)malloc(sizeof(ChunkScratch));
+#if CHUNK_SPARSE_STORAGE
+  for (uint32_t d = 0; d < (uint32_t)TREE_LEVELS; d++)
+    vec_init(&scratch->level_nodes[d], sizeof(SparseNode), NULL);
+#endif
+  return scratch;
+}
+
+void chunk_scratch_destroy(ChunkScratch *scratch) {
+  if (!scratch)
+    return;
+#if CHUNK_SPARSE_STORAGE
+  for (uint32_t d = 0; d < (uint32_t)TREE_LEVELS; d++)
+    vec_destroy(&scratch->level_nodes[d]);
+#endif
+  free(scratch);
 }
 
 void chunk_upload(ChunkTree *chunk, M_GPU *gpu, M_Resource *rm, CmdBuffer cmd) {
   if (!chunk->need_upload)
     return;
 
-  cmd_buffer_upload(cmd, gpu, rm, chunk->gpu_node, chunk->nodes.data, vec_bytes_len(&chunk->nodes));
+  // the selected representation (full tree or a truncated LOD) goes into the same buffers
+  uint32_t count;
+  const Node *nodes = chunk_lod_nodes(chunk, chunk->lod, &count);
+  const ChildIndex *child_indices = chunk_lod_child_indices(chunk, chunk->lod);
+
+#if CHUNK_NODE_LAYOUT != CHUNK_LAYOUT_SPLIT
+  // the full tree is kept packed, a coarse LOD is packed on the way out
+  Vector lod_packed = {0};
+  const PackedNode *packed = (const PackedNode *)chunk->packed.data;
+  if (chunk->lod != 0) {
+    vec_init(&lod_packed, sizeof(PackedNode), NULL);
+    chunk_layout_pack(nodes, child_indices, count, CHUNK_NODE_LAYOUT, &lod_packed);
+    packed = (const PackedNode *)lod_packed.data;
+  }
+#endif
+
+  // grow by half again so a chunk that keeps gaining nodes is not reallocated on every upload
+  RBuffer *node_buf = rm_get_buffer(rm, chunk->gpu_node);
+  if ((u64)node_buf->capacity < (u64)count * CHUNK_GPU_NODE_STRIDE) {
+    u32 grown = count + count / 2u;
+    rm_resize_buffer(rm, chunk->gpu_node, grown * (u32)CHUNK_GPU_NODE_STRIDE);
+#if CHUNK_NODE_LAYOUT == CHUNK_LAYOUT_SPLIT
+    rm_resize_buffer(rm, chunk->gpu_child_indices, grown * (u32)sizeof(ChildIndex));
+#endif
+    chunk->upload_all = true;
+  }
+
+  ChunkNodeRange ranges[CHUNK_MAX_UPLOAD_RANGES];
+  VkBufferCopy node_regions[CHUNK_MAX_UPLOAD_RANGES];
+  uint32_t range_count = chunk_take_upload_ranges(chunk, ranges);
+
+  // barriers as around the bits upload of chunk_gpu_build: no copy overlaps a shader still reading the old nodes
+#if CHUNK_NODE_LAYOUT == CHUNK_LAYOUT_SPLIT
+  VkBufferCopy child_regions[CHUNK_MAX_UPLOAD_RANGES];
+  for (uint32_t i = 0; i < range_count; i++) {
+    VkDeviceSize first = ranges[i].begin, n = ranges[i].end - ranges[i].begin;
+    node_regions[i] = (VkBufferCopy){.srcOffset = first * sizeof(Node), .dstOffset = first * sizeof(Node),
+                                     .size = n * sizeof(Node)};
+    child_regions[i] = (VkBufferCopy){.srcOffset = first * sizeof(ChildIndex),
+                                      .dstOffset = first * sizeof(ChildIndex),
+                                      .size = n * sizeof(ChildIndex)};
+  }
+
+  if (range_count > 0) {
+    cmd_sync_buffer(cmd.buffer, rm, chunk->gpu_node, STATE_TRANSFER, ACCESS_WRITE);
+    cmd_sync_buffer(cmd.buffer, rm, chunk->gpu_child_indices, STATE_TRANSFER, ACCESS_WRITE);
+  }
+  cmd_buffer_upload_regions(cmd, gpu, rm, chunk->gpu_node, nodes, node_regions, range_count);
+  cmd_buffer_upload_regions(cmd, gpu, rm, chunk->gpu_child_indices, child_indices, child_regions, range_count);
+  if (range_count > 0) {
+    cmd_sync_buffer(cmd.buffer, rm, chunk->gpu_node, STATE_SHADER, ACCESS_READ);
+    cmd_sync_buffer(cmd.buffer, rm, chunk->gpu_child_indices, STATE_SHADER, ACCESS_READ);
+  }
+#else
+  for (uint32_t i = 0; i < range_count; i++) {
+    VkDeviceSize first = ranges[i].begin, n = ranges[i].end - ranges[i].begin;
+    node_regions[i] = (VkBufferCopy){.srcOffset = first * sizeof(PackedNode),
+                                     .dstOffset = first * sizeof(PackedNode),
+                                     .size = n * sizeof(PackedNode)};
+  }
+
+  if (range_count > 0)
+    cmd_sync_buffer(cmd.buffer, rm, chunk->gpu_node, STATE_TRANSFER, ACCESS_WRITE);
+  cmd_buffer_upload_regions(cmd, gpu, rm, chunk->gpu_node, packed, node_regions, range_count);
+  if (range_count > 0)
+    cmd_sync_buffer(cmd.buffer, rm, chunk->gpu_node, STATE_SHADER, ACCESS_READ);
+  if (chunk->lod != 0)
+    vec_destroy(&lod_packed);
+#endif
 
-  cmd_buffer_upload(cmd, gpu, rm, chunk->gpu_child_indices, chunk->child_indices.data,
-                    vec_bytes_len(&chunk->child_indices));
+  chunk_upload_distance(chunk, gpu, rm, cmd);
 
   chunk->need_upload = false;
 }
 
+uint32_t chunk_take_upload_ranges(ChunkTree *chunk, ChunkNodeRange *out) {
+  uint32_t count;
+  chunk_lod_nodes(chunk, chunk->lod, &count);
+
+  // coarse LODs are rewritten wholesale by every rebuild, and are small
+  uint32_t n = 0;
+  // DFS order moves nodes around on every rebuild, BFS indices of changed nodes say nothing about it
+  bool whole = CHUNK_NODE_LAYOUT == CHUNK_LAYOUT_DFS && chunk->upload_range_count > 0;
+  if (whole || chunk->upload_all || chunk->lod != 0 || chunk->uploaded_lod != 0) {
+    if (count > 0)
+      out[n++] = (ChunkNodeRange){0, count};
+  } else {
+    // ranges past the end belong to nodes that were removed since
+    for (uint32_t i = 0; i < chunk->upload_range_count; i++) {
+      ChunkNodeRange r = chunk->upload_ranges[i];
+      if (r.end > count)
+        r.end = count;
+      if (r.begin < r.end)
+        out[n++] = r;
+    }
+  }
+
+  chunk->upload_all = false;
+  chunk->upload_range_count = 0;
+  chunk->uploaded_lod = chunk->lod;
+  return n;
+}
+
 // -------------------- Tests --------------------
 
+void chunk_fill_test_chunk(ChunkTree *chunk, uint32_t seed) {
+  int cs = (int)CHUNK_SIZE;
+  chunk_clear(chunk);
+
+  seed = seed * 1103515245u + 12345u;
+  int ground = cs / 8 + (int)((seed >> 16) % (unsigned)(cs / 4));
+  chunk_fill_box(chunk, (VoxelCoord){0, 0, 0}, (VoxelCoord){cs - 1, ground, cs - 1}, true);
+
+  seed = seed * 1103515245u + 12345u;
+  VoxelCoord c = {(int)((seed >> 8) % (unsigned)cs), ground + cs / 4, (int)((seed >> 16) % (unsigned)cs)};
+  chunk_fill_sphere(chunk, c, cs / 4, true);
+
+  // half the voxels of an aligned corner block on, the rest off: specks in the air, holes where the sphere reaches
+  int noise = cs / 4 < 32 ? cs / 4 : 32;
+  for (int z = 0; z < noise; z++) {
+    for (int y = 0; y < noise; y++) {
+      for (int x = 0; x < noise; x++) {
+        seed = seed * 1103515245u + 12345u;
+        chunk_set_voxel(chunk, cs - 1 - x, cs - 1 - y, z, ((seed >> 16) & 1u) != 0u);
+      }
+    }
+  }
+}
+
 int chunk_test(void) {
   ChunkTree chunk;
   chunk_init(&chunk);
@@ -214,7 +636,7 @@ int chunk_test(void) {
   // Test 1: single voxel
   {
     LOG_INFO("[Test 1] Single voxel... ");
-    memset(chunk.bits, 0, sizeof(chunk.bits));
+    chunk_clear(&chunk);
     chunk.is_dirty = true;
 
     int tx = (int)(CHUNK_SIZE / 2u);
@@ -239,13 +661,13 @@ int chunk_test(void) {
   // Test 2: random sparse set
   {
     LOG_INFO("[Test 2] Random cloud (200 voxels)... ");
-    memset(chunk.bits, 0, sizeof(chunk.bits));
+    chunk_clear(&chunk);
     vec_clear(&chunk.nodes);
     vec_clear(&chunk.child_indices);
     chunk.is_dirty = true;
     chunk.pending_edits = 0;
 
-    Point pts[200];
+    VoxelCoord pts[200];
     unsigned int seed = 12345u;
 
     for (int i = 0; i < 200; i++) {
@@ -255,7 +677,7 @@ int chunk_test(void) {
       int y = (int)((seed >> 8) & (CHUNK_SIZE - 1u));
       int z = (int)((seed) & (CHUNK_SIZE - 1u));
 
-      pts[i] = (Point){x, y, z};
+      pts[i] = (VoxelCoord){x, y, z};
       chunk_set_voxel(&chunk, x, y, z, true);
     }
 
@@ -281,8 +703,7 @@ int chunk_test(void) {
   // Test 3: full chunk
   {
     LOG_INFO("[Test 3] Full solid chunk... ");
-    memset(chunk.bits, 0xFF, sizeof(chunk.bits));
-    chunk.is_dirty = true;
+    chunk_fill_box(&chunk, (VoxelCoord){0, 0, 0}, (VoxelCoord){(int)CHUNK_SIZE - 1, (int)CHUNK_SIZE - 1, (int)CHUNK_SIZE - 1}, true);
 
     chunk_rebuild(&chunk);
 
@@ -310,65 +731,1389 @@ int chunk_test(void) {
     }
   }
 
-  chunk_destroy(&chunk);
-  LOG_INFO("All chunk tests passed.\n");
-  return 0;
-}
-// --- Private Functions ---
+  // Test 4: incremental rebuild must match a full rebuild byte-for-byte
+  {
+    LOG_INFO("[Test 4] Incremental vs full rebuild... ");
+    ChunkTree *full = (ChunkTree *)malloc(sizeof(ChunkTree));
+    chunk_init(full);
 
-// -------------------- Morton encoding --------------------
-// This encoder interleaves bits as: x at bit 0, y at bit 1, z at bit 2, repeating.
-// With CHUNK_SIZE=2^(2L), we need BITS_PER_AXIS = 2L bits per axis.
-// For TREE_LEVELS up to 6, BITS_PER_AXIS <= 12; this is fine.
-static uint64_t split_by_3(uint32_t a) {
-  // Keep enough bits; 21 is plenty for our use-case.
-  uint64_t x = (uint64_t)(a & 0x1FFFFFu);
+    chunk_clear(&chunk);
+    chunk_rebuild(&chunk);
 
-  x = (x | (x << 32)) & 0x1F00000000FFFFull;
-  x = (x | (x << 16)) & 0x1F0000FF0000FFull;
-  x = (x | (x << 8)) & 0x100F00F00F00F00Full;
-  x = (x | (x << 4)) & 0x10C30C30C30C30C3ull;
-  x = (x | (x << 2)) & 0x1249249249249249ull;
+    unsigned int seed = 777u;
+    bool ok = true;
 
-  return x;
-}
+    // round sizes straddle the flip threshold so both the patch and the fallback run
+    const uint32_t rounds[] = {1, 5, 40, 3, 300, 1, 64, 17};
+    for (uint32_t r = 0; r < sizeof(rounds) / sizeof(rounds[0]) && ok; r++) {
+      for (uint32_t i = 0; i < rounds[r]; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int x = (int)((seed >> 16) & (CHUNK_SIZE - 1u));
+        int y = (int)((seed >> 8) & (CHUNK_SIZE - 1u));
+        int z = (int)((seed) & (CHUNK_SIZE - 1u));
+        chunk_set_voxel(&chunk, x, y, z, ((seed >> 28) & 3u) != 0u);
+      }
 
-static uint64_t morton_encode(int x, int y, int z) {
-  // We assume inputs are already clamped to [0..CHUNK_SIZE-1]
-  return split_by_3((uint32_t)x) | (split_by_3((uint32_t)y) << 1) | (split_by_3((uint32_t)z) << 2);
-}
+      chunk_rebuild_incremental(&chunk);
 
-// -------------------- Internal traversal for tests --------------------
-static bool traverse_svo(const ChunkTree *chunk, int x, int y, int z) {
-  if (chunk->nodes.length == 0)
-    return false;
+      copy_voxels(full, &chunk);
+      chunk_rebuild(full);
 
-  uint64_t code = morton_encode(x, y, z);
-  uint32_t node_index = 0;
+      ok = chunk_trees_equal(&chunk, full);
+    }
 
-  const Node *node_arr = (const Node *)chunk->nodes.data;
-  const ChildIndex *child_arr = (const ChildIndex *)chunk->child_indices.data;
+    chunk_destroy(full);
+    free(full);
 
-  // Traverse from root (TREE_LEVELS-1) down to 0
-  for (int d = (int)TREE_LEVELS - 1; d >= 0; d--) {
-    Node n = node_arr[node_index];
+    if (ok)
+      LOG_INFO("PASSED (nodes=%zu)\n", chunk.nodes.length);
+    else {
+      LOG_INFO("FAILED (trees differ)\n");
+      chunk_destroy(&chunk);
+      return 1;
+    }
+  }
 
-    uint32_t slot = CHILD_SLOT(code, (uint32_t)d);
-    uint64_t bit = 1ull << slot;
+  // Test 5: vectorized parent reduction agrees with the scalar kernel
+  {
+    LOG_INFO("[Test 5] Parent mask reduction (%s)... ", simd_backend_name(simd_backend()));
+    uint64_t words[64];
+    unsigned int seed = 99u;
+    bool ok = true;
 
-    if ((n.mask & bit) == 0ull)
-      return false;
+    for (uint32_t r = 0; r < 256u && ok; r++) {
+      for (uint32_t c = 0; c < 64u; c++) {
+        seed = seed * 1103515245u + 12345u;
+        // mix of empty words, single high/low bits and dense words
+        uint32_t kind = (seed >> 24) & 3u;
+        words[c] = kind == 0 ? 0ull : kind == 1 ? (1ull << (seed & 63u)) : kind == 2 ? 0ull : ~0ull;
+      }
+      ok = simd_nonzero_mask64(words) == simd_nonzero_mask64_scalar(words);
+    }
 
-    if (d == 0)
-      return true; // leaf bit is the voxel
+    if (ok)
+      LOG_INFO("PASSED\n");
+    else {
+      LOG_INFO("FAILED (kernel mismatch)\n");
+      chunk_destroy(&chunk);
+      return 1;
+    }
+  }
 
-    uint64_t prefix = n.mask & (bit - 1ull);
-    uint32_t offset = (uint32_t)__builtin_popcountll(prefix);
+  // Test 6: steady-state rebuilds reuse the node and child index vectors (only those two go through the counter)
+  {
+    LOG_INFO("[Test 6] Rebuild reuses the node vectors... ");
+    AllocCounter counter = {0};
+    Allocator counting = {counting_alloc, counting_realloc, counting_free, &counter};
+    ChunkScratch *scratch = chunk_scratch_create();
+
+    chunk_destroy(&chunk);
+    chunk_init(&chunk);
+    vec_init(&chunk.nodes, sizeof(Node), &counting);
+    vec_init(&chunk.child_indices, sizeof(ChildIndex), &counting);
+
+    // warm-up: the largest tree sizes the vectors once
+    chunk_fill_box(&chunk, (VoxelCoord){0, 0, 0}, (VoxelCoord){(int)CHUNK_SIZE - 1, (int)CHUNK_SIZE - 1, (int)CHUNK_SIZE - 1}, true);
+    chunk_rebuild_with(&chunk, scratch, false);
+    uint32_t warm = counter.allocs + counter.reallocs;
+
+    unsigned int seed = 2024u;
+    for (uint32_t r = 0; r < 32u; r++) {
+      for (uint32_t i = 0; i < 8u * r; i++) {
+        seed = seed * 1103515245u + 12345u;
+        chunk_set_voxel(&chunk, (int)((seed >> 16) & (CHUNK_SIZE - 1u)), (int)((seed >> 8) & (CHUNK_SIZE - 1u)),
+                        (int)(seed & (CHUNK_SIZE - 1u)), (seed >> 31) != 0u);
+      }
+      chunk_rebuild_with(&chunk, scratch, (r & 1u) != 0u);
+    }
+
+    chunk_clear(&chunk);
+    chunk_rebuild_with(&chunk, scratch, false);
 
-    node_index = child_arr[node_index].first_child_index + offset;
+    uint32_t steady = counter.allocs + counter.reallocs - warm;
+    chunk_scratch_destroy(scratch);
+
+    // the counting allocator goes out of scope with this block
+    chunk_destroy(&chunk);
+    chunk_init(&chunk);
+
+    if (steady == 0)
+      LOG_INFO("PASSED (warm-up allocations=%u)\n", warm);
+    else {
+      LOG_INFO("FAILED (%u node vector allocations after warm-up)\n", steady);
+      chunk_destroy(&chunk);
+      return 1;
+    }
   }
 
-  return false;
-}
+  // Test 7: bulk edits agree with per-voxel edits
+  {
+    LOG_INFO("[Test 7] Bulk box/sphere/list/stamp edits... ");
+    ChunkTree *ref = (ChunkTree *)malloc(sizeof(ChunkTree));
+    chunk_init(ref);
+    chunk_clear(&chunk);
 
-static inline bool in_bounds(int v) { return (v >= 0) && (v < (int)CHUNK_SIZE); }
+    unsigned int seed = 555u;
+    bool ok = true;
+
+    for (uint32_t r = 0; r < 24u && ok; r++) {
+      seed = seed * 1103515245u + 12345u;
+      int cs = (int)CHUNK_SIZE;
+      VoxelCoord a = {(int)(seed % (cs + 8)) - 4, (int)((seed >> 8) % (cs + 8)) - 4, (int)((seed >> 16) % (cs + 8)) - 4};
+      seed = seed * 1103515245u + 12345u;
+      VoxelCoord b = {a.x + (int)(seed % 23u), a.y + (int)((seed >> 8) % 23u), a.z + (int)((seed >> 16) % 23u)};
+      int radius = (int)((seed >> 24) % 17u);
+      bool set = (r % 3u) != 2u;
+
+      if (r & 1u) {
+        chunk_fill_box(&chunk, a, b, set);
+        for (int z = a.z; z <= b.z; z++)
+          for (int y = a.y; y <= b.y; y++)
+            for (int x = a.x; x <= b.x; x++)
+              chunk_set_voxel(ref, x, y, z, set);
+      } else {
+        chunk_fill_sphere(&chunk, a, radius, set);
+        for (int z = a.z - radius; z <= a.z + radius; z++)
+          for (int y = a.y - radius; y <= a.y + radius; y++)
+            for (int x = a.x - radius; x <= a.x + radius; x++) {
+              int dx = x - a.x, dy = y - a.y, dz = z - a.z;
+              if (dx * dx + dy * dy + dz * dz <= radius * radius)
+                chunk_set_voxel(ref, x, y, z, set);
+            }
+      }
+
+      VoxelCoord list[700];
+      for (uint32_t i = 0; i < 700u; i++) {
+        seed = seed * 1103515245u + 12345u;
+        list[i] = (VoxelCoord){(int)((seed >> 16) & (CHUNK_SIZE - 1u)), (int)((seed >> 8) & (CHUNK_SIZE - 1u)),
+                               (int)(seed & (CHUNK_SIZE - 1u))};
+        chunk_set_voxel(ref, list[i].x, list[i].y, list[i].z, !set);
+      }
+      chunk_set_voxels(&chunk, list, 700u, !set);
+
+      ok = voxels_equal(&chunk, ref);
+    }
+
+    // stamping a copy of the reference onto itself subtracts everything
+    if (ok) {
+      chunk_stamp(&chunk, ref, CHUNK_STAMP_SUBTRACT);
+      for (uint64_t w = 0; w < WORDS_PER_CHUNK && ok; w++)
+        ok = chunk_get_word(&chunk, w) == 0ull;
+      chunk_stamp(&chunk, ref, CHUNK_STAMP_UNION);
+      ok = ok && voxels_equal(&chunk, ref);
+      chunk_stamp(&chunk, ref, CHUNK_STAMP_INTERSECT);
+      ok = ok && voxels_equal(&chunk, ref);
+    }
+
+    chunk_destroy(ref);
+    free(ref);
+
+    if (ok)
+      LOG_INFO("PASSED\n");
+    else {
+      LOG_INFO("FAILED (bulk result differs from per-voxel edits)\n");
+      chunk_destroy(&chunk);
+      return 1;
+    }
+  }
+
+  // Test 8: raw word access and storage that follows occupancy
+  {
+    LOG_INFO("[Test 8] Word access & storage (%s)... ", CHUNK_SPARSE_STORAGE ? "sparse" : "dense");
+    chunk_clear(&chunk);
+    chunk_rebuild(&chunk);
+
+    // far corner word and a word in the first page
+    uint64_t last = WORDS_PER_CHUNK - 1ull;
+    int hi = (int)CHUNK_SIZE - 1;
+    chunk_set_word(&chunk, last, 0x8000000000000001ull);
+    chunk_set_word(&chunk, 0, 0x10ull);
+    chunk_rebuild_incremental(&chunk);
+    size_t bytes = chunk_storage_bytes(&chunk);
+
+    bool ok = chunk_get_word(&chunk, last) == 0x8000000000000001ull && chunk_get_word(&chunk, 0) == 0x10ull &&
+              chunk_get_word(&chunk, 1) == 0ull && chunk_get_voxel(&chunk, hi, hi, hi) && traverse_svo(&chunk, hi, hi, hi) &&
+              chunk.level_count[0] == 2u;
+
+    chunk_set_word(&chunk, last, 0ull);
+    chunk_set_word(&chunk, 0, 0ull);
+    chunk_rebuild_incremental(&chunk);
+    ok = ok && chunk.nodes.length == 1u && !traverse_svo(&chunk, hi, hi, hi);
+
+#if CHUNK_SPARSE_STORAGE
+    // emptied pages are released by the rebuild, so clearing gives the memory back for reuse
+    ok = ok && chunk.pages.count == 0u;
+#endif
+
+    if (ok)
+      LOG_INFO("PASSED (2 words stored in %zu bytes, dense bitset=%llu bytes)\n", bytes,
+               (unsigned long long)BYTES_PER_CHUNK_BITSET);
+    else {
+      LOG_INFO("FAILED (word access or page release)\n");
+      chunk_destroy(&chunk);
+      return 1;
+    }
+  }
+
+  // Test 9: a GPU-side mirror patched with only the tracked ranges stays identical to the tree
+  {
+    LOG_INFO("[Test 9] Delta upload ranges... ");
+    int cs = (int)CHUNK_SIZE;
+    chunk_clear(&chunk);
+    chunk_fill_sphere(&chunk, (VoxelCoord){cs / 2, cs / 2, cs / 2}, cs / 3, true);
+    chunk_rebuild(&chunk);
+
+    size_t capacity = 0;
+    Node *mirror_nodes = NULL;
+    ChildIndex *mirror_children = NULL;
+    ChunkNodeRange ranges[CHUNK_MAX_UPLOAD_RANGES];
+    uint64_t sent = 0, full = 0;
+    unsigned int seed = 99u;
+    bool ok = true;
+
+    for (uint32_t r = 0; r < 64u && ok; r++) {
+      // odd rounds flip voxels inside the sphere only (masks change, no node appears or disappears)
+      for (uint32_t i = 0; i < 4u + r % 8u; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int x = (int)((seed >> 16) & (CHUNK_SIZE - 1u)), y = (int)((seed >> 8) & (CHUNK_SIZE - 1u));
+        int z = (int)(seed & (CHUNK_SIZE - 1u));
+        if (r & 1u) {
+          x = cs / 2 + (x & 7) - 4;
+          y = cs / 2 + (y & 7) - 4;
+          z = cs / 2 + (z & 7) - 4;
+        }
+        chunk_set_voxel(&chunk, x, y, z, (seed >> 31) != 0u);
+      }
+      chunk_rebuild_incremental(&chunk);
+
+      uint32_t count = (uint32_t)chunk.nodes.length;
+      if (count > capacity) {
+        capacity = count + count / 2u;
+        mirror_nodes = (Node *)realloc(mirror_nodes, capacity * sizeof(Node));
+        mirror_children = (ChildIndex *)realloc(mirror_children, capacity * sizeof(ChildIndex));
+      }
+
+      uint32_t n = chunk_take_upload_ranges(&chunk, ranges);
+      for (uint32_t i = 0; i < n; i++) {
+        uint32_t len = ranges[i].end - ranges[i].begin;
+        memcpy(mirror_nodes + ranges[i].begin, (Node *)chunk.nodes.data + ranges[i].begin, len * sizeof(Node));
+        memcpy(mirror_children + ranges[i].begin, (ChildIndex *)chunk.child_indices.data + ranges[i].begin,
+               len * sizeof(ChildIndex));
+        ok = ok && (i == 0 || ranges[i - 1].end < ranges[i].begin);
+        sent += r > 0 ? len : 0;
+      }
+      full += r > 0 ? count : 0;
+
+      ok = ok && memcmp(mirror_nodes, chunk.nodes.data, count * sizeof(Node)) == 0 &&
+           memcmp(mirror_children, chunk.child_indices.data, count * sizeof(ChildIndex)) == 0;
+      // a clean chunk has nothing left to send
+      ok = ok && chunk_take_upload_ranges(&chunk, ranges) == 0;
+    }
+
+    // a node added at the front of the tree shifts nearly all the others: that goes as one whole-tree range, so
+    // structural edits near the root cost a full upload (only mask edits stay small)
+    if (ok) {
+      chunk_fill_box(&chunk, (VoxelCoord){0, 0, 0}, (VoxelCoord){cs / 4 - 1, cs / 4 - 1, cs / 4 - 1}, false);
+      chunk_rebuild_incremental(&chunk);
+      chunk_take_upload_ranges(&chunk, ranges);
+      chunk_set_voxel(&chunk, 0, 0, 0, true);
+      chunk_rebuild_incremental(&chunk);
+      uint32_t count = (uint32_t)chunk.nodes.length;
+      bool whole = chunk.upload_all;
+      uint32_t n = chunk_take_upload_ranges(&chunk, ranges);
+      ok = whole && n == 1u && ranges[0].begin == 0u && ranges[0].end == count;
+    }
+
+    free(mirror_nodes);
+    free(mirror_children);
+
+    if (ok)
+      LOG_INFO("PASSED (%.1f%% of the full-upload nodes sent)\n", 100.0 * (double)sent / (double)full);
+    else {
+      LOG_INFO("FAILED (mirror differs from the tree)\n");
+      chunk_destroy(&chunk);
+      return 1;
+    }
+  }
+
+  // Test 10: uniform chunks keep no storage; an edit materializes it, the rebuild that restores uniformity drops it
+  {
+    LOG_INFO("[Test 10] Uniform chunk elision... ");
+    int hi = (int)CHUNK_SIZE - 1;
+    ChunkPoolStats pool_before, pool_after;
+
+    chunk_clear(&chunk);
+    chunk_rebuild(&chunk);
+    chunk_pool_stats(&pool_before);
+    bool ok = chunk.fill == CHUNK_FILL_EMPTY && chunk_storage_bytes(&chunk) == 0 && chunk.nodes.length == 1u;
+
+    // solid without a single word: reads and the tree must match a rebuild from real all-ones words
+    chunk_fill_box(&chunk, (VoxelCoord){0, 0, 0}, (VoxelCoord){hi, hi, hi}, true);
+    ok = ok && chunk.fill == CHUNK_FILL_SOLID && chunk_storage_bytes(&chunk) == 0 &&
+         chunk_get_word(&chunk, WORDS_PER_CHUNK - 1ull) == ~0ull && chunk_get_voxel(&chunk, hi, 0, hi);
+    chunk_rebuild(&chunk);
+
+    ChunkTree *ref = (ChunkTree *)malloc(sizeof(ChunkTree));
+    chunk_init(ref);
+    for (uint64_t w = 0; w < WORDS_PER_CHUNK; w++)
+      chunk_set_word(ref, w, ~0ull);
+    ok = ok && ref->fill == CHUNK_FILL_MIXED;
+    chunk_rebuild(ref);
+    ok = ok && ref->fill == CHUNK_FILL_SOLID && chunk_trees_equal(&chunk, ref) && traverse_svo(&chunk, hi, hi, hi);
+
+    // one voxel off: the incremental patch of the uniform tree stays exact
+    chunk_set_voxel(&chunk, 1, 2, 3, false);
+    ok = ok && chunk.fill == CHUNK_FILL_MIXED && chunk_storage_bytes(&chunk) > 0 && !chunk_get_voxel(&chunk, 1, 2, 3) &&
+         chunk_get_voxel(&chunk, 0, 0, 0);
+    chunk_rebuild_incremental(&chunk);
+    ok = ok && chunk.fill == CHUNK_FILL_MIXED && !traverse_svo(&chunk, 1, 2, 3) && traverse_svo(&chunk, 3, 2, 1);
+
+    chunk_set_voxel(&chunk, 1, 2, 3, true);
+    chunk_rebuild_incremental(&chunk);
+    ok = ok && chunk.fill == CHUNK_FILL_SOLID && chunk_storage_bytes(&chunk) == 0 && chunk_trees_equal(&chunk, ref);
+
+    // a uniform stamp source makes the target uniform without touching words
+    chunk_stamp(ref, &chunk, CHUNK_STAMP_SUBTRACT);
+    chunk_rebuild(ref);
+    ok = ok && ref->fill == CHUNK_FILL_EMPTY && ref->nodes.length == 1u && !traverse_svo(ref, 0, 0, 0);
+
+    chunk_destroy(ref);
+    free(ref);
+    chunk_pool_stats(&pool_after);
+    ok = ok && pool_after.used == pool_before.used;
+
+    if (ok)
+      LOG_INFO("PASSED (pool: %u bitsets in use, %u allocated)\n", pool_after.used, pool_after.capacity);
+    else {
+      LOG_INFO("FAILED (uniform chunk storage or tree)\n");
+      chunk_destroy(&chunk);
+      return 1;
+    }
+  }
+
+  chunk_destroy(&chunk);
+  LOG_INFO("All chunk tests passed.\n");
+  return 0;
+}
+
+// -------------------- Benchmarks --------------------
+
+void chunk_bench(void) {
+  const uint32_t edit_counts[] = {1, 64, 4096};
+  const uint32_t iterations = 64;
+
+  ChunkTree *full = (ChunkTree *)malloc(sizeof(ChunkTree));
+  ChunkTree *inc = (ChunkTree *)malloc(sizeof(ChunkTree));
+
+  LOG_INFO("Chunk Bench: rebuild after scattered edits (CHUNK_SIZE=%u)\n", (unsigned)CHUNK_SIZE);
+
+  for (uint32_t e = 0; e < sizeof(edit_counts) / sizeof(edit_counts[0]); e++) {
+    chunk_init(full);
+    chunk_init(inc);
+
+    // terrain-like baseline: lower half solid plus sparse noise above
+    unsigned int seed = 4242u;
+    for (uint32_t i = 0; i < (uint32_t)WORDS_PER_CHUNK / 2u; i++)
+      chunk_set_word(full, i, ~0ull);
+    for (uint32_t i = 0; i < (uint32_t)VOXELS_PER_CHUNK / 64u; i++) {
+      seed = seed * 1103515245u + 12345u;
+      uint64_t w = seed % WORDS_PER_CHUNK;
+      chunk_set_word(full, w, chunk_get_word(full, w) | (1ull << (seed >> 26)));
+    }
+    copy_voxels(inc, full);
+    chunk_rebuild(full);
+    chunk_rebuild(inc);
+
+    uint64_t full_ns = 0, inc_ns = 0;
+    for (uint32_t it = 0; it < iterations; it++) {
+      for (uint32_t i = 0; i < edit_counts[e]; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int x = (int)((seed >> 16) & (CHUNK_SIZE - 1u));
+        int y = (int)((seed >> 8) & (CHUNK_SIZE - 1u));
+        int z = (int)((seed) & (CHUNK_SIZE - 1u));
+        bool v = (seed >> 31) != 0u;
+        chunk_set_voxel(full, x, y, z, v);
+        chunk_set_voxel(inc, x, y, z, v);
+      }
+
+      uint64_t t0 = time_now_ns();
+      chunk_rebuild(full);
+      uint64_t t1 = time_now_ns();
+      chunk_rebuild_incremental(inc);
+      uint64_t t2 = time_now_ns();
+
+      full_ns += t1 - t0;
+      inc_ns += t2 - t1;
+    }
+
+    LOG_INFO("  %5u edits: full %8.2f us  incremental %8.2f us  (%s)\n", edit_counts[e],
+             (double)full_ns / iterations / 1000.0, (double)inc_ns / iterations / 1000.0,
+             chunk_trees_equal(full, inc) ? "match" : "MISMATCH");
+    if (e == 0)
+      LOG_INFO("  storage: %zu bytes (%s) vs %llu bytes dense bitset\n", chunk_storage_bytes(full),
+               CHUNK_SPARSE_STORAGE ? "sparse" : "dense", (unsigned long long)BYTES_PER_CHUNK_BITSET);
+
+    chunk_destroy(full);
+    chunk_destroy(inc);
+  }
+
+  free(full);
+  free(inc);
+
+  // Parent reduction over a whole leaf level (capped at 2^18 words), scalar vs dispatched kernel.
+  const uint32_t word_count = WORDS_PER_CHUNK < (1ull << 18) ? (uint32_t)WORDS_PER_CHUNK : (1u << 18);
+  const uint32_t parent_count = word_count / 64u ? word_count / 64u : 1u;
+  LOG_INFO("Chunk Bench: parent mask reduction over %u words (%s)\n", word_count, simd_backend_name(simd_backend()));
+
+  uint64_t *words = (uint64_t *)calloc(parent_count * 64u, sizeof(uint64_t));
+  uint64_t *parents = (uint64_t *)malloc(parent_count * sizeof(uint64_t));
+  const uint32_t reps = 2000;
+  const char *names[] = {"dense", "sparse"};
+
+  for (uint32_t k = 0; k < 2u; k++) {
+    unsigned int seed = 31337u;
+    for (uint32_t i = 0; i < word_count; i++) {
+      seed = seed * 1103515245u + 12345u;
+      words[i] = k == 0 ? (seed | 1u) : ((seed >> 20) == 0u ? (1ull << (seed & 63u)) : 0ull);
+    }
+
+    uint64_t sink = 0;
+    uint64_t t0 = time_now_ns();
+    for (uint32_t r = 0; r < reps; r++) {
+      for (uint32_t p = 0; p < word_count / 64u; p++)
+        parents[p] = simd_nonzero_mask64_scalar(&words[p * 64u]);
+      sink += parents[r % parent_count];
+    }
+    uint64_t t1 = time_now_ns();
+    for (uint32_t r = 0; r < reps; r++) {
+      for (uint32_t p = 0; p < word_count / 64u; p++)
+        parents[p] = simd_nonzero_mask64(&words[p * 64u]);
+      sink += parents[r % parent_count];
+    }
+    uint64_t t2 = time_now_ns();
+
+    LOG_INFO("  %-6s: scalar %8.2f us  simd %8.2f us  speedup %.2fx (sink=%llu)\n", names[k],
+             (double)(t1 - t0) / reps / 1000.0, (double)(t2 - t1) / reps / 1000.0,
+             (double)(t1 - t0) / (double)(t2 - t1 ? t2 - t1 : 1), (unsigned long long)(sink & 1ull));
+  }
+
+  free(parents);
+  free(words);
+
+  // Sphere sculpt, bulk API vs per-voxel loop.
+  ChunkTree *edit = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(edit);
+
+  int radius = (int)CHUNK_SIZE * 3 / 8;
+  VoxelCoord center = {(int)CHUNK_SIZE / 2, (int)CHUNK_SIZE / 2, (int)CHUNK_SIZE / 2};
+  uint64_t voxels = 0;
+
+  uint64_t t0 = time_now_ns();
+  for (uint32_t r = 0; r < 16u; r++) {
+    for (int z = center.z - radius; z <= center.z + radius; z++)
+      for (int y = center.y - radius; y <= center.y + radius; y++)
+        for (int x = center.x - radius; x <= center.x + radius; x++) {
+          int dx = x - center.x, dy = y - center.y, dz = z - center.z;
+          if (dx * dx + dy * dy + dz * dz <= radius * radius) {
+            chunk_set_voxel(edit, x, y, z, (r & 1u) == 0u);
+            voxels++;
+          }
+        }
+  }
+  uint64_t t1 = time_now_ns();
+  for (uint32_t r = 0; r < 16u; r++)
+    chunk_fill_sphere(edit, center, radius, (r & 1u) == 0u);
+  uint64_t t2 = time_now_ns();
+
+  LOG_INFO("Chunk Bench: sphere r=%d (%llu voxels): per-voxel %.1f Mvox/s  bulk %.1f Mvox/s\n", radius,
+           (unsigned long long)(voxels / 16u), (double)voxels / ((double)(t1 - t0) / 1e9) / 1e6,
+           (double)voxels / ((double)(t2 - t1 ? t2 - t1 : 1) / 1e9) / 1e6);
+
+  chunk_destroy(edit);
+  free(edit);
+}
+// --- Private Functions ---
+
+// -------------------- Morton encoding --------------------
+// Interleaves bits as: x at bit 0, y at bit 1, z at bit 2, repeating (see morton.h).
+// With CHUNK_SIZE=2^(2L), we need BITS_PER_AXIS = 2L bits per axis.
+static inline uint64_t morton_encode(int x, int y, int z) {
+  // We assume inputs are already clamped to [0..CHUNK_SIZE-1]; the inline cascade, no backend dispatch per voxel
+  return morton_encode3((uint32_t)x, (uint32_t)y, (uint32_t)z);
+}
+
+// -------------------- Internal traversal for tests --------------------
+static bool traverse_svo(const ChunkTree *chunk, int x, int y, int z) {
+  if (chunk->nodes.length == 0)
+    return false;
+
+  uint64_t code = morton_encode(x, y, z);
+  uint32_t node_index = 0;
+
+  // Traverse from root (TREE_LEVELS-1) down to 0, in whatever layout CHUNK_NODE_LAYOUT selects
+  for (int d = (int)TREE_LEVELS - 1; d >= 0; d--) {
+    uint64_t mask = CHUNK_NODE_MASK(chunk, node_index);
+
+    uint32_t slot = CHILD_SLOT(code, (uint32_t)d);
+    uint64_t bit = 1ull << slot;
+
+    if ((mask & bit) == 0ull)
+      return false;
+
+    if (d == 0)
+      return true; // leaf bit is the voxel
+
+    uint64_t prefix = mask & (bit - 1ull);
+    uint32_t offset = (uint32_t)__builtin_popcountll(prefix);
+
+    node_index = CHUNK_NODE_FIRST_CHILD(chunk, node_index) + offset;
+  }
+
+  return false;
+}
+
+static inline bool in_bounds(int v) { return (v >= 0) && (v < (int)CHUNK_SIZE); }
+
+// -------------------- Voxel storage --------------------
+// Leaf words of the page holding word w (dense: a window into bits[]). NULL for an unallocated page unless create.
+// Pages still shared with a snapshot are read from its frozen storage; store_word copies them over first.
+static uint64_t *page_words(const ChunkTree *chunk, uint64_t w, bool create) {
+  uint32_t key = (uint32_t)(w / CHUNK_PAGE_WORDS);
+  const ChunkTree *owner = chunk->snapshot && page_shared(chunk, key) ? &chunk->snapshot->tree : chunk;
+#if CHUNK_SPARSE_STORAGE
+  ChunkPageTable *t = (ChunkPageTable *)&owner->pages;
+  return create ? chunk_pages_get_or_create(t, key) : chunk_pages_find(t, key);
+#else
+  (void)create;
+  return (uint64_t *)&owner->bits[w & ~(uint64_t)(CHUNK_PAGE_WORDS - 1u)];
+#endif
+}
+
+static inline uint64_t load_word(const ChunkTree *chunk, uint64_t w) {
+  if (chunk->fill != CHUNK_FILL_MIXED)
+    return chunk->fill == CHUNK_FILL_SOLID ? ~0ull : 0ull;
+  const uint64_t *words = page_words(chunk, w, false);
+  return words ? words[w % CHUNK_PAGE_WORDS] : 0ull;
+}
+
+// Clearing never allocates a page; emptied pages are released by the next rebuild.
+// Callers only store changed words, so a uniform chunk always needs its storage here.
+static inline void store_word(ChunkTree *chunk, uint64_t w, uint64_t value) {
+  if (chunk->fill != CHUNK_FILL_MIXED)
+    chunk_materialize(chunk);
+  if (chunk->snapshot)
+    own_page(chunk, (uint32_t)(w / CHUNK_PAGE_WORDS));
+  uint64_t *words = page_words(chunk, w, value != 0ull);
+  if (words)
+    words[w % CHUNK_PAGE_WORDS] = value;
+}
+
+static void drop_storage(ChunkTree *chunk, ChunkFill fill) {
+  // none of the frozen pages are wanted any more
+  if (chunk->snapshot)
+    memset(chunk->snapshot->shared_pages, 0, sizeof(chunk->snapshot->shared_pages));
+#if CHUNK_SPARSE_STORAGE
+  if (chunk->pages.count > 0)
+    chunk_pages_clear(&chunk->pages);
+#else
+  chunk_pool_release(chunk->bits);
+  chunk->bits = NULL;
+#endif
+#if CHUNK_DISTANCE_FIELD
+  // a uniform chunk has nothing to skip around; the next mixed rebuild starts the field over
+  free(chunk->distance);
+  chunk->distance = NULL;
+#endif
+  chunk->fill = fill;
+  // the writers' pages are gone, and they cannot allocate a uniform chunk's storage themselves
+  if (chunk->concurrent)
+    chunk_concurrent_begin(chunk);
+}
+
+static inline bool page_shared(const ChunkTree *chunk, uint32_t p) {
+  return (chunk->snapshot->shared_pages[p >> 6] >> (p & 63u)) & 1ull;
+}
+
+// Copies a page still shared with the snapshot into the chunk's own storage (a missing sparse page stays missing).
+static void own_page(ChunkTree *chunk, uint32_t p) {
+  if (!page_shared(chunk, p))
+    return;
+  chunk->snapshot->shared_pages[p >> 6] &= ~(1ull << (p & 63u));
+  const ChunkTree *frozen = &chunk->snapshot->tree;
+#if CHUNK_SPARSE_STORAGE
+  const uint64_t *words = chunk_pages_find(&frozen->pages, p);
+  if (words)
+    memcpy(chunk_pages_get_or_create(&chunk->pages, p), words, sizeof(ChunkPage));
+#else
+  uint64_t first = (uint64_t)p * CHUNK_PAGE_WORDS;
+  memcpy(&chunk->bits[first], &frozen->bits[first], CHUNK_PAGE_WORDS * sizeof(uint64_t));
+#endif
+}
+
+// For the walks that read the storage directly. The voxels stay as they are, hence the const.
+static void unshare(const ChunkTree *chunk) {
+  if (!chunk->snapshot)
+    return;
+  for (uint32_t p = 0; p < PAGES_PER_CHUNK; p++)
+    own_page((ChunkTree *)chunk, p);
+}
+
+static uint64_t count_voxels(const ChunkTree *chunk) {
+  if (chunk->fill != CHUNK_FILL_MIXED)
+    return chunk->fill == CHUNK_FILL_SOLID ? VOXELS_PER_CHUNK : 0ull;
+
+  unshare(chunk);
+  uint64_t count = 0;
+#if CHUNK_SPARSE_STORAGE
+  const ChunkPageTable *t = &chunk->pages;
+  for (uint32_t i = 0; i < t->capacity; i++) {
+    if (t->keys[i] == CHUNK_PAGE_EMPTY)
+      continue;
+    const uint64_t *words = chunk_pages_at(t, t->values[i])->words;
+    for (uint32_t k = 0; k < CHUNK_PAGE_WORDS; k++)
+      count += (uint64_t)__builtin_popcountll(words[k]);
+  }
+#else
+  for (uint64_t w = 0; w < WORDS_PER_CHUNK; w++)
+    count += (uint64_t)__builtin_popcountll(chunk->bits[w]);
+#endif
+  return count;
+}
+
+static uint32_t stamp_word(ChunkTree *chunk, uint64_t w, uint64_t src, ChunkStampOp op) {
+  uint64_t before = load_word(chunk, w);
+  uint64_t after = before;
+
+  switch (op) {
+  case CHUNK_STAMP_UNION:
+    after = before | src;
+    break;
+  case CHUNK_STAMP_SUBTRACT:
+    after = before & ~src;
+    break;
+  case CHUNK_STAMP_INTERSECT:
+    after = before & src;
+    break;
+  case CHUNK_STAMP_REPLACE:
+    after = src;
+    break;
+  }
+
+  if (before == after)
+    return 0;
+
+  store_word(chunk, w, after);
+  mark_word_dirty(chunk, (uint32_t)w);
+  return (uint32_t)__builtin_popcountll(before ^ after);
+}
+
+static void copy_voxels(ChunkTree *dst, const ChunkTree *src) {
+  chunk_clear(dst);
+  chunk_stamp(dst, src, CHUNK_STAMP_UNION);
+}
+
+static bool voxels_equal(const ChunkTree *a, const ChunkTree *b) {
+  if (a->fill != CHUNK_FILL_MIXED || b->fill != CHUNK_FILL_MIXED) {
+    if (a->fill == b->fill)
+      return true;
+    for (uint64_t w = 0; w < WORDS_PER_CHUNK; w++) {
+      if (load_word(a, w) != load_word(b, w))
+        return false;
+    }
+    return true;
+  }
+  unshare(a);
+  unshare(b);
+
+#if CHUNK_SPARSE_STORAGE
+  // every allocated page on either side must match the other side (missing pages read as zero)
+  for (uint32_t pass = 0; pass < 2u; pass++) {
+    const ChunkTree *x = pass ? b : a;
+    const ChunkTree *y = pass ? a : b;
+    for (uint32_t i = 0; i < x->pages.capacity; i++) {
+      uint32_t key = x->pages.keys[i];
+      if (key == CHUNK_PAGE_EMPTY)
+        continue;
+      const uint64_t *words = chunk_pages_at(&x->pages, x->pages.values[i])->words;
+      for (uint32_t k = 0; k < CHUNK_PAGE_WORDS; k++) {
+        if (words[k] != load_word(y, (uint64_t)key * CHUNK_PAGE_WORDS + k))
+          return false;
+      }
+    }
+  }
+  return true;
+#else
+  return memcmp(a->bits, b->bits, BYTES_PER_CHUNK_BITSET) == 0;
+#endif
+}
+
+// -------------------- Bulk edits --------------------
+// Writes one leaf word; returns the number of voxels that actually changed.
+static uint32_t apply_word(ChunkTree *chunk, uint64_t w, uint64_t mask, bool set_active) {
+  uint64_t before = load_word(chunk, w);
+  uint64_t after = set_active ? (before | mask) : (before & ~mask);
+
+  if (before == after)
+    return 0;
+
+  store_word(chunk, w, after);
+  mark_word_dirty(chunk, (uint32_t)w);
+  return (uint32_t)__builtin_popcountll(before ^ after);
+}
+
+static void finish_batch(ChunkTree *chunk, uint32_t changed) {
+  if (changed == 0)
+    return;
+  chunk->is_dirty = true;
+  chunk->pending_edits += changed;
+}
+
+// Voxels of a leaf word whose local coordinate on `axis` lies in [lo, hi] (clamped to 0..3).
+static uint64_t span_mask(uint32_t axis, int lo, int hi) {
+  if (lo < 0)
+    lo = 0;
+  if (hi > 3)
+    hi = 3;
+
+  uint64_t mask = 0;
+  for (int v = lo; v <= hi; v++)
+    mask |= SPAN_VALUE_MASK[axis][v];
+  return mask;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// -------------------- Rebuild --------------------
+static pthread_key_t scratch_key;
+static pthread_once_t scratch_key_once = PTHREAD_ONCE_INIT;
+
+static ChunkScratch *thread_scratch(void) {
+  // one arena per thread, allocated on first use, reused for every rebuild after that and freed when the thread exits
+  pthread_once(&scratch_key_once, thread_scratch_key_create);
+  ChunkScratch *scratch = (ChunkScratch *)pthread_getspecific(scratch_key);
+  if (!scratch) {
+    scratch = chunk_scratch_create();
+    pthread_setspecific(scratch_key, scratch);
+  }
+  return scratch;
+}
+
+static void thread_scratch_key_create(void) { pthread_key_create(&scratch_key, thread_scratch_free); }
+
+static void thread_scratch_free(void *scratch) { chunk_scratch_destroy((ChunkScratch *)scratch); }
+
+#if CHUNK_SPARSE_STORAGE
+static void rebuild_full(ChunkTree *chunk, ChunkScratch *scratch) {
+  // Same BFS layout as the dense path, but the pyramid only holds non-empty nodes:
+  // level 1 is one node per page, every level above groups its children by index >> 6.
+  ChunkPageTable *t = &chunk->pages;
+  Vector *levels = scratch->level_nodes;
+  uint32_t level_count = (uint32_t)TREE_LEVELS;
+
+  vec_reserve(&levels[1], t->count);
+  SparseNode *pages = (SparseNode *)levels[1].data;
+  uint32_t page_count = 0;
+
+  for (uint32_t i = 0; i < t->capacity; i++) {
+    if (t->keys[i] == CHUNK_PAGE_EMPTY)
+      continue;
+    const uint64_t *words = chunk_pages_at(t, t->values[i])->words;
+    pages[page_count++] = (SparseNode){.index = t->keys[i], .mask = simd_nonzero_mask64(words), .words = words};
+  }
+
+  // pages emptied by edits are released after the walk; page memory itself never moves on release
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < page_count; i++) {
+    if (pages[i].mask != 0ull)
+      pages[kept++] = pages[i];
+    else if (!chunk->frozen)
+      chunk_pages_release(t, pages[i].index);
+  }
+  levels[1].length = kept;
+  qsort(pages, kept, sizeof(SparseNode), cmp_sparse_node);
+
+  // sorted children produce sorted parents
+  for (uint32_t d = 2; d < level_count; d++) {
+    vec_reserve(&levels[d], levels[d - 1].length);
+    const SparseNode *child = (const SparseNode *)levels[d - 1].data;
+    SparseNode *parent = (SparseNode *)levels[d].data;
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < levels[d - 1].length; i++) {
+      uint32_t index = child[i].index >> 6;
+      if (n == 0 || parent[n - 1].index != index)
+        parent[n++] = (SparseNode){.index = index, .mask = 0ull, .words = NULL};
+      parent[n - 1].mask |= 1ull << (child[i].index & 63u);
+    }
+    levels[d].length = n;
+  }
+
+  uint32_t level_start[TREE_LEVELS] = {0};
+  uint32_t active_count[TREE_LEVELS] = {0};
+  uint32_t total_active = 0;
+
+  for (int d = (int)level_count - 1; d >= 0; d--) {
+    level_start[d] = total_active;
+
+    // always keep root as node 0
+    uint32_t count = 1;
+    if (d + 1 < (int)level_count) {
+      count = 0;
+      const SparseNode *parent = (const SparseNode *)levels[d + 1].data;
+      for (uint32_t i = 0; i < levels[d + 1].length; i++)
+        count += (uint32_t)__builtin_popcountll(parent[i].mask);
+    }
+
+    active_count[d] = count;
+    total_active += count;
+  }
+
+  vec_reserve(&chunk->nodes, total_active);
+  vec_reserve(&chunk->child_indices, total_active);
+
+  Node *node_arr = (Node *)chunk->nodes.data;
+  ChildIndex *child_arr = (ChildIndex *)chunk->child_indices.data;
+  uint32_t out = 0;
+
+  if (levels[level_count - 1].length == 0) {
+    node_arr[out] = (Node){.mask = 0ull};
+    child_arr[out] = (ChildIndex){.first_child_index = 0};
+    out++;
+  }
+
+  for (int d = (int)level_count - 1; d >= 1; d--) {
+    uint32_t next_level_ptr = level_start[d - 1];
+    const SparseNode *level = (const SparseNode *)levels[d].data;
+
+    for (uint32_t i = 0; i < levels[d].length; i++) {
+      node_arr[out] = (Node){.mask = level[i].mask};
+      child_arr[out] = (ChildIndex){.first_child_index = next_level_ptr};
+      out++;
+      next_level_ptr += (uint32_t)__builtin_popcountll(level[i].mask);
+    }
+  }
+
+  // leaves come straight from the pages, in page order then slot order
+  for (uint32_t i = 0; i < kept; i++) {
+    for (uint64_t m = pages[i].mask; m != 0ull; m &= m - 1ull) {
+      node_arr[out] = (Node){.mask = pages[i].words[__builtin_ctzll(m)]};
+      child_arr[out] = (ChildIndex){.first_child_index = 0};
+      out++;
+    }
+  }
+
+  chunk->nodes.length = out;
+  chunk->child_indices.length = out;
+
+  for (uint32_t d = 0; d < level_count; d++) {
+    chunk->level_start[d] = level_start[d];
+    chunk->level_count[d] = active_count[d];
+  }
+
+  clear_dirty_words(chunk);
+  chunk->is_dirty = false;
+  chunk->need_upload = true;
+  chunk->upload_all = true;
+}
+
+static int cmp_sparse_node(const void *a, const void *b) {
+  uint32_t x = ((const SparseNode *)a)->index;
+  uint32_t y = ((const SparseNode *)b)->index;
+  return (x > y) - (x < y);
+}
+#else
+static void rebuild_full(ChunkTree *chunk, ChunkScratch *scratch) {
+  // Level 0: WORDS_PER_CHUNK leaf masks (each is exactly chunk->bits[i])
+  // Level 1: WORDS_PER_CHUNK/64 parent masks
+  // ...
+  // Level (TREE_LEVELS-1): root mask count = 1
+  //
+  // We build a bottom-up dense mask pyramid, then flatten sparsely in BFS order.
+
+  uint32_t level_count = (uint32_t)TREE_LEVELS;
+
+  uint64_t *level_masks[TREE_LEVELS];
+  uint32_t level_node_count[TREE_LEVELS];
+
+  // leaves are read straight from bits, parent levels are carved out of the scratch arena
+  uint64_t *parent_masks = scratch->parent_masks;
+  uint64_t current = (uint64_t)WORDS_PER_CHUNK; // leaf "node" count
+  for (uint32_t d = 0; d < level_count; d++) {
+    level_node_count[d] = (uint32_t)current;
+    if (d == 0) {
+      level_masks[d] = chunk->bits;
+    } else {
+      level_masks[d] = parent_masks;
+      parent_masks += current;
+    }
+
+    // next parent level groups 64 children into 1 parent
+    current = (current + 63ull) / 64ull; // ceil divide to be safe
+    if (current == 0)
+      current = 1;
+  }
+
+  // build parents: bit c set if child mask non-zero (vectorized 64 children at a time)
+  for (uint32_t d = 1; d < level_count; d++) {
+    uint32_t child_count = level_node_count[d - 1];
+    uint32_t parent_count = level_node_count[d];
+
+    for (uint32_t p = 0; p < parent_count; p++) {
+      uint32_t base = p * 64u;
+
+      if (base + 64u <= child_count) {
+        level_masks[d][p] = simd_nonzero_mask64(&level_masks[d - 1][base]);
+        continue;
+      }
+
+      uint64_t mask = 0;
+      for (uint32_t c = 0; c < child_count - base; c++) {
+        if (level_masks[d - 1][base + c] != 0ull) {
+          mask |= (1ull << c);
+        }
+      }
+      level_masks[d][p] = mask;
+    }
+  }
+
+  // flatten BFS from top level down
+  uint32_t level_start[TREE_LEVELS] = {0};
+  uint32_t active_count[TREE_LEVELS] = {0};
+
+  uint32_t total_active = 0;
+  for (int d = (int)level_count - 1; d >= 0; d--) {
+    level_start[d] = total_active;
+
+    // every set bit in a parent mask is exactly one non-empty child
+    uint32_t count = 0;
+    if (d + 1 < (int)level_count) {
+      for (uint32_t p = 0; p < level_node_count[d + 1]; p++)
+        count += (uint32_t)__builtin_popcountll(level_masks[d + 1][p]);
+    }
+
+    // always keep root as node 0
+    if (d == (int)level_count - 1)
+      count = 1;
+
+    active_count[d] = count;
+    total_active += count;
+  }
+
+  // capacities only ever grow, so steady-state rebuilds do not touch the allocator
+  vec_reserve(&chunk->nodes, total_active);
+  vec_reserve(&chunk->child_indices, total_active);
+
+  Node *node_arr = (Node *)chunk->nodes.data;
+  ChildIndex *child_arr = (ChildIndex *)chunk->child_indices.data;
+  uint32_t out = 0;
+
+  for (int d = (int)level_count - 1; d >= 0; d--) {
+    uint32_t next_level_ptr = (d > 0) ? level_start[d - 1] : 0;
+    bool root_forced = (d == (int)level_count - 1);
+
+    for (uint32_t i = 0; i < level_node_count[d]; i++) {
+      uint64_t mask = level_masks[d][i];
+
+      if (mask == 0ull && !root_forced)
+        continue;
+
+      node_arr[out] = (Node){.mask = mask};
+      child_arr[out] = (ChildIndex){.first_child_index = (d > 0 && mask != 0ull) ? next_level_ptr : 0};
+      out++;
+
+      if (d > 0) {
+        next_level_ptr += (uint32_t)__builtin_popcountll(mask);
+      }
+
+      if (root_forced) {
+        // if we forced an empty root, only emit one node
+        if (mask == 0ull)
+          break;
+        root_forced = false;
+      }
+    }
+  }
+
+  chunk->nodes.length = out;
+  chunk->child_indices.length = out;
+
+  for (uint32_t d = 0; d < level_count; d++) {
+    chunk->level_start[d] = level_start[d];
+    chunk->level_count[d] = active_count[d];
+  }
+
+  clear_dirty_words(chunk);
+  chunk->is_dirty = false;
+  chunk->need_upload = true;
+  chunk->upload_all = true;
+}
+#endif
+
+// A uniform chunk has no words to scan. Empty: the root alone. Solid: every node of every level, all full,
+// children in index order (the same layout rebuild_full produces from an all-ones bitset).
+static void rebuild_uniform(ChunkTree *chunk) {
+  bool solid = chunk->fill == CHUNK_FILL_SOLID;
+  uint32_t level_count = (uint32_t)TREE_LEVELS;
+  uint32_t total = 0;
+
+  for (int d = (int)level_count - 1; d >= 0; d--) {
+    chunk->level_start[d] = total;
+    chunk->level_count[d] = solid ? (uint32_t)(WORDS_PER_CHUNK >> LEVEL_SHIFT(d)) : (d == (int)level_count - 1);
+    total += chunk->level_count[d];
+  }
+
+  vec_reserve(&chunk->nodes, total);
+  vec_reserve(&chunk->child_indices, total);
+  Node *node_arr = (Node *)chunk->nodes.data;
+  ChildIndex *child_arr = (ChildIndex *)chunk->child_indices.data;
+
+  for (uint32_t d = 0; d < level_count; d++) {
+    uint32_t start = chunk->level_start[d];
+    uint32_t first_child = d > 0 ? chunk->level_start[d - 1] : 0;
+    for (uint32_t i = 0; i < chunk->level_count[d]; i++) {
+      node_arr[start + i] = (Node){.mask = solid ? ~0ull : 0ull};
+      child_arr[start + i] = (ChildIndex){.first_child_index = (d > 0 && solid) ? first_child + i * 64u : 0};
+    }
+  }
+
+  chunk->nodes.length = total;
+  chunk->child_indices.length = total;
+
+  clear_dirty_words(chunk);
+  chunk->is_dirty = false;
+  chunk->need_upload = true;
+  chunk->upload_all = true;
+}
+
+// CHUNK_BUILD_GPU: drops the CPU tree (and its LODs) and leaves the build to chunk_gpu_build.
+static void rebuild_deferred(ChunkTree *chunk) {
+  chunk->nodes.length = 0;
+  chunk->child_indices.length = 0;
+  memset(chunk->level_start, 0, sizeof(chunk->level_start));
+  memset(chunk->level_count, 0, sizeof(chunk->level_count));
+  chunk_build_lods(chunk);
+  chunk_build_layout(chunk);
+
+  clear_dirty_words(chunk);
+  chunk->is_dirty = false;
+  chunk->need_upload = true;
+  chunk->upload_all = true;
+}
+
+// Patches nodes/child_indices for the dirty leaf words. Returns false if a full rebuild is needed instead.
+static bool rebuild_incremental(ChunkTree *chunk) {
+  // nothing to patch yet, or too many edits to track
+  if (chunk->nodes.length == 0 || chunk->dirty_overflow)
+    return false;
+
+  qsort(chunk->dirty_words, chunk->dirty_word_count, sizeof(uint32_t), cmp_u32);
+
+  // Per level: the dense nodes whose mask changed. Level 0 holds every dirty leaf word,
+  // level d+1 holds the parents of nodes at level d that appeared or disappeared ("flips").
+  // Only flips change parent masks, so the list shrinks (or stays) going up.
+  LevelEdit edits[TREE_LEVELS][CHUNK_MAX_DIRTY_WORDS];
+  uint32_t edit_count[TREE_LEVELS] = {0};
+  uint32_t flips = 0;
+
+  for (uint32_t i = 0; i < chunk->dirty_word_count; i++) {
+    uint32_t w = chunk->dirty_words[i];
+    if (i > 0 && w == chunk->dirty_words[i - 1])
+      continue;
+
+    uint32_t pos;
+    LevelEdit *e = &edits[0][edit_count[0]++];
+    e->index = w;
+    e->mask = load_word(chunk, w);
+    e->was_present = find_node(chunk, 0, w, &pos);
+  }
+
+  for (uint32_t d = 0; d + 1 < (uint32_t)TREE_LEVELS; d++) {
+    for (uint32_t i = 0; i < edit_count[d]; i++) {
+      LevelEdit *e = &edits[d][i];
+      if ((e->mask != 0ull) == e->was_present)
+        continue;
+
+      if (++flips > CHUNK_INCREMENTAL_MAX_FLIPS)
+        return false;
+
+      uint32_t parent = e->index >> 6;
+      uint64_t bit = 1ull << (e->index & 63u);
+
+      LevelEdit *p = NULL;
+      for (uint32_t j = 0; j < edit_count[d + 1]; j++) {
+        if (edits[d + 1][j].index == parent) {
+          p = &edits[d + 1][j];
+          break;
+        }
+      }
+
+      if (!p) {
+        uint32_t pos;
+        p = &edits[d + 1][edit_count[d + 1]++];
+        p->index = parent;
+        p->was_present = find_node(chunk, d + 1, parent, &pos);
+        p->mask = p->was_present ? ((const Node *)chunk->nodes.data)[pos].mask : 0ull;
+      }
+
+      p->mask ^= bit;
+    }
+  }
+
+  // Removals bottom-up: children are gone before their parent is removed.
+  for (uint32_t d = 0; d + 1 < (uint32_t)TREE_LEVELS; d++) {
+    for (uint32_t i = 0; i < edit_count[d]; i++) {
+      if (edits[d][i].was_present && edits[d][i].mask == 0ull)
+        remove_node(chunk, d, edits[d][i].index);
+    }
+  }
+
+#if CHUNK_SPARSE_STORAGE
+  // an emptied level-1 node is an all-zero page (the root included at TREE_LEVELS=2)
+  for (uint32_t i = 0; i < edit_count[1]; i++) {
+    if (edits[1][i].mask == 0ull && !chunk->frozen)
+      chunk_pages_release(&chunk->pages, edits[1][i].index);
+  }
+#endif
+
+  // Insertions top-down: parents exist (empty) before their children are linked in.
+  for (int d = (int)TREE_LEVELS - 2; d >= 0; d--) {
+    for (uint32_t i = 0; i < edit_count[d]; i++) {
+      if (!edits[d][i].was_present && edits[d][i].mask != 0ull)
+        insert_node(chunk, (uint32_t)d, edits[d][i].index, d == 0 ? edits[d][i].mask : 0ull);
+    }
+  }
+
+  // Leaves that stayed non-empty only need their mask rewritten.
+  Node *node_arr = (Node *)chunk->nodes.data;
+  for (uint32_t i = 0; i < edit_count[0]; i++) {
+    uint32_t pos;
+    if (edits[0][i].was_present && edits[0][i].mask != 0ull && find_node(chunk, 0, edits[0][i].index, &pos)) {
+      node_arr[pos].mask = edits[0][i].mask;
+      mark_nodes_changed(chunk, pos, pos + 1u);
+    }
+  }
+
+  clear_dirty_words(chunk);
+  chunk->is_dirty = false;
+  chunk->need_upload = true;
+  return true;
+}
+
+// -------------------- Incremental rebuild --------------------
+static void mark_word_dirty(ChunkTree *chunk, uint32_t w) {
+  if (chunk->dirty_overflow)
+    return;
+
+  // cheap dedupe for runs of edits inside one 4x4x4 brick
+  if (chunk->dirty_word_count > 0 && chunk->dirty_words[chunk->dirty_word_count - 1] == w)
+    return;
+
+  if (chunk->dirty_word_count == CHUNK_MAX_DIRTY_WORDS) {
+    chunk->dirty_overflow = true;
+    return;
+  }
+
+  chunk->dirty_words[chunk->dirty_word_count++] = w;
+}
+
+static void clear_dirty_words(ChunkTree *chunk) {
+  chunk->dirty_word_count = 0;
+  chunk->dirty_overflow = false;
+}
+
+// Records [begin, end) for the next upload. Ranges within CHUNK_UPLOAD_MERGE_GAP nodes of each other are merged,
+// and when the list is full the two closest ranges are, so the list stays sorted and bounded.
+static void mark_nodes_changed(ChunkTree *chunk, uint32_t begin, uint32_t end) {
+  if (chunk->upload_all || begin >= end)
+    return;
+
+  ChunkNodeRange *r = chunk->upload_ranges;
+  uint32_t n = chunk->upload_range_count;
+
+  uint32_t i = 0;
+  while (i < n && r[i].end + CHUNK_UPLOAD_MERGE_GAP < begin)
+    i++;
+
+  uint32_t j = i;
+  while (j < n && r[j].begin <= end + CHUNK_UPLOAD_MERGE_GAP) {
+    begin = r[j].begin < begin ? r[j].begin : begin;
+    end = r[j].end > end ? r[j].end : end;
+    j++;
+  }
+
+  if (j > i) {
+    r[i] = (ChunkNodeRange){begin, end};
+    memmove(&r[i + 1], &r[j], (n - j) * sizeof(ChunkNodeRange));
+    chunk->upload_range_count = n - (j - i - 1u);
+    return;
+  }
+
+  if (n == CHUNK_MAX_UPLOAD_RANGES) {
+    uint32_t best = 0;
+    for (uint32_t k = 1; k + 1 < n; k++) {
+      if (r[k + 1].begin - r[k].end < r[best + 1].begin - r[best].end)
+        best = k;
+    }
+    r[best].end = r[best + 1].end;
+    memmove(&r[best + 1], &r[best + 2], (n - best - 2u) * sizeof(ChunkNodeRange));
+    chunk->upload_range_count = n - 1u;
+    mark_nodes_changed(chunk, begin, end);
+    return;
+  }
+
+  memmove(&r[i + 1], &r[i], (n - i) * sizeof(ChunkNodeRange));
+  r[i] = (ChunkNodeRange){begin, end};
+  chunk->upload_range_count = n + 1u;
+}
+
+// Nodes [pos, end) moved after an insert or remove. A tail that is most of the tree goes as a full upload.
+static void mark_tail_changed(ChunkTree *chunk, uint32_t pos) {
+  uint32_t count = (uint32_t)chunk->nodes.length;
+  if ((uint64_t)(count - pos) * CHUNK_UPLOAD_TAIL_DIVISOR > count) {
+    chunk->upload_all = true;
+    chunk->upload_range_count = 0;
+    return;
+  }
+  mark_nodes_changed(chunk, pos, count);
+}
+
+static int cmp_u32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Walk from the root to the dense node `index` at level d. Returns false if any ancestor lacks it.
+static bool find_node(const ChunkTree *chunk, uint32_t d, uint32_t index, uint32_t *out_pos) {
+  const Node *node_arr = (const Node *)chunk->nodes.data;
+  const ChildIndex *child_arr = (const ChildIndex *)chunk->child_indices.data;
+
+  uint32_t pos = 0;
+  for (uint32_t k = (uint32_t)TREE_LEVELS - 1; k > d; k--) {
+    uint64_t bit = 1ull << ((index >> LEVEL_SHIFT(k - 1 - d)) & 63u);
+    uint64_t mask = node_arr[pos].mask;
+
+    if ((mask & bit) == 0ull)
+      return false;
+
+    pos = child_arr[pos].first_child_index + (uint32_t)__builtin_popcountll(mask & (bit - 1ull));
+  }
+
+  *out_pos = pos;
+  return true;
+}
+
+// Link a new node into the compact arrays. Inner nodes are inserted empty; their children set the bits.
+static void insert_node(ChunkTree *chunk, uint32_t d, uint32_t index, uint64_t mask) {
+  uint32_t parent_pos = 0;
+  find_node(chunk, d + 1, index >> 6, &parent_pos);
+
+  Node *node_arr = (Node *)chunk->nodes.data;
+  ChildIndex *child_arr = (ChildIndex *)chunk->child_indices.data;
+
+  uint64_t bit = 1ull << (index & 63u);
+  uint64_t parent_mask = node_arr[parent_pos].mask;
+
+  uint32_t pos;
+  if (parent_mask != 0ull) {
+    pos = child_arr[parent_pos].first_child_index + (uint32_t)__builtin_popcountll(parent_mask & (bit - 1ull));
+  } else {
+    // parent has no children yet: slot in front of the next sibling's children
+    pos = chunk->level_start[d] + chunk->level_count[d];
+    uint32_t parent_end = chunk->level_start[d + 1] + chunk->level_count[d + 1];
+    for (uint32_t i = parent_pos + 1; i < parent_end; i++) {
+      if (node_arr[i].mask != 0ull) {
+        pos = child_arr[i].first_child_index;
+        break;
+      }
+    }
+  }
+
+  // every child pointer at or past the gap moves one slot down
+  for (uint32_t i = 0; i < chunk->level_start[0]; i++) {
+    if (i != parent_pos && node_arr[i].mask != 0ull && child_arr[i].first_child_index >= pos) {
+      child_arr[i].first_child_index++;
+      mark_nodes_changed(chunk, i, i + 1u);
+    }
+  }
+
+  Node n = {.mask = mask};
+  ChildIndex c = {.first_child_index = 0};
+  vec_insert_at(&chunk->nodes, pos, &n);
+  vec_insert_at(&chunk->child_indices, pos, &c);
+
+  node_arr = (Node *)chunk->nodes.data;
+  child_arr = (ChildIndex *)chunk->child_indices.data;
+
+  if (parent_mask == 0ull)
+    child_arr[parent_pos].first_child_index = pos;
+  node_arr[parent_pos].mask = parent_mask | bit;
+
+  // everything from the gap on moved; the parent sits before it
+  mark_nodes_changed(chunk, parent_pos, parent_pos + 1u);
+  mark_tail_changed(chunk, pos);
+
+  chunk->level_count[d]++;
+  for (uint32_t k = 0; k < d; k++)
+    chunk->level_start[k]++;
+}
+
+// Unlink an empty node (leaf or inner node whose children were already removed).
+static void remove_node(ChunkTree *chunk, uint32_t d, uint32_t index) {
+  uint32_t parent_pos = 0;
+  uint32_t pos = 0;
+  find_node(chunk, d + 1, index >> 6, &parent_pos);
+  find_node(chunk, d, index, &pos);
+
+  Node *node_arr = (Node *)chunk->nodes.data;
+  ChildIndex *child_arr = (ChildIndex *)chunk->child_indices.data;
+
+  for (uint32_t i = 0; i < chunk->level_start[0]; i++) {
+    if (i != parent_pos && node_arr[i].mask != 0ull && child_arr[i].first_child_index > pos) {
+      child_arr[i].first_child_index--;
+      mark_nodes_changed(chunk, i, i + 1u);
+    }
+  }
+
+  vec_remove_at(&chunk->nodes, pos);
+  vec_remove_at(&chunk->child_indices, pos);
+
+  node_arr[parent_pos].mask &= ~(1ull << (index & 63u));
+  if (node_arr[parent_pos].mask == 0ull)
+    child_arr[parent_pos].first_child_index = 0;
+
+  mark_nodes_changed(chunk, parent_pos, parent_pos + 1u);
+  mark_tail_changed(chunk, pos);
+
+  chunk->level_count[d]--;
+  for (uint32_t k = 0; k < d; k++)
+    chunk->level_start[k]--;
+}
+
+static void *counting_alloc(size_t size, void *ctx) {
+  ((AllocCounter *)ctx)->allocs++;
+  return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t old_size, size_t new_size, void *ctx) {
+  (void)old_size;
+  ((AllocCounter *)ctx)->reallocs++;
+  return realloc(ptr, new_size);
+}
+
+static void counting_free(void *ptr, void *ctx) {
+  (void)ctx;
+  free(ptr);
+}
+
+static bool chunk_trees_equal(const ChunkTree *a, const ChunkTree *b) {
+  if (a->nodes.length != b->nodes.length || a->child_indices.length != b->child_indices.length)
+    return false;
+
+  return memcmp(a->nodes.data, b->nodes.data, a->nodes.length * sizeof(Node)) == 0 &&
+         memcmp(a->child_indices.data, b->child_indices.data, a->child_indices.length * sizeof(ChildIndex)) == 0;
+}
@@ -18,9 +18,12 @@
   - chunk size per axis = 4^L = 2^(2L)
 
   Change TREE_LEVELS to scale the chunk resolution.
-  NOTE: Dense bitset storage becomes huge at TREE_LEVELS>=5.
+  NOTE: Dense bitset storage becomes huge at TREE_LEVELS>=5 (128 MiB per chunk),
+        so those sizes default to sparse paged storage (CHUNK_SPARSE_STORAGE).
 */
+#ifndef TREE_LEVELS
 #define TREE_LEVELS 3
+#endif
 
 #define BITS_PER_AXIS_PER_LEVEL 2
 #define AXIS_COUNT 3
@@ -43,9 +46,94 @@
 #define BITSET_BIT(morton) ((uint32_t)((morton) & 63ull))
 #define BIT_MASK_U64(bit) (1ull << ((bit) & 63u))
 
+/*
+  Voxel storage backend:
+  - 0: dense bitset of WORDS_PER_CHUNK words, taken from a shared pool (chunk_pool.c) while the chunk is mixed.
+  - 1: sparse pages of CHUNK_PAGE_WORDS leaf words (4x4x4 bricks of 4x4x4 voxels), allocated on first write
+       and keyed by the upper Morton bits (word >> 6). Memory tracks occupancy instead of volume.
+  Either way, all-empty and all-solid chunks keep no storage at all (ChunkFill): the first edit that breaks
+  the uniformity materializes it, a rebuild that finds the chunk uniform again drops it.
+*/
+#ifndef CHUNK_SPARSE_STORAGE
+#define CHUNK_SPARSE_STORAGE (TREE_LEVELS >= 5)
+#endif
+
+#define CHUNK_PAGE_WORDS 64u
+#define CHUNK_PAGE_EMPTY 0xFFFFFFFFu
+#define PAGES_PER_CHUNK ((WORDS_PER_CHUNK + CHUNK_PAGE_WORDS - 1ull) / CHUNK_PAGE_WORDS)
+
+/*
+  Incremental rebuild limits:
+  - CHUNK_MAX_DIRTY_WORDS: leaf words tracked between rebuilds before giving up and doing a full rebuild.
+  - CHUNK_INCREMENTAL_MAX_FLIPS: nodes inserted/removed in one incremental pass before a full rebuild is cheaper.
+    Every insert/remove shifts the compact arrays, so this bounds the patch cost to O(flips * node_count).
+*/
+#define CHUNK_MAX_DIRTY_WORDS 256u
+#define CHUNK_INCREMENTAL_MAX_FLIPS 64u
+
+/*
+  Delta uploads: node ranges patched by incremental rebuilds are recorded and sent as copy regions.
+  - CHUNK_MAX_UPLOAD_RANGES: ranges kept between uploads; past it the two closest ranges are merged.
+  - CHUNK_UPLOAD_MERGE_GAP: ranges closer than this many nodes are merged (one region beats two tiny ones).
+  - CHUNK_UPLOAD_TAIL_DIVISOR: a node inserted or removed shifts every node after it in the BFS array, so the whole
+    tail goes again; once that tail is more than 1/N of the tree the upload sends the tree as one region instead.
+*/
+#define CHUNK_MAX_UPLOAD_RANGES 32u
+#define CHUNK_UPLOAD_MERGE_GAP 8u
+#define CHUNK_UPLOAD_TAIL_DIVISOR 2u
+
+// Dense parent levels 1..TREE_LEVELS-1 of the rebuild pyramid: sum of WORDS_PER_CHUNK/64^d = (WORDS-1)/63
+// (+1 keeps the array non-empty at TREE_LEVELS=1).
+#define CHUNK_PARENT_MASK_WORDS ((WORDS_PER_CHUNK - 1ull) / 63ull + 1ull)
+
+/*
+  Coarse LODs: LOD k keeps only the top TREE_LEVELS - k levels of the compact tree, so the leaf masks of the
+  truncated tree are the level-k masks and every leaf bit stands for a (4^k)^3 voxel cell.
+  - 4x steps only: a 64-tree level is 4 voxels per axis, a 2x reduction would not be a tree level.
+  - CHUNK_LOD_OR: a cell is solid if any voxel in it is; the tree above it is the full tree's prefix.
+  - CHUNK_LOD_MAJORITY: a cell is solid if at least half its voxels are; only the leaf masks differ
+    (and may be 0, which traversal treats as empty).
+*/
+#define CHUNK_LOD_COUNT (TREE_LEVELS > 2 ? 2 : TREE_LEVELS - 1)
+
+/*
+  Node layout seen by traversal (traverse_svo, chunk_ray.c) and sent by the uploads (CHUNK_NODE_LAYOUT).
+  nodes/child_indices stay the BFS editing representation in every layout (rebuilds, LODs, DAG, region files);
+  the packed layouts are derived from them by every rebuild (chunk_layout.c).
+  - CHUNK_LAYOUT_SPLIT: nodes and child_indices as they are: a step reads a mask and an index from two arrays.
+  - CHUNK_LAYOUT_PACKED: PackedNode (mask and first child in 16 bytes), same BFS order and indices.
+  - CHUNK_LAYOUT_DFS: PackedNode, sibling groups in depth-first order: every group is followed by the groups
+    below it, so a descent stays close to where it started instead of jumping a whole level ahead.
+  Packed layouts cost 16 bytes per node next to the BFS arrays; GPU builds (chunk_gpu.c) cannot produce DFS.
+*/
+#define CHUNK_LAYOUT_SPLIT 0
+#define CHUNK_LAYOUT_PACKED 1
+#define CHUNK_LAYOUT_DFS 2
+
+#ifndef CHUNK_NODE_LAYOUT
+#define CHUNK_NODE_LAYOUT CHUNK_LAYOUT_SPLIT
+#endif
+
+/*
+  Empty-space distance field (chunk_distance.c): per 4x4x4 brick (one leaf word), the Chebyshev distance in
+  bricks to the nearest non-empty brick of the chunk. A brick at distance k sits in an empty cube of 2k - 1
+  bricks, so a ray can leave that whole cube in one step. Bricks are stored x fastest, then y, then z.
+  Kept for mixed chunks only, and only up to 64 bricks per axis (TREE_LEVELS <= 4).
+*/
+#ifndef CHUNK_DISTANCE_FIELD
+#define CHUNK_DISTANCE_FIELD (TREE_LEVELS <= 4)
+#endif
+#define CHUNK_DISTANCE_BRICKS_PER_AXIS (CHUNK_SIZE >> BITS_PER_AXIS_PER_LEVEL)
+#define CHUNK_DISTANCE_BRICKS WORDS_PER_CHUNK
+#define CHUNK_DISTANCE_NONE CHUNK_DISTANCE_BRICKS_PER_AXIS // no non-empty brick: the whole chunk is one empty cube
+#define CHUNK_DISTANCE_INDEX(bx, by, bz)                                                                               \
+  (((uint32_t)(bz) * CHUNK_DISTANCE_BRICKS_PER_AXIS + (uint32_t)(by)) * CHUNK_DISTANCE_BRICKS_PER_AXIS + (uint32_t)(bx))
+
 _Static_assert(BITS_PER_LEVEL == 6, "64-tree requires 6 bits per level.");
+_Static_assert(BITS_PER_AXIS <= 21, "Morton codes hold at most 21 bits per axis.");
 _Static_assert((CHUNK_SIZE & (CHUNK_SIZE - 1u)) == 0u, "CHUNK_SIZE must be a power of two.");
 _Static_assert((VOXELS_PER_CHUNK % VOXELS_PER_WORD) == 0ull, "VOXELS_PER_CHUNK must be divisible by 64.");
+_Static_assert(!CHUNK_SPARSE_STORAGE || TREE_LEVELS >= 2, "Sparse storage needs at least one page level.");
 
 // PUBLIC FUNCTIONS
 typedef struct Node {
@@ -56,6 +144,89 @@ typedef struct ChildIndex {
   uint32_t first_child_index; // base index into the next level's compact node array
 } ChildIndex;
 
+// Mask and child index of one node in a packed layout.
+typedef struct PackedNode {
+  uint64_t mask;
+  uint32_t first_child_index; // index of the first child in the same packed array
+  uint32_t pad;
+} PackedNode;
+
+// Traversal accessors for node i of the CHUNK_NODE_LAYOUT arrays (root = 0).
+// On the GPU a node takes CHUNK_GPU_NODE_STRIDE bytes of gpu_node, CHUNK_GPU_NODE_BYTES in all.
+#if CHUNK_NODE_LAYOUT == CHUNK_LAYOUT_SPLIT
+#define CHUNK_NODE_MASK(chunk, i) (((const Node *)(chunk)->nodes.data)[i].mask)
+#define CHUNK_NODE_FIRST_CHILD(chunk, i) (((const ChildIndex *)(chunk)->child_indices.data)[i].first_child_index)
+#define CHUNK_GPU_NODE_STRIDE sizeof(Node)
+#define CHUNK_GPU_NODE_BYTES (sizeof(Node) + sizeof(ChildIndex))
+#else
+#define CHUNK_NODE_MASK(chunk, i) (((const PackedNode *)(chunk)->packed.data)[i].mask)
+#define CHUNK_NODE_FIRST_CHILD(chunk, i) (((const PackedNode *)(chunk)->packed.data)[i].first_child_index)
+#define CHUNK_GPU_NODE_STRIDE sizeof(PackedNode)
+#define CHUNK_GPU_NODE_BYTES sizeof(PackedNode)
+#endif
+
+// One page: the 64 leaf words below a single level-1 node.
+typedef struct ChunkPage {
+  uint64_t words[CHUNK_PAGE_WORDS];
+} ChunkPage;
+
+#define CHUNK_PAGE_BLOCK 64u // pages per allocation; a page never moves once created
+
+// Open-addressing page index -> ChunkPage map (linear probing, power-of-two capacity).
+typedef struct ChunkPageTable {
+  uint32_t *keys;   // page index per slot, CHUNK_PAGE_EMPTY if unused
+  uint32_t *values; // storage slot per key, see chunk_pages_at
+  uint32_t capacity;
+  uint32_t count;
+
+  Vector blocks;     // ChunkPage *[], CHUNK_PAGE_BLOCK pages each
+  uint32_t slots;    // storage slots handed out so far
+  Vector free_pages; // uint32_t[], released storage slots reused before growing
+} ChunkPageTable;
+
+static inline ChunkPage *chunk_pages_at(const ChunkPageTable *t, uint32_t slot) {
+  return ((ChunkPage **)t->blocks.data)[slot / CHUNK_PAGE_BLOCK] + slot % CHUNK_PAGE_BLOCK;
+}
+
+typedef enum ChunkFill {
+  CHUNK_FILL_EMPTY, // every voxel off, no storage
+  CHUNK_FILL_SOLID, // every voxel on, no storage
+  CHUNK_FILL_MIXED, // voxels live in the storage backend
+} ChunkFill;
+
+typedef struct ChunkPoolStats {
+  uint32_t used;     // bitsets held by mixed chunks
+  uint32_t capacity; // bitsets allocated, used or waiting for reuse
+  size_t bytes;      // resident: capacity * BYTES_PER_CHUNK_BITSET
+} ChunkPoolStats;
+
+typedef enum ChunkBuildMode {
+  CHUNK_BUILD_CPU, // rebuilds flatten the tree into nodes/child_indices, chunk_upload copies them
+  CHUNK_BUILD_GPU, // rebuilds of mixed chunks only mark them; chunk_gpu_build uploads the words and builds there
+} ChunkBuildMode;
+
+typedef enum ChunkLodRule {
+  CHUNK_LOD_NONE, // no coarse copies are kept
+  CHUNK_LOD_OR,
+  CHUNK_LOD_MAJORITY,
+} ChunkLodRule;
+
+// [begin, end) in nodes[] / child_indices[]
+typedef struct ChunkNodeRange {
+  uint32_t begin;
+  uint32_t end;
+} ChunkNodeRange;
+
+// Concurrent edit mode state (chunk_concurrent.c), NULL outside the mode.
+typedef struct ChunkConcurrent ChunkConcurrent;
+typedef struct ChunkSnapshot ChunkSnapshot;
+
+// A truncated copy of the compact tree, uploadable on its own (its leaves have first_child_index 0).
+typedef struct ChunkLod {
+  Vector nodes;         // Node[]
+  Vector child_indices; // ChildIndex[]
+} ChunkLod;
+
 typedef struct ChunkTree {
   bool is_dirty;
   bool need_upload;
@@ -64,13 +235,95 @@ typedef struct ChunkTree {
   Vector nodes;         // Node[]
   Vector child_indices; // ChildIndex[]
 
-  ResHandle gpu_node;
-  ResHandle gpu_child_indices;
+  ResHandle gpu_node;          // Node[] (PackedNode[] in the packed layouts)
+  ResHandle gpu_child_indices; // ChildIndex[], unused in the packed layouts
+
+#if CHUNK_NODE_LAYOUT != CHUNK_LAYOUT_SPLIT
+  Vector packed; // PackedNode[], the full tree in CHUNK_NODE_LAYOUT, refreshed with the LODs
+#endif
+
+  // CHUNK_BUILD_GPU (dense storage only): while the chunk is mixed, nodes/child_indices stay empty on the CPU
+  // (no ray queries, LODs or DAG) and storage is not elided; uniform chunks are still built here.
+  ChunkBuildMode build_mode;
+
+  // Compact layout of the flattened tree, kept so edits can be patched in place.
+  uint32_t level_start[TREE_LEVELS]; // index of the first node of level d in nodes[]
+  uint32_t level_count[TREE_LEVELS]; // number of nodes of level d in nodes[]
+
+  // Nodes changed since the last upload (sorted, disjoint). upload_all: everything must go (full rebuild,
+  // new GPU buffers, LOD switch).
+  bool upload_all;
+  uint32_t uploaded_lod;
+  uint32_t upload_range_count;
+  ChunkNodeRange upload_ranges[CHUNK_MAX_UPLOAD_RANGES];
+
+  // Coarse copies, refreshed by every rebuild: lods[k - 1] is LOD k. lod picks what chunk_upload sends
+  // (0 = the full tree); change it with chunk_set_lod.
+  ChunkLodRule lod_rule;
+  uint32_t lod;
+#if CHUNK_LOD_COUNT > 0
+  ChunkLod lods[CHUNK_LOD_COUNT];
+#endif
+
+#if CHUNK_DISTANCE_FIELD
+  // CHUNK_DISTANCE_BRICKS entries, refreshed by every rebuild; NULL while the chunk is uniform.
+  uint8_t *distance;
+  bool distance_changed; // chunk_upload_distance has something to send
+  ResHandle gpu_distance; // the field, four bricks per 32-bit word (shaders/chunk_distance.glsl)
+#endif
+
+  // Edits published by concurrent writers, folded into is_dirty/pending_edits/dirty_words by the next flush.
+  ChunkConcurrent *concurrent;
+
+  // Snapshot in flight (chunk_snapshot.c): its frozen storage is what this chunk held when it was taken, and pages
+  // are read from there until their first write copies them over. Rebuilds wait for chunk_snapshot_apply.
+  ChunkSnapshot *snapshot;
+  bool frozen; // storage read by a live chunk: rebuilds neither compact it nor release its pages
+
+  // Leaf words touched since the last rebuild (unsorted, may hold duplicates).
+  bool dirty_overflow;
+  uint32_t dirty_word_count;
+  uint32_t dirty_words[CHUNK_MAX_DIRTY_WORDS];
 
-  // Dense voxel truth table, 1 bit per voxel, in Morton order.
-  uint64_t bits[WORDS_PER_CHUNK];
+  // Voxel truth table, 1 bit per voxel, in Morton order. Use chunk_get_word/chunk_set_word for raw access.
+  // Only read while fill is CHUNK_FILL_MIXED.
+  ChunkFill fill;
+#if CHUNK_SPARSE_STORAGE
+  ChunkPageTable pages;
+#else
+  uint64_t *bits; // WORDS_PER_CHUNK words from the bitset pool, NULL unless mixed
+#endif
 } ChunkTree;
 
+#define CHUNK_PAGE_MASK_WORDS ((PAGES_PER_CHUNK + 63ull) / 64ull)
+
+// A chunk's voxels frozen at chunk_snapshot_take, and the tree rebuilt from them off the editing thread.
+struct ChunkSnapshot {
+  ChunkTree tree;  // owns the frozen storage; the dirty words and upload tracking of the chunk at the take
+  ChunkTree *live; // the chunk it was taken from
+  uint64_t shared_pages[CHUNK_PAGE_MASK_WORDS]; // pages of live not written since the take (editing thread only)
+};
+
+typedef struct VoxelCoord {
+  int x, y, z;
+} VoxelCoord;
+
+typedef enum ChunkStampOp {
+  CHUNK_STAMP_UNION,     // dst |= src
+  CHUNK_STAMP_SUBTRACT,  // dst &= ~src
+  CHUNK_STAMP_INTERSECT, // dst &= src
+  CHUNK_STAMP_REPLACE,   // dst = src
+} ChunkStampOp;
+
+// Reusable rebuild memory. One per thread (or per worker); once warm, a rebuild never allocates beyond it.
+typedef struct ChunkScratch {
+#if CHUNK_SPARSE_STORAGE
+  Vector level_nodes[TREE_LEVELS]; // sorted non-empty nodes of levels 1..TREE_LEVELS-1 (index 0 unused)
+#else
+  uint64_t parent_masks[CHUNK_PARENT_MASK_WORDS];
+#endif
+} ChunkScratch;
+
 // lifecycle
 void chunk_init(ChunkTree *chunk);
 void chunk_destroy(ChunkTree *chunk);
@@ -79,10 +332,125 @@ void chunk_destroy(ChunkTree *chunk);
 bool chunk_get_voxel(const ChunkTree *chunk, int x, int y, int z);
 void chunk_set_voxel(ChunkTree *chunk, int x, int y, int z, bool set_active);
 
+// bulk voxel ops: edits are grouped per 64-bit leaf word, is_dirty/pending_edits updated once per call.
+// Out-of-range voxels are clipped. pending_edits grows by the number of voxels that changed.
+void chunk_set_voxels(ChunkTree *chunk, const VoxelCoord *coords, uint32_t count, bool set_active);
+void chunk_fill_box(ChunkTree *chunk, VoxelCoord min, VoxelCoord max, bool set_active); // inclusive bounds
+void chunk_fill_sphere(ChunkTree *chunk, VoxelCoord center, int radius, bool set_active);
+void chunk_stamp(ChunkTree *chunk, const ChunkTree *src, ChunkStampOp op);
+
+// raw leaf words (w = morton >> 6, 0..WORDS_PER_CHUNK-1); setting a word is tracked like any other edit
+uint64_t chunk_get_word(const ChunkTree *chunk, uint64_t w);
+void chunk_set_word(ChunkTree *chunk, uint64_t w, uint64_t value);
+// count consecutive words from `first` (clipped to the chunk), e.g. one page of generated bricks
+void chunk_set_words(ChunkTree *chunk, uint64_t first, const uint64_t *words, uint32_t count);
+void chunk_clear(ChunkTree *chunk);
+// Every voxel on (solid) or off, without any storage; pending_edits grows by the number of voxels that changed.
+void chunk_fill(ChunkTree *chunk, bool solid);
+// Drops the storage of a clean chunk whose tree is all empty or all solid (rebuilds do this on their own).
+void chunk_compact(ChunkTree *chunk);
+// Gives a uniform chunk real storage holding its fill, so single words can diverge from it; no-op if mixed.
+void chunk_materialize(ChunkTree *chunk);
+size_t chunk_storage_bytes(const ChunkTree *chunk); // voxel storage only, not the compact tree
+
 // rebuild & upload
 void chunk_rebuild(ChunkTree *chunk);
+void chunk_rebuild_incremental(ChunkTree *chunk);
+void chunk_rebuild_with(ChunkTree *chunk, ChunkScratch *scratch, bool incremental);
 void chunk_rebuild_if_needed(ChunkTree *chunk, uint32_t threshold);
+// True if the next rebuild leaves the tree to chunk_gpu_build (CHUNK_BUILD_GPU, mixed, dense storage).
+bool chunk_uses_gpu_build(const ChunkTree *chunk);
+// Sends only the changed node ranges (one staging copy, one region per range); grows the buffers if needed.
 void chunk_upload(ChunkTree *chunk, M_GPU *gpu, M_Resource *rm, CmdBuffer cmd);
+// Ranges the next upload has to send (the whole selected LOD if everything changed), then resets the tracking.
+// Only mask edits stay small: a node added or removed resends everything after it (see CHUNK_UPLOAD_TAIL_DIVISOR),
+// so structural edits near the root still cost about a full upload.
+uint32_t chunk_take_upload_ranges(ChunkTree *chunk, ChunkNodeRange *out);
+
+// LODs (chunk_lod.c)
+void chunk_build_lods(ChunkTree *chunk); // from the compact tree; rebuilds call it, so does region_load_chunk
+void chunk_set_lod(ChunkTree *chunk, uint32_t lod); // clamped to CHUNK_LOD_COUNT (0 without a lod_rule)
+const Node *chunk_lod_nodes(const ChunkTree *chunk, uint32_t lod, uint32_t *out_count);
+const ChildIndex *chunk_lod_child_indices(const ChunkTree *chunk, uint32_t lod);
+// x, y, z in LOD cells: 0 .. (CHUNK_SIZE >> 2 * lod) - 1
+bool chunk_lod_get_cell(const ChunkTree *chunk, uint32_t lod, int x, int y, int z);
+size_t chunk_gpu_bytes(const ChunkTree *chunk, uint32_t lod); // nodes + child indices
+
+// node layouts (chunk_layout.c)
+void chunk_build_layout(ChunkTree *chunk); // chunk->packed from the compact tree; no-op for CHUNK_LAYOUT_SPLIT
+// Packs a BFS tree (root at 0, leaves with first_child_index 0) into out (PackedNode[]) in layout
+// CHUNK_LAYOUT_PACKED or CHUNK_LAYOUT_DFS, whatever CHUNK_NODE_LAYOUT is.
+void chunk_layout_pack(const Node *nodes, const ChildIndex *child_indices, uint32_t count, int layout, Vector *out);
+
+// empty-space distance field (chunk_distance.c); no-ops without CHUNK_DISTANCE_FIELD
+// Brings the field up to date with the voxels. Rebuilds call it before they consume the dirty words, which
+// let it patch only around bricks that became non-empty; a brick that became empty rebuilds the whole field.
+void chunk_build_distance(ChunkTree *chunk);
+void chunk_upload_distance(ChunkTree *chunk, M_GPU *gpu, M_Resource *rm, CmdBuffer cmd); // if it changed
+
+// concurrent edits (chunk_concurrent.c)
+// Between begin and end, any number of threads may call the _concurrent ops on the chunk at once: words change
+// with atomic fetch-or/fetch-and, and each changed word is published once to a lock-free list. Everything else
+// (plain edits, rebuilds, uploads) still needs the writers quiescent, e.g. after a job_parallel_for; rebuilds flush
+// the list into the dirty words and keep the storage allocated for the writers. Sparse pages are created on the
+// first set bit (under a lock), and end releases the ones the writers left empty.
+void chunk_concurrent_begin(ChunkTree *chunk);
+void chunk_concurrent_end(ChunkTree *chunk); // flushes, then back to plain edits only
+// Returns true if the voxel changed. Lost updates are impossible, but two writers racing on one voxel in opposite
+// directions leave it as whichever ran last.
+bool chunk_set_voxel_concurrent(ChunkTree *chunk, int x, int y, int z, bool set_active);
+// Sets (or clears) the bits of mask in leaf word w; returns the number of voxels that changed.
+uint32_t chunk_set_bits_concurrent(ChunkTree *chunk, uint64_t w, uint64_t mask, bool set_active);
+bool chunk_get_voxel_concurrent(const ChunkTree *chunk, int x, int y, int z);
+// Folds the published edits into is_dirty, pending_edits and the dirty words (writers quiescent). Rebuilds and
+// chunk_rebuild_if_needed call it; so does anything that reads is_dirty of a chunk in the mode.
+void chunk_concurrent_flush(ChunkTree *chunk);
+
+// copy-on-write snapshots (chunk_snapshot.c)
+// Freezes the voxels of a dirty chunk for a rebuild on another thread without copying them: the snapshot takes
+// over the storage, and the chunk reads each page from there until it writes it (one page copy per page written).
+// Edits carry on as usual meanwhile. NULL if the chunk is clean, already has a snapshot in flight, is in concurrent
+// edit mode or is built on the GPU.
+ChunkSnapshot *chunk_snapshot_take(ChunkTree *chunk);
+// Any thread: brings snapshot->tree up to date, incrementally from the chunk's tree when it can. The chunk's tree
+// is only read, so the editing thread may keep tracing and uploading it.
+void chunk_snapshot_rebuild(ChunkSnapshot *snapshot, ChunkScratch *scratch);
+// Editing thread, once the rebuild is done: installs the rebuilt tree (and LODs, layout, distance field) for the
+// next upload and frees the snapshot. Must run before the chunk is destroyed. The chunk stays dirty if it was
+// edited since the take.
+void chunk_snapshot_apply(ChunkSnapshot *snapshot);
+
+// scratch (chunk_rebuild/chunk_rebuild_incremental use an implicit per-thread one, freed when its thread exits)
+ChunkScratch *chunk_scratch_create(void);
+void chunk_scratch_destroy(ChunkScratch *scratch);
+
+// sparse page table (chunk_pages.c)
+void chunk_pages_init(ChunkPageTable *t);
+void chunk_pages_destroy(ChunkPageTable *t);
+void chunk_pages_clear(ChunkPageTable *t);
+uint64_t *chunk_pages_find(const ChunkPageTable *t, uint32_t key);
+uint64_t *chunk_pages_get_or_create(ChunkPageTable *t, uint32_t key); // new pages start zeroed
+void chunk_pages_release(ChunkPageTable *t, uint32_t key);
+size_t chunk_pages_bytes(const ChunkPageTable *t);
+
+// dense bitset pool (chunk_pool.c), shared by every chunk and thread safe; bitsets come back uninitialized
+uint64_t *chunk_pool_acquire(void);
+void chunk_pool_release(uint64_t *bits);
+void chunk_pool_stats(ChunkPoolStats *out);
+// Frees the slabs whose bitsets are all back in the pool; returns the bytes given back to the system.
+size_t chunk_pool_trim(void);
 
 // tests
+// Shared test content, the same chunk for the same seed: a ground slab of seed-dependent height, a sphere on it and a
+// half-density block in a top corner, so every level has full, empty and partial nodes. Clears the chunk first.
+void chunk_fill_test_chunk(ChunkTree *chunk, uint32_t seed);
 int chunk_test(void);
+void chunk_bench(void);
+int chunk_lod_test(void);
+int chunk_layout_test(void);
+void chunk_layout_bench(void);
+int chunk_distance_test(void);
+int chunk_concurrent_test(void);
+void chunk_concurrent_bench(void);
+int chunk_snapshot_test(void);
+void chunk_snapshot_bench(void);
@@ -0,0 +1,465 @@
+/* chunk_concurrent.c */
+#include "chunk.h"
+#include "jobs.h"
+#include "morton.h"
+#include "simd.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// one bit per leaf word: set once the word is in dirty_words[]
+#define MARK_WORDS ((WORDS_PER_CHUNK + 63ull) / 64ull)
+
+struct ChunkConcurrent {
+  atomic_uint pending_edits; // voxels changed since the last flush
+  // Lock-free list of changed leaf words: a writer claims a slot with fetch-add and fills it. Claims past the
+  // end are counted but not stored; the flush turns them into dirty_overflow.
+  atomic_uint dirty_count;
+  uint32_t dirty_words[CHUNK_MAX_DIRTY_WORDS];
+  _Atomic uint64_t marks[MARK_WORDS];
+#if CHUNK_SPARSE_STORAGE
+  // Page -> its words in chunk->pages, filled in on first use. Writers create a missing page under page_lock; page
+  // storage never moves, so a mapped page stays valid until the storage is dropped or a rebuild releases pages.
+  pthread_mutex_t page_lock;
+  _Atomic(uint64_t *) page_map[PAGES_PER_CHUNK];
+#endif
+};
+
+#define CONCURRENT_TEST_JOBS 16u
+#define CONCURRENT_BENCH_EDITS (1u << 16)
+
+typedef struct {
+  ChunkTree *chunk;
+  uint64_t voxel_count; // morton codes [0, voxel_count) are edited, code c by job c % CONCURRENT_TEST_JOBS
+  uint32_t modulo;      // only codes with c % modulo == 0
+  bool set_active;
+  uint32_t changed[CONCURRENT_TEST_JOBS];
+} ConcurrentTestJob;
+
+typedef struct {
+  ChunkTree *chunk;
+  const uint32_t *words;
+  uint32_t word_count;
+  uint32_t round; // job j sets bit (j * 4 + round / 2) of every word in even rounds, clears it in odd ones
+} ConcurrentWordJob;
+
+typedef struct {
+  ChunkTree *chunk;
+  pthread_mutex_t lock;
+  bool use_lock;
+} ConcurrentBenchJob;
+
+// --- Private Prototypes ---
+static inline _Atomic uint64_t *_word(const ChunkTree *chunk, uint64_t w, bool create);
+#if CHUNK_SPARSE_STORAGE
+static uint64_t *_map_page(const ChunkTree *chunk, uint32_t p, bool create);
+static void _release_zero_pages(ChunkTree *chunk);
+#endif
+static void _publish(ChunkConcurrent *c, uint64_t w);
+static void _reserve_storage(ChunkTree *chunk);
+static void _test_job(void *user, uint32_t index, uint32_t worker);
+static void _word_job(void *user, uint32_t index, uint32_t worker);
+static void _bench_job(void *user, uint32_t index, uint32_t worker);
+static bool _same_tree(const ChunkTree *a, const ChunkTree *b);
+static uint32_t _run_test_jobs(JobSystem *js, ConcurrentTestJob *job);
+
+void chunk_concurrent_begin(ChunkTree *chunk) {
+  if (!chunk->concurrent) {
+    chunk->concurrent = (ChunkConcurrent *)calloc(1, sizeof(ChunkConcurrent));
+#if CHUNK_SPARSE_STORAGE
+    pthread_mutex_init(&chunk->concurrent->page_lock, NULL);
+#endif
+  }
+  _reserve_storage(chunk);
+}
+
+void chunk_concurrent_end(ChunkTree *chunk) {
+  if (!chunk->concurrent)
+    return;
+  chunk_concurrent_flush(chunk);
+#if CHUNK_SPARSE_STORAGE
+  _release_zero_pages(chunk);
+  pthread_mutex_destroy(&chunk->concurrent->page_lock);
+#endif
+  free(chunk->concurrent);
+  chunk->concurrent = NULL;
+}
+
+bool chunk_set_voxel_concurrent(ChunkTree *chunk, int x, int y, int z, bool set_active) {
+  int n = (int)CHUNK_SIZE;
+  if (x < 0 || y < 0 || z < 0 || x >= n || y >= n || z >= n)
+    return false;
+  uint64_t code = morton_encode3((uint32_t)x, (uint32_t)y, (uint32_t)z);
+  return chunk_set_bits_concurrent(chunk, BITSET_WORD(code), BIT_MASK_U64(BITSET_BIT(code)), set_active) != 0u;
+}
+
+uint32_t chunk_set_bits_concurrent(ChunkTree *chunk, uint64_t w, uint64_t mask, bool set_active) {
+  ChunkConcurrent *c = chunk->concurrent;
+  if (!c || w >= WORDS_PER_CHUNK || mask == 0ull)
+    return 0;
+
+  // clearing a missing page changes nothing, so only setting creates one
+  _Atomic uint64_t *word = _word(chunk, w, set_active);
+  if (!word)
+    return 0;
+
+  // relaxed is enough: nothing reads the words or the list before the join that ends the writes
+  uint64_t before = set_active ? atomic_fetch_or_explicit(word, mask, memory_order_relaxed)
+                               : atomic_fetch_and_explicit(word, ~mask, memory_order_relaxed);
+  uint64_t flipped = (set_active ? ~before : before) & mask;
+  if (flipped == 0ull)
+    return 0;
+
+  uint32_t changed = (uint32_t)__builtin_popcountll(flipped);
+  atomic_fetch_add_explicit(&c->pending_edits, changed, memory_order_relaxed);
+  _publish(c, w);
+  return changed;
+}
+
+bool chunk_get_voxel_concurrent(const ChunkTree *chunk, int x, int y, int z) {
+  int n = (int)CHUNK_SIZE;
+  if (!chunk->concurrent || x < 0 || y < 0 || z < 0 || x >= n || y >= n || z >= n)
+    return chunk_get_voxel(chunk, x, y, z);
+  uint64_t code = morton_encode3((uint32_t)x, (uint32_t)y, (uint32_t)z);
+  _Atomic uint64_t *word = _word(chunk, BITSET_WORD(code), false);
+  return word && (atomic_load_explicit(word, memory_order_relaxed) & BIT_MASK_U64(BITSET_BIT(code))) != 0ull;
+}
+
+void chunk_concurrent_flush(ChunkTree *chunk) {
+  ChunkConcurrent *c = chunk->concurrent;
+  if (!c)
+    return;
+  uint32_t edits = atomic_exchange_explicit(&c->pending_edits, 0u, memory_order_relaxed);
+  uint32_t count = atomic_exchange_explicit(&c->dirty_count, 0u, memory_order_relaxed);
+  if (edits == 0 && count == 0)
+    return;
+
+  chunk->is_dirty = true;
+  chunk->pending_edits += edits > UINT32_MAX - chunk->pending_edits ? UINT32_MAX - chunk->pending_edits : edits;
+
+  if (count > CHUNK_MAX_DIRTY_WORDS) {
+    chunk->dirty_overflow = true;
+    for (uint32_t i = 0; i < MARK_WORDS; i++)
+      atomic_store_explicit(&c->marks[i], 0ull, memory_order_relaxed);
+    return;
+  }
+
+  // the same bookkeeping as plain edits: past CHUNK_MAX_DIRTY_WORDS only a full rebuild can catch up
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t w = c->dirty_words[i];
+    atomic_store_explicit(&c->marks[w >> 6], 0ull, memory_order_relaxed);
+    if (chunk->dirty_overflow)
+      continue;
+    if (chunk->dirty_word_count == CHUNK_MAX_DIRTY_WORDS)
+      chunk->dirty_overflow = true;
+    else
+      chunk->dirty_words[chunk->dirty_word_count++] = w;
+  }
+}
+
+// -------------------- Tests --------------------
+
+int chunk_concurrent_test(void) {
+  JobSystem *js = job_system_create(4);
+  LOG_INFO("Chunk Concurrent Test: %u writers\n", job_worker_count(js));
+
+  ChunkTree *chunk = (ChunkTree *)malloc(sizeof(ChunkTree));
+  ChunkTree *ref = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(chunk);
+  chunk_init(ref);
+  bool ok = true;
+
+  // Test 1: every writer hits every word (neighbouring voxels belong to different jobs); plain read-modify-writes
+  // would drop most of these
+  LOG_INFO("[Test 1] No lost updates... ");
+  {
+    uint64_t n = VOXELS_PER_CHUNK < (1ull << 18) ? VOXELS_PER_CHUNK : (1ull << 18);
+    chunk_concurrent_begin(chunk);
+    ConcurrentTestJob job = {.chunk = chunk, .voxel_count = n, .modulo = 1, .set_active = true};
+    ok = _run_test_jobs(js, &job) == n;
+    chunk_concurrent_flush(chunk);
+    ok = ok && chunk->is_dirty && chunk->pending_edits == n;
+
+    // then every third voxel off again
+    job.modulo = 3;
+    job.set_active = false;
+    uint32_t cleared = _run_test_jobs(js, &job);
+    ok = ok && cleared == (uint32_t)((n + 2u) / 3u);
+
+    for (uint64_t w = 0; w < n / 64u; w++) {
+      uint64_t word = 0;
+      for (uint32_t b = 0; b < 64u; b++)
+        word |= ((w * 64u + b) % 3u != 0u) ? 1ull << b : 0ull;
+      chunk_set_word(ref, w, word);
+      ok = ok && chunk_get_word(chunk, w) == word;
+    }
+    chunk_rebuild(chunk);
+    chunk_rebuild(ref);
+    ok = ok && _same_tree(chunk, ref);
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 2: a word is published once however many writers change it, and the list drives incremental rebuilds
+  LOG_INFO("[Test 2] Published words feed incremental rebuilds... ");
+  {
+    // an odd multiplier keeps the words distinct (WORDS_PER_CHUNK is a power of two)
+    uint32_t words[40];
+    uint32_t word_count = WORDS_PER_CHUNK < 40u ? (uint32_t)WORDS_PER_CHUNK : 40u;
+    for (uint32_t i = 0; i < word_count; i++)
+      words[i] = (uint32_t)((i * 2654435761u) % WORDS_PER_CHUNK);
+
+    chunk_clear(chunk);
+    chunk_clear(ref);
+    chunk_rebuild(chunk);
+    chunk_rebuild(ref);
+
+    for (uint32_t round = 0; round < 4u && ok; round++) {
+      ConcurrentWordJob job = {.chunk = chunk, .words = words, .word_count = word_count, .round = round};
+      job_parallel_for(js, CONCURRENT_TEST_JOBS, _word_job, &job);
+      chunk_concurrent_flush(chunk);
+      ok = !chunk->dirty_overflow && chunk->dirty_word_count == word_count;
+
+      uint64_t bits = 0;
+      for (uint32_t j = 0; j < CONCURRENT_TEST_JOBS; j++)
+        bits |= 1ull << ((j * 4u + round / 2u) & 63u);
+      for (uint32_t i = 0; i < word_count; i++) {
+        uint64_t before = chunk_get_word(ref, words[i]);
+        chunk_set_word(ref, words[i], round % 2u == 0u ? before | bits : before & ~bits);
+      }
+      chunk_rebuild_incremental(chunk);
+      chunk_rebuild(ref);
+      ok = ok && _same_tree(chunk, ref);
+    }
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 3: rebuilds that compact the chunk (all solid, then all empty) keep storage for the writers
+  LOG_INFO("[Test 3] Uniform chunks stay writable... ");
+  {
+    chunk_fill(chunk, true);
+    chunk_rebuild(chunk);
+    ok = chunk->fill == CHUNK_FILL_MIXED && chunk_storage_bytes(chunk) > 0 &&
+         chunk_get_voxel_concurrent(chunk, 1, 2, 3);
+
+    ConcurrentTestJob job = {.chunk = chunk, .voxel_count = VOXELS_PER_CHUNK, .modulo = 1, .set_active = false};
+    ok = ok && _run_test_jobs(js, &job) == VOXELS_PER_CHUNK;
+    chunk_rebuild(chunk);
+    ok = ok && chunk->fill == CHUNK_FILL_MIXED && ((const Node *)chunk->nodes.data)[0].mask == 0ull;
+
+    int hi = (int)CHUNK_SIZE - 1;
+    ok = ok && chunk_set_voxel_concurrent(chunk, hi, 0, hi, true);
+    ok = ok && !chunk_set_voxel_concurrent(chunk, hi, 0, hi, true);
+    chunk_rebuild(chunk);
+    chunk_clear(ref);
+    chunk_set_voxel(ref, hi, 0, hi, true);
+    chunk_rebuild(ref);
+    ok = ok && _same_tree(chunk, ref);
+
+    // back to plain edits: the next rebuild may elide the storage again
+    chunk_concurrent_end(chunk);
+    chunk_set_voxel(chunk, hi, 0, hi, false);
+    chunk_rebuild(chunk);
+    ok = ok && !chunk->concurrent && chunk->fill == CHUNK_FILL_EMPTY;
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 4: only the pages writers set bits in are created; one left empty is released again by the end
+  LOG_INFO("[Test 4] Storage grows with the writes (%s)... ", CHUNK_SPARSE_STORAGE ? "sparse" : "dense");
+  {
+    chunk_concurrent_begin(chunk);
+    int hi = (int)CHUNK_SIZE - 1;
+    ok = !chunk_set_voxel_concurrent(chunk, 0, 0, 0, false) && chunk_set_voxel_concurrent(chunk, hi, hi, hi, true) &&
+         chunk_set_voxel_concurrent(chunk, 0, 0, 0, true) && chunk_set_voxel_concurrent(chunk, 0, 0, 0, false);
+    ok = ok && chunk_get_voxel_concurrent(chunk, hi, hi, hi) && !chunk_get_voxel_concurrent(chunk, 0, 0, 0);
+#if CHUNK_SPARSE_STORAGE
+    ok = ok && chunk->pages.count == (PAGES_PER_CHUNK > 1u ? 2u : 1u);
+#endif
+    chunk_concurrent_end(chunk);
+#if CHUNK_SPARSE_STORAGE
+    ok = ok && chunk->pages.count == 1u;
+#endif
+    ok = ok && chunk_get_voxel(chunk, hi, hi, hi) && !chunk_get_voxel(chunk, 0, 0, 0);
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+done:
+  chunk_destroy(chunk);
+  chunk_destroy(ref);
+  free(chunk);
+  free(ref);
+  job_system_destroy(js);
+  return ok ? 0 : 1;
+}
+
+// -------------------- Benchmarks --------------------
+
+void chunk_concurrent_bench(void) {
+  JobSystem *js = job_system_create(0);
+  uint32_t workers = job_worker_count(js);
+  ChunkTree *chunk = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(chunk);
+  LOG_INFO("Chunk Concurrent Bench: %u threads, %u random edits each\n", workers, CONCURRENT_BENCH_EDITS);
+
+  const char *names[] = {"mutex + chunk_set_voxel", "concurrent"};
+  for (uint32_t mode = 0; mode < 2u; mode++) {
+    ConcurrentBenchJob job = {.chunk = chunk, .use_lock = mode == 0u};
+    pthread_mutex_init(&job.lock, NULL);
+    if (!job.use_lock)
+      chunk_concurrent_begin(chunk);
+
+    uint64_t t0 = time_now_ns();
+    job_parallel_for(js, workers, _bench_job, &job);
+    uint64_t t1 = time_now_ns();
+    chunk_rebuild(chunk);
+
+    double edits = (double)workers * CONCURRENT_BENCH_EDITS;
+    LOG_INFO("  %-24s: %8.2f Medits/s\n", names[mode], edits / ((double)(t1 - t0) / 1e9) / 1e6);
+    chunk_concurrent_end(chunk);
+    pthread_mutex_destroy(&job.lock);
+  }
+
+  chunk_destroy(chunk);
+  free(chunk);
+  job_system_destroy(js);
+}
+
+// --- Private Functions ---
+
+// NULL for a missing sparse page unless create. A plain uint64_t word is accessed as an atomic one, which is fine
+// for the lock-free 64-bit atomics of the targets we build for.
+static inline _Atomic uint64_t *_word(const ChunkTree *chunk, uint64_t w, bool create) {
+#if CHUNK_SPARSE_STORAGE
+  uint32_t p = (uint32_t)(w / CHUNK_PAGE_WORDS);
+  uint64_t *words = atomic_load_explicit(&chunk->concurrent->page_map[p], memory_order_acquire);
+  if (!words)
+    words = _map_page(chunk, p, create);
+  return words ? (_Atomic uint64_t *)&words[w % CHUNK_PAGE_WORDS] : NULL;
+#else
+  (void)create;
+  return (_Atomic uint64_t *)&chunk->bits[w];
+#endif
+}
+
+#if CHUNK_SPARSE_STORAGE
+// The slow path of _word: the table is only ever looked up or grown under the lock while writers run. Pages the
+// plain edits created before the mode (or between flushes) are found and mapped like the writers' own.
+static uint64_t *_map_page(const ChunkTree *chunk, uint32_t p, bool create) {
+  ChunkConcurrent *c = chunk->concurrent;
+  ChunkPageTable *t = (ChunkPageTable *)&chunk->pages;
+  pthread_mutex_lock(&c->page_lock);
+  uint64_t *words = atomic_load_explicit(&c->page_map[p], memory_order_relaxed);
+  if (!words) {
+    words = create ? chunk_pages_get_or_create(t, p) : chunk_pages_find(t, p);
+    if (words)
+      atomic_store_explicit(&c->page_map[p], words, memory_order_release);
+  }
+  pthread_mutex_unlock(&c->page_lock);
+  return words;
+}
+
+// Pages a writer created (or mapped) but left empty go back to the table, as a rebuild would release them.
+static void _release_zero_pages(ChunkTree *chunk) {
+  ChunkConcurrent *c = chunk->concurrent;
+  if (chunk->snapshot)
+    return;
+  for (uint32_t p = 0; p < PAGES_PER_CHUNK; p++) {
+    const uint64_t *words = atomic_load_explicit(&c->page_map[p], memory_order_relaxed);
+    if (words && simd_nonzero_mask64(words) == 0ull)
+      chunk_pages_release(&chunk->pages, p);
+  }
+}
+#endif
+
+// Only the writer that sets the word's mark appends it, so the list holds each word once per flush.
+static void _publish(ChunkConcurrent *c, uint64_t w) {
+  uint64_t bit = 1ull << (w & 63u);
+  if (atomic_fetch_or_explicit(&c->marks[w >> 6], bit, memory_order_relaxed) & bit)
+    return;
+  uint32_t slot = atomic_fetch_add_explicit(&c->dirty_count, 1u, memory_order_relaxed);
+  if (slot < CHUNK_MAX_DIRTY_WORDS)
+    c->dirty_words[slot] = (uint32_t)w;
+}
+
+// A uniform chunk gets its storage up front; sparse pages are created by the first writer that sets a bit in them.
+// Pages released or dropped since the last call may have been reused, so the page map starts over.
+static void _reserve_storage(ChunkTree *chunk) {
+  chunk_materialize(chunk);
+#if CHUNK_SPARSE_STORAGE
+  for (uint32_t p = 0; p < PAGES_PER_CHUNK; p++)
+    atomic_store_explicit(&chunk->concurrent->page_map[p], NULL, memory_order_relaxed);
+#endif
+}
+
+static void _test_job(void *user, uint32_t index, uint32_t worker) {
+  (void)worker;
+  ConcurrentTestJob *job = (ConcurrentTestJob *)user;
+  uint32_t changed = 0;
+  for (uint64_t c = index; c < job->voxel_count; c += CONCURRENT_TEST_JOBS) {
+    if (c % job->modulo != 0u)
+      continue;
+    uint32_t x, y, z;
+    morton_decode3(c, &x, &y, &z);
+    changed += chunk_set_voxel_concurrent(job->chunk, (int)x, (int)y, (int)z, job->set_active) ? 1u : 0u;
+  }
+  job->changed[index] = changed;
+}
+
+static void _word_job(void *user, uint32_t index, uint32_t worker) {
+  (void)worker;
+  ConcurrentWordJob *job = (ConcurrentWordJob *)user;
+  uint64_t bit = 1ull << ((index * 4u + job->round / 2u) & 63u);
+  for (uint32_t i = 0; i < job->word_count; i++)
+    chunk_set_bits_concurrent(job->chunk, job->words[i], bit, job->round % 2u == 0u);
+}
+
+static void _bench_job(void *user, uint32_t index, uint32_t worker) {
+  (void)worker;
+  ConcurrentBenchJob *job = (ConcurrentBenchJob *)user;
+  unsigned int seed = 1234u + index * 7919u;
+  unsigned int n = (unsigned int)CHUNK_SIZE;
+  for (uint32_t i = 0; i < CONCURRENT_BENCH_EDITS; i++) {
+    seed = seed * 1103515245u + 12345u;
+    int x = (int)((seed >> 4) % n), y = (int)((seed >> 12) % n), z = (int)((seed >> 20) % n);
+    bool on = (seed >> 31) == 0u;
+    if (job->use_lock) {
+      pthread_mutex_lock(&job->lock);
+      chunk_set_voxel(job->chunk, x, y, z, on);
+      pthread_mutex_unlock(&job->lock);
+    } else {
+      chunk_set_voxel_concurrent(job->chunk, x, y, z, on);
+    }
+  }
+}
+
+static bool _same_tree(const ChunkTree *a, const ChunkTree *b) {
+  return a->nodes.length == b->nodes.length &&
+         memcmp(a->nodes.data, b->nodes.data, a->nodes.length * sizeof(Node)) == 0 &&
+         memcmp(a->child_indices.data, b->child_indices.data, a->nodes.length * sizeof(ChildIndex)) == 0;
+}
+
+// One job per CONCURRENT_TEST_JOBS residue, spread over the pool; returns the voxels changed in total.
+static uint32_t _run_test_jobs(JobSystem *js, ConcurrentTestJob *job) {
+  job_parallel_for(js, CONCURRENT_TEST_JOBS, _test_job, job);
+  uint32_t total = 0;
+  for (uint32_t j = 0; j < CONCURRENT_TEST_JOBS; j++)
+    total += job->changed[j];
+  return total;
+}
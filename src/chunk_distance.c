@@ -0,0 +1,290 @@
+/* chunk_distance.c */
+#include "chunk.h"
+#include "morton.h"
+#include "shaders/chunk_distance.glsl"
+
+#include <stdlib.h>
+#include <string.h>
+
+// more new bricks than this and a full pass is cheaper than patching around each
+#define DISTANCE_MAX_PATCHES 16u
+
+#if CHUNK_DISTANCE_FIELD
+#define BRICKS CHUNK_DISTANCE_BRICKS_PER_AXIS
+#define ROW_MASK (BRICKS == 64u ? ~0ull : (1ull << BRICKS) - 1ull)
+
+_Static_assert(CHUNK_DISTANCE_BRICK_SHIFT == BITS_PER_AXIS_PER_LEVEL, "a brick is one leaf word");
+_Static_assert(BRICKS <= 64u, "brick rows are single 64-bit words");
+
+// --- Private Prototypes ---
+static void _build_full(ChunkTree *chunk);
+static void _patch(uint8_t *distance, const uint32_t b[3]);
+static void _dilate(const uint64_t *src, uint64_t *dst, uint64_t *tmp);
+static bool _check_field(const ChunkTree *chunk);
+#endif
+
+void chunk_build_distance(ChunkTree *chunk) {
+#if CHUNK_DISTANCE_FIELD
+  if (chunk->fill != CHUNK_FILL_MIXED) {
+    free(chunk->distance);
+    chunk->distance = NULL;
+    return;
+  }
+  if (!chunk->distance || chunk->dirty_overflow) {
+    _build_full(chunk);
+    return;
+  }
+
+  // only a brick going from empty to non-empty (or back) moves the field; the field is left as it was until
+  // every dirty word has been looked at, so a brick listed twice is patched twice
+  uint32_t added[DISTANCE_MAX_PATCHES][3];
+  uint32_t added_count = 0;
+  for (uint32_t i = 0; i < chunk->dirty_word_count; i++) {
+    uint32_t w = chunk->dirty_words[i], b[3];
+    morton_decode3(w, &b[0], &b[1], &b[2]);
+    uint8_t *d = &chunk->distance[CHUNK_DISTANCE_INDEX(b[0], b[1], b[2])];
+    bool occupied = chunk_get_word(chunk, w) != 0ull;
+    if (occupied == (*d == 0u))
+      continue;
+
+    // a brick emptied: distances grow, possibly far away
+    if (!occupied || added_count == DISTANCE_MAX_PATCHES) {
+      _build_full(chunk);
+      return;
+    }
+    memcpy(added[added_count++], b, sizeof(b));
+  }
+
+  for (uint32_t i = 0; i < added_count; i++)
+    _patch(chunk->distance, added[i]);
+  if (added_count > 0)
+    chunk->distance_changed = true;
+#else
+  (void)chunk;
+#endif
+}
+
+void chunk_upload_distance(ChunkTree *chunk, M_GPU *gpu, M_Resource *rm, CmdBuffer cmd) {
+#if CHUNK_DISTANCE_FIELD
+  if (!chunk->distance_changed || !chunk->distance)
+    return;
+
+  // whole words for the shader, the padding is never read
+  u32 size = (u32)((CHUNK_DISTANCE_BRICKS + CHUNK_DISTANCE_BYTES_PER_WORD - 1u) / CHUNK_DISTANCE_BYTES_PER_WORD *
+                   CHUNK_DISTANCE_BYTES_PER_WORD);
+  if ((u64)rm_get_buffer(rm, chunk->gpu_distance)->capacity < size)
+    rm_resize_buffer(rm, chunk->gpu_distance, size);
+
+  VkBufferCopy region = {.size = CHUNK_DISTANCE_BRICKS};
+  cmd_sync_buffer(cmd.buffer, rm, chunk->gpu_distance, STATE_TRANSFER, ACCESS_WRITE);
+  cmd_buffer_upload_regions(cmd, gpu, rm, chunk->gpu_distance, chunk->distance, &region, 1);
+  cmd_sync_buffer(cmd.buffer, rm, chunk->gpu_distance, STATE_SHADER, ACCESS_READ);
+  chunk->distance_changed = false;
+#else
+  (void)chunk, (void)gpu, (void)rm, (void)cmd;
+#endif
+}
+
+// -------------------- Tests --------------------
+
+int chunk_distance_test(void) {
+#if CHUNK_DISTANCE_FIELD
+  LOG_INFO("Chunk Distance Test: %u bricks per axis\n", (unsigned)BRICKS);
+
+  ChunkTree *chunk = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(chunk);
+  int cs = (int)CHUNK_SIZE;
+  unsigned int seed = 321u;
+  bool ok = true;
+
+  // Test 1: a full pass gives every brick its distance to the nearest non-empty one
+  LOG_INFO("[Test 1] Full build vs brute force... ");
+  for (uint32_t i = 0; i < 6u; i++) {
+    seed = seed * 1103515245u + 12345u;
+    chunk_set_voxel(chunk, (int)((seed >> 16) % (unsigned)cs), (int)((seed >> 8) % (unsigned)cs),
+                    (int)(seed % (unsigned)cs), true);
+  }
+  chunk_rebuild(chunk);
+  ok = chunk->distance && _check_field(chunk);
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 2: incremental rebuilds patch additions and redo removals, and stay exact either way
+  LOG_INFO("[Test 2] Incremental edits... ");
+  for (uint32_t round = 0; round < 24u && ok; round++) {
+    // a few voxels on, then (every third round) one off again
+    for (uint32_t i = 0; i < 1u + round % 4u; i++) {
+      seed = seed * 1103515245u + 12345u;
+      chunk_set_voxel(chunk, (int)((seed >> 16) % (unsigned)cs), (int)((seed >> 8) % (unsigned)cs),
+                      (int)(seed % (unsigned)cs), true);
+    }
+    if (round % 3u == 2u) {
+      seed = seed * 1103515245u + 12345u;
+      chunk_fill_box(chunk, (VoxelCoord){0, 0, 0}, (VoxelCoord){cs - 1, cs - 1, (int)(seed % (unsigned)cs)}, false);
+    }
+    chunk_rebuild_incremental(chunk);
+    ok = chunk->fill != CHUNK_FILL_MIXED || _check_field(chunk);
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 3: uniform chunks keep no field, and get one back when they turn mixed
+  LOG_INFO("[Test 3] Uniform chunks... ");
+  chunk_fill(chunk, true);
+  chunk_rebuild(chunk);
+  ok = chunk->distance == NULL;
+  chunk_set_voxel(chunk, 0, 0, 0, false);
+  chunk_rebuild_incremental(chunk);
+  ok = ok && chunk->distance && _check_field(chunk);
+  chunk_clear(chunk);
+  chunk_rebuild(chunk);
+  ok = ok && chunk->distance == NULL;
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+done:
+  chunk_destroy(chunk);
+  free(chunk);
+  return ok ? 0 : 1;
+#else
+  LOG_INFO("Chunk Distance Test: skipped (CHUNK_DISTANCE_FIELD off)\n");
+  return 0;
+#endif
+}
+
+// --- Private Functions ---
+
+#if CHUNK_DISTANCE_FIELD
+// Grows the non-empty bricks by one brick in every direction (3x3x3 cube) per pass: a brick first covered
+// by pass k is at distance k. One row of bricks along x per 64-bit word.
+static void _build_full(ChunkTree *chunk) {
+  if (!chunk->distance)
+    chunk->distance = (uint8_t *)malloc(CHUNK_DISTANCE_BRICKS);
+  uint8_t *distance = chunk->distance;
+  memset(distance, CHUNK_DISTANCE_NONE, CHUNK_DISTANCE_BRICKS);
+  chunk->distance_changed = true;
+
+  uint64_t *scratch = (uint64_t *)calloc(3u * BRICKS * BRICKS, sizeof(uint64_t));
+  uint64_t *rows = scratch, *next = scratch + BRICKS * BRICKS, *tmp = next + BRICKS * BRICKS;
+
+  uint64_t any = 0;
+  for (uint64_t w = 0; w < WORDS_PER_CHUNK; w++) {
+    if (chunk_get_word(chunk, w) == 0ull)
+      continue;
+    uint32_t b[3];
+    morton_decode3(w, &b[0], &b[1], &b[2]);
+    rows[b[2] * BRICKS + b[1]] |= 1ull << b[0];
+    distance[CHUNK_DISTANCE_INDEX(b[0], b[1], b[2])] = 0u;
+    any = 1;
+  }
+
+  for (uint32_t k = 1; any && k < CHUNK_DISTANCE_NONE; k++) {
+    _dilate(rows, next, tmp);
+    any = 0;
+    for (uint32_t r = 0; r < BRICKS * BRICKS; r++) {
+      uint64_t fresh = next[r] & ~rows[r];
+      any |= fresh;
+      uint8_t *row = distance + (size_t)r * BRICKS;
+      for (; fresh; fresh &= fresh - 1ull)
+        row[__builtin_ctzll(fresh)] = (uint8_t)k;
+    }
+    uint64_t *swap = rows;
+    rows = next;
+    next = swap;
+  }
+
+  free(scratch);
+}
+
+static void _dilate(const uint64_t *src, uint64_t *dst, uint64_t *tmp) {
+  for (uint32_t r = 0; r < BRICKS * BRICKS; r++)
+    tmp[r] = (src[r] | (src[r] << 1) | (src[r] >> 1)) & ROW_MASK;
+
+  for (uint32_t z = 0; z < BRICKS; z++)
+    for (uint32_t y = 0; y < BRICKS; y++) {
+      uint32_t r = z * BRICKS + y;
+      dst[r] = tmp[r] | (y > 0 ? tmp[r - 1] : 0ull) | (y + 1 < BRICKS ? tmp[r + 1] : 0ull);
+    }
+
+  memcpy(tmp, dst, BRICKS * BRICKS * sizeof(uint64_t));
+  for (uint32_t z = 0; z < BRICKS; z++)
+    for (uint32_t y = 0; y < BRICKS; y++) {
+      uint32_t r = z * BRICKS + y;
+      dst[r] = tmp[r] | (z > 0 ? tmp[r - BRICKS] : 0ull) | (z + 1 < BRICKS ? tmp[r + BRICKS] : 0ull);
+    }
+}
+
+// A new non-empty brick b: lowers the distances around it shell by shell. The field changes by at most one
+// between neighbours, so once a whole shell is left as it was, no shell further out can change either.
+static void _patch(uint8_t *distance, const uint32_t b[3]) {
+  distance[CHUNK_DISTANCE_INDEX(b[0], b[1], b[2])] = 0u;
+  for (int r = 1; r < (int)CHUNK_DISTANCE_NONE; r++) {
+    bool changed = false;
+    int lo[3], hi[3];
+    for (int a = 0; a < AXIS_COUNT; a++) {
+      lo[a] = (int)b[a] - r < 0 ? 0 : (int)b[a] - r;
+      hi[a] = (int)b[a] + r >= (int)BRICKS ? (int)BRICKS - 1 : (int)b[a] + r;
+    }
+
+    for (int z = lo[2]; z <= hi[2]; z++)
+      for (int y = lo[1]; y <= hi[1]; y++) {
+        // inside the shell's z and y faces only its two x ends belong to it
+        bool face = abs(z - (int)b[2]) == r || abs(y - (int)b[1]) == r;
+        for (int x = face ? lo[0] : (int)b[0] - r; x <= hi[0]; x += face ? 1 : 2 * r) {
+          if (x < 0)
+            continue;
+          uint8_t *d = &distance[CHUNK_DISTANCE_INDEX(x, y, z)];
+          if (*d > r) {
+            *d = (uint8_t)r;
+            changed = true;
+          }
+        }
+      }
+
+    if (!changed)
+      return;
+  }
+}
+
+// Brute force over the non-empty bricks.
+static bool _check_field(const ChunkTree *chunk) {
+  if (!chunk->distance)
+    return false;
+
+  uint32_t *occupied = (uint32_t *)malloc(WORDS_PER_CHUNK * 3u * sizeof(uint32_t));
+  uint32_t n = 0;
+  for (uint64_t w = 0; w < WORDS_PER_CHUNK; w++) {
+    if (chunk_get_word(chunk, w) == 0ull)
+      continue;
+    morton_decode3(w, &occupied[3u * n], &occupied[3u * n + 1u], &occupied[3u * n + 2u]);
+    n++;
+  }
+
+  bool ok = true;
+  for (uint32_t z = 0; z < BRICKS && ok; z++)
+    for (uint32_t y = 0; y < BRICKS && ok; y++)
+      for (uint32_t x = 0; x < BRICKS && ok; x++) {
+        int best = (int)CHUNK_DISTANCE_NONE;
+        for (uint32_t i = 0; i < n; i++) {
+          int dx = abs((int)x - (int)occupied[3u * i]), dy = abs((int)y - (int)occupied[3u * i + 1u]);
+          int dz = abs((int)z - (int)occupied[3u * i + 2u]);
+          int d = dx > dy ? dx : dy;
+          d = d > dz ? d : dz;
+          best = d < best ? d : best;
+        }
+        ok = chunk->distance[CHUNK_DISTANCE_INDEX(x, y, z)] == best;
+      }
+
+  free(occupied);
+  return ok;
+}
+#endif
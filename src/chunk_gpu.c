@@ -0,0 +1,303 @@
+/* chunk_gpu.c */
+#include "chunk_gpu.h"
+#include "command.h"
+#include "gpu/gpu.h"
+#include "gpu/pipeline.h"
+#include "gpu/pipeline_hotreload.h"
+#include "resmanager.h"
+#include "system_manager.h"
+
+#include "shaders/chunk_build.glsl"
+
+#include <string.h>
+
+_Static_assert(TREE_LEVELS <= CHUNK_BUILD_MAX_LEVELS, "chunk_build.comp header holds CHUNK_BUILD_MAX_LEVELS levels.");
+_Static_assert(sizeof(Node) == 8 && sizeof(ChildIndex) == 4, "chunk_build.comp writes uvec2 nodes and uint indices.");
+
+#define CHUNK_BUILD_SCRATCH_BYTES                                                                                      \
+  (CHUNK_BUILD_HEADER_WORDS * sizeof(u32) + CHUNK_PARENT_MASK_WORDS * (sizeof(uint64_t) + sizeof(u32)))
+
+// --- Private Prototypes ---
+#if CHUNK_GPU_BUILD_SUPPORTED
+static void _dispatch(const ChunkGpuBuilder *builder, M_Pipeline *pm, M_Resource *rm, CmdBuffer cmd,
+                      PushChunkBuild *push, u32 pass, u32 level, u32 threads);
+#endif
+static uint32_t _level_nodes(uint32_t d);
+
+void chunk_gpu_builder_init(ChunkGpuBuilder *builder, M_Resource *rm, M_HotReload *pr) {
+  CpConfig config = cp_init("Chunk Build Pipeline");
+  cp_set_shader_path(&config, "shaders/chunk_build.comp");
+  builder->pipeline = pr_build_reg_cs(pr, config);
+
+  RGBufferInfo bits_info = {
+      .name = "ChunkBuildBits",
+      .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      .capacity = (u32)BYTES_PER_CHUNK_BITSET,
+      .mem = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+  };
+  RGBufferInfo scratch_info = {
+      .name = "ChunkBuildScratch",
+      .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      .capacity = (u32)CHUNK_BUILD_SCRATCH_BYTES,
+      .mem = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+  };
+  builder->bits = rm_create_buffer(rm, &bits_info);
+  builder->scratch = rm_create_buffer(rm, &scratch_info);
+}
+
+uint32_t chunk_gpu_node_capacity(void) {
+  uint32_t total = 0;
+  for (uint32_t d = 0; d < (uint32_t)TREE_LEVELS; d++)
+    total += _level_nodes(d);
+  return total;
+}
+
+void chunk_gpu_build(ChunkGpuBuilder *builder, ChunkTree *chunk, M_GPU *gpu, M_Resource *rm, CmdBuffer cmd) {
+  if (!chunk->need_upload)
+    return;
+  if (!chunk_uses_gpu_build(chunk)) {
+    chunk_upload(chunk, gpu, rm, cmd);
+    return;
+  }
+
+#if CHUNK_GPU_BUILD_SUPPORTED
+  auto *pm = SYSTEM_GET(SYSTEM_TYPE_PIPELINE, M_Pipeline);
+
+  // the node count is only known on the GPU, so the buffers hold the largest possible tree
+  u32 capacity = chunk_gpu_node_capacity();
+  RBuffer *node_buf = rm_get_buffer(rm, chunk->gpu_node);
+  if ((u64)node_buf->capacity < (u64)capacity * CHUNK_GPU_NODE_STRIDE) {
+    rm_resize_buffer(rm, chunk->gpu_node, capacity * (u32)CHUNK_GPU_NODE_STRIDE);
+#if CHUNK_NODE_LAYOUT == CHUNK_LAYOUT_SPLIT
+    rm_resize_buffer(rm, chunk->gpu_child_indices, capacity * (u32)sizeof(ChildIndex));
+#endif
+  }
+
+  // the previous build may still be reading the words and the pyramid
+  cmd_sync_buffer(cmd.buffer, rm, builder->bits, STATE_TRANSFER, ACCESS_WRITE);
+  cmd_buffer_upload(cmd, gpu, rm, builder->bits, chunk->bits, (u32)BYTES_PER_CHUNK_BITSET);
+  cmd_sync_buffer(cmd.buffer, rm, builder->bits, STATE_SHADER, ACCESS_READ);
+  cmd_sync_buffer(cmd.buffer, rm, builder->scratch, STATE_SHADER, ACCESS_READ | ACCESS_WRITE);
+  cmd_sync_buffer(cmd.buffer, rm, chunk->gpu_node, STATE_SHADER, ACCESS_WRITE);
+#if CHUNK_NODE_LAYOUT == CHUNK_LAYOUT_SPLIT
+  cmd_sync_buffer(cmd.buffer, rm, chunk->gpu_child_indices, STATE_SHADER, ACCESS_WRITE);
+#endif
+
+  PushChunkBuild push = {
+      .levels = (u32)TREE_LEVELS,
+      .words = (u32)WORDS_PER_CHUNK,
+      .bits_id = rm_get_buffer_descriptor_index(rm, builder->bits),
+      .scratch_id = rm_get_buffer_descriptor_index(rm, builder->scratch),
+      .node_id = rm_get_buffer_descriptor_index(rm, chunk->gpu_node),
+#if CHUNK_NODE_LAYOUT == CHUNK_LAYOUT_SPLIT
+      .child_id = rm_get_buffer_descriptor_index(rm, chunk->gpu_child_indices),
+#else
+      .packed = 1u,
+#endif
+  };
+
+  for (uint32_t d = 1; d < (uint32_t)TREE_LEVELS; d++) {
+    _dispatch(builder, pm, rm, cmd, &push, CHUNK_BUILD_PASS_REDUCE, d, _level_nodes(d - 1));
+    cmd_sync_buffer(cmd.buffer, rm, builder->scratch, STATE_SHADER, ACCESS_READ | ACCESS_WRITE);
+  }
+  for (uint32_t d = (uint32_t)TREE_LEVELS - 1; d >= 1; d--) {
+    _dispatch(builder, pm, rm, cmd, &push, CHUNK_BUILD_PASS_SCAN, d, CHUNK_BUILD_GROUP_SIZE);
+    cmd_sync_buffer(cmd.buffer, rm, builder->scratch, STATE_SHADER, ACCESS_READ | ACCESS_WRITE);
+  }
+  // levels scatter to disjoint ranges, no barrier between them
+  for (uint32_t d = 0; d < (uint32_t)TREE_LEVELS; d++)
+    _dispatch(builder, pm, rm, cmd, &push, CHUNK_BUILD_PASS_EMIT, d, _level_nodes(d));
+
+  // the field is built on the CPU either way (chunk_build_distance)
+  chunk_upload_distance(chunk, gpu, rm, cmd);
+
+  // everything went up, whatever was recorded for a delta upload is obsolete
+  chunk->need_upload = false;
+  chunk->upload_all = false;
+  chunk->upload_range_count = 0;
+  chunk->uploaded_lod = 0;
+#endif
+}
+
+// --- Private Functions ---
+
+#if CHUNK_GPU_BUILD_SUPPORTED
+static void _dispatch(const ChunkGpuBuilder *builder, M_Pipeline *pm, M_Resource *rm, CmdBuffer cmd,
+                      PushChunkBuild *push, u32 pass, u32 level, u32 threads) {
+  push->pass = pass;
+  push->level = level;
+
+  BindPipelineInfo b = {.p_push = push, .push_size = sizeof(PushChunkBuild), .handle = builder->pipeline};
+  cmd_bind_pipeline(cmd, pm, rm, &b);
+  vkCmdDispatch(cmd.buffer, (threads + CHUNK_BUILD_GROUP_SIZE - 1) / CHUNK_BUILD_GROUP_SIZE, 1, 1);
+}
+#endif
+
+static uint32_t _level_nodes(uint32_t d) { return (uint32_t)(WORDS_PER_CHUNK >> LEVEL_SHIFT(d)); }
+
+// -------------------- Tests --------------------
+
+#if CHUNK_GPU_BUILD_SUPPORTED
+// Builds chunk on the GPU and waits for it (immediate command buffer).
+static void _test_build(ChunkGpuBuilder *builder, ChunkTree *chunk, M_GPU *gpu, M_Resource *rm) {
+  CmdBuffer cmd = {.pool = gpu->imm_cmd_pool, .buffer = gpu->imm_cmd_buffer, .device = gpu->device};
+  cmd_begin(gpu->device, cmd);
+  cmd_bind_bindless(cmd, rm, (VkExtent2D){1, 1});
+  chunk_gpu_build(builder, chunk, gpu, rm, cmd);
+  cmd_end(gpu->device, cmd);
+
+  VkCommandBufferSubmitInfo cmd_info = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                        .commandBuffer = cmd.buffer};
+  VkSubmitInfo2 submit = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2, .commandBufferInfoCount = 1, .pCommandBufferInfos = &cmd_info};
+  vk_check(vkQueueSubmit2(gpu->graphics_queue, 1, &submit, gpu->imm_fence));
+  vk_check(vkWaitForFences(gpu->device, 1, &gpu->imm_fence, VK_TRUE, UINT64_MAX));
+  vk_check(vkResetFences(gpu->device, 1, &gpu->imm_fence));
+}
+
+// Rebuilds both chunks (cpu on the CPU, gpu on the GPU) and compares the output buffers byte for byte with
+// the CPU tree. Everything past the CPU node count must still hold the 0xFF fill: the GPU emitted no extra nodes.
+static bool _test_compare(ChunkGpuBuilder *builder, ChunkTree *cpu, ChunkTree *gpu_chunk, M_GPU *gpu,
+                          M_Resource *rm) {
+  chunk_rebuild(cpu);
+  chunk_rebuild(gpu_chunk);
+  if (gpu_chunk->nodes.length != 0 || !gpu_chunk->need_upload)
+    return false;
+
+  size_t capacity = chunk_gpu_node_capacity();
+  VmaAllocation node_alloc = rm_get_buffer(rm, gpu_chunk->gpu_node)->alloc;
+  void *nodes = NULL;
+  vk_check(vmaMapMemory(gpu->allocator, node_alloc, &nodes));
+  memset(nodes, 0xFF, capacity * CHUNK_GPU_NODE_STRIDE);
+#if CHUNK_NODE_LAYOUT == CHUNK_LAYOUT_SPLIT
+  VmaAllocation child_alloc = rm_get_buffer(rm, gpu_chunk->gpu_child_indices)->alloc;
+  void *children = NULL;
+  vk_check(vmaMapMemory(gpu->allocator, child_alloc, &children));
+  memset(children, 0xFF, capacity * sizeof(ChildIndex));
+#endif
+
+  _test_build(builder, gpu_chunk, gpu, rm);
+
+  size_t count = cpu->nodes.length;
+#if CHUNK_NODE_LAYOUT == CHUNK_LAYOUT_SPLIT
+  bool ok = memcmp(nodes, cpu->nodes.data, count * sizeof(Node)) == 0 &&
+            memcmp(children, cpu->child_indices.data, count * sizeof(ChildIndex)) == 0;
+  vmaUnmapMemory(gpu->allocator, child_alloc);
+#else
+  bool ok = cpu->packed.length == count && memcmp(nodes, cpu->packed.data, count * sizeof(PackedNode)) == 0;
+#endif
+  for (size_t i = count * CHUNK_GPU_NODE_STRIDE; ok && i < capacity * CHUNK_GPU_NODE_STRIDE; i++)
+    ok = ((const u8 *)nodes)[i] == 0xFF;
+
+  vmaUnmapMemory(gpu->allocator, node_alloc);
+  return ok;
+}
+#endif
+
+int chunk_gpu_test(void) {
+  LOG_INFO("Chunk GPU Build Test: TREE_LEVELS=%d, %u nodes max\n", (int)TREE_LEVELS, chunk_gpu_node_capacity());
+#if !CHUNK_GPU_BUILD_SUPPORTED
+  LOG_INFO("Skipped: sparse storage and the DFS layout build every chunk on the CPU\n");
+  return 0;
+#else
+  auto *gpu = SYSTEM_GET(SYSTEM_TYPE_GPU, M_GPU);
+  auto *rm = SYSTEM_GET(SYSTEM_TYPE_RESOURCE, M_Resource);
+  auto *pr = SYSTEM_GET(SYSTEM_TYPE_HOTRELOAD, M_HotReload);
+  int failed = 0;
+
+  ChunkGpuBuilder builder;
+  chunk_gpu_builder_init(&builder, rm, pr);
+
+  // host visible, so the test can fill and read them back
+  u32 capacity = chunk_gpu_node_capacity();
+  RGBufferInfo node_info = {.name = "ChunkGpuTestNodes",
+                            .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                            .capacity = capacity * (u32)CHUNK_GPU_NODE_STRIDE,
+                            .mem = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+  RGBufferInfo child_info = node_info;
+  child_info.name = "ChunkGpuTestChildIndices";
+  child_info.capacity = capacity * (u32)sizeof(ChildIndex);
+
+  ChunkTree cpu, gpu_chunk;
+  chunk_init(&cpu);
+  chunk_init(&gpu_chunk);
+  gpu_chunk.build_mode = CHUNK_BUILD_GPU;
+  gpu_chunk.gpu_node = rm_create_buffer(rm, &node_info);
+  gpu_chunk.gpu_child_indices = rm_create_buffer(rm, &child_info);
+
+  int n = (int)CHUNK_SIZE;
+
+  // Test 1: single voxel (one path from the root to one leaf)
+  {
+    LOG_INFO("[Test 1] Single voxel... ");
+    chunk_set_voxel(&cpu, n / 2, n / 3, n - 1, true);
+    chunk_stamp(&gpu_chunk, &cpu, CHUNK_STAMP_REPLACE);
+
+    if (_test_compare(&builder, &cpu, &gpu_chunk, gpu, rm))
+      LOG_INFO("PASSED\n");
+    else {
+      LOG_INFO("FAILED\n");
+      failed++;
+    }
+  }
+
+  // Test 2: scattered voxels, most subtrees partly filled
+  {
+    LOG_INFO("[Test 2] Random scatter... ");
+    uint32_t rng = 0x9E3779B9u;
+    for (int i = 0; i < n * n * 4; i++) {
+      rng ^= rng << 13;
+      rng ^= rng >> 17;
+      rng ^= rng << 5;
+      int x = (int)(rng % (uint32_t)n), y = (int)((rng >> 8) % (uint32_t)n), z = (int)((rng >> 16) % (uint32_t)n);
+      chunk_set_voxel(&cpu, x, y, z, true);
+    }
+    chunk_stamp(&gpu_chunk, &cpu, CHUNK_STAMP_REPLACE);
+
+    if (_test_compare(&builder, &cpu, &gpu_chunk, gpu, rm))
+      LOG_INFO("PASSED\n");
+    else {
+      LOG_INFO("FAILED\n");
+      failed++;
+    }
+  }
+
+  // Test 3: solid regions next to empty ones (full nodes, empty subtrees, the buffers of Test 2 reused)
+  {
+    LOG_INFO("[Test 3] Sphere and box... ");
+    chunk_clear(&cpu);
+    chunk_fill_sphere(&cpu, (VoxelCoord){n / 2, n / 2, n / 2}, n / 3, true);
+    chunk_fill_box(&cpu, (VoxelCoord){0, 0, 0}, (VoxelCoord){n - 1, n / 4, n - 1}, true);
+    chunk_fill_box(&cpu, (VoxelCoord){n / 4, 0, n / 4}, (VoxelCoord){n / 2, n / 8, n / 2}, false);
+    chunk_stamp(&gpu_chunk, &cpu, CHUNK_STAMP_REPLACE);
+
+    if (_test_compare(&builder, &cpu, &gpu_chunk, gpu, rm))
+      LOG_INFO("PASSED\n");
+    else {
+      LOG_INFO("FAILED\n");
+      failed++;
+    }
+  }
+
+  // Test 4: a mixed chunk with every voxel cleared: only the empty root
+  {
+    LOG_INFO("[Test 4] Emptied mixed chunk... ");
+    chunk_fill_box(&gpu_chunk, (VoxelCoord){0, 0, 0}, (VoxelCoord){n - 1, n - 1, n - 2}, false);
+    chunk_fill_box(&gpu_chunk, (VoxelCoord){0, 0, n - 1}, (VoxelCoord){n - 1, n - 1, n - 1}, false);
+    chunk_clear(&cpu);
+
+    bool ok = gpu_chunk.fill == CHUNK_FILL_MIXED;
+    ok = ok && _test_compare(&builder, &cpu, &gpu_chunk, gpu, rm);
+    if (ok)
+      LOG_INFO("PASSED\n");
+    else {
+      LOG_INFO("FAILED\n");
+      failed++;
+    }
+  }
+
+  chunk_destroy(&cpu);
+  chunk_destroy(&gpu_chunk);
+  return failed;
+#endif
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "chunk.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+  GPU tree build for chunks in CHUNK_BUILD_GPU mode: only the leaf words (bits[]) are uploaded, and
+  shaders/chunk_build.comp turns them into the nodes/child_indices chunk_rebuild would produce, written straight
+  into the chunk's gpu_node / gpu_child_indices buffers.
+
+  - reduce, per parent level bottom-up: bit c of a parent is set if child c is non-empty (the dense pyramid).
+  - scan, per parent level top-down: exclusive prefix sum of popcount(mask) over the level, in one workgroup.
+    It gives every node its first_child_index and every child its position in the compact level below.
+  - emit, all levels: non-empty nodes scatter to their compact index (the root is always node 0).
+
+  Passes are separated by buffer barriers. The word and pyramid buffers belong to the builder, so builds
+  recorded into the same command buffer run one after another. Dense storage and BFS layouts only: with
+  CHUNK_SPARSE_STORAGE or CHUNK_LAYOUT_DFS every chunk is built on the CPU.
+*/
+
+#define CHUNK_GPU_BUILD_SUPPORTED (!CHUNK_SPARSE_STORAGE && CHUNK_NODE_LAYOUT != CHUNK_LAYOUT_DFS)
+
+typedef struct ChunkGpuBuilder {
+  PipelineHandle pipeline;
+  ResHandle bits;    // the leaf words of the chunk being built
+  ResHandle scratch; // level header, dense parent masks and scans (layout in shaders/chunk_build.glsl)
+} ChunkGpuBuilder;
+
+// PUBLIC FUNCTIONS
+void chunk_gpu_builder_init(ChunkGpuBuilder *builder, M_Resource *rm, M_HotReload *pr);
+
+// Nodes of a tree with every node present: the output buffers of a GPU build are sized for it.
+uint32_t chunk_gpu_node_capacity(void);
+
+// Records the build of a chunk with need_upload set. Chunks that do not use the GPU build (chunk_uses_gpu_build)
+// go through chunk_upload. Expects the bindless set to be bound (cmd_bind_bindless).
+void chunk_gpu_build(ChunkGpuBuilder *builder, ChunkTree *chunk, M_GPU *gpu, M_Resource *rm, CmdBuffer cmd);
+
+// tests (need the GPU systems; compares against chunk_rebuild)
+int chunk_gpu_test(void);
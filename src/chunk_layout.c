@@ -0,0 +1,311 @@
+/* chunk_layout.c */
+#include "chunk.h"
+#include "morton.h"
+#include "terrain.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LAYOUT_BENCH_CHUNKS 64u
+
+static const char *const s_layout_names[] = {"split", "packed", "dfs"};
+
+// --- Private Prototypes ---
+static void _pack_dfs(const Node *nodes, const ChildIndex *child_indices, PackedNode *out);
+static bool _lookup_split(const Node *nodes, const ChildIndex *child_indices, uint64_t code);
+static bool _lookup_packed(const PackedNode *nodes, uint64_t code);
+static bool _lookup(const ChunkTree *chunk, const Vector *packed, int layout, uint64_t code);
+static bool _walk_chunk(const ChunkTree *chunk, int x, int y, int z);
+
+void chunk_build_layout(ChunkTree *chunk) {
+#if CHUNK_NODE_LAYOUT != CHUNK_LAYOUT_SPLIT
+  chunk_layout_pack((const Node *)chunk->nodes.data, (const ChildIndex *)chunk->child_indices.data,
+                    (uint32_t)chunk->nodes.length, CHUNK_NODE_LAYOUT, &chunk->packed);
+#else
+  (void)chunk;
+#endif
+}
+
+void chunk_layout_pack(const Node *nodes, const ChildIndex *child_indices, uint32_t count, int layout, Vector *out) {
+  vec_reserve(out, count);
+  out->length = count;
+  if (count == 0)
+    return;
+
+  PackedNode *packed = (PackedNode *)out->data;
+  if (layout == CHUNK_LAYOUT_DFS) {
+    _pack_dfs(nodes, child_indices, packed);
+    return;
+  }
+  for (uint32_t i = 0; i < count; i++)
+    packed[i] = (PackedNode){.mask = nodes[i].mask, .first_child_index = child_indices[i].first_child_index};
+}
+
+// -------------------- Tests --------------------
+
+int chunk_layout_test(void) {
+  LOG_INFO("Chunk Layout Test: CHUNK_NODE_LAYOUT=%s\n", s_layout_names[CHUNK_NODE_LAYOUT]);
+
+  ChunkTree *chunk = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(chunk);
+  Vector packed[3];
+  for (int l = 0; l < 3; l++)
+    vec_init(&packed[l], sizeof(PackedNode), NULL);
+  int cs = (int)CHUNK_SIZE;
+  bool ok = true;
+
+  // Test 1: every layout answers point queries like the voxel bits
+  LOG_INFO("[Test 1] Lookups in every layout match the voxels... ");
+  chunk_fill_test_chunk(chunk, 11u);
+  chunk_rebuild(chunk);
+  const Node *nodes = (const Node *)chunk->nodes.data;
+  const ChildIndex *child_indices = (const ChildIndex *)chunk->child_indices.data;
+  uint32_t count = (uint32_t)chunk->nodes.length;
+  chunk_layout_pack(nodes, child_indices, count, CHUNK_LAYOUT_PACKED, &packed[CHUNK_LAYOUT_PACKED]);
+  chunk_layout_pack(nodes, child_indices, count, CHUNK_LAYOUT_DFS, &packed[CHUNK_LAYOUT_DFS]);
+
+  unsigned int seed = 99u;
+  for (uint32_t i = 0; i < 20000u && ok; i++) {
+    seed = seed * 1103515245u + 12345u;
+    int x = (int)((seed >> 16) % (unsigned)cs), y = (int)((seed >> 8) % (unsigned)cs), z = (int)(seed % (unsigned)cs);
+    bool expected = chunk_get_voxel(chunk, x, y, z);
+    uint64_t code = morton_encode3((uint32_t)x, (uint32_t)y, (uint32_t)z);
+    for (int l = 0; l < 3 && ok; l++)
+      ok = _lookup(chunk, &packed[l], l, code) == expected;
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 2: DFS order puts every sibling group after its parent, the first child's group right behind its own
+  LOG_INFO("[Test 2] DFS order keeps groups next to their parents... ");
+  {
+    const PackedNode *dfs = (const PackedNode *)packed[CHUNK_LAYOUT_DFS].data;
+    for (uint32_t i = 0; i < count && ok; i++) {
+      uint32_t first = dfs[i].first_child_index;
+      if (first == 0u)
+        continue;
+      uint32_t group = (uint32_t)__builtin_popcountll(dfs[i].mask);
+      ok = first > i && first + group <= count;
+      if (ok && dfs[first].first_child_index != 0u)
+        ok = dfs[first].first_child_index == first + group;
+    }
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 3: the compiled layout follows incremental rebuilds (what traversal and uploads read)
+  LOG_INFO("[Test 3] %s layout tracks incremental rebuilds... ", s_layout_names[CHUNK_NODE_LAYOUT]);
+  for (uint32_t round = 0; round < 8u && ok; round++) {
+    for (uint32_t i = 0; i < 32u; i++) {
+      seed = seed * 1103515245u + 12345u;
+      chunk_set_voxel(chunk, (int)((seed >> 16) % (unsigned)cs), (int)((seed >> 8) % (unsigned)cs),
+                      (int)(seed % (unsigned)cs), (seed >> 31) != 0u);
+    }
+    chunk_rebuild_incremental(chunk);
+
+    for (uint32_t i = 0; i < 4000u && ok; i++) {
+      seed = seed * 1103515245u + 12345u;
+      int x = (int)((seed >> 16) % (unsigned)cs), y = (int)((seed >> 8) % (unsigned)cs), z = (int)(seed % (unsigned)cs);
+      ok = _walk_chunk(chunk, x, y, z) == chunk_get_voxel(chunk, x, y, z);
+    }
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+done:
+  for (int l = 0; l < 3; l++)
+    vec_destroy(&packed[l]);
+  chunk_destroy(chunk);
+  free(chunk);
+  return ok ? 0 : 1;
+}
+
+// -------------------- Benchmarks --------------------
+
+// All three layouts of the same terrain chunks: random point lookups, and rays marched voxel by voxel
+// (neighbouring rays and steps descend nearly the same paths). Chunks are spread so the trees outgrow the caches.
+void chunk_layout_bench(void) {
+  ChunkTree *chunks = (ChunkTree *)malloc(LAYOUT_BENCH_CHUNKS * sizeof(ChunkTree));
+  Vector packed[LAYOUT_BENCH_CHUNKS][3];
+  TerrainParams params;
+  terrain_default_params(&params, 1234u);
+
+  // mixed chunks only: uniform ones have nothing to lay out
+  uint32_t n = 0;
+  size_t total_nodes = 0;
+  for (int i = 0; i < 4096 && n < LAYOUT_BENCH_CHUNKS; i++) {
+    chunk_init(&chunks[n]);
+    int cy = (int)(params.base_height / (float)CHUNK_SIZE) + (i % 3) - 1;
+    if (terrain_generate(&params, i / 3 % 64, cy, i / 192, &chunks[n]) != TERRAIN_CHUNK_MIXED) {
+      chunk_destroy(&chunks[n]);
+      continue;
+    }
+    chunk_rebuild(&chunks[n]);
+    const Node *nodes = (const Node *)chunks[n].nodes.data;
+    const ChildIndex *child_indices = (const ChildIndex *)chunks[n].child_indices.data;
+    uint32_t count = (uint32_t)chunks[n].nodes.length;
+    for (int l = 1; l < 3; l++) {
+      vec_init(&packed[n][l], sizeof(PackedNode), NULL);
+      chunk_layout_pack(nodes, child_indices, count, l, &packed[n][l]);
+    }
+    total_nodes += count;
+    n++;
+  }
+
+  LOG_INFO("Chunk Layout Bench: %u terrain chunks, %zu nodes (CHUNK_SIZE=%u, compiled layout %s)\n", n, total_nodes,
+           (unsigned)CHUNK_SIZE, s_layout_names[CHUNK_NODE_LAYOUT]);
+  if (n == 0) {
+    free(chunks);
+    return;
+  }
+
+  enum { LOOKUPS = 1 << 21, RAYS = 1 << 14 };
+  uint64_t *codes = (uint64_t *)malloc(LOOKUPS * sizeof(uint64_t));
+  uint32_t *owners = (uint32_t *)malloc(LOOKUPS * sizeof(uint32_t));
+  unsigned int seed = 777u;
+  for (uint32_t i = 0; i < LOOKUPS; i++) {
+    seed = seed * 1103515245u + 12345u;
+    owners[i] = (seed >> 8) % n;
+    seed = seed * 1103515245u + 12345u;
+    codes[i] = ((uint64_t)seed * 2654435761ull) & (VOXELS_PER_CHUNK - 1ull);
+  }
+
+  for (int l = 0; l < 3; l++) {
+    uint32_t hits = 0;
+    uint64_t t0 = time_now_ns();
+    for (uint32_t i = 0; i < LOOKUPS; i++)
+      hits += _lookup(&chunks[owners[i]], &packed[owners[i]][l], l, codes[i]) ? 1u : 0u;
+    uint64_t t1 = time_now_ns();
+
+    // rays in 16x16 bundles per chunk, sideways through the terrain surface, one lookup per voxel step
+    uint64_t steps = 0;
+    uint32_t ray_hits = 0;
+    for (uint32_t r = 0; r < RAYS; r++) {
+      const ChunkTree *chunk = &chunks[(r / 256u) % n];
+      const Vector *p = &packed[(r / 256u) % n][l];
+      float y = (float)(r % 16u) * (float)CHUNK_SIZE / 16.0f, z = (float)(r / 16u % 16u) * (float)CHUNK_SIZE / 16.0f;
+      for (float x = 0.0f; x < (float)CHUNK_SIZE; x += 1.0f, y += 0.25f) {
+        int iy = (int)y % (int)CHUNK_SIZE;
+        steps++;
+        if (_lookup(chunk, p, l, morton_encode3((uint32_t)x, (uint32_t)iy, (uint32_t)z))) {
+          ray_hits++;
+          break;
+        }
+      }
+    }
+    uint64_t t2 = time_now_ns();
+
+    LOG_INFO("  %-6s: random %7.2f Mlookups/s (%u%% solid)  coherent rays %7.2f Msteps/s (%u%% hit)\n",
+             s_layout_names[l], LOOKUPS / ((double)(t1 - t0) / 1e9) / 1e6, hits * 100u / LOOKUPS,
+             (double)steps / ((double)(t2 - t1) / 1e9) / 1e6, ray_hits * 100u / RAYS);
+  }
+
+  for (uint32_t i = 0; i < n; i++) {
+    for (int l = 1; l < 3; l++)
+      vec_destroy(&packed[i][l]);
+    chunk_destroy(&chunks[i]);
+  }
+  free(codes);
+  free(owners);
+  free(chunks);
+}
+
+// --- Private Functions ---
+
+// Sibling groups in depth-first order. A group is emitted whole when its parent is reached, then the subtrees
+// of its members follow one after another; the stack holds (old index, new index) of nodes still to expand.
+static void _pack_dfs(const Node *nodes, const ChildIndex *child_indices, PackedNode *out) {
+  uint32_t stack[64u * TREE_LEVELS][2];
+  uint32_t top = 0, next = 1;
+
+  out[0] = (PackedNode){.mask = nodes[0].mask};
+  stack[top][0] = 0;
+  stack[top][1] = 0;
+  top++;
+
+  while (top > 0) {
+    top--;
+    uint32_t old_index = stack[top][0], new_index = stack[top][1];
+    uint32_t first = child_indices[old_index].first_child_index;
+    if (first == 0u || nodes[old_index].mask == 0ull)
+      continue;
+
+    uint32_t group = (uint32_t)__builtin_popcountll(nodes[old_index].mask);
+    out[new_index].first_child_index = next;
+    for (uint32_t c = 0; c < group; c++)
+      out[next + c] = (PackedNode){.mask = nodes[first + c].mask};
+
+    // last sibling pushed first, so the first one's subtree comes right behind the group
+    for (uint32_t c = group; c-- > 0;) {
+      stack[top][0] = first + c;
+      stack[top][1] = next + c;
+      top++;
+    }
+    next += group;
+  }
+}
+
+static bool _lookup_split(const Node *nodes, const ChildIndex *child_indices, uint64_t code) {
+  uint32_t index = 0;
+  for (int d = (int)TREE_LEVELS - 1; d >= 0; d--) {
+    uint64_t mask = nodes[index].mask;
+    uint64_t bit = 1ull << CHILD_SLOT(code, (uint32_t)d);
+    if ((mask & bit) == 0ull)
+      return false;
+    if (d == 0)
+      return true;
+    index = child_indices[index].first_child_index + (uint32_t)__builtin_popcountll(mask & (bit - 1ull));
+  }
+  return false;
+}
+
+static bool _lookup_packed(const PackedNode *nodes, uint64_t code) {
+  uint32_t index = 0;
+  for (int d = (int)TREE_LEVELS - 1; d >= 0; d--) {
+    PackedNode node = nodes[index];
+    uint64_t bit = 1ull << CHILD_SLOT(code, (uint32_t)d);
+    if ((node.mask & bit) == 0ull)
+      return false;
+    if (d == 0)
+      return true;
+    index = node.first_child_index + (uint32_t)__builtin_popcountll(node.mask & (bit - 1ull));
+  }
+  return false;
+}
+
+// layout CHUNK_LAYOUT_SPLIT reads the chunk's own arrays, the others `packed`
+static bool _lookup(const ChunkTree *chunk, const Vector *packed, int layout, uint64_t code) {
+  if (chunk->nodes.length == 0)
+    return false;
+  if (layout == CHUNK_LAYOUT_SPLIT)
+    return _lookup_split((const Node *)chunk->nodes.data, (const ChildIndex *)chunk->child_indices.data, code);
+  return _lookup_packed((const PackedNode *)packed->data, code);
+}
+
+// Through the CHUNK_NODE_LAYOUT accessors, like traverse_svo and chunk_ray.c.
+static bool _walk_chunk(const ChunkTree *chunk, int x, int y, int z) {
+  if (chunk->nodes.length == 0)
+    return false;
+
+  uint64_t code = morton_encode3((uint32_t)x, (uint32_t)y, (uint32_t)z);
+  uint32_t index = 0;
+  for (int d = (int)TREE_LEVELS - 1; d >= 0; d--) {
+    uint64_t mask = CHUNK_NODE_MASK(chunk, index);
+    uint64_t bit = 1ull << CHILD_SLOT(code, (uint32_t)d);
+    if ((mask & bit) == 0ull)
+      return false;
+    if (d == 0)
+      return true;
+    index = CHUNK_NODE_FIRST_CHILD(chunk, index) + (uint32_t)__builtin_popcountll(mask & (bit - 1ull));
+  }
+  return false;
+}
@@ -0,0 +1,268 @@
+/* chunk_lod.c */
+#include "chunk.h"
+#include "morton.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// --- Private Prototypes ---
+static uint32_t _lod_count(const ChunkTree *chunk);
+static uint64_t _majority_mask(const ChunkTree *chunk, uint32_t index, uint32_t level);
+static uint64_t _subtree_voxels(const ChunkTree *chunk, uint32_t index, uint32_t level);
+static bool _check_lods(const ChunkTree *chunk, uint32_t *counts);
+
+void chunk_build_lods(ChunkTree *chunk) {
+#if CHUNK_LOD_COUNT > 0
+  if (chunk->lod_rule == CHUNK_LOD_NONE)
+    return;
+
+  const Node *nodes = (const Node *)chunk->nodes.data;
+  const ChildIndex *child_indices = (const ChildIndex *)chunk->child_indices.data;
+
+  for (uint32_t k = 1; k <= CHUNK_LOD_COUNT; k++) {
+    ChunkLod *lod = &chunk->lods[k - 1];
+
+    // levels are stored root first, so the top levels are a prefix of the compact arrays
+    uint32_t count = 0;
+    for (uint32_t d = k; d < (uint32_t)TREE_LEVELS; d++)
+      count += chunk->level_count[d];
+    if (chunk->nodes.length == 0)
+      count = 0;
+    uint32_t leaf_start = count - (count ? chunk->level_count[k] : 0u);
+
+    vec_reserve(&lod->nodes, count);
+    vec_reserve(&lod->child_indices, count);
+    lod->nodes.length = count;
+    lod->child_indices.length = count;
+    if (count == 0)
+      continue;
+
+    Node *out_nodes = (Node *)lod->nodes.data;
+    ChildIndex *out_children = (ChildIndex *)lod->child_indices.data;
+    memcpy(out_nodes, nodes, count * sizeof(Node));
+    memcpy(out_children, child_indices, leaf_start * sizeof(ChildIndex));
+    memset(out_children + leaf_start, 0, (count - leaf_start) * sizeof(ChildIndex));
+
+    if (chunk->lod_rule == CHUNK_LOD_MAJORITY) {
+      for (uint32_t i = leaf_start; i < count; i++)
+        out_nodes[i].mask = _majority_mask(chunk, i, k);
+    }
+  }
+#else
+  (void)chunk;
+#endif
+}
+
+void chunk_set_lod(ChunkTree *chunk, uint32_t lod) {
+  uint32_t max = _lod_count(chunk);
+  if (lod > max)
+    lod = max;
+  if (lod == chunk->lod)
+    return;
+
+  chunk->lod = lod;
+  chunk->need_upload = true;
+}
+
+const Node *chunk_lod_nodes(const ChunkTree *chunk, uint32_t lod, uint32_t *out_count) {
+#if CHUNK_LOD_COUNT > 0
+  if (lod > 0 && lod <= _lod_count(chunk)) {
+    *out_count = (uint32_t)chunk->lods[lod - 1].nodes.length;
+    return (const Node *)chunk->lods[lod - 1].nodes.data;
+  }
+#endif
+  *out_count = (uint32_t)chunk->nodes.length;
+  return (const Node *)chunk->nodes.data;
+}
+
+const ChildIndex *chunk_lod_child_indices(const ChunkTree *chunk, uint32_t lod) {
+#if CHUNK_LOD_COUNT > 0
+  if (lod > 0 && lod <= _lod_count(chunk))
+    return (const ChildIndex *)chunk->lods[lod - 1].child_indices.data;
+#endif
+  return (const ChildIndex *)chunk->child_indices.data;
+}
+
+bool chunk_lod_get_cell(const ChunkTree *chunk, uint32_t lod, int x, int y, int z) {
+  if (lod > _lod_count(chunk))
+    return false;
+
+  uint32_t shift = 2u * lod;
+  int cells = (int)(CHUNK_SIZE >> shift);
+  if (x < 0 || y < 0 || z < 0 || x >= cells || y >= cells || z >= cells)
+    return false;
+
+  uint32_t count;
+  const Node *nodes = chunk_lod_nodes(chunk, lod, &count);
+  const ChildIndex *child_indices = chunk_lod_child_indices(chunk, lod);
+  if (count == 0)
+    return false;
+
+  uint64_t code = morton_encode3((uint32_t)x << shift, (uint32_t)y << shift, (uint32_t)z << shift);
+  uint32_t index = 0;
+  for (uint32_t d = (uint32_t)TREE_LEVELS - 1u;; d--) {
+    uint64_t mask = nodes[index].mask;
+    uint64_t bit = 1ull << CHILD_SLOT(code, d);
+    if ((mask & bit) == 0ull)
+      return false;
+    if (d == lod)
+      return true;
+    index = child_indices[index].first_child_index + (uint32_t)__builtin_popcountll(mask & (bit - 1ull));
+  }
+}
+
+size_t chunk_gpu_bytes(const ChunkTree *chunk, uint32_t lod) {
+  uint32_t count;
+  chunk_lod_nodes(chunk, lod, &count);
+  return (size_t)count * CHUNK_GPU_NODE_BYTES;
+}
+
+// -------------------- Tests --------------------
+
+int chunk_lod_test(void) {
+  LOG_INFO("Chunk LOD Test: %u coarse levels\n", (unsigned)CHUNK_LOD_COUNT);
+  if (CHUNK_LOD_COUNT == 0) {
+    LOG_INFO("SKIPPED (TREE_LEVELS=1 has no coarser level)\n");
+    return 0;
+  }
+
+  ChunkTree *chunk = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(chunk);
+  uint32_t cells = (uint32_t)(CHUNK_SIZE >> 2u) * (CHUNK_SIZE >> 2u) * (CHUNK_SIZE >> 2u);
+  uint32_t *counts = (uint32_t *)malloc(cells * sizeof(uint32_t));
+  bool ok = true;
+
+  LOG_INFO("[Test 1] OR and majority LODs match a brute-force downsample... ");
+  const ChunkLodRule rules[] = {CHUNK_LOD_OR, CHUNK_LOD_MAJORITY};
+  for (uint32_t r = 0; r < 2u && ok; r++) {
+    chunk_clear(chunk);
+    chunk->lod_rule = rules[r];
+    chunk_fill_test_chunk(chunk, 7u + r);
+    chunk_rebuild(chunk);
+    ok = _check_lods(chunk, counts);
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  LOG_INFO("[Test 2] Incremental rebuilds refresh the LODs... ");
+  for (uint32_t round = 0; round < 8u && ok; round++) {
+    for (uint32_t i = 0; i < 20u; i++) {
+      int v = (int)((round * 131u + i * 37u) % CHUNK_SIZE);
+      chunk_set_voxel(chunk, v, (int)((i * 11u) % CHUNK_SIZE), (int)((round * 7u + i) % CHUNK_SIZE), (i & 1u) == 0u);
+    }
+    chunk_rebuild_incremental(chunk);
+    ok = _check_lods(chunk, counts);
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  LOG_INFO("[Test 3] Coarser LODs are smaller and selectable... ");
+  size_t full_bytes = chunk_gpu_bytes(chunk, 0);
+  size_t lod1_bytes = chunk_gpu_bytes(chunk, 1);
+
+  chunk->need_upload = false;
+  chunk_set_lod(chunk, CHUNK_LOD_COUNT + 5u);
+  ok = chunk->lod == CHUNK_LOD_COUNT && chunk->need_upload;
+  for (uint32_t k = 1; k <= CHUNK_LOD_COUNT && ok; k++)
+    ok = chunk_gpu_bytes(chunk, k) < chunk_gpu_bytes(chunk, k - 1u);
+
+  // without a rule there is nothing coarser to select
+  chunk->lod_rule = CHUNK_LOD_NONE;
+  chunk_set_lod(chunk, 1);
+  ok = ok && chunk->lod == 0;
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED (%zu bytes full, %zu at LOD 1)\n", full_bytes, lod1_bytes);
+
+done:
+  free(counts);
+  chunk_destroy(chunk);
+  free(chunk);
+  return ok ? 0 : 1;
+}
+
+// --- Private Functions ---
+
+static uint32_t _lod_count(const ChunkTree *chunk) {
+  return chunk->lod_rule == CHUNK_LOD_NONE ? 0u : (uint32_t)CHUNK_LOD_COUNT;
+}
+
+// Leaf mask of a LOD `level` node: a cell is kept if at least half of its voxels are solid.
+static uint64_t _majority_mask(const ChunkTree *chunk, uint32_t index, uint32_t level) {
+  const Node *nodes = (const Node *)chunk->nodes.data;
+  const ChildIndex *child_indices = (const ChildIndex *)chunk->child_indices.data;
+
+  uint64_t mask = nodes[index].mask;
+  uint32_t child = child_indices[index].first_child_index;
+  uint64_t half = 1ull << (LEVEL_SHIFT(level) - 1u); // a child holds 64^level voxels
+  uint64_t out = 0;
+
+  for (uint64_t m = mask; m; m &= m - 1ull, child++) {
+    if (_subtree_voxels(chunk, child, level - 1u) >= half)
+      out |= m & (~m + 1ull);
+  }
+  return out;
+}
+
+static uint64_t _subtree_voxels(const ChunkTree *chunk, uint32_t index, uint32_t level) {
+  const Node *nodes = (const Node *)chunk->nodes.data;
+  uint64_t mask = nodes[index].mask;
+  if (level == 0)
+    return (uint64_t)__builtin_popcountll(mask);
+
+  const ChildIndex *child_indices = (const ChildIndex *)chunk->child_indices.data;
+  uint32_t first = child_indices[index].first_child_index;
+  uint32_t n = (uint32_t)__builtin_popcountll(mask);
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < n; i++)
+    sum += _subtree_voxels(chunk, first + i, level - 1u);
+  return sum;
+}
+
+// Compares every cell of every LOD against counts gathered from the voxel bits.
+static bool _check_lods(const ChunkTree *chunk, uint32_t *counts) {
+  for (uint32_t k = 1; k <= CHUNK_LOD_COUNT; k++) {
+    uint32_t shift = 2u * k;
+    uint32_t cells = (uint32_t)(CHUNK_SIZE >> shift);
+    memset(counts, 0, (size_t)cells * cells * cells * sizeof(uint32_t));
+
+    for (uint64_t w = 0; w < WORDS_PER_CHUNK; w++) {
+      for (uint64_t word = chunk_get_word(chunk, w); word; word &= word - 1ull) {
+        uint32_t x, y, z;
+        morton_decode3((w << 6) | (uint64_t)__builtin_ctzll(word), &x, &y, &z);
+        counts[(x >> shift) + (y >> shift) * cells + (z >> shift) * cells * cells]++;
+      }
+    }
+
+    uint64_t voxels_per_cell = 1ull << (3u * shift);
+    for (uint32_t i = 0; i < cells * cells * cells; i++) {
+      bool expected = chunk->lod_rule == CHUNK_LOD_MAJORITY ? counts[i] * 2ull >= voxels_per_cell : counts[i] > 0;
+      if (chunk_lod_get_cell(chunk, k, (int)(i % cells), (int)((i / cells) % cells), (int)(i / (cells * cells))) !=
+          expected)
+        return false;
+    }
+
+    // above the leaves the OR tree is the full tree's prefix, and leaves do not point anywhere
+    uint32_t count;
+    const Node *nodes = chunk_lod_nodes(chunk, k, &count);
+    const ChildIndex *child_indices = chunk_lod_child_indices(chunk, k);
+    uint32_t leaf_start = count - chunk->level_count[k];
+    if (memcmp(child_indices, chunk->child_indices.data, leaf_start * sizeof(ChildIndex)) != 0)
+      return false;
+    for (uint32_t i = leaf_start; i < count; i++) {
+      if (child_indices[i].first_child_index != 0)
+        return false;
+    }
+    if (chunk->lod_rule == CHUNK_LOD_OR && memcmp(nodes, chunk->nodes.data, count * sizeof(Node)) != 0)
+      return false;
+  }
+  return true;
+}
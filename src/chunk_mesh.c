@@ -0,0 +1,542 @@
+/* chunk_mesh.c */
+#include "chunk_mesh.h"
+#include "morton.h"
+#include "terrain.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MESH_S CHUNK_MESH_SECTION_SIZE
+
+// Per-thread meshing memory, allocated on first use.
+typedef struct MeshScratch {
+  uint64_t cols[AXIS_COUNT][64 * 64]; // occupancy per axis a: [u * 64 + v], bit = coordinate along a
+  uint64_t planes[2][64];             // neighbour layer just before (0) / after (1) the section: [u] bit v
+  uint64_t slices[64][64];            // visible faces of one direction: [d][u] bit v
+  uint64_t bricks[16 * 16 * 16];      // leaf words of the section, [(z * n + y) * n + x]
+} MeshScratch;
+
+// --- Private Prototypes ---
+static MeshScratch *_thread_scratch(void);
+static void _scratch_key_create(void);
+static inline uint32_t _local_bit(uint32_t x, uint32_t y, uint32_t z);
+static inline uint64_t _swap_index_bits(uint64_t x, uint64_t mask, uint32_t shift);
+static inline uint64_t _brick_columns(uint64_t w, uint32_t axis);
+static void _transpose_nibbles(uint64_t a[16]);
+static bool _extract_columns(MeshScratch *s, const ChunkTree *chunk, const int origin[3]);
+static void _extract_layer(const ChunkTree *src, uint32_t axis, int c, const int origin[3], uint64_t plane[64]);
+static void _neighbor_layers(MeshScratch *s, const ChunkTree *chunk,
+                             const ChunkTree *const neighbors[CHUNK_MESH_FACE_COUNT], uint32_t axis,
+                             const int origin[3]);
+static void _mesh_face(ChunkMesh *mesh, MeshScratch *s, uint32_t face);
+static void _emit_quad(ChunkMesh *mesh, uint32_t face, uint32_t plane, uint32_t u, uint32_t v, uint32_t w,
+                       uint32_t h);
+static bool _test_solid(const ChunkTree *chunk, const ChunkTree *const neighbors[CHUNK_MESH_FACE_COUNT], int x,
+                        int y, int z);
+static bool _check_mesh(const ChunkMesh *mesh, const ChunkTree *chunk,
+                        const ChunkTree *const neighbors[CHUNK_MESH_FACE_COUNT], uint32_t section,
+                        uint32_t *out_faces);
+
+void chunk_mesh_init(ChunkMesh *mesh) {
+  memset(mesh, 0, sizeof(*mesh));
+  vec_init(&mesh->vertices, sizeof(MeshVertex), NULL);
+}
+
+void chunk_mesh_destroy(ChunkMesh *mesh) {
+  vec_destroy(&mesh->vertices);
+  memset(mesh, 0, sizeof(*mesh));
+}
+
+VoxelCoord chunk_mesh_section_origin(uint32_t section) {
+  const uint32_t n = CHUNK_MESH_SECTIONS_PER_AXIS;
+  return (VoxelCoord){(int)((section % n) * MESH_S), (int)((section / n % n) * MESH_S),
+                      (int)((section / (n * n)) * MESH_S)};
+}
+
+void chunk_mesh_build(ChunkMesh *mesh, const ChunkTree *chunk, const ChunkTree *const neighbors[CHUNK_MESH_FACE_COUNT],
+                      uint32_t section) {
+  mesh->vertices.length = 0;
+  mesh->quad_count = 0;
+  memset(mesh->face_first, 0, sizeof(mesh->face_first));
+  memset(mesh->face_quads, 0, sizeof(mesh->face_quads));
+
+  MeshScratch *s = _thread_scratch();
+  VoxelCoord o = chunk_mesh_section_origin(section);
+  const int origin[3] = {o.x, o.y, o.z};
+  if (!_extract_columns(s, chunk, origin))
+    return;
+
+  for (uint32_t a = 0; a < AXIS_COUNT; a++) {
+    _neighbor_layers(s, chunk, neighbors, a, origin);
+    for (uint32_t f = a * 2u; f < a * 2u + 2u; f++) {
+      mesh->face_first[f] = mesh->quad_count;
+      _mesh_face(mesh, s, f);
+      mesh->face_quads[f] = mesh->quad_count - mesh->face_first[f];
+    }
+  }
+}
+
+// --- Private Functions ---
+
+static pthread_key_t s_scratch_key;
+static pthread_once_t s_scratch_once = PTHREAD_ONCE_INIT;
+
+// One scratch per meshing thread, freed with the thread.
+static MeshScratch *_thread_scratch(void) {
+  pthread_once(&s_scratch_once, _scratch_key_create);
+  MeshScratch *scratch = (MeshScratch *)pthread_getspecific(s_scratch_key);
+  if (!scratch) {
+    scratch = (MeshScratch *)malloc(sizeof(MeshScratch));
+    pthread_setspecific(s_scratch_key, scratch);
+  }
+  return scratch;
+}
+
+static void _scratch_key_create(void) { pthread_key_create(&s_scratch_key, free); }
+
+// Bit of voxel (x, y, z) inside its leaf word (x0 y0 z0 x1 y1 z1).
+static inline uint32_t _local_bit(uint32_t x, uint32_t y, uint32_t z) {
+  return (x & 1u) | ((y & 1u) << 1) | ((z & 1u) << 2) | ((x >> 1) << 3) | ((y >> 1) << 4) | ((z >> 1) << 5);
+}
+
+// Delta swap: bits whose index has bit i set and bit j clear trade places with their partner (index + shift).
+static inline uint64_t _swap_index_bits(uint64_t x, uint64_t mask, uint32_t shift) {
+  uint64_t t = ((x >> shift) ^ x) & mask;
+  return x ^ t ^ (t << shift);
+}
+
+// 16x16 matrix of 4-bit cells: nibble c of a[r] moves to nibble r of a[c]. Swaps off-diagonal blocks, halving
+// the block size each round.
+static void _transpose_nibbles(uint64_t a[16]) {
+  static const uint64_t masks[4] = {0x00000000FFFFFFFFull, 0x0000FFFF0000FFFFull, 0x00FF00FF00FF00FFull,
+                                    0x0F0F0F0F0F0F0F0Full};
+  for (uint32_t i = 0, j = 8u; j != 0u; i++, j >>= 1) {
+    for (uint32_t k = 0; k < 16u; k = ((k | j) + 1u) & ~j) {
+      uint64_t t = ((a[k] >> (4u * j)) ^ a[k | j]) & masks[i];
+      a[k] ^= t << (4u * j);
+      a[k | j] ^= t;
+    }
+  }
+}
+
+// Permutes a leaf word (x0 y0 z0 x1 y1 z1) so that nibble v + 4u holds the 4 voxels of column (u, v) along
+// axis, lowest first (u = axis + 1, v = axis + 2, like the column arrays).
+static inline uint64_t _brick_columns(uint64_t w, uint32_t axis) {
+  switch (axis) {
+  case 0: // -> x0 x1 z0 z1 y0 y1
+    w = _swap_index_bits(w, 0x00CC00CC00CC00CCull, 6);
+    w = _swap_index_bits(w, 0x00000000FF00FF00ull, 24);
+    return _swap_index_bits(w, 0x00000000FFFF0000ull, 16);
+  case 1: // -> y0 y1 x0 x1 z0 z1
+    w = _swap_index_bits(w, 0x2222222222222222ull, 1);
+    w = _swap_index_bits(w, 0x0000CCCC0000CCCCull, 14);
+    return _swap_index_bits(w, 0x0000F0F00000F0F0ull, 12);
+  default: // -> z0 z1 y0 y1 x0 x1
+    w = _swap_index_bits(w, 0x0A0A0A0A0A0A0A0Aull, 3);
+    w = _swap_index_bits(w, 0x00000000CCCCCCCCull, 30);
+    w = _swap_index_bits(w, 0x00000000F0F0F0F0ull, 28);
+    w = _swap_index_bits(w, 0x0000FF000000FF00ull, 8);
+    return _swap_index_bits(w, 0x00000000FFFF0000ull, 16);
+  }
+}
+
+// Occupancy columns of every axis straight from the leaf words: each brick holds 4 bits of 16 columns, a row of
+// bricks along the axis fills them. Returns false if the section is empty.
+static bool _extract_columns(MeshScratch *s, const ChunkTree *chunk, const int origin[3]) {
+  const uint32_t n = MESH_S / 4u;
+  uint64_t any = 0ull;
+  for (uint32_t bz = 0; bz < n; bz++) {
+    for (uint32_t by = 0; by < n; by++) {
+      for (uint32_t bx = 0; bx < n; bx++) {
+        uint64_t w = chunk_get_word(chunk, morton_encode3((uint32_t)origin[0] / 4u + bx,
+                                                          (uint32_t)origin[1] / 4u + by,
+                                                          (uint32_t)origin[2] / 4u + bz));
+        s->bricks[(bz * n + by) * n + bx] = w;
+        any |= w;
+      }
+    }
+  }
+  if (any == 0ull)
+    return false;
+  if (MESH_S < 64u)
+    memset(s->cols, 0, sizeof(s->cols));
+
+  const uint32_t stride[3] = {1u, n, n * n};
+  for (uint32_t a = 0; a < AXIS_COUNT; a++) {
+    const uint32_t ua = (a + 1u) % 3u, va = (a + 2u) % 3u;
+    for (uint32_t bu = 0; bu < n; bu++) {
+      for (uint32_t bv = 0; bv < n; bv++) {
+        // row of bricks along the axis: nibble c of rows[d] is column c at brick d, transposed into rows[c]
+        const uint64_t *row = &s->bricks[bu * stride[ua] + bv * stride[va]];
+        uint64_t rows[16] = {0}, row_or = 0ull, row_and = ~0ull;
+        for (uint32_t d = 0; d < n; d++) {
+          uint64_t w = row[d * stride[a]];
+          rows[d] = w;
+          row_or |= w;
+          row_and &= w;
+        }
+
+        if (row_and == ~0ull) {
+          // solid run (common below terrain): every column is full, no shuffling needed
+          for (uint32_t c = 0; c < 16u; c++)
+            rows[c] = MESH_S == 64u ? ~0ull : (1ull << MESH_S) - 1ull;
+        } else if (row_or != 0ull) {
+          for (uint32_t d = 0; d < n; d++)
+            rows[d] = _brick_columns(rows[d], a);
+          _transpose_nibbles(rows);
+        }
+
+        uint64_t *cols = &s->cols[a][bu * 4u * 64u + bv * 4u];
+        for (uint32_t c = 0; c < 16u; c++)
+          cols[(c >> 2) * 64u + (c & 3u)] = rows[c];
+      }
+    }
+  }
+  return true;
+}
+
+// Voxels of src with coordinate c on `axis`, over the section's u/v range: plane[u] bit v.
+static void _extract_layer(const ChunkTree *src, uint32_t axis, int c, const int origin[3], uint64_t plane[64]) {
+  memset(plane, 0, 64u * sizeof(uint64_t));
+  if (!src)
+    return;
+
+  const uint32_t ua = (axis + 1u) % 3u, va = (axis + 2u) % 3u;
+  const uint32_t bricks = MESH_S / 4u;
+  uint32_t b[3], l[3];
+  b[axis] = (uint32_t)c / 4u;
+  l[axis] = (uint32_t)c & 3u;
+
+  for (uint32_t bu = 0; bu < bricks; bu++) {
+    for (uint32_t bv = 0; bv < bricks; bv++) {
+      b[ua] = (uint32_t)origin[ua] / 4u + bu;
+      b[va] = (uint32_t)origin[va] / 4u + bv;
+      uint64_t w = chunk_get_word(src, morton_encode3(b[0], b[1], b[2]));
+      if (w == 0ull)
+        continue;
+
+      for (l[ua] = 0; l[ua] < 4u; l[ua]++)
+        for (l[va] = 0; l[va] < 4u; l[va]++)
+          plane[bu * 4u + l[ua]] |= ((w >> _local_bit(l[0], l[1], l[2])) & 1ull) << (bv * 4u + l[va]);
+    }
+  }
+}
+
+// The layers touching the section on both sides of `axis`: the same chunk inside it, else the neighbour.
+static void _neighbor_layers(MeshScratch *s, const ChunkTree *chunk,
+                             const ChunkTree *const neighbors[CHUNK_MESH_FACE_COUNT], uint32_t axis,
+                             const int origin[3]) {
+  const int cs = (int)CHUNK_SIZE;
+  int before = origin[axis] - 1, after = origin[axis] + (int)MESH_S;
+
+  if (before < 0)
+    _extract_layer(neighbors ? neighbors[axis * 2u + 1u] : NULL, axis, cs - 1, origin, s->planes[0]);
+  else
+    _extract_layer(chunk, axis, before, origin, s->planes[0]);
+
+  if (after >= cs)
+    _extract_layer(neighbors ? neighbors[axis * 2u] : NULL, axis, 0, origin, s->planes[1]);
+  else
+    _extract_layer(chunk, axis, after, origin, s->planes[1]);
+}
+
+static void _mesh_face(ChunkMesh *mesh, MeshScratch *s, uint32_t face) {
+  const uint32_t axis = face / 2u;
+  const bool positive = (face & 1u) == 0u;
+  const uint64_t *cols = s->cols[axis];
+  const uint64_t *nb = s->planes[positive ? 1 : 0];
+  const uint64_t top = 1ull << (MESH_S - 1u);
+
+  // cull: a face is visible where the next voxel along the normal is empty, the border bit comes from nb
+  uint64_t used = 0ull;
+  for (uint32_t u = 0; u < MESH_S; u++) {
+    for (uint32_t v = 0; v < MESH_S; v++) {
+      uint64_t col = cols[u * 64u + v];
+      if (col == 0ull)
+        continue;
+      uint64_t edge = (nb[u] >> v) & 1ull;
+      uint64_t faces = positive ? col & ~((col >> 1) | (edge ? top : 0ull)) : col & ~((col << 1) | edge);
+
+      // scatter into slices: slice d, row u, bit v (a slice is cleared on first use)
+      for (uint64_t f = faces; f; f &= f - 1ull) {
+        uint32_t d = (uint32_t)__builtin_ctzll(f);
+        if (!(used & (1ull << d))) {
+          memset(s->slices[d], 0, sizeof(s->slices[d]));
+          used |= 1ull << d;
+        }
+        s->slices[d][u] |= 1ull << v;
+      }
+    }
+  }
+
+  // greedy: take the lowest run of a row, grow it over the following rows that contain the whole run
+  for (uint64_t sl = used; sl; sl &= sl - 1ull) {
+    uint32_t d = (uint32_t)__builtin_ctzll(sl);
+    uint64_t *rows = s->slices[d];
+    uint32_t plane = positive ? d + 1u : d;
+
+    for (uint32_t u = 0; u < MESH_S; u++) {
+      while (rows[u]) {
+        uint32_t v = (uint32_t)__builtin_ctzll(rows[u]);
+        uint64_t rest = rows[u] >> v;
+        uint32_t h = ~rest == 0ull ? 64u - v : (uint32_t)__builtin_ctzll(~rest);
+        uint64_t run = (h == 64u ? ~0ull : (1ull << h) - 1ull) << v;
+
+        uint32_t w = 1;
+        while (u + w < MESH_S && (rows[u + w] & run) == run) {
+          rows[u + w] &= ~run;
+          w++;
+        }
+        rows[u] &= ~run;
+        _emit_quad(mesh, face, plane, u, v, w, h);
+      }
+    }
+  }
+}
+
+// Quad on `plane` along the face axis, spanning [u, u + w) x [v, v + h); counter-clockwise seen from outside.
+static void _emit_quad(ChunkMesh *mesh, uint32_t face, uint32_t plane, uint32_t u, uint32_t v, uint32_t w,
+                       uint32_t h) {
+  const uint32_t axis = face / 2u, ua = (axis + 1u) % 3u, va = (axis + 2u) % 3u;
+  // (u, v) corners in order; cross(e_u, e_v) = e_axis, so this order faces +axis
+  const uint32_t cu[4] = {u, u + w, u + w, u}, cv[4] = {v, v, v + h, v + h};
+  static const uint32_t order[2][4] = {{0, 1, 2, 3}, {0, 3, 2, 1}};
+
+  // vec_reserve grows to exactly what is asked, double instead
+  if (mesh->vertices.length + 4u > mesh->vertices.capacity)
+    vec_reserve(&mesh->vertices, mesh->vertices.capacity * 2u > 256u ? mesh->vertices.capacity * 2u : 256u);
+  MeshVertex *out = (MeshVertex *)mesh->vertices.data + mesh->vertices.length;
+  for (uint32_t i = 0; i < 4u; i++) {
+    uint32_t k = order[face & 1u][i];
+    uint32_t p[3];
+    p[axis] = plane;
+    p[ua] = cu[k];
+    p[va] = cv[k];
+    out[i] = MESH_VERTEX_PACK(p[0], p[1], p[2], face);
+  }
+  mesh->vertices.length += 4u;
+  mesh->quad_count++;
+}
+
+// -------------------- Tests/Benchmarks --------------------
+
+// Voxel lookup across the chunk border (one axis out of range at a time, like the mesher sees it).
+static bool _test_solid(const ChunkTree *chunk, const ChunkTree *const neighbors[CHUNK_MESH_FACE_COUNT], int x,
+                        int y, int z) {
+  const int cs = (int)CHUNK_SIZE;
+  int p[3] = {x, y, z};
+  for (uint32_t a = 0; a < AXIS_COUNT; a++) {
+    if (p[a] >= 0 && p[a] < cs)
+      continue;
+    const ChunkTree *nb = neighbors ? neighbors[a * 2u + (p[a] < 0 ? 1u : 0u)] : NULL;
+    p[a] = p[a] < 0 ? p[a] + cs : p[a] - cs;
+    return nb && chunk_get_voxel(nb, p[0], p[1], p[2]);
+  }
+  return chunk_get_voxel(chunk, x, y, z);
+}
+
+// Every visible face of the section is covered by exactly one quad, nothing else is, and windings face out.
+static bool _check_mesh(const ChunkMesh *mesh, const ChunkTree *chunk,
+                        const ChunkTree *const neighbors[CHUNK_MESH_FACE_COUNT], uint32_t section,
+                        uint32_t *out_faces) {
+  const uint32_t s3 = MESH_S * MESH_S * MESH_S;
+  uint8_t *covered = (uint8_t *)calloc(s3, 1);
+  VoxelCoord o = chunk_mesh_section_origin(section);
+  const MeshVertex *verts = (const MeshVertex *)mesh->vertices.data;
+  bool ok = mesh->vertices.length == (size_t)mesh->quad_count * 4u;
+  uint32_t covered_faces = 0;
+
+  for (uint32_t f = 0; f < CHUNK_MESH_FACE_COUNT && ok; f++) {
+    const uint32_t axis = f / 2u, ua = (axis + 1u) % 3u, va = (axis + 2u) % 3u;
+    ok = mesh->face_first[f] + mesh->face_quads[f] <= mesh->quad_count;
+
+    for (uint32_t q = mesh->face_first[f]; q < mesh->face_first[f] + mesh->face_quads[f] && ok; q++) {
+      const MeshVertex *v = &verts[q * 4u];
+      int p[4][3];
+      for (uint32_t i = 0; i < 4u; i++) {
+        p[i][0] = (int)MESH_VERTEX_X(v[i]);
+        p[i][1] = (int)MESH_VERTEX_Y(v[i]);
+        p[i][2] = (int)MESH_VERTEX_Z(v[i]);
+        ok = ok && MESH_VERTEX_FACE(v[i]) == f && p[i][axis] == p[0][axis];
+      }
+
+      // winding: (p1 - p0) x (p2 - p0) points along the face normal
+      int e1[3], e2[3];
+      for (uint32_t a = 0; a < 3u; a++) {
+        e1[a] = p[1][a] - p[0][a];
+        e2[a] = p[2][a] - p[0][a];
+      }
+      int n = e1[ua] * e2[va] - e1[va] * e2[ua];
+      ok = ok && ((f & 1u) ? n < 0 : n > 0);
+
+      int lo[3], hi[3];
+      for (uint32_t a = 0; a < 3u; a++) {
+        lo[a] = hi[a] = p[0][a];
+        for (uint32_t i = 1; i < 4u; i++) {
+          lo[a] = p[i][a] < lo[a] ? p[i][a] : lo[a];
+          hi[a] = p[i][a] > hi[a] ? p[i][a] : hi[a];
+        }
+      }
+      int d = (f & 1u) ? lo[axis] : lo[axis] - 1;
+
+      for (int cu = lo[ua]; cu < hi[ua] && ok; cu++) {
+        for (int cv = lo[va]; cv < hi[va] && ok; cv++) {
+          int c[3];
+          c[axis] = d;
+          c[ua] = cu;
+          c[va] = cv;
+          uint32_t idx = ((uint32_t)c[2] * MESH_S + (uint32_t)c[1]) * MESH_S + (uint32_t)c[0];
+          ok = d >= 0 && d < (int)MESH_S && !(covered[idx] & (1u << f));
+          if (!ok)
+            break;
+          covered[idx] |= (uint8_t)(1u << f);
+          covered_faces++;
+
+          int x = o.x + c[0], y = o.y + c[1], z = o.z + c[2];
+          int nx = x + (f == 0 ? 1 : f == 1 ? -1 : 0), ny = y + (f == 2 ? 1 : f == 3 ? -1 : 0);
+          int nz = z + (f == 4 ? 1 : f == 5 ? -1 : 0);
+          ok = chunk_get_voxel(chunk, x, y, z) && !_test_solid(chunk, neighbors, nx, ny, nz);
+        }
+      }
+    }
+  }
+
+  // nothing visible was left out
+  uint32_t visible = 0;
+  for (uint32_t i = 0; i < s3 && ok; i++) {
+    int x = o.x + (int)(i % MESH_S), y = o.y + (int)(i / MESH_S % MESH_S), z = o.z + (int)(i / (MESH_S * MESH_S));
+    if (!chunk_get_voxel(chunk, x, y, z))
+      continue;
+    visible += !_test_solid(chunk, neighbors, x + 1, y, z) + !_test_solid(chunk, neighbors, x - 1, y, z) +
+               !_test_solid(chunk, neighbors, x, y + 1, z) + !_test_solid(chunk, neighbors, x, y - 1, z) +
+               !_test_solid(chunk, neighbors, x, y, z + 1) + !_test_solid(chunk, neighbors, x, y, z - 1);
+  }
+  ok = ok && visible == covered_faces;
+
+  free(covered);
+  if (out_faces)
+    *out_faces = visible;
+  return ok;
+}
+
+int chunk_mesh_test(void) {
+  LOG_INFO("Chunk Mesh Test: CHUNK_SIZE=%u, %u section(s)\n", (unsigned)CHUNK_SIZE, (unsigned)CHUNK_MESH_SECTIONS);
+  const int cs = (int)CHUNK_SIZE;
+
+  ChunkTree *trees = (ChunkTree *)malloc(3u * sizeof(ChunkTree));
+  ChunkTree *chunk = &trees[0], *solid = &trees[1], *other = &trees[2];
+  for (uint32_t i = 0; i < 3u; i++)
+    chunk_init(&trees[i]);
+  chunk_fill_box(solid, (VoxelCoord){0, 0, 0}, (VoxelCoord){cs - 1, cs - 1, cs - 1}, true);
+
+  ChunkMesh mesh;
+  chunk_mesh_init(&mesh);
+  bool ok = true;
+
+  // Test 1: a lone voxel is a cube of 6 unit quads
+  {
+    LOG_INFO("[Test 1] Single voxel... ");
+    chunk_set_voxel(chunk, 1, 2, 3, true);
+    chunk_mesh_build(&mesh, chunk, NULL, 0);
+    ok = mesh.quad_count == 6u && _check_mesh(&mesh, chunk, NULL, 0, NULL);
+    for (uint32_t f = 0; f < CHUNK_MESH_FACE_COUNT; f++)
+      ok = ok && mesh.face_quads[f] == 1u;
+
+    if (ok)
+      LOG_INFO("PASSED\n");
+    else
+      LOG_INFO("FAILED (%u quads)\n", mesh.quad_count);
+  }
+
+  // Test 2: a solid chunk merges into one quad per side, and into nothing once every side has a solid neighbour
+  if (ok) {
+    LOG_INFO("[Test 2] Solid chunk, open and enclosed... ");
+    const ChunkTree *enclosed[CHUNK_MESH_FACE_COUNT] = {solid, solid, solid, solid, solid, solid};
+    chunk_mesh_build(&mesh, solid, NULL, 0);
+    uint32_t open_quads = mesh.quad_count;
+    ok = _check_mesh(&mesh, solid, NULL, 0, NULL);
+    chunk_mesh_build(&mesh, solid, enclosed, 0);
+    ok = ok && mesh.quad_count == 0u;
+
+    // sections only border other sections of the same chunk on their inner sides
+    uint32_t expected = CHUNK_MESH_SECTIONS == 1u ? 6u : 3u;
+    ok = ok && open_quads == expected;
+
+    if (ok)
+      LOG_INFO("PASSED\n");
+    else
+      LOG_INFO("FAILED (%u quads open, %u enclosed)\n", open_quads, mesh.quad_count);
+  }
+
+  // Test 3: noisy chunk against mixed neighbours covers exactly the visible faces
+  if (ok) {
+    LOG_INFO("[Test 3] Visible faces match a per-voxel scan... ");
+    chunk_fill_test_chunk(chunk, 17u);
+    chunk_fill_test_chunk(other, 91u);
+    const ChunkTree *neighbors[CHUNK_MESH_FACE_COUNT] = {solid, other, NULL, other, solid, NULL};
+    const uint32_t sections[2] = {0u, CHUNK_MESH_SECTIONS - 1u};
+
+    uint32_t quads = 0, faces = 0;
+    for (uint32_t i = 0; i < 2u && ok; i++) {
+      uint32_t visible = 0;
+      chunk_mesh_build(&mesh, chunk, neighbors, sections[i]);
+      ok = _check_mesh(&mesh, chunk, neighbors, sections[i], &visible);
+      quads += mesh.quad_count;
+      faces += visible;
+    }
+
+    if (ok)
+      LOG_INFO("PASSED (%u faces in %u quads)\n", faces, quads);
+    else
+      LOG_INFO("FAILED\n");
+  }
+
+  chunk_mesh_destroy(&mesh);
+  for (uint32_t i = 0; i < 3u; i++)
+    chunk_destroy(&trees[i]);
+  free(trees);
+
+  if (!ok)
+    return 1;
+  LOG_INFO("All chunk mesh tests passed.\n");
+  return 0;
+}
+
+void chunk_mesh_bench(void) {
+  const uint32_t reps = 64;
+  ChunkTree *chunk = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(chunk);
+  ChunkMesh mesh;
+  chunk_mesh_init(&mesh);
+
+  TerrainParams params;
+  terrain_default_params(&params, 1337u);
+
+  LOG_INFO("Chunk Mesh Bench: section %u^3, %u reps per chunk\n", (unsigned)MESH_S, reps);
+  for (uint32_t c = 0; c < 3u; c++) {
+    const char *name = "terrain surface";
+    if (c == 0)
+      terrain_generate(&params, 0, (int)floorf(params.base_height / (float)CHUNK_SIZE) - 1, 0, chunk);
+    else if (c == 1) {
+      name = "terrain caves";
+      terrain_generate(&params, 1, (int)floorf((float)(params.cave_min_y / 2) / (float)CHUNK_SIZE), -1, chunk);
+    } else {
+      name = "noisy sphere";
+      chunk_fill_test_chunk(chunk, 5u);
+    }
+
+    uint64_t t0 = time_now_ns();
+    for (uint32_t r = 0; r < reps; r++)
+      chunk_mesh_build(&mesh, chunk, NULL, 0);
+    double us = (double)(time_now_ns() - t0) / reps / 1e3;
+
+    LOG_INFO("  %-16s %8.1f us  %7u quads  %8.1f KiB vertices\n", name, us, mesh.quad_count,
+             (double)mesh.vertices.length * sizeof(MeshVertex) / 1024.0);
+  }
+
+  chunk_mesh_destroy(&mesh);
+  chunk_destroy(chunk);
+  free(chunk);
+}
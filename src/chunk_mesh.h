@@ -0,0 +1,67 @@
+#pragma once
+
+#include "chunk.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+  Binary greedy mesher: triangle meshes for a raster path, straight from the voxel bits.
+
+  - Occupancy is turned into 64-bit columns along each axis (one bit per voxel). A face is visible where
+    col & ~(col >> 1) (and the mirrored shift): a column of 64 voxels is culled with a handful of ops.
+    The bit shifted in at the ends comes from the neighbour chunk (or section), so borders cull too.
+  - Visible faces of each slice are merged greedily into quads: runs along a row, then rows extended while
+    the next one holds the same run.
+  - Chunks wider than 64 voxels are meshed in 64^3 sections (CHUNK_MESH_SECTIONS), vertex coordinates are
+    relative to the section origin.
+
+  Vertex format (MeshVertex, 4 per quad, counter-clockwise seen from outside):
+    bits  0..6  x, 7..13 y, 14..20 z  (0..64, section-local corner)
+    bits 21..23 face (ChunkMeshFace)
+  Draw with a shared quad index buffer (0 1 2, 0 2 3 per quad); the normal comes from the face.
+*/
+
+#define CHUNK_MESH_SECTION_SIZE (CHUNK_SIZE < 64u ? CHUNK_SIZE : 64u)
+#define CHUNK_MESH_SECTIONS_PER_AXIS (CHUNK_SIZE / CHUNK_MESH_SECTION_SIZE)
+#define CHUNK_MESH_SECTIONS (CHUNK_MESH_SECTIONS_PER_AXIS * CHUNK_MESH_SECTIONS_PER_AXIS * CHUNK_MESH_SECTIONS_PER_AXIS)
+
+#define MESH_VERTEX_PACK(x, y, z, face)                                                                             \
+  ((uint32_t)(x) | ((uint32_t)(y) << 7) | ((uint32_t)(z) << 14) | ((uint32_t)(face) << 21))
+#define MESH_VERTEX_X(v) ((v) & 127u)
+#define MESH_VERTEX_Y(v) (((v) >> 7) & 127u)
+#define MESH_VERTEX_Z(v) (((v) >> 14) & 127u)
+#define MESH_VERTEX_FACE(v) (((v) >> 21) & 7u)
+
+typedef uint32_t MeshVertex;
+
+typedef enum ChunkMeshFace {
+  CHUNK_MESH_POS_X,
+  CHUNK_MESH_NEG_X,
+  CHUNK_MESH_POS_Y,
+  CHUNK_MESH_NEG_Y,
+  CHUNK_MESH_POS_Z,
+  CHUNK_MESH_NEG_Z,
+  CHUNK_MESH_FACE_COUNT,
+} ChunkMeshFace;
+
+typedef struct ChunkMesh {
+  Vector vertices; // MeshVertex[], grouped by face so whole directions can be skipped (backface culling)
+  uint32_t face_first[CHUNK_MESH_FACE_COUNT]; // first quad of each face group
+  uint32_t face_quads[CHUNK_MESH_FACE_COUNT];
+  uint32_t quad_count;
+} ChunkMesh;
+
+// PUBLIC FUNCTIONS
+void chunk_mesh_init(ChunkMesh *mesh);
+void chunk_mesh_destroy(ChunkMesh *mesh);
+
+// Replaces mesh with the visible faces of one section of chunk (reads the voxel bits, no rebuild needed).
+// neighbors[face] is the chunk on that side, NULL = empty (faces on that border are kept).
+void chunk_mesh_build(ChunkMesh *mesh, const ChunkTree *chunk, const ChunkTree *const neighbors[CHUNK_MESH_FACE_COUNT],
+                      uint32_t section);
+// Chunk-local voxel coordinate of a section's origin.
+VoxelCoord chunk_mesh_section_origin(uint32_t section);
+
+// tests
+int chunk_mesh_test(void);
+void chunk_mesh_bench(void);
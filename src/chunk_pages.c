@@ -0,0 +1,153 @@
+/* chunk_pages.c */
+#include "chunk.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE_TABLE_MIN_CAPACITY 16u
+
+// --- Private Prototypes ---
+static uint32_t _hash(uint32_t key);
+static void _grow(ChunkPageTable *t);
+static void _insert_slot(ChunkPageTable *t, uint32_t key, uint32_t page);
+
+void chunk_pages_init(ChunkPageTable *t) {
+  memset(t, 0, sizeof(*t));
+  vec_init(&t->blocks, sizeof(ChunkPage *), NULL);
+  vec_init(&t->free_pages, sizeof(uint32_t), NULL);
+}
+
+void chunk_pages_destroy(ChunkPageTable *t) {
+  free(t->keys);
+  free(t->values);
+  for (uint32_t i = 0; i < t->blocks.length; i++)
+    free(((ChunkPage **)t->blocks.data)[i]);
+  vec_destroy(&t->blocks);
+  vec_destroy(&t->free_pages);
+  memset(t, 0, sizeof(*t));
+}
+
+void chunk_pages_clear(ChunkPageTable *t) {
+  // a cleared chunk gives its memory back instead of keeping the high-water mark
+  chunk_pages_destroy(t);
+  chunk_pages_init(t);
+}
+
+uint64_t *chunk_pages_find(const ChunkPageTable *t, uint32_t key) {
+  if (t->count == 0)
+    return NULL;
+
+  uint32_t mask = t->capacity - 1u;
+  for (uint32_t i = _hash(key) & mask;; i = (i + 1u) & mask) {
+    if (t->keys[i] == key)
+      return chunk_pages_at(t, t->values[i])->words;
+    if (t->keys[i] == CHUNK_PAGE_EMPTY)
+      return NULL;
+  }
+}
+
+uint64_t *chunk_pages_get_or_create(ChunkPageTable *t, uint32_t key) {
+  uint64_t *words = chunk_pages_find(t, key);
+  if (words)
+    return words;
+
+  // keep the load factor at or below 1/2
+  if ((t->count + 1u) * 2u > t->capacity)
+    _grow(t);
+
+  uint32_t page;
+  if (t->free_pages.length > 0) {
+    page = ((uint32_t *)t->free_pages.data)[--t->free_pages.length];
+  } else {
+    // whole blocks, so handing out a slot never moves the pages already handed out
+    if (t->slots == t->blocks.length * CHUNK_PAGE_BLOCK) {
+      ChunkPage *block = (ChunkPage *)malloc(CHUNK_PAGE_BLOCK * sizeof(ChunkPage));
+      vec_push(&t->blocks, &block);
+    }
+    page = t->slots++;
+  }
+
+  ChunkPage *p = chunk_pages_at(t, page);
+  memset(p, 0, sizeof(*p));
+
+  _insert_slot(t, key, page);
+  t->count++;
+  return p->words;
+}
+
+void chunk_pages_release(ChunkPageTable *t, uint32_t key) {
+  if (t->count == 0)
+    return;
+
+  uint32_t mask = t->capacity - 1u;
+  uint32_t i = _hash(key) & mask;
+  while (t->keys[i] != key) {
+    if (t->keys[i] == CHUNK_PAGE_EMPTY)
+      return;
+    i = (i + 1u) & mask;
+  }
+
+  vec_push(&t->free_pages, &t->values[i]);
+  t->keys[i] = CHUNK_PAGE_EMPTY;
+  t->count--;
+
+  // backward-shift deletion keeps probe chains intact without tombstones
+  for (uint32_t j = (i + 1u) & mask; t->keys[j] != CHUNK_PAGE_EMPTY; j = (j + 1u) & mask) {
+    uint32_t home = _hash(t->keys[j]) & mask;
+    // move j into the hole at i unless its home lies cyclically in (i, j]
+    bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+    if (stays)
+      continue;
+
+    t->keys[i] = t->keys[j];
+    t->values[i] = t->values[j];
+    t->keys[j] = CHUNK_PAGE_EMPTY;
+    i = j;
+  }
+}
+
+size_t chunk_pages_bytes(const ChunkPageTable *t) {
+  return t->blocks.length * CHUNK_PAGE_BLOCK * sizeof(ChunkPage) + t->blocks.capacity * sizeof(ChunkPage *) +
+         t->free_pages.capacity * sizeof(uint32_t) + (size_t)t->capacity * 2u * sizeof(uint32_t);
+}
+
+// --- Private Functions ---
+
+static uint32_t _hash(uint32_t key) {
+  // lowbias32 finalizer: page keys are dense Morton prefixes, so spread them out
+  key ^= key >> 16;
+  key *= 0x7feb352du;
+  key ^= key >> 15;
+  key *= 0x846ca68bu;
+  key ^= key >> 16;
+  return key;
+}
+
+static void _grow(ChunkPageTable *t) {
+  uint32_t *old_keys = t->keys;
+  uint32_t *old_values = t->values;
+  uint32_t old_capacity = t->capacity;
+
+  t->capacity = old_capacity ? old_capacity * 2u : PAGE_TABLE_MIN_CAPACITY;
+  t->keys = (uint32_t *)malloc(t->capacity * sizeof(uint32_t));
+  t->values = (uint32_t *)malloc(t->capacity * sizeof(uint32_t));
+  memset(t->keys, 0xFF, t->capacity * sizeof(uint32_t));
+
+  for (uint32_t i = 0; i < old_capacity; i++) {
+    if (old_keys[i] != CHUNK_PAGE_EMPTY)
+      _insert_slot(t, old_keys[i], old_values[i]);
+  }
+
+  free(old_keys);
+  free(old_values);
+}
+
+static void _insert_slot(ChunkPageTable *t, uint32_t key, uint32_t page) {
+  uint32_t mask = t->capacity - 1u;
+  uint32_t i = _hash(key) & mask;
+  while (t->keys[i] != CHUNK_PAGE_EMPTY)
+    i = (i + 1u) & mask;
+
+  t->keys[i] = key;
+  t->values[i] = page;
+}
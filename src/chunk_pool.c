@@ -0,0 +1,130 @@
+/* chunk_pool.c */
+#include "chunk.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+// Bitsets are carved out of slabs of about POOL_SLAB_BYTES (1 to POOL_SLAB_MAX_BITSETS per slab).
+#define POOL_SLAB_BYTES (4ull << 20)
+#define POOL_SLAB_MAX_BITSETS 256ull
+#define POOL_SLAB_BITSETS                                                                                              \
+  (uint32_t)(BYTES_PER_CHUNK_BITSET >= POOL_SLAB_BYTES                                                                 \
+                 ? 1ull                                                                                                \
+                 : (POOL_SLAB_BYTES / BYTES_PER_CHUNK_BITSET < POOL_SLAB_MAX_BITSETS                                   \
+                        ? POOL_SLAB_BYTES / BYTES_PER_CHUNK_BITSET                                                     \
+                        : POOL_SLAB_MAX_BITSETS))
+// cache-line aligned, like the rest of the SIMD-scanned storage
+#define POOL_STRIDE ((size_t)((BYTES_PER_CHUNK_BITSET + 63ull) & ~63ull))
+
+// One pool for the whole process: trees are swapped by value between world slots and loader staging trees,
+// so a bitset cannot belong to any single owner. Slabs stay until chunk_pool_trim finds them unused.
+typedef struct BitsetPool {
+  pthread_mutex_t mutex;
+  bool ready;
+  Vector slabs;     // uint64_t *[], POOL_SLAB_BITSETS bitsets each
+  Vector free_list; // uint64_t *[], released bitsets, handed out again before a new slab is carved
+  uint32_t used;
+} BitsetPool;
+
+static BitsetPool s_pool = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+// --- Private Prototypes ---
+static void _grow(BitsetPool *pool);
+static int _cmp_ptr(const void *a, const void *b);
+
+uint64_t *chunk_pool_acquire(void) {
+  BitsetPool *pool = &s_pool;
+  pthread_mutex_lock(&pool->mutex);
+  if (pool->free_list.length == 0)
+    _grow(pool);
+
+  uint64_t *bits = ((uint64_t **)pool->free_list.data)[--pool->free_list.length];
+  pool->used++;
+  pthread_mutex_unlock(&pool->mutex);
+  return bits;
+}
+
+void chunk_pool_release(uint64_t *bits) {
+  if (!bits)
+    return;
+
+  BitsetPool *pool = &s_pool;
+  pthread_mutex_lock(&pool->mutex);
+  vec_push(&pool->free_list, &bits);
+  pool->used--;
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+void chunk_pool_stats(ChunkPoolStats *out) {
+  BitsetPool *pool = &s_pool;
+  pthread_mutex_lock(&pool->mutex);
+  out->used = pool->used;
+  out->capacity = (uint32_t)pool->slabs.length * POOL_SLAB_BITSETS;
+  out->bytes = (size_t)out->capacity * BYTES_PER_CHUNK_BITSET;
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+size_t chunk_pool_trim(void) {
+  BitsetPool *pool = &s_pool;
+  pthread_mutex_lock(&pool->mutex);
+  if (pool->slabs.length == 0) {
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+  }
+
+  // sorted, the free list groups each slab's bitsets together and in slab order
+  uint8_t **slabs = (uint8_t **)pool->slabs.data;
+  uint64_t **free_list = (uint64_t **)pool->free_list.data;
+  qsort(slabs, pool->slabs.length, sizeof(uint8_t *), _cmp_ptr);
+  qsort(free_list, pool->free_list.length, sizeof(uint64_t *), _cmp_ptr);
+
+  size_t kept_slabs = 0, kept_free = 0, f = 0, released = 0;
+  for (size_t i = 0; i < pool->slabs.length; i++) {
+    uint8_t *begin = slabs[i], *end = begin + POOL_STRIDE * POOL_SLAB_BITSETS;
+    size_t first = f;
+    while (f < pool->free_list.length && (uint8_t *)free_list[f] < end)
+      f++;
+
+    // every bitset of the slab is free: the whole slab goes back to the system
+    if (f - first == POOL_SLAB_BITSETS) {
+      free(begin);
+      released += POOL_STRIDE * POOL_SLAB_BITSETS;
+      continue;
+    }
+    slabs[kept_slabs++] = begin;
+    for (size_t k = first; k < f; k++)
+      free_list[kept_free++] = free_list[k];
+  }
+  pool->slabs.length = kept_slabs;
+  pool->free_list.length = kept_free;
+
+  pthread_mutex_unlock(&pool->mutex);
+  return released;
+}
+
+// --- Private Functions ---
+
+// Called with the mutex held.
+static void _grow(BitsetPool *pool) {
+  if (!pool->ready) {
+    vec_init(&pool->slabs, sizeof(uint64_t *), NULL);
+    vec_init(&pool->free_list, sizeof(uint64_t *), NULL);
+    pool->ready = true;
+  }
+
+  uint8_t *slab = (uint8_t *)aligned_alloc(64, POOL_STRIDE * POOL_SLAB_BITSETS);
+  vec_push(&pool->slabs, &slab);
+
+  // pushed last to first, so a fresh slab is handed out in address order
+  vec_reserve(&pool->free_list, pool->free_list.length + POOL_SLAB_BITSETS);
+  for (uint32_t i = POOL_SLAB_BITSETS; i-- > 0;) {
+    uint64_t *bits = (uint64_t *)(slab + (size_t)i * POOL_STRIDE);
+    vec_push(&pool->free_list, &bits);
+  }
+}
+
+static int _cmp_ptr(const void *a, const void *b) {
+  uintptr_t x = *(const uintptr_t *)a;
+  uintptr_t y = *(const uintptr_t *)b;
+  return (x > y) - (x < y);
+}
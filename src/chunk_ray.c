@@ -0,0 +1,622 @@
+/* chunk_ray.c */
+#include "chunk_ray.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Per-packet ray setup, one array per component so the clip loops vectorize.
+typedef struct {
+  float o[AXIS_COUNT][CHUNK_RAY_PACKET];
+  float d[AXIS_COUNT][CHUNK_RAY_PACKET];
+  float inv[AXIS_COUNT][CHUNK_RAY_PACKET];
+  float t0[CHUNK_RAY_PACKET];
+  float t1[CHUNK_RAY_PACKET];
+  int axis[CHUNK_RAY_PACKET];
+} RayPacket;
+
+// --- Private Prototypes ---
+static bool _clip(const float o[3], const float d[3], const float inv[3], float max_t, float *t0, float *t1,
+                  int *axis);
+static void _clip_packet(RayPacket *p, uint32_t n, float max_t);
+static bool _trace(const ChunkTree *chunk, const uint8_t *distance, const float o[3], const float d[3],
+                   const float inv[3], float t, float t_end, int axis, ChunkRayHit *out, uint32_t *steps);
+static float _exit_box(const float o[3], const float d[3], const float inv[3], const int lo[3], const int hi[3],
+                       int *axis);
+static const uint8_t *_distance(const ChunkTree *chunk);
+static inline uint32_t _slot(const int c[3], uint32_t shift);
+static inline float _inv(float d);
+static void _miss(ChunkRayHit *out);
+static bool _reference_cast(const ChunkTree *chunk, const float o[3], const float d[3], float max_t, ChunkRayHit *out);
+static void _random_ray(unsigned int *seed, float o[3], float d[3]);
+static float _rand01(unsigned int *seed);
+
+bool chunk_raycast(const ChunkTree *chunk, const vec3 origin, const vec3 dir, float max_t, ChunkRayHit *out) {
+  float inv[AXIS_COUNT] = {_inv(dir[0]), _inv(dir[1]), _inv(dir[2])};
+  float t0, t1;
+  int axis;
+
+  if (!_clip(origin, dir, inv, max_t, &t0, &t1, &axis)) {
+    _miss(out);
+    return false;
+  }
+
+  return _trace(chunk, _distance(chunk), origin, dir, inv, t0, t1, axis, out, NULL);
+}
+
+void chunk_raycast_batch(const ChunkTree *chunk, const ChunkRayBatch *rays, uint32_t count, float max_t,
+                         ChunkRayHit *out) {
+  // an empty chunk (or one never rebuilt) cannot be hit: skip setup entirely
+  if (chunk->nodes.length == 0 || ((const Node *)chunk->nodes.data)[0].mask == 0ull) {
+    for (uint32_t i = 0; i < count; i++)
+      _miss(&out[i]);
+    return;
+  }
+
+  RayPacket p;
+  const uint8_t *distance = _distance(chunk);
+  for (uint32_t base = 0; base < count; base += CHUNK_RAY_PACKET) {
+    uint32_t n = count - base < CHUNK_RAY_PACKET ? count - base : CHUNK_RAY_PACKET;
+
+    for (uint32_t i = 0; i < n; i++) {
+      p.o[0][i] = rays->ox[base + i];
+      p.o[1][i] = rays->oy[base + i];
+      p.o[2][i] = rays->oz[base + i];
+      p.d[0][i] = rays->dx[base + i];
+      p.d[1][i] = rays->dy[base + i];
+      p.d[2][i] = rays->dz[base + i];
+    }
+
+    _clip_packet(&p, n, max_t);
+
+    // lanes diverge as soon as they reach different cells, so the walk itself is per lane
+    for (uint32_t i = 0; i < n; i++) {
+      if (p.t0[i] > p.t1[i]) {
+        _miss(&out[base + i]);
+        continue;
+      }
+      float o[AXIS_COUNT] = {p.o[0][i], p.o[1][i], p.o[2][i]};
+      float d[AXIS_COUNT] = {p.d[0][i], p.d[1][i], p.d[2][i]};
+      float inv[AXIS_COUNT] = {p.inv[0][i], p.inv[1][i], p.inv[2][i]};
+      _trace(chunk, distance, o, d, inv, p.t0[i], p.t1[i], p.axis[i], &out[base + i], NULL);
+    }
+  }
+}
+
+// -------------------- Tests --------------------
+
+int chunk_ray_test(void) {
+  ChunkTree *chunk = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(chunk);
+  LOG_INFO("Chunk Ray Test: CHUNK_SIZE=%u\n", (unsigned)CHUNK_SIZE);
+
+  int cs = (int)CHUNK_SIZE;
+  const char *names[] = {"sparse cloud", "terrain"};
+  bool ok = true;
+
+  for (uint32_t scene = 0; scene < 2u && ok; scene++) {
+    LOG_INFO("[Test %u] Hierarchical vs voxel DDA (%s)... ", scene + 1u, names[scene]);
+    unsigned int seed = 4711u + scene;
+    chunk_clear(chunk);
+
+    if (scene == 0) {
+      for (uint32_t i = 0; i < (uint32_t)(cs * cs / 4); i++) {
+        seed = seed * 1103515245u + 12345u;
+        chunk_set_voxel(chunk, (int)((seed >> 16) % (unsigned)cs), (int)((seed >> 8) % (unsigned)cs),
+                        (int)(seed % (unsigned)cs), true);
+      }
+    } else {
+      chunk_fill_box(chunk, (VoxelCoord){0, 0, 0}, (VoxelCoord){cs - 1, cs / 3, cs - 1}, true);
+      chunk_fill_sphere(chunk, (VoxelCoord){cs / 2, cs / 2, cs / 2}, cs / 5, true);
+      chunk_fill_box(chunk, (VoxelCoord){cs / 8, 0, cs / 8}, (VoxelCoord){cs / 4, cs - 1, cs / 4}, true);
+    }
+    chunk_rebuild(chunk);
+
+    uint32_t rays = 4000u, hits = 0;
+    for (uint32_t r = 0; r < rays && ok; r++) {
+      float o[3], d[3];
+      _random_ray(&seed, o, d);
+
+      ChunkRayHit a, b;
+      bool ha = chunk_raycast(chunk, o, d, 1e30f, &a);
+      bool hb = _reference_cast(chunk, o, d, 1e30f, &b);
+
+      ok = ha == hb;
+      if (ok && ha) {
+        hits++;
+        ok = memcmp(a.voxel, b.voxel, sizeof(ivec3)) == 0 && memcmp(a.normal, b.normal, sizeof(ivec3)) == 0 &&
+             fabsf(a.t - b.t) <= 1e-3f * (1.0f + fabsf(b.t));
+      }
+      if (!ok)
+        LOG_INFO("FAILED (ray %u: hit %d/%d voxel %d,%d,%d vs %d,%d,%d)\n", r, (int)ha, (int)hb, a.voxel[0],
+                 a.voxel[1], a.voxel[2], b.voxel[0], b.voxel[1], b.voxel[2]);
+    }
+
+    if (ok)
+      LOG_INFO("PASSED (%u/%u hits)\n", hits, rays);
+  }
+
+  // Test 3: the batch API returns exactly what single casts return
+  if (ok) {
+    LOG_INFO("[Test 3] Batched packets vs single rays... ");
+    enum { N = 1003 };
+    float *soa = (float *)malloc(6u * N * sizeof(float));
+    ChunkRayHit *batch = (ChunkRayHit *)malloc(N * sizeof(ChunkRayHit));
+    unsigned int seed = 99u;
+
+    for (uint32_t i = 0; i < N; i++) {
+      float o[3], d[3];
+      _random_ray(&seed, o, d);
+      for (uint32_t a = 0; a < 3u; a++) {
+        soa[a * N + i] = o[a];
+        soa[(3u + a) * N + i] = d[a];
+      }
+    }
+    // axis-aligned rays exercise the zero-direction paths
+    soa[3u * N] = 0.0f, soa[4u * N] = 0.0f, soa[5u * N] = -1.0f;
+
+    ChunkRayBatch rb = {soa, soa + N, soa + 2 * N, soa + 3 * N, soa + 4 * N, soa + 5 * N};
+    chunk_raycast_batch(chunk, &rb, N, 1e30f, batch);
+
+    for (uint32_t i = 0; i < N && ok; i++) {
+      float o[3] = {rb.ox[i], rb.oy[i], rb.oz[i]};
+      float d[3] = {rb.dx[i], rb.dy[i], rb.dz[i]};
+      ChunkRayHit single;
+      chunk_raycast(chunk, o, d, 1e30f, &single);
+      ok = single.hit == batch[i].hit &&
+           (!single.hit || (memcmp(single.voxel, batch[i].voxel, sizeof(ivec3)) == 0 && single.t == batch[i].t));
+    }
+
+    free(soa);
+    free(batch);
+    if (ok)
+      LOG_INFO("PASSED\n");
+    else
+      LOG_INFO("FAILED (batch differs from single casts)\n");
+  }
+
+  // Test 4: edits patched into the distance field by incremental rebuilds never let a ray skip a voxel
+  if (ok) {
+    LOG_INFO("[Test 4] Distance field skips after incremental edits... ");
+    unsigned int seed = 1234u;
+    chunk_clear(chunk);
+    for (uint32_t i = 0; i < 4u; i++) {
+      seed = seed * 1103515245u + 12345u;
+      VoxelCoord c = {(int)(seed % (unsigned)cs), (int)((seed >> 8) % (unsigned)cs),
+                      (int)((seed >> 16) % (unsigned)cs)};
+      chunk_fill_sphere(chunk, c, cs / 16 + 1, true);
+    }
+    chunk_rebuild(chunk);
+
+    uint32_t hits = 0;
+    for (uint32_t round = 0; round < 16u && ok; round++) {
+      // single voxels appear in open space (patched), every fourth round a sphere is carved out (full pass)
+      for (uint32_t i = 0; i < 3u; i++) {
+        seed = seed * 1103515245u + 12345u;
+        chunk_set_voxel(chunk, (int)((seed >> 16) % (unsigned)cs), (int)((seed >> 8) % (unsigned)cs),
+                        (int)(seed % (unsigned)cs), true);
+      }
+      if (round % 4u == 3u) {
+        seed = seed * 1103515245u + 12345u;
+        VoxelCoord c = {(int)(seed % (unsigned)cs), (int)((seed >> 8) % (unsigned)cs), cs / 2};
+        chunk_fill_sphere(chunk, c, cs / 8, false);
+      }
+      chunk_rebuild_incremental(chunk);
+
+      for (uint32_t r = 0; r < 500u && ok; r++) {
+        float o[3], d[3];
+        _random_ray(&seed, o, d);
+        ChunkRayHit a, b;
+        bool ha = chunk_raycast(chunk, o, d, 1e30f, &a);
+        bool hb = _reference_cast(chunk, o, d, 1e30f, &b);
+        ok = ha == hb && (!ha || memcmp(a.voxel, b.voxel, sizeof(ivec3)) == 0);
+        hits += ha ? 1u : 0u;
+      }
+    }
+
+    if (ok)
+      LOG_INFO("PASSED (%u/%u hits)\n", hits, 16u * 500u);
+    else
+      LOG_INFO("FAILED (a ray skipped past a voxel)\n");
+  }
+
+  chunk_destroy(chunk);
+  free(chunk);
+  return ok ? 0 : 1;
+}
+
+// -------------------- Benchmarks --------------------
+
+void chunk_ray_bench(void) {
+  ChunkTree *chunk = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(chunk);
+
+  int cs = (int)CHUNK_SIZE;
+  const char *names[] = {"noise", "sparse", "dense"};
+  enum { N = 1 << 16 };
+  float *soa = (float *)malloc(6u * N * sizeof(float));
+  ChunkRayHit *hits = (ChunkRayHit *)malloc(N * sizeof(ChunkRayHit));
+
+  LOG_INFO("Chunk Ray Bench: %d rays per pass (CHUNK_SIZE=%u)\n", N, (unsigned)CHUNK_SIZE);
+
+  for (uint32_t scene = 0; scene < 3u; scene++) {
+    unsigned int seed = 8080u;
+    chunk_clear(chunk);
+    if (scene == 0) {
+      // ~0.1% uniform occupancy: every coarse cell is occupied, only 4^3 cells can be skipped
+      for (uint64_t i = 0; i < VOXELS_PER_CHUNK / 1024u; i++) {
+        seed = seed * 1103515245u + 12345u;
+        chunk_set_voxel(chunk, (int)((seed >> 16) % (unsigned)cs), (int)((seed >> 8) % (unsigned)cs),
+                        (int)(seed % (unsigned)cs), true);
+      }
+    } else if (scene == 1) {
+      // a few small objects in open space
+      for (uint32_t i = 0; i < 8u; i++) {
+        seed = seed * 1103515245u + 12345u;
+        VoxelCoord c = {(int)(seed % (unsigned)cs), (int)((seed >> 8) % (unsigned)cs), (int)((seed >> 16) % (unsigned)cs)};
+        chunk_fill_sphere(chunk, c, cs / 16, true);
+      }
+    } else {
+      chunk_fill_box(chunk, (VoxelCoord){0, 0, 0}, (VoxelCoord){cs - 1, cs / 2, cs - 1}, true);
+      for (uint32_t i = 0; i < 32u; i++) {
+        seed = seed * 1103515245u + 12345u;
+        chunk_fill_sphere(chunk, (VoxelCoord){(int)(seed % (unsigned)cs), cs / 2, (int)((seed >> 8) % (unsigned)cs)},
+                          cs / 10, true);
+      }
+    }
+    chunk_rebuild(chunk);
+
+    for (uint32_t i = 0; i < N; i++) {
+      float o[3], d[3];
+      _random_ray(&seed, o, d);
+      for (uint32_t a = 0; a < 3u; a++) {
+        soa[a * N + i] = o[a];
+        soa[(3u + a) * N + i] = d[a];
+      }
+    }
+    ChunkRayBatch rb = {soa, soa + N, soa + 2 * N, soa + 3 * N, soa + 4 * N, soa + 5 * N};
+
+    uint32_t hit_count = 0;
+    uint64_t t0 = time_now_ns();
+    for (uint32_t i = 0; i < N; i++) {
+      float o[3] = {rb.ox[i], rb.oy[i], rb.oz[i]};
+      float d[3] = {rb.dx[i], rb.dy[i], rb.dz[i]};
+      hit_count += chunk_raycast(chunk, o, d, 1e30f, &hits[i]) ? 1u : 0u;
+    }
+    uint64_t t1 = time_now_ns();
+    chunk_raycast_batch(chunk, &rb, N, 1e30f, hits);
+    uint64_t t2 = time_now_ns();
+
+    uint32_t ref_count = 0;
+    uint64_t t3 = time_now_ns();
+    for (uint32_t i = 0; i < N / 16u; i++) {
+      float o[3] = {rb.ox[i], rb.oy[i], rb.oz[i]};
+      float d[3] = {rb.dx[i], rb.dy[i], rb.dz[i]};
+      ChunkRayHit h;
+      ref_count += _reference_cast(chunk, o, d, 1e30f, &h) ? 1u : 0u;
+    }
+    uint64_t t4 = time_now_ns();
+
+    LOG_INFO("  %-6s (%u%% hit): single %6.2f Mrays/s  batch %6.2f Mrays/s  voxel DDA %6.2f Mrays/s\n", names[scene],
+             hit_count * 100u / N, N / ((double)(t1 - t0) / 1e9) / 1e6, N / ((double)(t2 - t1) / 1e9) / 1e6,
+             (N / 16u) / ((double)(t4 - t3 ? t4 - t3 : 1) / 1e9) / 1e6);
+    (void)ref_count;
+
+    // cells visited per ray, and time, with the tree alone and with the distance field on top
+    const uint8_t *fields[2] = {NULL, _distance(chunk)};
+    uint64_t steps[2] = {0, 0}, ns[2] = {0, 0};
+    for (uint32_t f = 0; f < 2u; f++) {
+      uint64_t s0 = time_now_ns();
+      for (uint32_t i = 0; i < N; i++) {
+        float o[3] = {rb.ox[i], rb.oy[i], rb.oz[i]};
+        float d[3] = {rb.dx[i], rb.dy[i], rb.dz[i]};
+        float inv[3] = {_inv(d[0]), _inv(d[1]), _inv(d[2])};
+        float ta, tb;
+        int axis;
+        uint32_t n = 0;
+        if (_clip(o, d, inv, 1e30f, &ta, &tb, &axis))
+          _trace(chunk, fields[f], o, d, inv, ta, tb, axis, &hits[i], &n);
+        steps[f] += n;
+      }
+      ns[f] = time_now_ns() - s0;
+    }
+    LOG_INFO("  %-6s steps/ray: tree %6.2f  + distance field %6.2f  (%6.2f vs %6.2f Mrays/s)\n", names[scene],
+             (double)steps[0] / N, (double)steps[1] / N, N / ((double)ns[0] / 1e9) / 1e6,
+             N / ((double)ns[1] / 1e9) / 1e6);
+  }
+
+  free(soa);
+  free(hits);
+  chunk_destroy(chunk);
+  free(chunk);
+}
+
+// --- Private Functions ---
+
+static inline float _inv(float d) { return d != 0.0f ? 1.0f / d : INFINITY; }
+
+static void _miss(ChunkRayHit *out) { memset(out, 0, sizeof(*out)); }
+
+// Clips the ray to the chunk box [0, CHUNK_SIZE]^3 and [0, max_t]. axis: entry face axis, -1 if it starts inside.
+static bool _clip(const float o[3], const float d[3], const float inv[3], float max_t, float *t0, float *t1,
+                  int *axis) {
+  float lo = 0.0f, hi = max_t;
+  int entry = -1;
+
+  for (int a = 0; a < AXIS_COUNT; a++) {
+    if (d[a] == 0.0f) {
+      if (o[a] < 0.0f || o[a] >= (float)CHUNK_SIZE)
+        return false;
+      continue;
+    }
+
+    float ta = (0.0f - o[a]) * inv[a];
+    float tb = ((float)CHUNK_SIZE - o[a]) * inv[a];
+    float near = fminf(ta, tb), far = fmaxf(ta, tb);
+    if (near > lo) {
+      lo = near;
+      entry = a;
+    }
+    hi = fminf(hi, far);
+  }
+
+  *t0 = lo;
+  *t1 = hi;
+  *axis = entry;
+  return lo <= hi;
+}
+
+// Same as _clip for a whole packet; misses come out as t0 > t1.
+static void _clip_packet(RayPacket *p, uint32_t n, float max_t) {
+  for (uint32_t i = 0; i < CHUNK_RAY_PACKET; i++) {
+    p->t0[i] = 0.0f;
+    p->t1[i] = i < n ? max_t : -1.0f;
+    p->axis[i] = -1;
+  }
+
+  for (int a = 0; a < AXIS_COUNT; a++) {
+    for (uint32_t i = 0; i < n; i++) {
+      float o = p->o[a][i], d = p->d[a][i];
+      float inv = _inv(d);
+      p->inv[a][i] = inv;
+
+      // parallel to the slab: inside it costs nothing, outside it is a miss
+      bool parallel = d == 0.0f;
+      bool outside = o < 0.0f || o >= (float)CHUNK_SIZE;
+      float ta = (0.0f - o) * inv;
+      float tb = ((float)CHUNK_SIZE - o) * inv;
+      float near = parallel ? (outside ? INFINITY : -INFINITY) : fminf(ta, tb);
+      float far = parallel ? INFINITY : fmaxf(ta, tb);
+
+      if (near > p->t0[i]) {
+        p->t0[i] = near;
+        p->axis[i] = a;
+      }
+      p->t1[i] = fminf(p->t1[i], far);
+    }
+  }
+}
+
+// Child slot of voxel c inside a node whose children are 4^(shift/2) voxels wide (x0 y0 z0 x1 y1 z1).
+static inline uint32_t _slot(const int c[3], uint32_t shift) {
+  uint32_t x = ((uint32_t)c[0] >> shift) & 3u;
+  uint32_t y = ((uint32_t)c[1] >> shift) & 3u;
+  uint32_t z = ((uint32_t)c[2] >> shift) & 3u;
+  return (x & 1u) | ((y & 1u) << 1) | ((z & 1u) << 2) | ((x & 2u) << 2) | ((y & 2u) << 3) | ((z & 2u) << 4);
+}
+
+// distance: the chunk's empty-space field, or NULL to skip by the tree alone. steps (optional) counts the cells
+// the ray visits, descents included.
+static bool _trace(const ChunkTree *chunk, const uint8_t *distance, const float o[3], const float d[3],
+                   const float inv[3], float t, float t_end, int axis, ChunkRayHit *out, uint32_t *steps) {
+  if (chunk->nodes.length == 0) {
+    _miss(out);
+    return false;
+  }
+
+  // voxel containing the entry point; the entry axis is snapped exactly onto the chunk face.
+  // Truncation instead of floorf is exact here: every coordinate is clamped to a non-negative range.
+  int c[AXIS_COUNT];
+  for (int a = 0; a < AXIS_COUNT; a++) {
+    int v = (int)(o[a] + d[a] * t);
+    c[a] = v < 0 ? 0 : (v > (int)CHUNK_SIZE - 1 ? (int)CHUNK_SIZE - 1 : v);
+  }
+  if (axis >= 0)
+    c[axis] = d[axis] > 0.0f ? 0 : (int)CHUNK_SIZE - 1;
+
+  // node of each level on the path to the current voxel; stack[d] stays valid while c keeps its bits >= 2d+2
+  uint32_t stack[TREE_LEVELS];
+  int level = (int)TREE_LEVELS - 1;
+  stack[level] = 0;
+
+  for (;;) {
+    if (steps)
+      (*steps)++;
+    uint32_t node = stack[level];
+    uint64_t mask = CHUNK_NODE_MASK(chunk, node);
+    uint32_t shift = (uint32_t)level * BITS_PER_AXIS_PER_LEVEL;
+    uint64_t bit = 1ull << _slot(c, shift);
+
+    if (mask & bit) {
+      if (level == 0) {
+        out->hit = true;
+        memcpy(out->voxel, c, sizeof(ivec3));
+        memset(out->normal, 0, sizeof(ivec3));
+        if (axis >= 0)
+          out->normal[axis] = d[axis] > 0.0f ? -1 : 1;
+        out->t = t;
+        return true;
+      }
+
+      stack[level - 1] = CHUNK_NODE_FIRST_CHILD(chunk, node) + (uint32_t)__builtin_popcountll(mask & (bit - 1ull));
+      level--;
+      continue;
+    }
+
+    // empty cell of 4^level voxels: jump to where the ray leaves it
+    int size = 1 << shift;
+    int lo[AXIS_COUNT], hi[AXIS_COUNT];
+    for (int a = 0; a < AXIS_COUNT; a++) {
+      lo[a] = c[a] & ~(size - 1);
+      hi[a] = lo[a] + size;
+    }
+    int exit_axis;
+    float t_next = _exit_box(o, d, inv, lo, hi, &exit_axis);
+
+#if CHUNK_DISTANCE_FIELD
+    // the brick of c is empty, and so is the cube of bricks the field puts around it: leave whichever box the
+    // ray stays in longer (both contain c, so the way out of either is empty)
+    if (distance && level > 0) {
+      int r = (int)distance[CHUNK_DISTANCE_INDEX(c[0] >> BITS_PER_AXIS_PER_LEVEL, c[1] >> BITS_PER_AXIS_PER_LEVEL,
+                                                 c[2] >> BITS_PER_AXIS_PER_LEVEL)] - 1;
+      if (r > 0) {
+        int flo[AXIS_COUNT], fhi[AXIS_COUNT], faxis;
+        for (int a = 0; a < AXIS_COUNT; a++) {
+          int brick = c[a] >> BITS_PER_AXIS_PER_LEVEL;
+          flo[a] = (brick - r < 0 ? 0 : brick - r) << BITS_PER_AXIS_PER_LEVEL;
+          fhi[a] = (brick + r + 1 > (int)CHUNK_DISTANCE_BRICKS_PER_AXIS ? (int)CHUNK_DISTANCE_BRICKS_PER_AXIS
+                                                                        : brick + r + 1)
+                   << BITS_PER_AXIS_PER_LEVEL;
+        }
+        float tf = _exit_box(o, d, inv, flo, fhi, &faxis);
+        if (tf > t_next) {
+          t_next = tf;
+          exit_axis = faxis;
+          memcpy(lo, flo, sizeof(lo));
+          memcpy(hi, fhi, sizeof(hi));
+        }
+      }
+    }
+#else
+    (void)distance;
+#endif
+
+    if (exit_axis < 0 || t_next > t_end) {
+      _miss(out);
+      return false;
+    }
+
+    int n[AXIS_COUNT];
+    for (int a = 0; a < AXIS_COUNT; a++) {
+      if (a == exit_axis) {
+        n[a] = d[a] > 0.0f ? hi[a] : lo[a] - 1;
+        continue;
+      }
+      // the other axes stay inside the box we are leaving
+      int v = (int)(o[a] + d[a] * t_next);
+      n[a] = v < lo[a] ? lo[a] : (v > hi[a] - 1 ? hi[a] - 1 : v);
+    }
+
+    if (n[exit_axis] < 0 || n[exit_axis] >= (int)CHUNK_SIZE) {
+      _miss(out);
+      return false;
+    }
+
+    // resume at the lowest level whose node still contains the new voxel
+    uint32_t diff = (uint32_t)((c[0] ^ n[0]) | (c[1] ^ n[1]) | (c[2] ^ n[2]));
+    level = (31 - __builtin_clz(diff)) / BITS_PER_AXIS_PER_LEVEL;
+
+    memcpy(c, n, sizeof(c));
+    t = t_next;
+    axis = exit_axis;
+  }
+}
+
+// Where the ray leaves the voxel box [lo, hi); axis: the axis of the face it leaves through (-1: never).
+static float _exit_box(const float o[3], const float d[3], const float inv[3], const int lo[3], const int hi[3],
+                       int *axis) {
+  float t_exit = INFINITY;
+  *axis = -1;
+  for (int a = 0; a < AXIS_COUNT; a++) {
+    if (d[a] == 0.0f)
+      continue;
+    float edge = (float)(d[a] > 0.0f ? hi[a] : lo[a]);
+    float ta = (edge - o[a]) * inv[a];
+    if (ta < t_exit) {
+      t_exit = ta;
+      *axis = a;
+    }
+  }
+  return t_exit;
+}
+
+static const uint8_t *_distance(const ChunkTree *chunk) {
+#if CHUNK_DISTANCE_FIELD
+  return chunk->distance;
+#else
+  (void)chunk;
+  return NULL;
+#endif
+}
+
+// Voxel-by-voxel Amanatides-Woo walk over chunk_get_voxel, the ground truth for the tests.
+static bool _reference_cast(const ChunkTree *chunk, const float o[3], const float d[3], float max_t,
+                            ChunkRayHit *out) {
+  float inv[AXIS_COUNT] = {_inv(d[0]), _inv(d[1]), _inv(d[2])};
+  float t, t_end;
+  int axis;
+
+  if (!_clip(o, d, inv, max_t, &t, &t_end, &axis)) {
+    _miss(out);
+    return false;
+  }
+
+  int c[AXIS_COUNT];
+  for (int a = 0; a < AXIS_COUNT; a++) {
+    int v = (int)floorf(o[a] + d[a] * t);
+    c[a] = v < 0 ? 0 : (v > (int)CHUNK_SIZE - 1 ? (int)CHUNK_SIZE - 1 : v);
+  }
+  if (axis >= 0)
+    c[axis] = d[axis] > 0.0f ? 0 : (int)CHUNK_SIZE - 1;
+
+  for (;;) {
+    if (chunk_get_voxel(chunk, c[0], c[1], c[2])) {
+      out->hit = true;
+      memcpy(out->voxel, c, sizeof(ivec3));
+      memset(out->normal, 0, sizeof(ivec3));
+      if (axis >= 0)
+        out->normal[axis] = d[axis] > 0.0f ? -1 : 1;
+      out->t = t;
+      return true;
+    }
+
+    float t_next = INFINITY;
+    int exit_axis = -1;
+    for (int a = 0; a < AXIS_COUNT; a++) {
+      if (d[a] == 0.0f)
+        continue;
+      float edge = (float)(d[a] > 0.0f ? c[a] + 1 : c[a]);
+      float ta = (edge - o[a]) * inv[a];
+      if (ta < t_next) {
+        t_next = ta;
+        exit_axis = a;
+      }
+    }
+
+    if (exit_axis < 0 || t_next > t_end)
+      break;
+
+    c[exit_axis] += d[exit_axis] > 0.0f ? 1 : -1;
+    if (c[exit_axis] < 0 || c[exit_axis] >= (int)CHUNK_SIZE)
+      break;
+    t = t_next;
+    axis = exit_axis;
+  }
+
+  _miss(out);
+  return false;
+}
+
+static float _rand01(unsigned int *seed) {
+  *seed = *seed * 1103515245u + 12345u;
+  return (float)(*seed >> 8) / 16777216.0f;
+}
+
+// Origin anywhere in a box twice the chunk size, aimed at a random point inside the chunk.
+static void _random_ray(unsigned int *seed, float o[3], float d[3]) {
+  float cs = (float)CHUNK_SIZE;
+  for (int a = 0; a < AXIS_COUNT; a++) {
+    o[a] = (_rand01(seed) * 2.0f - 0.5f) * cs;
+    d[a] = _rand01(seed) * cs - o[a];
+  }
+}
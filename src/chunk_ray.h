@@ -0,0 +1,43 @@
+#pragma once
+
+#include "cglm/types.h"
+#include "chunk.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+  CPU ray queries against a chunk's compact 64-tree (nodes/child_indices), in chunk-local voxel units.
+
+  - Hierarchical DDA: a ray steps through the largest empty cell it is in (a clear bit at level d skips
+    a 4^d voxel cube), and only descends where the occupancy masks say there is something below.
+  - With CHUNK_DISTANCE_FIELD, an empty brick also lets the ray leave the whole empty cube the chunk's distance
+    field puts around it, when that gets it further than the tree cell does.
+  - Reads the compact tree (in CHUNK_NODE_LAYOUT) and the distance field, not the voxel bits: rebuild after
+    edits before querying.
+  - dir does not need to be normalized; t is in units of |dir| (voxels when dir is normalized).
+*/
+
+#define CHUNK_RAY_PACKET 8u
+
+typedef struct ChunkRayHit {
+  bool hit;
+  ivec3 voxel;  // solid voxel that was hit
+  ivec3 normal; // face the ray entered through, pointing back at the ray; zero if the origin is inside the voxel
+  float t;      // origin + dir * t lies on that face
+} ChunkRayHit;
+
+// Structure-of-arrays ray batch: origin (ox, oy, oz) and direction (dx, dy, dz) per ray.
+typedef struct ChunkRayBatch {
+  const float *ox, *oy, *oz;
+  const float *dx, *dy, *dz;
+} ChunkRayBatch;
+
+// PUBLIC FUNCTIONS
+bool chunk_raycast(const ChunkTree *chunk, const vec3 origin, const vec3 dir, float max_t, ChunkRayHit *out);
+// Traces `count` rays in packets of CHUNK_RAY_PACKET; out[i] receives the result of ray i.
+void chunk_raycast_batch(const ChunkTree *chunk, const ChunkRayBatch *rays, uint32_t count, float max_t,
+                         ChunkRayHit *out);
+
+// tests
+int chunk_ray_test(void);
+void chunk_ray_bench(void);
@@ -0,0 +1,411 @@
+/* chunk_snapshot.c */
+#include "chunk.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAPSHOT_BENCH_EDITS 4096u
+
+// A short-lived rebuild thread, with its own scratch (the implicit per-thread one would outlive the thread).
+typedef struct {
+  ChunkSnapshot *snapshot;
+  ChunkScratch *scratch;
+  pthread_t thread;
+} SnapshotWorker;
+
+// --- Private Prototypes ---
+static void _swap_vectors(Vector *a, Vector *b);
+static void _release_frozen(ChunkTree *chunk, ChunkTree *frozen, const uint64_t *shared);
+static void *_worker_main(void *arg);
+static void _worker_start(SnapshotWorker *worker, ChunkSnapshot *snapshot);
+static void _worker_join(SnapshotWorker *worker);
+static bool _same_tree(const ChunkTree *a, const ChunkTree *b);
+static bool _same_voxels(const ChunkTree *a, const ChunkTree *b);
+static void _random_edits(ChunkTree *chunk, unsigned int *seed, uint32_t count);
+static int _cmp_u64(const void *a, const void *b);
+
+ChunkSnapshot *chunk_snapshot_take(ChunkTree *chunk) {
+  if (!chunk->is_dirty || chunk->snapshot || chunk->concurrent || chunk_uses_gpu_build(chunk))
+    return NULL;
+
+  ChunkSnapshot *snapshot = (ChunkSnapshot *)calloc(1, sizeof(ChunkSnapshot));
+  ChunkTree *t = &snapshot->tree;
+  chunk_init(t);
+  snapshot->live = chunk;
+
+  // the rebuild starts where the chunk's tree is: its layout, dirty words and pending uploads
+  t->is_dirty = true;
+  t->pending_edits = chunk->pending_edits;
+  t->build_mode = chunk->build_mode;
+  t->lod_rule = chunk->lod_rule;
+  t->lod = chunk->lod;
+  memcpy(t->level_start, chunk->level_start, sizeof(t->level_start));
+  memcpy(t->level_count, chunk->level_count, sizeof(t->level_count));
+  t->upload_all = chunk->upload_all;
+  t->upload_range_count = chunk->upload_range_count;
+  memcpy(t->upload_ranges, chunk->upload_ranges, chunk->upload_range_count * sizeof(ChunkNodeRange));
+  t->dirty_overflow = chunk->dirty_overflow;
+  t->dirty_word_count = chunk->dirty_word_count;
+  memcpy(t->dirty_words, chunk->dirty_words, chunk->dirty_word_count * sizeof(uint32_t));
+#if CHUNK_DISTANCE_FIELD
+  if (chunk->distance) {
+    t->distance = (uint8_t *)malloc(CHUNK_DISTANCE_BRICKS);
+    memcpy(t->distance, chunk->distance, CHUNK_DISTANCE_BRICKS);
+  }
+#endif
+
+  // the storage moves over whole; every page is shared until the chunk writes it
+  t->fill = chunk->fill;
+  t->frozen = true;
+  if (chunk->fill == CHUNK_FILL_MIXED) {
+#if CHUNK_SPARSE_STORAGE
+    chunk_pages_destroy(&t->pages);
+    t->pages = chunk->pages;
+    chunk_pages_init(&chunk->pages);
+#else
+    t->bits = chunk->bits;
+    chunk->bits = chunk_pool_acquire();
+#endif
+    for (uint32_t p = 0; p < PAGES_PER_CHUNK; p++)
+      snapshot->shared_pages[p >> 6] |= 1ull << (p & 63u);
+  }
+
+  // edits from here on are tracked against the tree the snapshot is about to produce; the chunk stays dirty (its
+  // tree is stale) until the apply
+  chunk->pending_edits = 0;
+  chunk->dirty_word_count = 0;
+  chunk->dirty_overflow = false;
+  chunk->snapshot = snapshot;
+  return snapshot;
+}
+
+void chunk_snapshot_rebuild(ChunkSnapshot *snapshot, ChunkScratch *scratch) {
+  ChunkTree *t = &snapshot->tree;
+  if (!t->is_dirty)
+    return;
+
+  // the live tree does not change while the snapshot is in flight (its rebuilds wait), so it is safe to read here
+  const ChunkTree *live = snapshot->live;
+  vec_reserve(&t->nodes, live->nodes.length);
+  vec_reserve(&t->child_indices, live->child_indices.length);
+  if (live->nodes.length > 0) {
+    memcpy(t->nodes.data, live->nodes.data, live->nodes.length * sizeof(Node));
+    memcpy(t->child_indices.data, live->child_indices.data, live->child_indices.length * sizeof(ChildIndex));
+  }
+  t->nodes.length = live->nodes.length;
+  t->child_indices.length = live->child_indices.length;
+
+  if (scratch)
+    chunk_rebuild_with(t, scratch, true);
+  else
+    chunk_rebuild_incremental(t);
+}
+
+void chunk_snapshot_apply(ChunkSnapshot *snapshot) {
+  ChunkTree *chunk = snapshot->live;
+  ChunkTree *t = &snapshot->tree;
+
+  _swap_vectors(&chunk->nodes, &t->nodes);
+  _swap_vectors(&chunk->child_indices, &t->child_indices);
+#if CHUNK_NODE_LAYOUT != CHUNK_LAYOUT_SPLIT
+  _swap_vectors(&chunk->packed, &t->packed);
+#endif
+#if CHUNK_LOD_COUNT > 0
+  for (uint32_t k = 0; k < CHUNK_LOD_COUNT; k++) {
+    _swap_vectors(&chunk->lods[k].nodes, &t->lods[k].nodes);
+    _swap_vectors(&chunk->lods[k].child_indices, &t->lods[k].child_indices);
+  }
+#endif
+#if CHUNK_DISTANCE_FIELD
+  uint8_t *distance = chunk->distance;
+  chunk->distance = t->distance;
+  t->distance = distance;
+  chunk->distance_changed = true;
+#endif
+  memcpy(chunk->level_start, t->level_start, sizeof(chunk->level_start));
+  memcpy(chunk->level_count, t->level_count, sizeof(chunk->level_count));
+
+  // the snapshot's ranges start from the chunk's at the take; resending what was uploaded meanwhile is harmless
+  chunk->need_upload = true;
+  chunk->upload_all = t->upload_all;
+  chunk->upload_range_count = t->upload_range_count;
+  memcpy(chunk->upload_ranges, t->upload_ranges, t->upload_range_count * sizeof(ChunkNodeRange));
+
+  chunk->snapshot = NULL;
+  _release_frozen(chunk, t, snapshot->shared_pages);
+  chunk->is_dirty = chunk->pending_edits > 0 || chunk->dirty_word_count > 0 || chunk->dirty_overflow;
+
+  chunk_destroy(t);
+  free(snapshot);
+}
+
+// -------------------- Tests --------------------
+
+int chunk_snapshot_test(void) {
+  LOG_INFO("Chunk Snapshot Test: %u pages per chunk\n", (unsigned)PAGES_PER_CHUNK);
+  ChunkTree *chunk = (ChunkTree *)malloc(sizeof(ChunkTree));
+  ChunkTree *ref = (ChunkTree *)malloc(sizeof(ChunkTree));
+  ChunkTree *frozen = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(chunk);
+  chunk_init(ref);
+  chunk_init(frozen);
+  int n = (int)CHUNK_SIZE;
+  unsigned int seed = 99u;
+  bool ok = true;
+
+  // Test 1: a worker rebuilds the snapshot while this thread keeps editing; the rebuilt tree is the tree of the
+  // voxels at the take, and the later edits are still pending after the apply
+  LOG_INFO("[Test 1] Edits while the snapshot rebuilds... ");
+  for (uint32_t round = 0; round < 6u && ok; round++) {
+    _random_edits(chunk, &seed, 200u);
+    if (round % 3u == 0u)
+      chunk_fill_sphere(chunk, (VoxelCoord){n / 2, n / 2, n / 2}, n / 4 + (int)round, round % 2u == 0u);
+
+    chunk_clear(frozen);
+    chunk_stamp(frozen, chunk, CHUNK_STAMP_UNION);
+    ChunkSnapshot *snapshot = chunk_snapshot_take(chunk);
+    ok = snapshot != NULL && chunk_snapshot_take(chunk) == NULL;
+    if (!ok)
+      break;
+
+    SnapshotWorker worker;
+    _worker_start(&worker, snapshot);
+    _random_edits(chunk, &seed, 300u);
+    _worker_join(&worker);
+
+    // the frozen voxels did not move
+    ok = _same_voxels(&snapshot->tree, frozen);
+
+    chunk_snapshot_apply(snapshot);
+    chunk_clear(ref);
+    chunk_stamp(ref, frozen, CHUNK_STAMP_UNION);
+    chunk_rebuild(ref);
+    ok = ok && !chunk->snapshot && chunk->is_dirty && _same_tree(chunk, ref);
+
+    // and the edits made during the rebuild come in incrementally on top
+    chunk_rebuild_incremental(chunk);
+    chunk_clear(ref);
+    chunk_stamp(ref, chunk, CHUNK_STAMP_UNION);
+    chunk_rebuild(ref);
+    ok = ok && !chunk->is_dirty && _same_tree(chunk, ref);
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 2: only written pages are copied; everything else stays shared until the apply
+  LOG_INFO("[Test 2] Pages are copied on first write... ");
+  {
+    chunk_set_voxel(chunk, 0, 0, 0, !chunk_get_voxel(chunk, 0, 0, 0));
+    ChunkSnapshot *snapshot = chunk_snapshot_take(chunk);
+    ok = snapshot != NULL && chunk->fill == CHUNK_FILL_MIXED;
+    if (ok) {
+      // two voxels of one page, one of another (the far corner)
+      chunk_set_voxel(chunk, 1, 0, 0, !chunk_get_voxel(chunk, 1, 0, 0));
+      chunk_set_voxel(chunk, 0, 1, 0, !chunk_get_voxel(chunk, 0, 1, 0));
+      chunk_set_voxel(chunk, n - 1, n - 1, n - 1, !chunk_get_voxel(chunk, n - 1, n - 1, n - 1));
+      uint32_t shared = 0;
+      for (uint32_t i = 0; i < CHUNK_PAGE_MASK_WORDS; i++)
+        shared += (uint32_t)__builtin_popcountll(snapshot->shared_pages[i]);
+      ok = shared == (uint32_t)PAGES_PER_CHUNK - (PAGES_PER_CHUNK > 1u ? 2u : 1u);
+
+      chunk_snapshot_rebuild(snapshot, NULL);
+      chunk_snapshot_apply(snapshot);
+      chunk_rebuild(chunk);
+      chunk_clear(ref);
+      chunk_stamp(ref, chunk, CHUNK_STAMP_UNION);
+      chunk_rebuild(ref);
+      ok = ok && _same_tree(chunk, ref);
+    }
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 3: clearing the chunk drops the sharing, uniform chunks have nothing to share, and a snapshot with no
+  // edits after it leaves the chunk clean
+  LOG_INFO("[Test 3] Clears and uniform chunks... ");
+  {
+    chunk_set_voxel(chunk, 2, 3, 4, !chunk_get_voxel(chunk, 2, 3, 4));
+    ChunkSnapshot *snapshot = chunk_snapshot_take(chunk);
+    chunk_clear(chunk);
+    chunk_set_voxel(chunk, 5, 6, 7, true);
+    chunk_snapshot_rebuild(snapshot, NULL);
+    chunk_snapshot_apply(snapshot);
+    chunk_rebuild(chunk);
+    chunk_clear(ref);
+    chunk_set_voxel(ref, 5, 6, 7, true);
+    chunk_rebuild(ref);
+    ok = _same_tree(chunk, ref);
+
+    chunk_fill(chunk, true);
+    snapshot = chunk_snapshot_take(chunk);
+    ok = ok && snapshot != NULL && chunk->fill == CHUNK_FILL_SOLID;
+    if (ok) {
+      chunk_snapshot_rebuild(snapshot, NULL);
+      chunk_snapshot_apply(snapshot);
+      chunk_fill(ref, true);
+      chunk_rebuild(ref);
+      ok = !chunk->is_dirty && _same_tree(chunk, ref);
+    }
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+done:
+  chunk_destroy(chunk);
+  chunk_destroy(ref);
+  chunk_destroy(frozen);
+  free(chunk);
+  free(ref);
+  free(frozen);
+  return ok ? 0 : 1;
+}
+
+// -------------------- Benchmarks --------------------
+
+// The editing thread's view of one full rebuild of a dense chunk: how long the rebuild point blocks it (the rebuild
+// itself, or only the take while a worker rebuilds), and the latency of the edits around it.
+void chunk_snapshot_bench(void) {
+  ChunkTree *chunk = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(chunk);
+  int n = (int)CHUNK_SIZE;
+  unsigned int seed = 7u;
+  uint64_t *lat = (uint64_t *)malloc(SNAPSHOT_BENCH_EDITS * sizeof(uint64_t));
+  LOG_INFO("Chunk Snapshot Bench: %u edits around one full rebuild (CHUNK_SIZE=%u)\n", SNAPSHOT_BENCH_EDITS,
+           (unsigned)CHUNK_SIZE);
+
+  const char *names[] = {"rebuild in line", "snapshot + worker"};
+  for (uint32_t mode = 0; mode < 2u; mode++) {
+    chunk_clear(chunk);
+    chunk_fill_sphere(chunk, (VoxelCoord){n / 2, n / 2, n / 2}, n / 2 - 2, true);
+    _random_edits(chunk, &seed, 20000u);
+
+    SnapshotWorker worker = {0};
+    ChunkSnapshot *snapshot = NULL;
+    uint64_t blocked = 0;
+    for (uint32_t i = 0; i < SNAPSHOT_BENCH_EDITS; i++) {
+      if (i == SNAPSHOT_BENCH_EDITS / 4u) {
+        uint64_t b0 = time_now_ns();
+        if (mode == 0u)
+          chunk_rebuild(chunk);
+        else
+          snapshot = chunk_snapshot_take(chunk);
+        blocked = time_now_ns() - b0;
+        // a real worker would already be waiting; starting a thread is not part of the cost
+        if (snapshot)
+          _worker_start(&worker, snapshot);
+      }
+      uint64_t e0 = time_now_ns();
+      _random_edits(chunk, &seed, 1u);
+      lat[i] = time_now_ns() - e0;
+    }
+    if (snapshot) {
+      _worker_join(&worker);
+      chunk_snapshot_apply(snapshot);
+    }
+
+    qsort(lat, SNAPSHOT_BENCH_EDITS, sizeof(uint64_t), _cmp_u64);
+    LOG_INFO("  %-18s: rebuild point blocks %9.0f ns, edit p50 %5.0f ns, p99 %6.0f ns\n", names[mode],
+             (double)blocked, (double)lat[SNAPSHOT_BENCH_EDITS / 2u], (double)lat[SNAPSHOT_BENCH_EDITS * 99u / 100u]);
+  }
+
+  free(lat);
+  chunk_destroy(chunk);
+  free(chunk);
+}
+
+// --- Private Functions ---
+
+static void _swap_vectors(Vector *a, Vector *b) {
+  Vector tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+// Before the frozen storage goes, the pages the chunk never wrote come back from it. Dense storage moves whichever
+// side has fewer pages to copy: shared pages into the chunk, or the chunk's own pages into the frozen bitset.
+static void _release_frozen(ChunkTree *chunk, ChunkTree *frozen, const uint64_t *shared) {
+  uint32_t shared_count = 0;
+  for (uint32_t i = 0; i < CHUNK_PAGE_MASK_WORDS; i++)
+    shared_count += (uint32_t)__builtin_popcountll(shared[i]);
+  if (shared_count == 0)
+    return;
+
+  size_t page_bytes = CHUNK_PAGE_WORDS * sizeof(uint64_t);
+#if CHUNK_SPARSE_STORAGE
+  for (uint32_t p = 0; p < PAGES_PER_CHUNK; p++) {
+    const uint64_t *words = (shared[p >> 6] >> (p & 63u)) & 1ull ? chunk_pages_find(&frozen->pages, p) : NULL;
+    if (words)
+      memcpy(chunk_pages_get_or_create(&chunk->pages, p), words, page_bytes);
+  }
+#else
+  bool adopt = shared_count * 2u > (uint32_t)PAGES_PER_CHUNK;
+  for (uint32_t p = 0; p < PAGES_PER_CHUNK; p++) {
+    bool is_shared = (shared[p >> 6] >> (p & 63u)) & 1ull;
+    uint64_t first = (uint64_t)p * CHUNK_PAGE_WORDS;
+    if (adopt && !is_shared)
+      memcpy(&frozen->bits[first], &chunk->bits[first], page_bytes);
+    else if (!adopt && is_shared)
+      memcpy(&chunk->bits[first], &frozen->bits[first], page_bytes);
+  }
+  if (adopt) {
+    uint64_t *bits = chunk->bits;
+    chunk->bits = frozen->bits;
+    frozen->bits = bits;
+  }
+#endif
+}
+
+static void *_worker_main(void *arg) {
+  SnapshotWorker *worker = (SnapshotWorker *)arg;
+  chunk_snapshot_rebuild(worker->snapshot, worker->scratch);
+  return NULL;
+}
+
+static void _worker_start(SnapshotWorker *worker, ChunkSnapshot *snapshot) {
+  worker->snapshot = snapshot;
+  worker->scratch = chunk_scratch_create();
+  pthread_create(&worker->thread, NULL, _worker_main, worker);
+}
+
+static void _worker_join(SnapshotWorker *worker) {
+  pthread_join(worker->thread, NULL);
+  chunk_scratch_destroy(worker->scratch);
+}
+
+static bool _same_tree(const ChunkTree *a, const ChunkTree *b) {
+  return a->nodes.length == b->nodes.length &&
+         memcmp(a->nodes.data, b->nodes.data, a->nodes.length * sizeof(Node)) == 0 &&
+         memcmp(a->child_indices.data, b->child_indices.data, a->nodes.length * sizeof(ChildIndex)) == 0;
+}
+
+static bool _same_voxels(const ChunkTree *a, const ChunkTree *b) {
+  for (uint64_t w = 0; w < WORDS_PER_CHUNK; w++) {
+    if (chunk_get_word(a, w) != chunk_get_word(b, w))
+      return false;
+  }
+  return true;
+}
+
+static void _random_edits(ChunkTree *chunk, unsigned int *seed, uint32_t count) {
+  unsigned int n = (unsigned int)CHUNK_SIZE;
+  for (uint32_t i = 0; i < count; i++) {
+    *seed = *seed * 1103515245u + 12345u;
+    chunk_set_voxel(chunk, (int)((*seed >> 4) % n), (int)((*seed >> 12) % n), (int)((*seed >> 20) % n),
+                    (*seed >> 31) == 0u);
+  }
+}
+
+static int _cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
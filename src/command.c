@@ -230,24 +230,54 @@ void cmd_sync_buffer(VkCommandBuffer cmd, M_Resource *rm, ResHandle buf_handle,
 }
 
 void cmd_buffer_upload(CmdBuffer cmd, M_GPU *dev, M_Resource *rm, ResHandle handle, void *data, u32 size) {
+  VkBufferCopy region = {.srcOffset = 0, .dstOffset = 0, .size = size};
+  cmd_buffer_upload_regions(cmd, dev, rm, handle, data, &region, 1);
+};
+
+void cmd_buffer_upload_regions(CmdBuffer cmd, M_GPU *dev, M_Resource *rm, ResHandle handle, const void *data,
+                               const VkBufferCopy *regions, u32 region_count) {
+  if (region_count == 0)
+    return;
+
   RBuffer *buffer = rm_get_buffer(rm, handle);
+  const u8 *src = (const u8 *)data;
 
-  // TODO, a check if the buffer is big enough,
-  // otherwise might need to return result about needing to resize the buffer
   if (buffer->mem == VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
-    // TODO, create staging buffer, then copy over all stuff
-    // TODO, ask resource manager for a staging buffer of X size
-    // TODO, transfer buffer stage to src
+    // one staging range holds every region back to back, then one copy command moves them all
+    VkDeviceSize total = 0;
+    for (u32 i = 0; i < region_count; i++)
+      total += regions[i].size;
+
+    void *mapped = NULL;
+    u64 base = 0;
+    VkBuffer staging = rm_staging_alloc(rm, total, &mapped, &base);
+
+    VkBufferCopy batch[CMD_UPLOAD_BATCH_REGIONS];
+    u32 n = 0;
+    VkDeviceSize offset = 0;
+    for (u32 i = 0; i < region_count; i++) {
+      memcpy((u8 *)mapped + offset, src + regions[i].srcOffset, regions[i].size);
+      batch[n++] =
+          (VkBufferCopy){.srcOffset = base + offset, .dstOffset = regions[i].dstOffset, .size = regions[i].size};
+      offset += regions[i].size;
+
+      if (n == CMD_UPLOAD_BATCH_REGIONS || i + 1 == region_count) {
+        vkCmdCopyBuffer(cmd.buffer, staging, buffer->handle, n, batch);
+        n = 0;
+      }
+    }
+    rm_flush_staging(rm, base, total);
   } else {
     void *gpu_ptr = {};
     VmaAllocator allocator = dev->allocator;
     vk_check(vmaMapMemory(allocator, buffer->alloc, &gpu_ptr));
 
-    memcpy(gpu_ptr, data, size);
+    for (u32 i = 0; i < region_count; i++)
+      memcpy((u8 *)gpu_ptr + regions[i].dstOffset, src + regions[i].srcOffset, regions[i].size);
 
     vmaUnmapMemory(allocator, buffer->alloc);
   }
-};
+}
 
 // --- Private Functions ---
 
@@ -1,6 +1,8 @@
 #pragma once
 #include "resmanager.h"
 
+#define CMD_UPLOAD_BATCH_REGIONS 64u // VkBufferCopy regions per vkCmdCopyBuffer
+
 typedef struct CmdBuffer {
   VkCommandPool pool;
   VkCommandBuffer buffer;
@@ -46,5 +48,9 @@ void cmd_sync_image(CmdBuffer cmd, M_Resource *rm, ResHandle img_handle, Resourc
                     AccessType dst_access);
 
 void cmd_buffer_upload(CmdBuffer cmd, M_GPU *dev, M_Resource *rm, ResHandle handle, void *data, u32 size);
+// Copies the given byte ranges of data (srcOffset) to the buffer (dstOffset). Device-local buffers go through a
+// single staging buffer and vkCmdCopyBuffer, host-visible ones are mapped once and patched in place.
+void cmd_buffer_upload_regions(CmdBuffer cmd, M_GPU *dev, M_Resource *rm, ResHandle handle, const void *data,
+                               const VkBufferCopy *regions, u32 region_count);
 void cmd_sync_buffer(VkCommandBuffer cmd, M_Resource *rm, ResHandle buf_handle, ResourceState dst_state,
                      AccessType dst_access);
@@ -0,0 +1,261 @@
+/* jobs.c */
+#include "jobs.h"
+#include "util.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Pending indices [begin, end) owned by one worker. Padded so neighbouring queues do not share a cache line.
+typedef struct JobQueue {
+  _Alignas(64) pthread_mutex_t lock;
+  uint32_t begin;
+  uint32_t end;
+} JobQueue;
+
+typedef struct JobThread {
+  JobSystem *js;
+  uint32_t worker;
+  pthread_t handle;
+} JobThread;
+
+struct JobSystem {
+  uint32_t worker_count;
+  JobQueue *queues;    // [worker_count]
+  JobThread *threads;  // [worker_count - 1], pool worker i + 1
+
+  // batch hand-off, guarded by mutex
+  pthread_mutex_t mutex;
+  pthread_cond_t wake; // new batch or quit
+  pthread_cond_t done; // last pool thread left the batch
+  uint64_t generation;
+  uint32_t busy_threads;
+  bool quit;
+
+  JobFn fn;
+  void *user;
+};
+
+// --- Private Prototypes ---
+static void *_thread_main(void *arg);
+static void _run_worker(JobSystem *js, uint32_t worker);
+static bool _pop(JobQueue *q, uint32_t *out_index);
+static bool _steal(JobSystem *js, uint32_t worker, uint32_t *out_index);
+static void _test_job(void *user, uint32_t index, uint32_t worker);
+
+JobSystem *job_system_create(uint32_t worker_count) {
+  if (worker_count == 0)
+    worker_count = job_hardware_threads();
+
+  JobSystem *js = (JobSystem *)calloc(1, sizeof(JobSystem));
+  js->worker_count = worker_count;
+  js->queues = (JobQueue *)aligned_alloc(_Alignof(JobQueue), worker_count * sizeof(JobQueue));
+  js->threads = worker_count > 1 ? (JobThread *)calloc(worker_count - 1, sizeof(JobThread)) : NULL;
+
+  for (uint32_t i = 0; i < worker_count; i++) {
+    memset(&js->queues[i], 0, sizeof(JobQueue));
+    pthread_mutex_init(&js->queues[i].lock, NULL);
+  }
+
+  pthread_mutex_init(&js->mutex, NULL);
+  pthread_cond_init(&js->wake, NULL);
+  pthread_cond_init(&js->done, NULL);
+
+  for (uint32_t i = 0; i + 1 < worker_count; i++) {
+    js->threads[i] = (JobThread){.js = js, .worker = i + 1};
+    if (pthread_create(&js->threads[i].handle, NULL, _thread_main, &js->threads[i]) != 0) {
+      LOG_ERROR("Failed to create job worker %u", i + 1);
+      abort();
+    }
+  }
+
+  return js;
+}
+
+void job_system_destroy(JobSystem *js) {
+  if (!js)
+    return;
+
+  pthread_mutex_lock(&js->mutex);
+  js->quit = true;
+  pthread_cond_broadcast(&js->wake);
+  pthread_mutex_unlock(&js->mutex);
+
+  for (uint32_t i = 0; i + 1 < js->worker_count; i++)
+    pthread_join(js->threads[i].handle, NULL);
+
+  for (uint32_t i = 0; i < js->worker_count; i++)
+    pthread_mutex_destroy(&js->queues[i].lock);
+
+  pthread_mutex_destroy(&js->mutex);
+  pthread_cond_destroy(&js->wake);
+  pthread_cond_destroy(&js->done);
+
+  free(js->queues);
+  free(js->threads);
+  free(js);
+}
+
+uint32_t job_worker_count(const JobSystem *js) { return js->worker_count; }
+
+uint32_t job_hardware_threads(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (uint32_t)n : 1u;
+}
+
+void job_parallel_for(JobSystem *js, uint32_t count, JobFn fn, void *user) {
+  if (count == 0)
+    return;
+
+  // pool threads are all parked between batches, so the queues can be refilled without their locks
+  uint32_t per_worker = count / js->worker_count;
+  uint32_t extra = count % js->worker_count;
+  uint32_t begin = 0;
+  for (uint32_t i = 0; i < js->worker_count; i++) {
+    uint32_t n = per_worker + (i < extra ? 1u : 0u);
+    js->queues[i].begin = begin;
+    js->queues[i].end = begin + n;
+    begin += n;
+  }
+
+  pthread_mutex_lock(&js->mutex);
+  js->fn = fn;
+  js->user = user;
+  js->busy_threads = js->worker_count - 1;
+  js->generation++;
+  pthread_cond_broadcast(&js->wake);
+  pthread_mutex_unlock(&js->mutex);
+
+  _run_worker(js, 0);
+
+  // join: every pool thread must check out, not just every index finish, before the next batch may reuse the queues
+  pthread_mutex_lock(&js->mutex);
+  while (js->busy_threads > 0)
+    pthread_cond_wait(&js->done, &js->mutex);
+  pthread_mutex_unlock(&js->mutex);
+}
+
+// -------------------- Tests --------------------
+
+int job_test(void) {
+  // fixed pool size so stealing and the join are exercised even on small machines
+  JobSystem *js = job_system_create(4);
+  uint32_t workers = job_worker_count(js);
+  LOG_INFO("Job Test: %u workers", workers);
+
+  const uint32_t counts[] = {0, 1, 3, 64, 1000, 100000};
+  atomic_uint *hits = (atomic_uint *)malloc(100000u * sizeof(atomic_uint));
+  bool ok = true;
+
+  LOG_INFO("[Test 1] Every index runs exactly once... ");
+  for (uint32_t round = 0; round < 20u && ok; round++) {
+    for (uint32_t c = 0; c < sizeof(counts) / sizeof(counts[0]) && ok; c++) {
+      for (uint32_t i = 0; i < counts[c]; i++)
+        atomic_init(&hits[i], 0u);
+
+      job_parallel_for(js, counts[c], _test_job, hits);
+
+      // results must be visible right after the join
+      for (uint32_t i = 0; i < counts[c] && ok; i++) {
+        uint32_t h = atomic_load(&hits[i]);
+        ok = (h & 0xFFFFu) == 1u && (h >> 16) < workers;
+      }
+    }
+  }
+
+  free(hits);
+  job_system_destroy(js);
+
+  if (!ok) {
+    LOG_INFO("FAILED (index skipped, repeated or bad worker id)");
+    return 1;
+  }
+
+  LOG_INFO("PASSED");
+  return 0;
+}
+
+// --- Private Functions ---
+
+static void *_thread_main(void *arg) {
+  JobThread *t = (JobThread *)arg;
+  JobSystem *js = t->js;
+  uint64_t seen = 0;
+
+  pthread_mutex_lock(&js->mutex);
+  for (;;) {
+    while (!js->quit && js->generation == seen)
+      pthread_cond_wait(&js->wake, &js->mutex);
+    if (js->quit)
+      break;
+    seen = js->generation;
+    pthread_mutex_unlock(&js->mutex);
+
+    _run_worker(js, t->worker);
+
+    pthread_mutex_lock(&js->mutex);
+    if (--js->busy_threads == 0)
+      pthread_cond_signal(&js->done);
+  }
+  pthread_mutex_unlock(&js->mutex);
+  return NULL;
+}
+
+static void _run_worker(JobSystem *js, uint32_t worker) {
+  uint32_t index;
+  while (_pop(&js->queues[worker], &index) || _steal(js, worker, &index))
+    js->fn(js->user, index, worker);
+}
+
+static bool _pop(JobQueue *q, uint32_t *out_index) {
+  pthread_mutex_lock(&q->lock);
+  bool ok = q->begin < q->end;
+  if (ok)
+    *out_index = q->begin++;
+  pthread_mutex_unlock(&q->lock);
+  return ok;
+}
+
+// Takes the back half of the first non-empty victim range; runs its first index, keeps the rest locally.
+static bool _steal(JobSystem *js, uint32_t worker, uint32_t *out_index) {
+  for (uint32_t k = 1; k < js->worker_count; k++) {
+    JobQueue *victim = &js->queues[(worker + k) % js->worker_count];
+
+    pthread_mutex_lock(&victim->lock);
+    uint32_t available = victim->end - victim->begin;
+    if (available == 0) {
+      pthread_mutex_unlock(&victim->lock);
+      continue;
+    }
+    uint32_t take = (available + 1u) / 2u;
+    uint32_t begin = victim->end - take;
+    uint32_t end = victim->end;
+    victim->end = begin;
+    pthread_mutex_unlock(&victim->lock);
+
+    JobQueue *own = &js->queues[worker];
+    pthread_mutex_lock(&own->lock);
+    own->begin = begin + 1u;
+    own->end = end;
+    pthread_mutex_unlock(&own->lock);
+
+    *out_index = begin;
+    return true;
+  }
+
+  return false;
+}
+
+static void _test_job(void *user, uint32_t index, uint32_t worker) {
+  atomic_uint *hits = (atomic_uint *)user;
+  atomic_fetch_add_explicit(&hits[index], 1u + (worker << 16), memory_order_relaxed);
+
+  // skew the cost towards the first ranges so idle workers have to steal
+  if (index < 64u) {
+    volatile uint32_t spin = 0;
+    for (uint32_t i = 0; i < 20000u; i++)
+      spin += i;
+  }
+}
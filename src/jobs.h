@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+  Fork/join job system for data-parallel CPU work (chunk rebuilds, meshing, ...).
+
+  - job_parallel_for splits [0, count) evenly across the workers. Each worker drains its own range
+    front to back and, when empty, steals the back half of another worker's range.
+  - The calling thread is worker 0; the pool owns worker_count - 1 threads.
+  - job_parallel_for returns only after every index ran AND every pool thread has left the batch,
+    so it is a deterministic join point: results may be consumed (uploaded, ...) right after it.
+*/
+
+typedef struct JobSystem JobSystem;
+
+// index: item in [0, count). worker: [0, job_worker_count) - stable per thread, use it to pick per-worker memory.
+typedef void (*JobFn)(void *user, uint32_t index, uint32_t worker);
+
+// PUBLIC FUNCTIONS
+JobSystem *job_system_create(uint32_t worker_count); // 0 = one worker per online CPU
+void job_system_destroy(JobSystem *js);
+uint32_t job_worker_count(const JobSystem *js);
+uint32_t job_hardware_threads(void);
+
+// Blocks until all `count` items are done. Not reentrant: do not call from inside a job.
+void job_parallel_for(JobSystem *js, uint32_t count, JobFn fn, void *user);
+
+// tests
+int job_test(void);
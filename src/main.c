@@ -10,6 +10,7 @@
 #include <GLFW/glfw3.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <glslang/Include/glslang_c_interface.h>
 
@@ -26,10 +27,65 @@
 static void _register_systems(GPUSystemInfo info);
 
 #include "chunk.h"
+#include "chunk_gpu.h"
+#include "chunk_mesh.h"
+#include "chunk_ray.h"
+#include "jobs.h"
+#include "morton.h"
+#include "point_ingest.h"
+#include "region.h"
+#include "svo_dag.h"
+#include "terrain.h"
+#include "voxel_import.h"
+#include "world.h"
+
+typedef struct BenchEntry {
+  const char *name;
+  void (*run)(void);
+} BenchEntry;
+
+static const BenchEntry BENCHES[] = {
+    {"chunk", chunk_bench},
+    {"chunk_layout", chunk_layout_bench},
+    {"chunk_concurrent", chunk_concurrent_bench},
+    {"chunk_snapshot", chunk_snapshot_bench},
+    {"chunk_ray", chunk_ray_bench},
+    {"chunk_mesh", chunk_mesh_bench},
+    {"morton", morton_bench},
+    {"region", region_bench},
+    {"terrain", terrain_bench},
+    {"world", world_bench},
+    {"world_occupancy", world_occupancy_bench},
+    {"voxel_import", voxel_import_bench},
+    {"point_ingest", point_ingest_bench},
+};
+
+int main(int argc, char **argv) {
+  // --bench [name]: the CPU benchmarks, all of them or the named one, then exit
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bool found = false;
+    for (uint32_t i = 0; i < sizeof(BENCHES) / sizeof(BENCHES[0]); i++) {
+      if (argc > 2 && strcmp(argv[2], BENCHES[i].name) != 0)
+        continue;
+      BENCHES[i].run();
+      found = true;
+    }
+    if (!found) {
+      printf("Unknown bench '%s'\n", argv[2]);
+      return 1;
+    }
+    return 0;
+  }
+
+  // CPU tests by default; --gpu-test skips them and runs the GPU tests once the systems are up
+  bool gpu_test = argc > 1 && strcmp(argv[1], "--gpu-test") == 0;
+  if (!gpu_test)
+    return chunk_test() || chunk_lod_test() || chunk_layout_test() || chunk_distance_test() ||
+           chunk_concurrent_test() || chunk_snapshot_test() || chunk_ray_test() || morton_test() || region_test() ||
+           svo_dag_test() || terrain_test() || chunk_mesh_test() || job_test() || world_test() ||
+           world_occupancy_test() || voxel_import_test() || point_ingest_test();
 
-int main() {
   // 1. Init Windowp
-  return chunk_test();
   u32 width = 800;
   u32 height = 600;
 
@@ -48,6 +104,15 @@ int main() {
     exit(1);
   }
 
+  // GPU build against the CPU rebuild, needs the systems above (runs on lavapipe too)
+  if (gpu_test) {
+    int failed = chunk_gpu_test();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    glslang_finalize_process();
+    return failed;
+  }
+
   // Sample sample = create_triangle_sample();
   Sample sample = create_raytrace_sample();
   run_sample(&sample, window);
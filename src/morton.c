@@ -0,0 +1,309 @@
+#include "morton.h"
+#include "util.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MORTON_X86 1
+#endif
+
+#define MORTON_MASK_X 0x1249249249249249ull // every third bit from bit 0, 21 bits
+#define MORTON_MASK_Y (MORTON_MASK_X << 1)
+#define MORTON_MASK_Z (MORTON_MASK_X << 2)
+#define MORTON_AXIS_MASK 0x1FFFFFu
+
+typedef struct MortonImpl {
+  void (*encode_batch)(const uint32_t *x, const uint32_t *y, const uint32_t *z, uint64_t *out, size_t count);
+  void (*decode_batch)(const uint64_t *codes, uint32_t *x, uint32_t *y, uint32_t *z, size_t count);
+} MortonImpl;
+
+// --- Private Prototypes ---
+static void _init_once(void);
+static const MortonImpl *_impl(void);
+static void _cascade_encode_batch(const uint32_t *x, const uint32_t *y, const uint32_t *z, uint64_t *out,
+                                  size_t count);
+static void _cascade_decode_batch(const uint64_t *codes, uint32_t *x, uint32_t *y, uint32_t *z, size_t count);
+static uint64_t _lut_encode(uint32_t x, uint32_t y, uint32_t z);
+static void _lut_decode(uint64_t code, uint32_t *x, uint32_t *y, uint32_t *z);
+static void _lut_encode_batch(const uint32_t *x, const uint32_t *y, const uint32_t *z, uint64_t *out, size_t count);
+static void _lut_decode_batch(const uint64_t *codes, uint32_t *x, uint32_t *y, uint32_t *z, size_t count);
+#if MORTON_X86
+static void _bmi2_encode_batch(const uint32_t *x, const uint32_t *y, const uint32_t *z, uint64_t *out, size_t count);
+static void _bmi2_decode_batch(const uint64_t *codes, uint32_t *x, uint32_t *y, uint32_t *z, size_t count);
+#endif
+static void _build_luts(void);
+
+static const MortonImpl IMPLS[MORTON_BACKEND_COUNT] = {
+    [MORTON_BACKEND_CASCADE] = {_cascade_encode_batch, _cascade_decode_batch},
+    [MORTON_BACKEND_LUT] = {_lut_encode_batch, _lut_decode_batch},
+#if MORTON_X86
+    [MORTON_BACKEND_BMI2] = {_bmi2_encode_batch, _bmi2_decode_batch},
+#endif
+};
+
+// Published with release once the tables are built, so a reader that sees the LUT backend also sees its tables.
+static _Atomic(const MortonImpl *) s_impl = NULL;
+static pthread_once_t s_init_once = PTHREAD_ONCE_INIT;
+
+static uint32_t s_encode_lut[256]; // 8 axis bits -> 24 spread bits
+static uint16_t s_decode_lut[512]; // 9 code bits -> x | y << 3 | z << 6
+
+void morton_init(void) { pthread_once(&s_init_once, _init_once); }
+
+MortonBackend morton_backend(void) { return (MortonBackend)(_impl() - IMPLS); }
+
+const char *morton_backend_name(MortonBackend backend) {
+  static const char *names[MORTON_BACKEND_COUNT] = {
+      [MORTON_BACKEND_CASCADE] = "cascade",
+      [MORTON_BACKEND_LUT] = "lut",
+      [MORTON_BACKEND_BMI2] = "bmi2",
+  };
+  return backend < MORTON_BACKEND_COUNT ? names[backend] : "unknown";
+}
+
+bool morton_backend_supported(MortonBackend backend) {
+  switch (backend) {
+  case MORTON_BACKEND_CASCADE:
+  case MORTON_BACKEND_LUT:
+    return true;
+  case MORTON_BACKEND_BMI2:
+#if MORTON_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
+  default:
+    return false;
+  }
+}
+
+bool morton_set_backend(MortonBackend backend) {
+  morton_init();
+  if (!morton_backend_supported(backend))
+    return false;
+
+  // every backend gives the same codes, so batches already running on the old one stay correct
+  atomic_store_explicit(&s_impl, &IMPLS[backend], memory_order_release);
+  return true;
+}
+
+void morton_encode3_batch(const uint32_t *x, const uint32_t *y, const uint32_t *z, uint64_t *out, size_t count) {
+  _impl()->encode_batch(x, y, z, out, count);
+}
+
+void morton_decode3_batch(const uint64_t *codes, uint32_t *x, uint32_t *y, uint32_t *z, size_t count) {
+  _impl()->decode_batch(codes, x, y, z, count);
+}
+
+// -------------------- Tests --------------------
+
+int morton_test(void) {
+  LOG_INFO("Morton Test: default backend=%s\n", morton_backend_name(morton_backend()));
+  MortonBackend saved = morton_backend();
+
+  enum { N = 4096 };
+  static uint32_t xs[N], ys[N], zs[N], dx[N], dy[N], dz[N];
+  static uint64_t codes[N];
+
+  unsigned int seed = 8086u;
+  for (uint32_t i = 0; i < N; i++) {
+    seed = seed * 1103515245u + 12345u;
+    xs[i] = seed & MORTON_AXIS_MASK;
+    seed = seed * 1103515245u + 12345u;
+    ys[i] = seed & MORTON_AXIS_MASK;
+    seed = seed * 1103515245u + 12345u;
+    zs[i] = seed & MORTON_AXIS_MASK;
+  }
+  xs[0] = ys[0] = zs[0] = 0;
+  xs[1] = ys[1] = zs[1] = MORTON_AXIS_MASK;
+
+  for (uint32_t b = 0; b < MORTON_BACKEND_COUNT; b++) {
+    if (!morton_set_backend((MortonBackend)b)) {
+      LOG_INFO("[%s] skipped (unsupported)\n", morton_backend_name((MortonBackend)b));
+      continue;
+    }
+
+    LOG_INFO("[%s] encode/decode round trip... ", morton_backend_name((MortonBackend)b));
+    morton_encode3_batch(xs, ys, zs, codes, N);
+    morton_decode3_batch(codes, dx, dy, dz, N);
+
+    bool ok = true;
+    for (uint32_t i = 0; i < N && ok; i++) {
+      uint32_t sx, sy, sz;
+      morton_decode3(codes[i], &sx, &sy, &sz);
+      ok = codes[i] == morton_encode3(xs[i], ys[i], zs[i]) && dx[i] == xs[i] && dy[i] == ys[i] && dz[i] == zs[i] &&
+           sx == xs[i] && sy == ys[i] && sz == zs[i];
+    }
+
+    if (ok)
+      LOG_INFO("PASSED\n");
+    else {
+      LOG_INFO("FAILED\n");
+      morton_set_backend(saved);
+      return 1;
+    }
+  }
+
+  morton_set_backend(saved);
+  return 0;
+}
+
+void morton_bench(void) {
+  enum { N = 1 << 16, REPS = 64 };
+  static uint32_t xs[N], ys[N], zs[N];
+  static uint64_t codes[N];
+  MortonBackend saved = morton_backend();
+
+  LOG_INFO("Morton Bench: %d coords x %d reps, Mcodes/s (encode batch / decode batch; inline: encode single)\n", N,
+           REPS);
+
+  // TREE_LEVELS L uses 2L bits per axis
+  for (uint32_t levels = 2; levels <= 5; levels++) {
+    uint32_t axis_mask = (1u << (2u * levels)) - 1u;
+    unsigned int seed = 1234u + levels;
+    for (uint32_t i = 0; i < N; i++) {
+      seed = seed * 1103515245u + 12345u;
+      xs[i] = (seed >> 4) & axis_mask;
+      seed = seed * 1103515245u + 12345u;
+      ys[i] = (seed >> 4) & axis_mask;
+      seed = seed * 1103515245u + 12345u;
+      zs[i] = (seed >> 4) & axis_mask;
+    }
+
+    for (uint32_t b = 0; b < MORTON_BACKEND_COUNT; b++) {
+      if (!morton_set_backend((MortonBackend)b))
+        continue;
+
+      uint64_t t0 = time_now_ns();
+      for (uint32_t r = 0; r < REPS; r++)
+        morton_encode3_batch(xs, ys, zs, codes, N);
+      uint64_t t1 = time_now_ns();
+      for (uint32_t r = 0; r < REPS; r++)
+        morton_decode3_batch(codes, xs, ys, zs, N);
+      uint64_t t2 = time_now_ns();
+
+      double total = (double)N * REPS / 1e6;
+      LOG_INFO("  L=%u %-7s: %8.1f / %8.1f\n", levels, morton_backend_name((MortonBackend)b),
+               total / ((double)(t1 - t0) / 1e9), total / ((double)(t2 - t1) / 1e9));
+    }
+
+    uint64_t sink = 0;
+    uint64_t t0 = time_now_ns();
+    for (uint32_t r = 0; r < REPS; r++)
+      for (uint32_t i = 0; i < N; i++)
+        sink += morton_encode3(xs[i], ys[i], zs[i]);
+    uint64_t t1 = time_now_ns();
+    LOG_INFO("  L=%u inline : %8.1f (sink=%llu)\n", levels, (double)N * REPS / 1e6 / ((double)(t1 - t0) / 1e9),
+             (unsigned long long)(sink & 1ull));
+  }
+
+  morton_set_backend(saved);
+}
+
+// --- Private Functions ---
+
+static void _init_once(void) {
+  _build_luts();
+
+  MortonBackend backend = MORTON_BACKEND_LUT;
+#if MORTON_X86
+  __builtin_cpu_init();
+  // PDEP/PEXT are microcoded (~100+ cycles) on Zen1/Zen2, the tables win there
+  if (morton_backend_supported(MORTON_BACKEND_BMI2) && !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2"))
+    backend = MORTON_BACKEND_BMI2;
+#endif
+
+  atomic_store_explicit(&s_impl, &IMPLS[backend], memory_order_release);
+}
+
+static const MortonImpl *_impl(void) {
+  const MortonImpl *impl = atomic_load_explicit(&s_impl, memory_order_acquire);
+  if (impl)
+    return impl;
+  morton_init();
+  return atomic_load_explicit(&s_impl, memory_order_acquire);
+}
+
+// -------------------- Cascade --------------------
+static void _cascade_encode_batch(const uint32_t *x, const uint32_t *y, const uint32_t *z, uint64_t *out,
+                                  size_t count) {
+  for (size_t i = 0; i < count; i++)
+    out[i] = morton_encode3(x[i], y[i], z[i]);
+}
+
+static void _cascade_decode_batch(const uint64_t *codes, uint32_t *x, uint32_t *y, uint32_t *z, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    morton_decode3(codes[i], &x[i], &y[i], &z[i]);
+}
+
+// -------------------- Byte tables --------------------
+static inline uint64_t _lut_split(uint32_t a) {
+  return (uint64_t)s_encode_lut[a & 0xFFu] | ((uint64_t)s_encode_lut[(a >> 8) & 0xFFu] << 24) |
+         ((uint64_t)s_encode_lut[(a >> 16) & 0x1Fu] << 48);
+}
+
+static uint64_t _lut_encode(uint32_t x, uint32_t y, uint32_t z) {
+  return _lut_split(x) | (_lut_split(y) << 1) | (_lut_split(z) << 2);
+}
+
+static void _lut_decode(uint64_t code, uint32_t *x, uint32_t *y, uint32_t *z) {
+  uint32_t rx = 0, ry = 0, rz = 0;
+
+  // up to 7 groups of 9 code bits, each yields 3 bits per axis; stops at the highest set bit
+  for (uint32_t i = 0; code != 0ull; i++, code >>= 9) {
+    uint32_t e = s_decode_lut[code & 0x1FFu];
+    rx |= (e & 7u) << (3u * i);
+    ry |= ((e >> 3) & 7u) << (3u * i);
+    rz |= ((e >> 6) & 7u) << (3u * i);
+  }
+
+  *x = rx;
+  *y = ry;
+  *z = rz;
+}
+
+static void _lut_encode_batch(const uint32_t *x, const uint32_t *y, const uint32_t *z, uint64_t *out, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    out[i] = _lut_encode(x[i], y[i], z[i]);
+}
+
+static void _lut_decode_batch(const uint64_t *codes, uint32_t *x, uint32_t *y, uint32_t *z, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    _lut_decode(codes[i], &x[i], &y[i], &z[i]);
+}
+
+static void _build_luts(void) {
+  for (uint32_t i = 0; i < 256u; i++)
+    s_encode_lut[i] = (uint32_t)morton_split3(i);
+
+  for (uint32_t i = 0; i < 512u; i++) {
+    uint32_t x = morton_compact3(i), y = morton_compact3(i >> 1), z = morton_compact3(i >> 2);
+    s_decode_lut[i] = (uint16_t)(x | (y << 3) | (z << 6));
+  }
+}
+
+// -------------------- BMI2 --------------------
+#if MORTON_X86
+__attribute__((target("bmi2"))) static inline uint64_t _bmi2_encode_inline(uint32_t x, uint32_t y, uint32_t z) {
+  return _pdep_u64(x & MORTON_AXIS_MASK, MORTON_MASK_X) | _pdep_u64(y & MORTON_AXIS_MASK, MORTON_MASK_Y) |
+         _pdep_u64(z & MORTON_AXIS_MASK, MORTON_MASK_Z);
+}
+
+__attribute__((target("bmi2"))) static void _bmi2_encode_batch(const uint32_t *x, const uint32_t *y,
+                                                               const uint32_t *z, uint64_t *out, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    out[i] = _bmi2_encode_inline(x[i], y[i], z[i]);
+}
+
+__attribute__((target("bmi2"))) static void _bmi2_decode_batch(const uint64_t *codes, uint32_t *x, uint32_t *y,
+                                                               uint32_t *z, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    x[i] = (uint32_t)_pext_u64(codes[i], MORTON_MASK_X);
+    y[i] = (uint32_t)_pext_u64(codes[i], MORTON_MASK_Y);
+    z[i] = (uint32_t)_pext_u64(codes[i], MORTON_MASK_Z);
+  }
+}
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  3D Morton (Z-order) codes, bit layout x0 y0 z0 x1 y1 z1 ... (x at bit 0).
+  Up to 21 bits per axis (63-bit codes).
+
+  Single codes are encoded and decoded inline with the shift cascade: the per-voxel paths call these once per voxel,
+  where a call through a backend table costs as much as the cascade itself.
+
+  The batch variants go through one of three interchangeable backends, picked once at first use:
+  - BMI2:    PDEP/PEXT, one instruction per axis (skipped on Zen1/2 where PDEP is microcoded)
+  - LUT:     byte tables, 3 lookups per axis to encode, one per 9 code bits to decode
+  - CASCADE: magic-number shift cascade, no tables
+  Picking and switching are thread-safe; a switch only affects batches that start after it.
+*/
+#define MORTON_MAX_AXIS_BITS 21u
+
+typedef enum MortonBackend {
+  MORTON_BACKEND_CASCADE,
+  MORTON_BACKEND_LUT,
+  MORTON_BACKEND_BMI2,
+  MORTON_BACKEND_COUNT,
+} MortonBackend;
+
+// PUBLIC FUNCTIONS
+
+void morton_init(void);
+MortonBackend morton_backend(void);
+const char *morton_backend_name(MortonBackend backend);
+bool morton_backend_supported(MortonBackend backend);
+// Forces a backend (tests/benchmarks). Returns false and keeps the current one if unsupported.
+bool morton_set_backend(MortonBackend backend);
+
+static inline uint64_t morton_encode3(uint32_t x, uint32_t y, uint32_t z);
+static inline void morton_decode3(uint64_t code, uint32_t *x, uint32_t *y, uint32_t *z);
+
+// batch variants, structure-of-arrays
+void morton_encode3_batch(const uint32_t *x, const uint32_t *y, const uint32_t *z, uint64_t *out, size_t count);
+void morton_decode3_batch(const uint64_t *codes, uint32_t *x, uint32_t *y, uint32_t *z, size_t count);
+
+// tests
+int morton_test(void);
+void morton_bench(void);
+
+// Spreads the low 21 bits of a so that bit i lands at bit 3i.
+static inline uint64_t morton_split3(uint32_t a) {
+  uint64_t x = (uint64_t)(a & 0x1FFFFFu);
+  x = (x | (x << 32)) & 0x1F00000000FFFFull;
+  x = (x | (x << 16)) & 0x1F0000FF0000FFull;
+  x = (x | (x << 8)) & 0x100F00F00F00F00Full;
+  x = (x | (x << 4)) & 0x10C30C30C30C30C3ull;
+  x = (x | (x << 2)) & 0x1249249249249249ull;
+  return x;
+}
+
+// Inverse of morton_split3: gathers every third bit from bit 0.
+static inline uint32_t morton_compact3(uint64_t x) {
+  x &= 0x1249249249249249ull;
+  x = (x ^ (x >> 2)) & 0x10C30C30C30C30C3ull;
+  x = (x ^ (x >> 4)) & 0x100F00F00F00F00Full;
+  x = (x ^ (x >> 8)) & 0x1F0000FF0000FFull;
+  x = (x ^ (x >> 16)) & 0x1F00000000FFFFull;
+  x = (x ^ (x >> 32)) & 0x1FFFFFull;
+  return (uint32_t)x;
+}
+
+static inline uint64_t morton_encode3(uint32_t x, uint32_t y, uint32_t z) {
+  return morton_split3(x) | (morton_split3(y) << 1) | (morton_split3(z) << 2);
+}
+
+static inline void morton_decode3(uint64_t code, uint32_t *x, uint32_t *y, uint32_t *z) {
+  *x = morton_compact3(code);
+  *y = morton_compact3(code >> 1);
+  *z = morton_compact3(code >> 2);
+}
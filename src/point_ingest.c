@@ -0,0 +1,536 @@
+/* point_ingest.c */
+#include "point_ingest.h"
+#include "morton.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INGEST_BLOCK (1u << 16) // points per quantize job, keys per radix part
+#define INGEST_ENCODE_RUN 256u  // points quantized per inner pass of _quantize_job
+#define INGEST_RADIX_BITS 12u
+#define INGEST_BUCKETS (1u << INGEST_RADIX_BITS)
+#define INGEST_SLOT_BITS 12u
+#define INGEST_KEY_BITS (INGEST_SLOT_BITS + MORTON_BITS)
+#define INGEST_BENCH_POINTS (1u << 23)
+
+_Static_assert(WORLD_CHUNK_COUNT == 1u << INGEST_SLOT_BITS, "a slot index fills the key bits above the Morton code");
+
+// slot << MORTON_BITS | chunk-local Morton code; 32 bits while they fit (TREE_LEVELS <= 3)
+#if INGEST_KEY_BITS <= 32
+typedef uint32_t IngestKey;
+#else
+typedef uint64_t IngestKey;
+#endif
+
+#define KEY_SLOT(key) ((uint32_t)((key) >> MORTON_BITS))
+#define KEY_WORD(key) ((key) >> 6) // leaf word, slot included
+
+typedef struct IngestContext {
+  WorldManager *world;
+  const vec3 *points; // the batch
+  uint32_t count;
+  vec3 origin;
+  float inv_voxel_size;
+  int (*held)[3]; // [WORLD_CHUNK_COUNT], see _held_chunks
+
+  // part p of a key array starts at p * INGEST_BLOCK and holds part_count[p] keys
+  IngestKey *keys, *tmp;
+  uint32_t parts;
+  uint32_t *part_count;
+  uint32_t *hist; // [parts][INGEST_BUCKETS] digit counts, then scatter offsets
+  const IngestKey *src;
+  IngestKey *dst;
+  uint32_t shift;
+  uint32_t sorted; // keys left after the first pass dropped the invalid ones
+
+  // per worker
+  uint64_t *voxels_set;
+  uint32_t *chunks_touched;
+} IngestContext;
+
+// --- Private Prototypes ---
+static void _quantize_job(void *user, uint32_t index, uint32_t worker);
+static inline IngestKey _local_code(uint32_t x, uint32_t y, uint32_t z);
+static void _held_chunks(IngestContext *ctx);
+static void _histogram_job(void *user, uint32_t index, uint32_t worker);
+static void _scatter_job(void *user, uint32_t index, uint32_t worker);
+static void _sweep_job(void *user, uint32_t index, uint32_t worker);
+static const IngestKey *_sort(IngestContext *ctx);
+static void _flush_word(ChunkTree *tree, uint64_t w, uint64_t mask, uint64_t *set, bool *changed);
+static void _random_points(vec3 *points, uint32_t count, float extent, unsigned int *seed);
+static bool _same_worlds(const WorldManager *a, const WorldManager *b, uint32_t *dirty);
+
+void point_ingest(WorldManager *world, const vec3 *points, uint64_t count, const PointIngestDesc *desc,
+                  PointIngestStats *stats) {
+  uint64_t t0 = time_now_ns();
+  uint32_t batch = desc->batch ? desc->batch : POINT_INGEST_BATCH;
+  uint32_t workers = job_worker_count(world->jobs);
+  uint32_t max_parts = (batch + INGEST_BLOCK - 1u) / INGEST_BLOCK;
+
+  IngestContext ctx = {.world = world, .inv_voxel_size = 1.0f / desc->voxel_size};
+  memcpy(ctx.origin, desc->origin, sizeof(vec3));
+  ctx.held = (int(*)[3])malloc(WORLD_CHUNK_COUNT * sizeof(*ctx.held));
+  _held_chunks(&ctx);
+  ctx.keys = (IngestKey *)malloc((size_t)batch * sizeof(IngestKey));
+  ctx.tmp = (IngestKey *)malloc((size_t)batch * sizeof(IngestKey));
+  ctx.part_count = (uint32_t *)malloc(max_parts * sizeof(uint32_t));
+  ctx.hist = (uint32_t *)malloc((size_t)max_parts * INGEST_BUCKETS * sizeof(uint32_t));
+  ctx.voxels_set = (uint64_t *)calloc(workers, sizeof(uint64_t));
+  ctx.chunks_touched = (uint32_t *)calloc(workers, sizeof(uint32_t));
+
+  PointIngestStats s = {.points = count};
+  for (uint64_t first = 0; first < count; first += batch) {
+    ctx.points = points + first;
+    ctx.count = count - first < batch ? (uint32_t)(count - first) : batch;
+    ctx.parts = (ctx.count + INGEST_BLOCK - 1u) / INGEST_BLOCK;
+
+    uint64_t t1 = time_now_ns();
+    job_parallel_for(world->jobs, ctx.parts, _quantize_job, &ctx);
+    uint64_t t2 = time_now_ns();
+    const IngestKey *sorted = _sort(&ctx);
+    uint64_t t3 = time_now_ns();
+
+    s.dropped += ctx.count - ctx.sorted;
+    // whole slot runs per job, so no two jobs write one chunk
+    ctx.src = sorted;
+    ctx.parts = (ctx.sorted + INGEST_BLOCK - 1u) / INGEST_BLOCK;
+    job_parallel_for(world->jobs, ctx.parts, _sweep_job, &ctx);
+    uint64_t t4 = time_now_ns();
+
+    s.quantize_ns += t2 - t1;
+    s.sort_ns += t3 - t2;
+    s.sweep_ns += t4 - t3;
+  }
+
+  for (uint32_t w = 0; w < workers; w++) {
+    s.voxels_set += ctx.voxels_set[w];
+    s.chunks_touched += ctx.chunks_touched[w];
+  }
+  free(ctx.held);
+  free(ctx.keys);
+  free(ctx.tmp);
+  free(ctx.part_count);
+  free(ctx.hist);
+  free(ctx.voxels_set);
+  free(ctx.chunks_touched);
+  s.ns = time_now_ns() - t0;
+  if (stats)
+    *stats = s;
+}
+
+// -------------------- Tests --------------------
+int point_ingest_test(void) {
+  LOG_INFO("Point Ingest Test: %u key bits (%zu-byte keys)\n", (unsigned)INGEST_KEY_BITS, sizeof(IngestKey));
+  WorldManager *a = (WorldManager *)malloc(sizeof(WorldManager));
+  WorldManager *b = (WorldManager *)malloc(sizeof(WorldManager));
+  world_init(a, 3);
+  world_init(b, 1);
+  unsigned int seed = 2024u;
+  bool ok = true;
+
+  // Test 1: the radix sort orders keys by leaf word and keeps every key
+  LOG_INFO("[Test 1] Radix sort... ");
+  {
+    const uint32_t n = 3u * INGEST_BLOCK + 1234u;
+    IngestContext ctx = {.world = a, .count = n, .parts = (n + INGEST_BLOCK - 1u) / INGEST_BLOCK};
+    ctx.keys = (IngestKey *)malloc(n * sizeof(IngestKey));
+    ctx.tmp = (IngestKey *)malloc(n * sizeof(IngestKey));
+    ctx.part_count = (uint32_t *)malloc(ctx.parts * sizeof(uint32_t));
+    ctx.hist = (uint32_t *)malloc((size_t)ctx.parts * INGEST_BUCKETS * sizeof(uint32_t));
+
+    // parts with holes, as quantize leaves them; a narrow slot range so some digits never vary
+    uint64_t sum = 0;
+    uint32_t kept = 0;
+    for (uint32_t p = 0; p < ctx.parts; p++) {
+      uint32_t size = p + 1u < ctx.parts ? INGEST_BLOCK : n - p * INGEST_BLOCK;
+      ctx.part_count[p] = size - (p * 97u) % 1000u;
+      for (uint32_t i = 0; i < ctx.part_count[p]; i++) {
+        seed = seed * 1103515245u + 12345u;
+        uint64_t r = ((uint64_t)seed << 20) ^ (seed >> 3);
+        IngestKey key = (IngestKey)(((uint64_t)(3u + seed % 5u) << MORTON_BITS) | (r & ((1ull << MORTON_BITS) - 1ull)));
+        ctx.keys[p * INGEST_BLOCK + i] = key;
+        sum += key;
+      }
+      kept += ctx.part_count[p];
+    }
+    const IngestKey *sorted = _sort(&ctx);
+    ok = ctx.sorted == kept;
+    for (uint32_t i = 0; i < kept && ok; i++) {
+      sum -= sorted[i];
+      ok = i == 0 || KEY_WORD(sorted[i - 1]) <= KEY_WORD(sorted[i]);
+    }
+    ok = ok && sum == 0;
+    free(ctx.keys);
+    free(ctx.tmp);
+    free(ctx.part_count);
+    free(ctx.hist);
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 2: small batches of points land exactly where map_insert_voxel puts them; only those chunks are dirty
+  LOG_INFO("[Test 2] Same voxels as map_insert_voxel... ");
+  const uint32_t count = 200000u;
+  vec3 *points = (vec3 *)malloc(count * sizeof(vec3));
+  float extent = (float)(MAP_DIM * (int)CHUNK_SIZE) * 0.5f; // in world units, for voxel_size 0.5
+  _random_points(points, count, extent, &seed);
+  for (uint32_t i = 0; i < count; i += 97u)
+    points[i][i % 3u] = i % 2u ? -3.0f : NAN; // outside the window or not a position at all
+  PointIngestDesc desc = {.origin = {-1.0f, 0.0f, 0.25f}, .voxel_size = 0.5f, .batch = 50000u};
+
+  uint64_t dropped = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    float v[3];
+    for (int k = 0; k < 3; k++)
+      v[k] = floorf((points[i][k] - desc.origin[k]) / desc.voxel_size);
+    bool inside = true;
+    for (int k = 0; k < 3; k++)
+      inside = inside && v[k] >= 0.0f && v[k] < (float)(MAP_DIM * (int)CHUNK_SIZE);
+    if (inside)
+      map_insert_voxel(b, (int)v[0], (int)v[1], (int)v[2], true);
+    dropped += !inside;
+  }
+
+  // fresh slots start dirty
+  world_rebuild_dirty(a, 0);
+  PointIngestStats stats;
+  point_ingest(a, points, count, &desc, &stats);
+  uint32_t dirty = 0, filled = 0;
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++)
+    filled += b->chunks[i].tree.fill != CHUNK_FILL_EMPTY;
+  ok = stats.points == count && stats.dropped == dropped && stats.voxels_set > 0u && _same_worlds(a, b, &dirty) &&
+       dirty == filled && stats.chunks_touched >= filled;
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done_points;
+  }
+  LOG_INFO("PASSED (%u chunks)\n", dirty);
+
+  // Test 3: the same points again set nothing and dirty nothing
+  LOG_INFO("[Test 3] Repeated ingest... ");
+  world_rebuild_dirty(a, 0);
+  point_ingest(a, points, count, &desc, &stats);
+  ok = stats.voxels_set == 0u && stats.chunks_touched == 0u && _same_worlds(a, b, &dirty) && dirty == 0u;
+  if (!ok)
+    LOG_INFO("FAILED\n");
+  else
+    LOG_INFO("PASSED\n");
+
+done_points:
+  free(points);
+done:
+  world_destroy(a);
+  world_destroy(b);
+  free(a);
+  free(b);
+  return ok ? 0 : 1;
+}
+
+// -------------------- Benchmarks --------------------
+// A LiDAR-like scan (points scattered over a rolling terrain surface) into a static window: point_ingest
+// against quantizing each point and calling map_insert_voxel.
+void point_ingest_bench(void) {
+  const uint32_t count = INGEST_BENCH_POINTS;
+  vec3 *points = (vec3 *)malloc(count * sizeof(vec3));
+  float dim = (float)(MAP_DIM * (int)CHUNK_SIZE);
+  unsigned int seed = 77u;
+  for (uint32_t i = 0; i < count; i++) {
+    seed = seed * 1103515245u + 12345u;
+    float x = (float)(seed >> 8) / 16777216.0f * dim;
+    seed = seed * 1103515245u + 12345u;
+    float z = (float)(seed >> 8) / 16777216.0f * dim;
+    seed = seed * 1103515245u + 12345u;
+    float jitter = (float)(seed >> 8) / 16777216.0f * 2.0f;
+    points[i][0] = x;
+    points[i][1] = dim * 0.4f + 40.0f * sinf(x * 0.01f) * cosf(z * 0.013f) + jitter;
+    points[i][2] = z;
+  }
+  PointIngestDesc desc = {.origin = {0.0f, 0.0f, 0.0f}, .voxel_size = 1.0f};
+
+  WorldManager *world = (WorldManager *)malloc(sizeof(WorldManager));
+  world_init(world, 0);
+  PointIngestStats stats;
+  point_ingest(world, points, count, &desc, &stats);
+  LOG_INFO("Point Ingest Bench: %u points, %u workers (CHUNK_SIZE=%u, %zu-byte keys)\n", count,
+           job_worker_count(world->jobs), (unsigned)CHUNK_SIZE, sizeof(IngestKey));
+  LOG_INFO("  point_ingest     : %7.1f ms, %6.1f Mpoints/s (quantize %.1f, sort %.1f, sweep %.1f ms), %u chunks\n",
+           (double)stats.ns / 1e6, (double)count * 1e3 / (double)stats.ns, (double)stats.quantize_ns / 1e6,
+           (double)stats.sort_ns / 1e6, (double)stats.sweep_ns / 1e6, stats.chunks_touched);
+  world_destroy(world);
+
+  world_init(world, 0);
+  uint64_t t0 = time_now_ns();
+  for (uint32_t i = 0; i < count; i++) {
+    map_insert_voxel(world, (int)floorf(points[i][0]), (int)floorf(points[i][1]), (int)floorf(points[i][2]), true);
+  }
+  uint64_t ns = time_now_ns() - t0;
+  LOG_INFO("  map_insert_voxel : %7.1f ms, %6.1f Mpoints/s\n", (double)ns / 1e6, (double)count * 1e3 / (double)ns);
+  world_destroy(world);
+  free(world);
+  free(points);
+}
+
+// --- Private Functions ---
+
+// morton_encode3 of chunk-local coordinates. Up to 10 bits per axis the spread fits 32-bit lanes, so it vectorizes,
+// and needs only the last four steps of the morton_split3 cascade.
+static inline IngestKey _local_code(uint32_t x, uint32_t y, uint32_t z) {
+#if BITS_PER_AXIS <= 10
+  x = (x | (x << 16)) & 0x030000FFu;
+  y = (y | (y << 16)) & 0x030000FFu;
+  z = (z | (z << 16)) & 0x030000FFu;
+  x = (x | (x << 8)) & 0x0300F00Fu;
+  y = (y | (y << 8)) & 0x0300F00Fu;
+  z = (z | (z << 8)) & 0x0300F00Fu;
+  x = (x | (x << 4)) & 0x030C30C3u;
+  y = (y | (y << 4)) & 0x030C30C3u;
+  z = (z | (z << 4)) & 0x030C30C3u;
+  x = (x | (x << 2)) & 0x09249249u;
+  y = (y | (y << 2)) & 0x09249249u;
+  z = (z | (z << 2)) & 0x09249249u;
+  return (IngestKey)(x | (y << 1) | (z << 2));
+#else
+  return (IngestKey)morton_encode3(x, y, z);
+#endif
+}
+
+// Block `index` of the batch into part `index` of keys, valid keys first.
+static void _quantize_job(void *user, uint32_t index, uint32_t worker) {
+  (void)worker;
+  IngestContext *ctx = (IngestContext *)user;
+  uint32_t begin = index * INGEST_BLOCK;
+  uint32_t end = begin + INGEST_BLOCK < ctx->count ? begin + INGEST_BLOCK : ctx->count;
+  IngestKey *out = ctx->keys + begin;
+  uint32_t n = 0;
+  const float o[3] = {ctx->origin[0], ctx->origin[1], ctx->origin[2]};
+  const float inv = ctx->inv_voxel_size;
+
+  // fixed-length passes over runs of points so that they vectorize; the quiet compares keep NaN from trapping, which
+  // would otherwise stop the compiler from turning the selects into masks
+  float f[3][INGEST_ENCODE_RUN];
+  int v[3][INGEST_ENCODE_RUN];
+  int valid[INGEST_ENCODE_RUN];
+  IngestKey keys[INGEST_ENCODE_RUN];
+  vec3 tail[INGEST_ENCODE_RUN];
+  for (uint32_t run = begin; run < end; run += INGEST_ENCODE_RUN) {
+    uint32_t count = end - run < INGEST_ENCODE_RUN ? end - run : INGEST_ENCODE_RUN;
+    const vec3 *points = ctx->points + run;
+    if (count < INGEST_ENCODE_RUN) {
+      memcpy(tail, points, count * sizeof(vec3));
+      memset(tail + count, 0, (INGEST_ENCODE_RUN - count) * sizeof(vec3));
+      points = tail;
+    }
+
+    for (uint32_t i = 0; i < INGEST_ENCODE_RUN; i++)
+      valid[i] = 1;
+    for (int a = 0; a < 3; a++) {
+      for (uint32_t i = 0; i < INGEST_ENCODE_RUN; i++) {
+        float g = (points[i][a] - o[a]) * inv;
+        int in = __builtin_isless(fabsf(g), 1073741824.0f); // false for NaN too
+        f[a][i] = in ? g : 0.0f;
+        valid[i] &= in;
+      }
+    }
+    // floor through a truncating cast
+    for (int a = 0; a < 3; a++) {
+      for (uint32_t i = 0; i < INGEST_ENCODE_RUN; i++) {
+        int t = (int)f[a][i];
+        v[a][i] = t - __builtin_isgreater((float)t, f[a][i]);
+      }
+    }
+    for (uint32_t i = 0; i < INGEST_ENCODE_RUN; i++) {
+      // slot layout of get_chunk_index, with MAP_DIM a power of two
+      uint32_t s = ((uint32_t)(v[0][i] >> BITS_PER_AXIS) & (MAP_DIM - 1)) +
+                   ((uint32_t)(v[1][i] >> BITS_PER_AXIS) & (MAP_DIM - 1)) * MAP_DIM +
+                   ((uint32_t)(v[2][i] >> BITS_PER_AXIS) & (MAP_DIM - 1)) * MAP_DIM * MAP_DIM;
+      keys[i] = ((IngestKey)s << MORTON_BITS) | _local_code((uint32_t)v[0][i] & (CHUNK_SIZE - 1u),
+                                                            (uint32_t)v[1][i] & (CHUNK_SIZE - 1u),
+                                                            (uint32_t)v[2][i] & (CHUNK_SIZE - 1u));
+    }
+
+    // keep the keys of the points whose chunk the slot holds, without a branch on the (random) outcome
+    for (uint32_t i = 0; i < count; i++) {
+      const int *held = ctx->held[KEY_SLOT(keys[i])];
+      int keep = valid[i] & (held[0] == v[0][i] >> BITS_PER_AXIS) & (held[1] == v[1][i] >> BITS_PER_AXIS) &
+                 (held[2] == v[2][i] >> BITS_PER_AXIS);
+      out[n] = keys[i];
+      n += (uint32_t)keep;
+    }
+  }
+  ctx->part_count[index] = n;
+}
+
+// held[slot]: the chunk world_chunk_slot maps onto the slot, INT_MIN if none. Candidates are the static window
+// before the first recenter and the slots' own chunks after it.
+static void _held_chunks(IngestContext *ctx) {
+  const WorldManager *world = ctx->world;
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++)
+    ctx->held[i][0] = INT_MIN;
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++) {
+    int c[3] = {(int)(i % MAP_DIM), (int)(i / MAP_DIM % MAP_DIM), (int)(i / (MAP_DIM * MAP_DIM))};
+    if (world->has_center) {
+      for (int a = 0; a < 3; a++)
+        c[a] = world->chunks[i].global_pos[a] >> BITS_PER_AXIS;
+    }
+    int s = world_chunk_slot(world, c[0], c[1], c[2]);
+    if (s >= 0)
+      memcpy(ctx->held[s], c, sizeof(c));
+  }
+}
+
+static void _histogram_job(void *user, uint32_t index, uint32_t worker) {
+  (void)worker;
+  IngestContext *ctx = (IngestContext *)user;
+  uint32_t *hist = ctx->hist + (size_t)index * INGEST_BUCKETS;
+  memset(hist, 0, INGEST_BUCKETS * sizeof(uint32_t));
+  const IngestKey *keys = ctx->src + (size_t)index * INGEST_BLOCK;
+  for (uint32_t i = 0; i < ctx->part_count[index]; i++)
+    hist[(keys[i] >> ctx->shift) & (INGEST_BUCKETS - 1u)]++;
+}
+
+// Stable: part p's keys of a digit go after those of parts < p, in their order.
+static void _scatter_job(void *user, uint32_t index, uint32_t worker) {
+  (void)worker;
+  IngestContext *ctx = (IngestContext *)user;
+  uint32_t offset[INGEST_BUCKETS];
+  memcpy(offset, ctx->hist + (size_t)index * INGEST_BUCKETS, sizeof(offset));
+  const IngestKey *keys = ctx->src + (size_t)index * INGEST_BLOCK;
+  for (uint32_t i = 0; i < ctx->part_count[index]; i++) {
+    IngestKey key = keys[i];
+    ctx->dst[offset[(key >> ctx->shift) & (INGEST_BUCKETS - 1u)]++] = key;
+  }
+}
+
+// LSD over the key bits above the bit index (keys of one leaf word may stay in any order). The first pass reads
+// the parts as quantize left them and always runs, which packs the keys; returns the array holding the result.
+static const IngestKey *_sort(IngestContext *ctx) {
+  ctx->src = ctx->keys;
+  ctx->dst = ctx->tmp;
+  bool first = true;
+  for (uint32_t shift = 6; shift < INGEST_KEY_BITS; shift += INGEST_RADIX_BITS) {
+    ctx->shift = shift;
+    job_parallel_for(ctx->world->jobs, ctx->parts, _histogram_job, ctx);
+
+    uint32_t total[INGEST_BUCKETS] = {0};
+    uint32_t n = 0;
+    for (uint32_t p = 0; p < ctx->parts; p++) {
+      const uint32_t *hist = ctx->hist + (size_t)p * INGEST_BUCKETS;
+      for (uint32_t d = 0; d < INGEST_BUCKETS; d++)
+        total[d] += hist[d];
+      n += ctx->part_count[p];
+    }
+    bool uniform = false;
+    for (uint32_t d = 0; d < INGEST_BUCKETS && !first; d++)
+      uniform = uniform || total[d] == n;
+    if (uniform)
+      continue;
+
+    // digit-major, part-minor offsets
+    uint32_t running = 0;
+    for (uint32_t d = 0; d < INGEST_BUCKETS; d++) {
+      for (uint32_t p = 0; p < ctx->parts; p++) {
+        uint32_t *h = &ctx->hist[(size_t)p * INGEST_BUCKETS + d];
+        uint32_t c = *h;
+        *h = running;
+        running += c;
+      }
+    }
+    job_parallel_for(ctx->world->jobs, ctx->parts, _scatter_job, ctx);
+
+    IngestKey *done = ctx->dst;
+    ctx->dst = (IngestKey *)ctx->src;
+    ctx->src = done;
+    if (first) {
+      // packed from here on: full parts but the last
+      ctx->sorted = n;
+      ctx->parts = (n + INGEST_BLOCK - 1u) / INGEST_BLOCK;
+      for (uint32_t p = 0; p < ctx->parts; p++)
+        ctx->part_count[p] = p + 1u < ctx->parts ? INGEST_BLOCK : n - p * INGEST_BLOCK;
+      first = false;
+    }
+  }
+  return ctx->src;
+}
+
+// Part `index` of the sorted keys, widened to whole slot runs: a run belongs to the part it starts in.
+static void _sweep_job(void *user, uint32_t index, uint32_t worker) {
+  IngestContext *ctx = (IngestContext *)user;
+  const IngestKey *keys = ctx->src;
+  uint32_t n = ctx->sorted;
+  uint32_t begin = index * INGEST_BLOCK;
+  uint32_t end = begin + INGEST_BLOCK < n ? begin + INGEST_BLOCK : n;
+  while (begin > 0 && begin < n && KEY_SLOT(keys[begin]) == KEY_SLOT(keys[begin - 1]))
+    begin++;
+  while (end < n && KEY_SLOT(keys[end]) == KEY_SLOT(keys[end - 1]))
+    end++;
+
+  uint64_t set = 0;
+  uint32_t touched = 0;
+  for (uint32_t i = begin; i < end;) {
+    uint32_t slot = KEY_SLOT(keys[i]);
+    ChunkTree *tree = &ctx->world->chunks[slot].tree;
+    bool changed = false;
+    while (i < end && KEY_SLOT(keys[i]) == slot) {
+      IngestKey word = KEY_WORD(keys[i]);
+      uint64_t mask = 0;
+      for (; i < end && KEY_WORD(keys[i]) == word; i++)
+        mask |= 1ull << (keys[i] & 63u);
+      if (tree->fill != CHUNK_FILL_SOLID)
+        _flush_word(tree, (uint64_t)(word & ((IngestKey)WORDS_PER_CHUNK - 1u)), mask, &set, &changed);
+    }
+    touched += changed;
+  }
+  ctx->voxels_set[worker] += set;
+  ctx->chunks_touched[worker] += touched;
+}
+
+static void _flush_word(ChunkTree *tree, uint64_t w, uint64_t mask, uint64_t *set, bool *changed) {
+  uint64_t old = chunk_get_word(tree, w);
+  uint64_t added = mask & ~old;
+  if (added == 0ull)
+    return;
+  chunk_set_word(tree, w, old | added);
+  *set += (uint64_t)__builtin_popcountll(added);
+  *changed = true;
+}
+
+// [0, extent) per axis: clustered around a few centers so chunks see runs of points, the rest spread over the
+// lower half of each axis so part of the window stays untouched
+static void _random_points(vec3 *points, uint32_t count, float extent, unsigned int *seed) {
+  float centers[4][3];
+  for (uint32_t c = 0; c < 4u; c++) {
+    for (int a = 0; a < 3; a++) {
+      *seed = *seed * 1103515245u + 12345u;
+      centers[c][a] = (float)(*seed >> 8) / 16777216.0f * extent;
+    }
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    for (int a = 0; a < 3; a++) {
+      *seed = *seed * 1103515245u + 12345u;
+      float r = (float)(*seed >> 8) / 16777216.0f;
+      float v = i % 5u == 0u ? r * extent * 0.5f : centers[i % 4u][a] + (r - 0.5f) * extent * 0.1f;
+      points[i][a] = v < 0.0f ? 0.0f : (v >= extent ? extent * 0.999f : v);
+    }
+  }
+}
+
+// Every slot holds the same voxels; dirty counts the slots of a that are dirty.
+static bool _same_worlds(const WorldManager *a, const WorldManager *b, uint32_t *dirty) {
+  *dirty = 0;
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++) {
+    const ChunkTree *ta = &a->chunks[i].tree, *tb = &b->chunks[i].tree;
+    *dirty += ta->is_dirty;
+    if (ta->fill != tb->fill)
+      return false;
+    for (uint64_t w = 0; w < WORDS_PER_CHUNK && ta->fill == CHUNK_FILL_MIXED; w++) {
+      if (chunk_get_word(ta, w) != chunk_get_word(tb, w))
+        return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "world.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+  Bulk point-cloud ingestion into the world window, in batches of at most PointIngestDesc.batch points:
+  1. quantize (parallel, one job per block of points): voxel coordinates, the slot that holds the voxel's chunk
+     (world_chunk_slot, looked up in a per-call table of the chunk each slot holds) and a key
+     slot << MORTON_BITS | chunk-local Morton code. Points no slot holds are dropped.
+  2. sort: parallel LSD radix sort on the key bits above the voxel's bit in its leaf word, 12 bits per pass:
+     per-block histograms, one prefix pass, stable per-block scatters. The first pass also compacts the keys of
+     the dropped points away; later passes whose digit is the same for every key are skipped.
+  3. sweep (parallel, one job per range of whole slot runs): each chunk's keys are visited in word order, the
+     bits of a leaf word are ORed together and the word is written once.
+  Only the chunks that gained voxels are marked dirty; world_rebuild_dirty (or world_update) rebuilds them.
+*/
+
+#define POINT_INGEST_BATCH (1u << 22) // default points per batch: two key buffers of this size are held
+
+typedef struct PointIngestDesc {
+  vec3 origin;      // world position of the min corner of global voxel (0, 0, 0)
+  float voxel_size; // world units per voxel
+  uint32_t batch;   // points per batch, 0 = POINT_INGEST_BATCH
+} PointIngestDesc;
+
+typedef struct PointIngestStats {
+  uint64_t points;         // points read
+  uint64_t dropped;        // points outside the window (or not a finite position)
+  uint64_t voxels_set;     // voxels that were off before
+  uint32_t chunks_touched; // chunks that gained voxels, summed over the batches
+  uint64_t quantize_ns, sort_ns, sweep_ns;
+  uint64_t ns; // whole ingest
+} PointIngestStats;
+
+// PUBLIC FUNCTIONS
+
+// Sets the voxel under every point. Runs on world->jobs, so not from inside a job. stats may be NULL.
+void point_ingest(WorldManager *world, const vec3 *points, uint64_t count, const PointIngestDesc *desc,
+                  PointIngestStats *stats);
+
+// tests
+int point_ingest_test(void);
+void point_ingest_bench(void);
@@ -0,0 +1,471 @@
+/* region.c */
+#include "region.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define REGION_INDEX_BYTES (sizeof(RegionHeader) + REGION_CHUNKS * sizeof(RegionEntry))
+
+// --- Private Prototypes ---
+static uint32_t _checksum(const Node *nodes, const ChildIndex *child_indices, uint32_t count);
+static bool _validate(const RegionFile *rf, const RegionEntry *e, ChunkView *out);
+static void _restore_words(ChunkTree *chunk, const ChunkView *v, uint32_t pos, int level, uint64_t dense);
+static bool _trees_equal(const ChunkTree *a, const ChunkTree *b);
+
+void region_coord(int cx, int cy, int cz, int *rx, int *ry, int *rz) {
+  *rx = floor_div(cx, REGION_DIM);
+  *ry = floor_div(cy, REGION_DIM);
+  *rz = floor_div(cz, REGION_DIM);
+}
+
+uint32_t region_local_index(int cx, int cy, int cz) {
+  uint32_t lx = (uint32_t)wrap(cx, REGION_DIM);
+  uint32_t ly = (uint32_t)wrap(cy, REGION_DIM);
+  uint32_t lz = (uint32_t)wrap(cz, REGION_DIM);
+  return lx + ly * REGION_DIM + lz * REGION_DIM * REGION_DIM;
+}
+
+void region_path(char *buf, size_t buf_size, const char *dir, int rx, int ry, int rz) {
+  snprintf(buf, buf_size, "%s/r.%d.%d.%d.vxr", dir, rx, ry, rz);
+}
+
+bool region_write(const char *path, const ChunkTree *const *chunks) {
+  RegionHeader header = {.magic = REGION_MAGIC,
+                         .version = REGION_VERSION,
+                         .tree_levels = TREE_LEVELS,
+                         .chunk_count = REGION_CHUNKS,
+                         .entry_size = sizeof(RegionEntry)};
+  RegionEntry *entries = (RegionEntry *)calloc(REGION_CHUNKS, sizeof(RegionEntry));
+
+  // lay out the payloads first so the index can be written in one go
+  uint64_t offset = (REGION_INDEX_BYTES + REGION_PAYLOAD_ALIGN - 1u) & ~(uint64_t)(REGION_PAYLOAD_ALIGN - 1u);
+  for (uint32_t i = 0; i < REGION_CHUNKS; i++) {
+    const ChunkTree *chunk = chunks[i];
+    if (!chunk || chunk->nodes.length == 0)
+      continue;
+
+    if (chunk->is_dirty) {
+      LOG_WARN("region_write: chunk %u is dirty, rebuild it before saving", i);
+      free(entries);
+      return false;
+    }
+
+    RegionEntry *e = &entries[i];
+    e->offset = offset;
+    e->node_count = (uint32_t)chunk->nodes.length;
+    e->checksum =
+        _checksum((const Node *)chunk->nodes.data, (const ChildIndex *)chunk->child_indices.data, e->node_count);
+    memcpy(e->level_count, chunk->level_count, sizeof(e->level_count));
+
+    offset += (uint64_t)e->node_count * (sizeof(Node) + sizeof(ChildIndex));
+    offset = (offset + REGION_PAYLOAD_ALIGN - 1u) & ~(uint64_t)(REGION_PAYLOAD_ALIGN - 1u);
+  }
+  header.file_size = offset;
+
+  char tmp_path[1024];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  FILE *f = fopen(tmp_path, "wb");
+  if (!f) {
+    LOG_WARN("region_write: cannot open %s", tmp_path);
+    free(entries);
+    return false;
+  }
+
+  static const uint8_t zeros[REGION_PAYLOAD_ALIGN] = {0};
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(entries, sizeof(RegionEntry), REGION_CHUNKS, f) == REGION_CHUNKS;
+  uint64_t written = REGION_INDEX_BYTES;
+
+  for (uint32_t i = 0; i < REGION_CHUNKS && ok; i++) {
+    const RegionEntry *e = &entries[i];
+    if (e->offset == 0)
+      continue;
+
+    ok = fwrite(zeros, 1, e->offset - written, f) == e->offset - written &&
+         fwrite(chunks[i]->nodes.data, sizeof(Node), e->node_count, f) == e->node_count &&
+         fwrite(chunks[i]->child_indices.data, sizeof(ChildIndex), e->node_count, f) == e->node_count;
+    written = e->offset + (uint64_t)e->node_count * (sizeof(Node) + sizeof(ChildIndex));
+  }
+  ok = ok && fwrite(zeros, 1, header.file_size - written, f) == header.file_size - written;
+
+  ok = (fclose(f) == 0) && ok;
+  free(entries);
+
+  if (!ok || rename(tmp_path, path) != 0) {
+    LOG_WARN("region_write: failed to write %s", path);
+    remove(tmp_path);
+    return false;
+  }
+  return true;
+}
+
+bool region_open(RegionFile *rf, const char *path) {
+  memset(rf, 0, sizeof(*rf));
+  rf->fd = -1;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < REGION_INDEX_BYTES) {
+    close(fd);
+    return false;
+  }
+
+  void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+
+  const RegionHeader *h = (const RegionHeader *)base;
+  if (h->magic != REGION_MAGIC || h->version != REGION_VERSION || h->tree_levels != TREE_LEVELS ||
+      h->chunk_count != REGION_CHUNKS || h->entry_size != sizeof(RegionEntry) || h->file_size != (uint64_t)st.st_size) {
+    LOG_WARN("region_open: %s has an incompatible header", path);
+    munmap(base, (size_t)st.st_size);
+    close(fd);
+    return false;
+  }
+
+  rf->fd = fd;
+  rf->base = (const uint8_t *)base;
+  rf->size = (size_t)st.st_size;
+  rf->entries = (const RegionEntry *)(rf->base + sizeof(RegionHeader));
+  return true;
+}
+
+void region_close(RegionFile *rf) {
+  if (rf->base)
+    munmap((void *)rf->base, rf->size);
+  if (rf->fd >= 0)
+    close(rf->fd);
+  memset(rf, 0, sizeof(*rf));
+  rf->fd = -1;
+}
+
+bool region_has_chunk(const RegionFile *rf, uint32_t local_index) {
+  return local_index < REGION_CHUNKS && rf->entries[local_index].offset != 0;
+}
+
+bool region_chunk_view(const RegionFile *rf, uint32_t local_index, ChunkView *out) {
+  if (!region_has_chunk(rf, local_index))
+    return false;
+  return _validate(rf, &rf->entries[local_index], out);
+}
+
+bool region_load_chunk(const RegionFile *rf, uint32_t local_index, ChunkTree *chunk) {
+  ChunkView v;
+  if (!region_chunk_view(rf, local_index, &v))
+    return false;
+
+  chunk_clear(chunk);
+  _restore_words(chunk, &v, 0, (int)TREE_LEVELS - 1, 0);
+  chunk_build_distance(chunk);
+
+  vec_reserve(&chunk->nodes, v.node_count);
+  vec_reserve(&chunk->child_indices, v.node_count);
+  memcpy(chunk->nodes.data, v.nodes, v.node_count * sizeof(Node));
+  memcpy(chunk->child_indices.data, v.child_indices, v.node_count * sizeof(ChildIndex));
+  chunk->nodes.length = v.node_count;
+  chunk->child_indices.length = v.node_count;
+
+  uint32_t start = 0;
+  for (int d = (int)TREE_LEVELS - 1; d >= 0; d--) {
+    chunk->level_start[d] = start;
+    chunk->level_count[d] = v.level_count[d];
+    start += v.level_count[d];
+  }
+
+  // the stored tree already matches the restored voxels
+  chunk->is_dirty = false;
+  chunk->pending_edits = 0;
+  chunk->dirty_overflow = false;
+  chunk->dirty_word_count = 0;
+  chunk->need_upload = true;
+  chunk->upload_all = true;
+  chunk_compact(chunk);
+  chunk_build_lods(chunk);
+  chunk_build_layout(chunk);
+  return true;
+}
+
+void region_prefetch(const RegionFile *rf, uint32_t local_index) {
+  if (!region_has_chunk(rf, local_index))
+    return;
+
+  const RegionEntry *e = &rf->entries[local_index];
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t begin = (size_t)e->offset & ~(page - 1u);
+  size_t end = (size_t)e->offset + (size_t)e->node_count * (sizeof(Node) + sizeof(ChildIndex));
+  if (end > rf->size)
+    end = rf->size;
+  if (end > begin)
+    madvise((void *)(rf->base + begin), end - begin, MADV_WILLNEED);
+}
+
+// -------------------- Tests --------------------
+
+int region_test(void) {
+  const char *path = "/tmp/vkengine_region_test.vxr";
+  LOG_INFO("Region Test: %u chunks per region, TREE_LEVELS=%d\n", (unsigned)REGION_CHUNKS, (int)TREE_LEVELS);
+
+  ChunkTree *chunks = (ChunkTree *)malloc(4u * sizeof(ChunkTree));
+  const ChunkTree *slots[REGION_CHUNKS] = {0};
+  const uint32_t stored[4] = {0, 7, 300, REGION_CHUNKS - 1u};
+
+  for (uint32_t i = 0; i < 4u; i++) {
+    chunk_init(&chunks[i]);
+    if (i != 2u)
+      chunk_fill_test_chunk(&chunks[i], 31u * i + 5u);
+    // one patched incrementally, one left empty (root only)
+    if (i == 1u) {
+      chunk_rebuild(&chunks[i]);
+      chunk_set_voxel(&chunks[i], 1, 2, 3, true);
+      chunk_rebuild_incremental(&chunks[i]);
+    }
+    chunks[i].is_dirty = true; // the empty one still gets its root
+    chunk_rebuild(&chunks[i]);
+    slots[stored[i]] = &chunks[i];
+  }
+
+  // Test 1: round trip through the file
+  LOG_INFO("[Test 1] Write, map and view... ");
+  bool ok = region_write(path, slots);
+  RegionFile rf;
+  ok = ok && region_open(&rf, path);
+
+  ChunkTree *loaded = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(loaded);
+
+  for (uint32_t i = 0; i < 4u && ok; i++) {
+    ChunkView v;
+    ok = region_chunk_view(&rf, stored[i], &v) && v.node_count == chunks[i].nodes.length &&
+         memcmp(v.nodes, chunks[i].nodes.data, v.node_count * sizeof(Node)) == 0 &&
+         memcmp(v.child_indices, chunks[i].child_indices.data, v.node_count * sizeof(ChildIndex)) == 0;
+
+    // loading restores the voxels too: a forced full rebuild must reproduce the stored tree
+    ok = ok && region_load_chunk(&rf, stored[i], loaded) && _trees_equal(loaded, &chunks[i]);
+    if (ok) {
+      loaded->is_dirty = true;
+      chunk_rebuild(loaded);
+      ok = _trees_equal(loaded, &chunks[i]);
+    }
+  }
+  ok = ok && !region_has_chunk(&rf, 1u) && !region_chunk_view(&rf, 1u, &(ChunkView){0});
+  region_close(&rf);
+
+  if (ok)
+    LOG_INFO("PASSED\n");
+  else
+    LOG_INFO("FAILED (round trip differs)\n");
+
+  // Test 2: a damaged file is rejected by the validation pass instead of handing out a broken tree
+  if (ok) {
+    LOG_INFO("[Test 2] Corruption is detected... ");
+    FILE *f = fopen(path, "r+b");
+    RegionEntry e;
+    fseek(f, (long)(sizeof(RegionHeader) + stored[0] * sizeof(RegionEntry)), SEEK_SET);
+    ok = fread(&e, sizeof(e), 1, f) == 1;
+
+    // bump the root's first child index
+    fseek(f, (long)(e.offset + (uint64_t)e.node_count * sizeof(Node)), SEEK_SET);
+    ChildIndex root;
+    ok = ok && fread(&root, sizeof(root), 1, f) == 1;
+    root.first_child_index++;
+    fseek(f, (long)(e.offset + (uint64_t)e.node_count * sizeof(Node)), SEEK_SET);
+    ok = ok && fwrite(&root, sizeof(root), 1, f) == 1;
+    fclose(f);
+
+    ChunkView v;
+    ok = ok && region_open(&rf, path) && !region_chunk_view(&rf, stored[0], &v) &&
+         region_chunk_view(&rf, stored[1], &v);
+    region_close(&rf);
+
+    if (ok)
+      LOG_INFO("PASSED\n");
+    else
+      LOG_INFO("FAILED (corrupted chunk accepted)\n");
+  }
+
+  remove(path);
+  chunk_destroy(loaded);
+  free(loaded);
+  for (uint32_t i = 0; i < 4u; i++)
+    chunk_destroy(&chunks[i]);
+  free(chunks);
+  return ok ? 0 : 1;
+}
+
+// -------------------- Benchmarks --------------------
+
+void region_bench(void) {
+  const char *path = "/tmp/vkengine_region_bench.vxr";
+  const uint32_t reps = 8;
+
+  ChunkTree *chunks = (ChunkTree *)malloc(REGION_CHUNKS * sizeof(ChunkTree));
+  const ChunkTree *slots[REGION_CHUNKS];
+  for (uint32_t i = 0; i < REGION_CHUNKS; i++) {
+    chunk_init(&chunks[i]);
+    chunk_fill_test_chunk(&chunks[i], i);
+    chunk_rebuild(&chunks[i]);
+    slots[i] = &chunks[i];
+  }
+
+  uint64_t t0 = time_now_ns();
+  region_write(path, slots);
+  uint64_t t1 = time_now_ns();
+
+  RegionFile rf;
+  region_open(&rf, path);
+  size_t file_size = rf.size;
+  region_close(&rf);
+
+  LOG_INFO("Region Bench: %u chunks, %.2f MiB on disk (%.2f MiB as dense bitsets), write %.2f ms\n",
+           (unsigned)REGION_CHUNKS, file_size / 1048576.0, (double)REGION_CHUNKS * BYTES_PER_CHUNK_BITSET / 1048576.0,
+           (t1 - t0) / 1e6);
+
+  ChunkTree *loaded = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(loaded);
+  const char *names[] = {"cold", "warm"};
+
+  for (uint32_t mode = 0; mode < 2u; mode++) {
+    uint64_t view_ns = 0, load_ns = 0;
+    uint64_t sink = 0;
+
+    for (uint32_t r = 0; r < reps; r++) {
+      if (mode == 0) {
+        // drop the file from the page cache (best effort: needs the pages to be clean)
+        int fd = open(path, O_RDONLY);
+        if (fd >= 0) {
+          fdatasync(fd);
+          posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+          close(fd);
+        }
+      }
+
+      uint64_t a = time_now_ns();
+      region_open(&rf, path);
+      for (uint32_t i = 0; i < REGION_CHUNKS; i++) {
+        ChunkView v;
+        if (region_chunk_view(&rf, i, &v))
+          sink += v.nodes[v.node_count - 1].mask;
+      }
+      region_close(&rf);
+      uint64_t b = time_now_ns();
+
+      region_open(&rf, path);
+      for (uint32_t i = 0; i < REGION_CHUNKS; i++)
+        sink += region_load_chunk(&rf, i, loaded) ? 1u : 0u;
+      region_close(&rf);
+      uint64_t c = time_now_ns();
+
+      view_ns += b - a;
+      load_ns += c - b;
+    }
+
+    double view_s = (double)view_ns / reps / 1e9;
+    double load_s = (double)load_ns / reps / 1e9;
+    LOG_INFO("  %s: view %8.0f chunks/s (%7.1f MiB/s)  load %8.0f chunks/s (sink=%llu)\n", names[mode],
+             REGION_CHUNKS / view_s, file_size / 1048576.0 / view_s, REGION_CHUNKS / load_s,
+             (unsigned long long)(sink & 1u));
+  }
+
+  remove(path);
+  chunk_destroy(loaded);
+  free(loaded);
+  for (uint32_t i = 0; i < REGION_CHUNKS; i++)
+    chunk_destroy(&chunks[i]);
+  free(chunks);
+}
+
+// --- Private Functions ---
+
+static uint32_t _checksum(const Node *nodes, const ChildIndex *child_indices, uint32_t count) {
+  // multiply-xor over whole words: cheap enough to run on every view
+  uint64_t h = 0x9E3779B97F4A7C15ull ^ count;
+  for (uint32_t i = 0; i < count; i++) {
+    h = (h ^ nodes[i].mask) * 0x100000001B3ull;
+    h = (h ^ child_indices[i].first_child_index) * 0x100000001B3ull;
+  }
+  return (uint32_t)(h ^ (h >> 32));
+}
+
+// Checks that the stored arrays are exactly what a rebuild produces: in-bounds, BFS-ordered, intact.
+static bool _validate(const RegionFile *rf, const RegionEntry *e, ChunkView *out) {
+  uint32_t n = e->node_count;
+  uint64_t bytes = (uint64_t)n * (sizeof(Node) + sizeof(ChildIndex));
+  if (n == 0 || e->offset < REGION_INDEX_BYTES || (e->offset % sizeof(Node)) != 0 || e->offset + bytes > rf->size)
+    return false;
+
+  uint64_t total = 0;
+  for (uint32_t d = 0; d < (uint32_t)TREE_LEVELS; d++)
+    total += e->level_count[d];
+  if (total != n || e->level_count[TREE_LEVELS - 1] != 1u)
+    return false;
+
+  const Node *nodes = (const Node *)(rf->base + e->offset);
+  const ChildIndex *child = (const ChildIndex *)(rf->base + e->offset + (uint64_t)n * sizeof(Node));
+
+  uint32_t start = 0;
+  for (int d = (int)TREE_LEVELS - 1; d >= 0; d--) {
+    uint32_t end = start + e->level_count[d];
+    uint32_t next = end; // children of this level are handed out in order from here
+
+    for (uint32_t i = start; i < end; i++) {
+      uint64_t mask = nodes[i].mask;
+      bool root = (d == (int)TREE_LEVELS - 1);
+
+      // only the root may be empty; leaves and empty roots have no children
+      if (mask == 0ull && !root)
+        return false;
+      if (d == 0 || mask == 0ull) {
+        if (child[i].first_child_index != 0)
+          return false;
+        continue;
+      }
+
+      if (child[i].first_child_index != next)
+        return false;
+      next += (uint32_t)__builtin_popcountll(mask);
+    }
+
+    if (d > 0 && next != end + e->level_count[d - 1])
+      return false;
+    start = end;
+  }
+
+  if (_checksum(nodes, child, n) != e->checksum)
+    return false;
+
+  out->nodes = nodes;
+  out->child_indices = child;
+  out->node_count = n;
+  memcpy(out->level_count, e->level_count, sizeof(out->level_count));
+  return true;
+}
+
+// Depth-first walk writing every leaf mask back to its dense word (dense = node index within its level).
+static void _restore_words(ChunkTree *chunk, const ChunkView *v, uint32_t pos, int level, uint64_t dense) {
+  uint64_t mask = v->nodes[pos].mask;
+  if (level == 0) {
+    chunk_set_word(chunk, dense, mask);
+    return;
+  }
+
+  uint32_t child = v->child_indices[pos].first_child_index;
+  for (uint64_t m = mask; m != 0ull; m &= m - 1ull)
+    _restore_words(chunk, v, child++, level - 1, dense * 64u + (uint64_t)__builtin_ctzll(m));
+}
+
+static bool _trees_equal(const ChunkTree *a, const ChunkTree *b) {
+  return a->nodes.length == b->nodes.length &&
+         memcmp(a->nodes.data, b->nodes.data, a->nodes.length * sizeof(Node)) == 0 &&
+         memcmp(a->child_indices.data, b->child_indices.data, a->nodes.length * sizeof(ChildIndex)) == 0 &&
+         memcmp(a->level_count, b->level_count, sizeof(a->level_count)) == 0;
+}
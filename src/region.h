@@ -0,0 +1,80 @@
+#pragma once
+
+#include "chunk.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  Region files: REGION_DIM^3 chunks per file, stored as their compact 64-tree (nodes + child_indices),
+  never as the dense bitset, so a file is as small as the trees it holds.
+
+  Layout (little endian, every chunk payload 64-byte aligned):
+    RegionHeader
+    RegionEntry[REGION_CHUNKS]        offset 0 = chunk not stored
+    payload: Node[node_count] then ChildIndex[node_count], per stored chunk
+
+  Files are opened read-only with mmap: region_chunk_view hands out pointers straight into the mapping
+  after a validation pass (bounds, BFS consistency, checksum), so a load is no parse and no copy.
+  Writes go to "<path>.tmp" and are renamed into place, so readers never see a half-written file.
+*/
+
+#define REGION_DIM 8
+#define REGION_CHUNKS (REGION_DIM * REGION_DIM * REGION_DIM)
+#define REGION_MAGIC 0x47525856u // "VXRG"
+#define REGION_VERSION 1u
+#define REGION_PAYLOAD_ALIGN 64u
+
+typedef struct RegionHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t tree_levels; // must match the TREE_LEVELS the reader was built with
+  uint32_t chunk_count; // REGION_CHUNKS
+  uint32_t entry_size;  // sizeof(RegionEntry)
+  uint64_t file_size;
+} RegionHeader;
+
+typedef struct RegionEntry {
+  uint64_t offset;     // byte offset of the payload, 0 if the chunk is absent
+  uint32_t node_count; // nodes and child indices stored
+  uint32_t checksum;   // over both arrays
+  uint32_t level_count[TREE_LEVELS];
+} RegionEntry;
+
+typedef struct RegionFile {
+  int fd;
+  const uint8_t *base; // read-only mapping of the whole file
+  size_t size;
+  const RegionEntry *entries;
+} RegionFile;
+
+// Zero-copy view of one stored chunk; valid until region_close.
+typedef struct ChunkView {
+  const Node *nodes;
+  const ChildIndex *child_indices;
+  uint32_t node_count;
+  uint32_t level_count[TREE_LEVELS];
+} ChunkView;
+
+// PUBLIC FUNCTIONS
+
+// region coordinates & naming (chunk coordinates are global, in chunks)
+void region_coord(int cx, int cy, int cz, int *rx, int *ry, int *rz);
+uint32_t region_local_index(int cx, int cy, int cz);
+void region_path(char *buf, size_t buf_size, const char *dir, int rx, int ry, int rz);
+
+// chunks: REGION_CHUNKS entries indexed by region_local_index, NULL = absent. Chunks must be rebuilt (not dirty).
+bool region_write(const char *path, const ChunkTree *const *chunks);
+
+bool region_open(RegionFile *rf, const char *path);
+void region_close(RegionFile *rf);
+bool region_has_chunk(const RegionFile *rf, uint32_t local_index);
+bool region_chunk_view(const RegionFile *rf, uint32_t local_index, ChunkView *out);
+// Copies the tree into chunk and restores its voxel bits from the leaves; chunk is clean afterwards.
+bool region_load_chunk(const RegionFile *rf, uint32_t local_index, ChunkTree *chunk);
+// Asks the kernel to start reading a chunk's pages ahead of region_chunk_view.
+void region_prefetch(const RegionFile *rf, uint32_t local_index);
+
+// tests
+int region_test(void);
+void region_bench(void);
@@ -12,6 +12,10 @@
 // --- Constants ---
 #define RM_MAX_RESOURCES 1024
 #define INVALID_BINDING_INDEX UINT32_MAX
+// Frames a retired resource or a staging block is kept before reuse; at least the submit manager's frames in flight
+#define RM_FRAMES_IN_FLIGHT 3u
+#define RM_STAGING_MIN_BYTES (4ull << 20)
+#define RM_STAGING_ALIGN 16ull
 
 typedef struct {
   ResType type;
@@ -28,6 +32,16 @@ typedef struct {
   };
 } RetiredRes;
 
+// One persistently mapped upload buffer per frame in flight, handed out linearly and rewound when its frame comes
+// around again
+typedef struct {
+  VkBuffer handle;
+  VmaAllocation alloc;
+  u8 *mapped;
+  u64 capacity;
+  u64 used;
+} StagingBlock;
+
 struct M_Resource {
 
   u32 frame_count;
@@ -35,6 +49,8 @@ struct M_Resource {
   VECTOR_TYPES(RetiredRes)
   Vector retired_res;
 
+  StagingBlock staging[RM_FRAMES_IN_FLIGHT];
+
   VECTOR_TYPES(RBuffer, RImage)
   Vector resources[RES_TYPE_COUNT];
 
@@ -57,6 +73,8 @@ static void _create_image_full(M_Resource *rm, RImage *image);
 static void _retire_buffer(M_Resource *rm, ResHandle handle);
 static void _reset_image_sync(RImage *image);
 static void _retire_image(M_Resource *rm, ResHandle handle);
+static void _grow_staging(M_Resource *rm, StagingBlock *block, u64 size);
+static void _destroy_retired(M_GPU *gpu, RetiredRes *r);
 static void _bindless_add(M_Resource *rm, ResHandle handle, VkDescriptorImageInfo *imageInfo,
                           VkDescriptorBufferInfo *bufferInfo);
 
@@ -85,6 +103,12 @@ ResHandle rm_create_buffer(M_Resource *rm, RGBufferInfo *info) {
 
   vmaCreateBuffer(gpu->allocator, &ci, &ai, &buffer.handle, &buffer.alloc, NULL);
 
+  // kept so the buffer can be recreated at another size (rm_resize_buffer)
+  buffer.mem = info->mem;
+  buffer.usage = (VkBufferUsageFlags)info->usage;
+  buffer.capacity = info->capacity;
+  buffer.size = info->capacity;
+
   // Add to Manager & Update Bindless
   uint32_t id = (uint32_t)vec_len(&rm->resources[RES_TYPE_BUFFER]);
   ResHandle resHandle = {.id = id, .res_type = RES_TYPE_BUFFER};
@@ -101,6 +125,46 @@ ResHandle rm_create_buffer(M_Resource *rm, RGBufferInfo *info) {
 }
 // I resmanager.c
 
+void rm_resize_buffer(M_Resource *rm, ResHandle handle, u32 capacity) {
+  auto *gpu = SYSTEM_GET(SYSTEM_TYPE_GPU, M_GPU);
+
+  // frames in flight may still read the old buffer, it is destroyed later by rm_on_new_frame
+  _retire_buffer(rm, handle);
+
+  RBuffer *buffer = rm_get_buffer(rm, handle);
+  VkBufferCreateInfo ci = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO, .size = capacity, .usage = buffer->usage};
+  VmaAllocationCreateInfo ai = {.requiredFlags = buffer->mem};
+  vmaCreateBuffer(gpu->allocator, &ci, &ai, &buffer->handle, &buffer->alloc, NULL);
+
+  buffer->capacity = capacity;
+  buffer->size = capacity;
+  buffer->sync = (SyncDef){.access = VK_ACCESS_2_NONE, .stage = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT};
+
+  // same bindless slot, new buffer behind it
+  VkDescriptorBufferInfo descriptorInfo = {.buffer = buffer->handle, .range = VK_WHOLE_SIZE};
+  _bindless_update(rm, handle, NULL, &descriptorInfo);
+}
+
+VkBuffer rm_staging_alloc(M_Resource *rm, u64 size, void **out_mapped, u64 *out_offset) {
+  StagingBlock *block = &rm->staging[rm->frame_count % RM_FRAMES_IN_FLIGHT];
+  u64 offset = (block->used + RM_STAGING_ALIGN - 1) & ~(RM_STAGING_ALIGN - 1);
+  if (offset + size > block->capacity) {
+    _grow_staging(rm, block, size);
+    offset = 0;
+  }
+  block->used = offset + size;
+  *out_mapped = block->mapped + offset;
+  *out_offset = offset;
+  return block->handle;
+}
+
+void rm_flush_staging(M_Resource *rm, u64 offset, u64 size) {
+  auto *gpu = SYSTEM_GET(SYSTEM_TYPE_GPU, M_GPU);
+  // no-op on host-coherent memory, which AUTO + SEQUENTIAL_WRITE does not guarantee
+  StagingBlock *block = &rm->staging[rm->frame_count % RM_FRAMES_IN_FLIGHT];
+  vk_check(vmaFlushAllocation(gpu->allocator, block->alloc, offset, size));
+}
+
 void rm_resize_image(M_Resource *rm, ResHandle handle, uint32_t width, uint32_t height) {
   _retire_image(rm, handle);
 
@@ -185,19 +249,18 @@ ResHandle rm_import_image(M_Resource *rm, RGImageInfo *info, VkImage img, VkImag
 }
 
 void rm_on_new_frame(M_Resource *rm) {
-  uint64_t safe_frame = rm->frame_count - 3; // Eller din MAX_FRAMES_IN_FLIGHT
   auto *gpu = SYSTEM_GET(SYSTEM_TYPE_GPU, M_GPU);
+  rm->frame_count++;
+
+  // the frame that last wrote this block is RM_FRAMES_IN_FLIGHT frames back, done by now
+  rm->staging[rm->frame_count % RM_FRAMES_IN_FLIGHT].used = 0;
 
   for (int i = 0; i < vec_len(&rm->retired_res); i++) {
     RetiredRes *r = VEC_AT(&rm->retired_res, i, RetiredRes);
 
-    if (r->frame_retired < safe_frame) {
-      if (r->type == RES_TYPE_BUFFER) {
-        vmaDestroyBuffer(gpu->allocator, r->buffer.handle, r->alloc);
-      } else if (r->type == RES_TYPE_IMAGE) {
-        vkDestroyImageView(gpu->device, r->image.view, NULL);
-        vmaDestroyImage(gpu->allocator, r->image.handle, r->alloc);
-      }
+    // frame_retired <= frame_count, so the difference cannot wrap
+    if (rm->frame_count - r->frame_retired >= RM_FRAMES_IN_FLIGHT) {
+      _destroy_retired(gpu, r);
 
       // Ta bort från listan (swap-remove är snabbast om ordning ej spelar roll)
       vec_remove_at(&rm->retired_res, i);
@@ -250,6 +313,15 @@ static void _destroy(M_Resource *rm) {
     vec_free(&rm->resources[i]);
   }
 
+  // the device is idle by now
+  for (size_t i = 0; i < vec_len(&rm->retired_res); i++)
+    _destroy_retired(gpu, VEC_AT(&rm->retired_res, i, RetiredRes));
+  vec_free(&rm->retired_res);
+  for (u32 i = 0; i < RM_FRAMES_IN_FLIGHT; i++) {
+    if (rm->staging[i].handle)
+      vmaDestroyBuffer(gpu->allocator, rm->staging[i].handle, rm->staging[i].alloc);
+  }
+
   // 2. Destroy Bindless Context
   vkDestroySampler(gpu->device, rm->default_sampler, NULL);
   vkDestroyDescriptorSetLayout(gpu->device, rm->bindless_layout, NULL);
@@ -326,6 +398,40 @@ static void _retire_buffer(M_Resource *rm, ResHandle handle) {
   vec_push(&rm->retired_res, &rb);
 }
 
+// Replaces the block with a larger one; ranges already handed out this frame stay valid in the retired buffer.
+static void _grow_staging(M_Resource *rm, StagingBlock *block, u64 size) {
+  auto *gpu = SYSTEM_GET(SYSTEM_TYPE_GPU, M_GPU);
+  u64 capacity = block->capacity ? block->capacity * 2 : RM_STAGING_MIN_BYTES;
+  while (capacity < size)
+    capacity *= 2;
+
+  if (block->handle) {
+    RetiredRes rb = {.frame_retired = rm->frame_count, .alloc = block->alloc, .type = RES_TYPE_BUFFER};
+    rb.buffer.handle = block->handle;
+    vec_push(&rm->retired_res, &rb);
+  }
+
+  VkBufferCreateInfo ci = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO, .size = capacity, .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT};
+  VmaAllocationCreateInfo ai = {
+      .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+      .usage = VMA_MEMORY_USAGE_AUTO};
+  VmaAllocationInfo alloc_info;
+  vk_check(vmaCreateBuffer(gpu->allocator, &ci, &ai, &block->handle, &block->alloc, &alloc_info));
+  block->mapped = (u8 *)alloc_info.pMappedData;
+  block->capacity = capacity;
+  block->used = 0;
+}
+
+static void _destroy_retired(M_GPU *gpu, RetiredRes *r) {
+  if (r->type == RES_TYPE_BUFFER) {
+    vmaDestroyBuffer(gpu->allocator, r->buffer.handle, r->alloc);
+  } else if (r->type == RES_TYPE_IMAGE) {
+    vkDestroyImageView(gpu->device, r->image.view, NULL);
+    vmaDestroyImage(gpu->allocator, r->image.handle, r->alloc);
+  }
+}
+
 static void _reset_image_sync(RImage *image) {
   image->sync = (SyncDef){
       .layout = VK_IMAGE_LAYOUT_UNDEFINED, .access = VK_ACCESS_2_NONE, .stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT};
@@ -129,10 +129,17 @@ u32 rm_get_image_index(M_Resource *rm, ResHandle image);
 u32 rm_get_buffer_image_index(M_Resource *rm, ResHandle buffer);
 
 u32 rm_get_buffer_descriptor_index(M_Resource *rm, ResHandle buffer);
+// Once per frame, after the submit manager waited for the frame's slot: frees retired resources, rewinds staging.
 void rm_on_new_frame(M_Resource *rm);
 void rm_destroy(M_Resource *rm);
 
 ResHandle rm_create_buffer(M_Resource *rm, RGBufferInfo *info);
+// Recreates the buffer with a new capacity (contents are lost); handle and bindless index stay the same.
+void rm_resize_buffer(M_Resource *rm, ResHandle handle, u32 capacity);
+// Transfer-source range of this frame's persistently mapped staging buffer (one per frame in flight, grown on
+// demand); the range is reused once rm_on_new_frame has come back around. Flush what was written before submitting.
+VkBuffer rm_staging_alloc(M_Resource *rm, u64 size, void **out_mapped, u64 *out_offset);
+void rm_flush_staging(M_Resource *rm, u64 offset, u64 size);
 void rm_buffer_sync(M_Resource *rm, VkCommandBuffer cmd, BufferBarrierInfo *info);
 
 ResHandle rm_create_image(M_Resource *rm, RGImageInfo info);
@@ -70,6 +70,7 @@ void run_sample(Sample *sample, GLFWwindow *window) {
     camera_update(&ctx.cam, window, dt);
     m_system_update();
     sm_begin_frame(sm);
+    rm_on_new_frame(rm);
     sm_acquire_swapchain(sm, swapchain);
 
     ctx.swap_img = swapchain_get_image(swapchain);
@@ -0,0 +1,148 @@
+#include "simd.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#endif
+
+typedef struct SimdImpl {
+  SimdBackend backend;
+  uint64_t (*nonzero_mask64)(const uint64_t *words);
+} SimdImpl;
+
+// --- Private Prototypes ---
+static void _init_once(void);
+static const SimdImpl *_impl(void);
+#if SIMD_X86
+static uint64_t _nonzero_mask64_sse41(const uint64_t *words);
+static uint64_t _nonzero_mask64_avx2(const uint64_t *words);
+#endif
+#if SIMD_NEON
+static uint64_t _nonzero_mask64_neon(const uint64_t *words);
+#endif
+
+static const SimdImpl IMPLS[SIMD_BACKEND_COUNT] = {
+    [SIMD_BACKEND_SCALAR] = {SIMD_BACKEND_SCALAR, simd_nonzero_mask64_scalar},
+#if SIMD_X86
+    [SIMD_BACKEND_SSE41] = {SIMD_BACKEND_SSE41, _nonzero_mask64_sse41},
+    [SIMD_BACKEND_AVX2] = {SIMD_BACKEND_AVX2, _nonzero_mask64_avx2},
+#endif
+#if SIMD_NEON
+    [SIMD_BACKEND_NEON] = {SIMD_BACKEND_NEON, _nonzero_mask64_neon},
+#endif
+};
+
+// Picked once; rebuilds on several job workers may reach the first kernel call at the same time.
+static _Atomic(const SimdImpl *) s_impl = NULL;
+static pthread_once_t s_init_once = PTHREAD_ONCE_INIT;
+
+void simd_init(void) { pthread_once(&s_init_once, _init_once); }
+
+SimdBackend simd_backend(void) { return _impl()->backend; }
+
+const char *simd_backend_name(SimdBackend backend) {
+  static const char *names[SIMD_BACKEND_COUNT] = {
+      [SIMD_BACKEND_SCALAR] = "scalar",
+      [SIMD_BACKEND_SSE41] = "sse4.1",
+      [SIMD_BACKEND_AVX2] = "avx2",
+      [SIMD_BACKEND_NEON] = "neon",
+  };
+  return backend < SIMD_BACKEND_COUNT ? names[backend] : "unknown";
+}
+
+uint64_t simd_nonzero_mask64(const uint64_t *words) { return _impl()->nonzero_mask64(words); }
+
+uint64_t simd_nonzero_mask64_scalar(const uint64_t *words) {
+  uint64_t mask = 0;
+  for (uint32_t c = 0; c < 64u; c++)
+    mask |= (uint64_t)(words[c] != 0ull) << c;
+  return mask;
+}
+
+// --- Private Functions ---
+
+static void _init_once(void) {
+  SimdBackend backend = SIMD_BACKEND_SCALAR;
+#if SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    backend = SIMD_BACKEND_AVX2;
+  else if (__builtin_cpu_supports("sse4.1"))
+    backend = SIMD_BACKEND_SSE41;
+#elif SIMD_NEON
+  backend = SIMD_BACKEND_NEON;
+#endif
+  atomic_store_explicit(&s_impl, &IMPLS[backend], memory_order_release);
+}
+
+static const SimdImpl *_impl(void) {
+  const SimdImpl *impl = atomic_load_explicit(&s_impl, memory_order_acquire);
+  if (impl)
+    return impl;
+  simd_init();
+  return atomic_load_explicit(&s_impl, memory_order_acquire);
+}
+
+#if SIMD_X86
+__attribute__((target("sse4.1"))) static uint64_t _nonzero_mask64_sse41(const uint64_t *words) {
+  const __m128i zero = _mm_setzero_si128();
+  uint64_t is_zero = 0;
+
+  // 2 words per compare, movemask_pd packs the two sign bits
+  for (uint32_t c = 0; c < 64u; c += 8u) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(words + c));
+    __m128i b = _mm_loadu_si128((const __m128i *)(words + c + 2));
+    __m128i d = _mm_loadu_si128((const __m128i *)(words + c + 4));
+    __m128i e = _mm_loadu_si128((const __m128i *)(words + c + 6));
+
+    uint64_t bits = (uint64_t)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(a, zero))) |
+                    ((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(b, zero))) << 2) |
+                    ((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(d, zero))) << 4) |
+                    ((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(e, zero))) << 6);
+    is_zero |= bits << c;
+  }
+
+  return ~is_zero;
+}
+
+__attribute__((target("avx2"))) static uint64_t _nonzero_mask64_avx2(const uint64_t *words) {
+  const __m256i zero = _mm256_setzero_si256();
+  uint64_t is_zero = 0;
+
+  // 4 words per compare, 16 words per iteration
+  for (uint32_t c = 0; c < 64u; c += 16u) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(words + c));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(words + c + 4));
+    __m256i d = _mm256_loadu_si256((const __m256i *)(words + c + 8));
+    __m256i e = _mm256_loadu_si256((const __m256i *)(words + c + 12));
+
+    uint64_t bits = (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, zero))) |
+                    ((uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(b, zero))) << 4) |
+                    ((uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(d, zero))) << 8) |
+                    ((uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(e, zero))) << 12);
+    is_zero |= bits << c;
+  }
+
+  return ~is_zero;
+}
+#endif
+
+#if SIMD_NEON
+static uint64_t _nonzero_mask64_neon(const uint64_t *words) {
+  uint64_t mask = 0;
+
+  for (uint32_t c = 0; c < 64u; c += 2u) {
+    uint64x2_t nz = vtstq_u64(vld1q_u64(words + c), vld1q_u64(words + c)); // all-ones where word != 0
+    mask |= (vgetq_lane_u64(nz, 0) & 1ull) << c;
+    mask |= (vgetq_lane_u64(nz, 1) & 1ull) << (c + 1u);
+  }
+
+  return mask;
+}
+#endif
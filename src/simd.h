@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum SimdBackend {
+  SIMD_BACKEND_SCALAR,
+  SIMD_BACKEND_SSE41,
+  SIMD_BACKEND_AVX2,
+  SIMD_BACKEND_NEON,
+  SIMD_BACKEND_COUNT,
+} SimdBackend;
+
+// PUBLIC FUNCTIONS
+
+// Picks the best kernels for the running CPU, once. Safe to call from any thread; kernels self-init on first use.
+void simd_init(void);
+SimdBackend simd_backend(void);
+const char *simd_backend_name(SimdBackend backend);
+
+// Bit c of the result is set if words[c] != 0 (c = 0..63). Used to reduce 64 children into a parent mask.
+uint64_t simd_nonzero_mask64(const uint64_t *words);
+uint64_t simd_nonzero_mask64_scalar(const uint64_t *words);
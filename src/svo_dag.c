@@ -0,0 +1,302 @@
+/* svo_dag.c */
+#include "svo_dag.h"
+#include "morton.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DAG_TABLE_MIN_CAPACITY 64u
+
+// --- Private Prototypes ---
+static uint64_t _hash_group(const Node *nodes, const ChildIndex *children, uint32_t count);
+static bool _group_equal(const SvoDag *dag, const DagGroup *g, const Node *nodes, const ChildIndex *children,
+                         uint32_t count);
+static uint32_t _intern(SvoDag *dag, const Node *nodes, const ChildIndex *children, uint32_t count);
+static void _grow(SvoDag *dag);
+static void _fill_dag_test_chunk(ChunkTree *chunk, uint32_t variant);
+static bool _check_chunk(const SvoDag *dag, uint32_t root, const ChunkTree *chunk);
+
+void svo_dag_init(SvoDag *dag) {
+  memset(dag, 0, sizeof(*dag));
+  vec_init(&dag->nodes, sizeof(Node), NULL);
+  vec_init(&dag->child_indices, sizeof(ChildIndex), NULL);
+  vec_init(&dag->remap, sizeof(uint32_t), NULL);
+  vec_init(&dag->group_childs, sizeof(ChildIndex), NULL);
+}
+
+void svo_dag_destroy(SvoDag *dag) {
+  vec_destroy(&dag->nodes);
+  vec_destroy(&dag->child_indices);
+  vec_destroy(&dag->remap);
+  vec_destroy(&dag->group_childs);
+  free(dag->table);
+  memset(dag, 0, sizeof(*dag));
+}
+
+void svo_dag_clear(SvoDag *dag) {
+  // keeps the pool and table memory for the next build
+  dag->nodes.length = 0;
+  dag->child_indices.length = 0;
+  if (dag->table)
+    memset(dag->table, 0, dag->capacity * sizeof(DagGroup));
+  dag->group_count = 0;
+  dag->nodes_inserted = 0;
+}
+
+uint32_t svo_dag_insert(SvoDag *dag, const ChunkTree *chunk) {
+  uint32_t node_count = (uint32_t)chunk->nodes.length;
+  if (node_count == 0) {
+    // never rebuilt: same as an empty root
+    Node empty = {0};
+    ChildIndex none = {0};
+    return _intern(dag, &empty, &none, 1);
+  }
+
+  const Node *nodes = (const Node *)chunk->nodes.data;
+  const ChildIndex *child_indices = (const ChildIndex *)chunk->child_indices.data;
+  dag->nodes_inserted += node_count;
+
+  vec_reserve(&dag->remap, node_count);
+  vec_reserve(&dag->group_childs, 64);
+  uint32_t *remap = (uint32_t *)dag->remap.data;
+  ChildIndex *group_childs = (ChildIndex *)dag->group_childs.data;
+
+  // leaves have no child group
+  uint32_t leaf_start = chunk->level_start[0];
+  for (uint32_t i = leaf_start; i < leaf_start + chunk->level_count[0]; i++)
+    remap[i] = 0;
+
+  // bottom-up: a node's children are interned before the node itself, so its pool form is final
+  for (uint32_t d = 1; d < (uint32_t)TREE_LEVELS; d++) {
+    uint32_t start = chunk->level_start[d];
+    for (uint32_t p = start; p < start + chunk->level_count[d]; p++) {
+      uint32_t first = child_indices[p].first_child_index;
+      uint32_t count = (uint32_t)__builtin_popcountll(nodes[p].mask);
+      // an empty root has no child group to share
+      if (count == 0) {
+        remap[p] = 0;
+        continue;
+      }
+      for (uint32_t c = 0; c < count; c++)
+        group_childs[c].first_child_index = remap[first + c];
+      remap[p] = _intern(dag, &nodes[first], group_childs, count);
+    }
+  }
+
+  ChildIndex root = {remap[0]};
+  return _intern(dag, &nodes[0], &root, 1);
+}
+
+bool svo_dag_get_voxel(const SvoDag *dag, uint32_t root, int x, int y, int z) {
+  if (x < 0 || y < 0 || z < 0 || x >= (int)CHUNK_SIZE || y >= (int)CHUNK_SIZE || z >= (int)CHUNK_SIZE)
+    return false;
+
+  const Node *nodes = (const Node *)dag->nodes.data;
+  const ChildIndex *child_indices = (const ChildIndex *)dag->child_indices.data;
+  uint64_t code = morton_encode3((uint32_t)x, (uint32_t)y, (uint32_t)z);
+  uint32_t index = root;
+
+  for (int d = (int)TREE_LEVELS - 1; d >= 0; d--) {
+    uint64_t mask = nodes[index].mask;
+    uint64_t bit = 1ull << CHILD_SLOT(code, (uint32_t)d);
+    if ((mask & bit) == 0ull)
+      return false;
+    if (d == 0)
+      return true;
+    index = child_indices[index].first_child_index + (uint32_t)__builtin_popcountll(mask & (bit - 1ull));
+  }
+  return false;
+}
+
+size_t svo_dag_bytes(const SvoDag *dag) { return dag->nodes.length * (sizeof(Node) + sizeof(ChildIndex)); }
+
+// -------------------- Tests --------------------
+
+int svo_dag_test(void) {
+  LOG_INFO("SVO DAG Test\n");
+
+  const uint32_t variants = 6;
+  ChunkTree *chunks = (ChunkTree *)malloc(variants * sizeof(ChunkTree));
+  uint32_t roots[6];
+  SvoDag dag;
+  svo_dag_init(&dag);
+  bool ok = true;
+
+  for (uint32_t v = 0; v < variants; v++) {
+    chunk_init(&chunks[v]);
+    _fill_dag_test_chunk(&chunks[v], v);
+    chunks[v].is_dirty = true;
+    chunk_rebuild(&chunks[v]);
+  }
+
+  LOG_INFO("[Test 1] DAG traversal matches the chunk trees... ");
+  for (uint32_t v = 0; v < variants; v++)
+    roots[v] = svo_dag_insert(&dag, &chunks[v]);
+  for (uint32_t v = 0; v < variants && ok; v++)
+    ok = _check_chunk(&dag, roots[v], &chunks[v]);
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED (%llu nodes -> %zu)\n", (unsigned long long)dag.nodes_inserted, dag.nodes.length);
+
+  LOG_INFO("[Test 2] Identical subtrees are stored once... ");
+  {
+    // re-inserting adds nothing. A solid chunk is the root plus one group of 64 full nodes: the leaf group and
+    // every interior group encode the same (all ones, child group 0), and traversal tracks the depth itself.
+    size_t before = dag.nodes.length;
+    for (uint32_t v = 0; v < variants && ok; v++)
+      ok = svo_dag_insert(&dag, &chunks[v]) == roots[v];
+    ok = ok && dag.nodes.length == before;
+
+    SvoDag solid;
+    svo_dag_init(&solid);
+    svo_dag_insert(&solid, &chunks[1]);
+    ok = ok && solid.nodes.length == 65u;
+    svo_dag_destroy(&solid);
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  LOG_INFO("[Test 3] Clear and rebuild after edits... ");
+  chunk_fill_sphere(&chunks[2], (VoxelCoord){3, 3, 3}, 2, false);
+  chunk_rebuild_incremental(&chunks[2]);
+  svo_dag_clear(&dag);
+  for (uint32_t v = 0; v < variants; v++)
+    roots[v] = svo_dag_insert(&dag, &chunks[v]);
+  for (uint32_t v = 0; v < variants && ok; v++)
+    ok = _check_chunk(&dag, roots[v], &chunks[v]);
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+done:
+  for (uint32_t v = 0; v < variants; v++)
+    chunk_destroy(&chunks[v]);
+  free(chunks);
+  svo_dag_destroy(&dag);
+  return ok ? 0 : 1;
+}
+
+// --- Private Functions ---
+
+static uint64_t _hash_group(const Node *nodes, const ChildIndex *children, uint32_t count) {
+  uint64_t h = 0x9E3779B97F4A7C15ull ^ count;
+  for (uint32_t i = 0; i < count; i++) {
+    h ^= nodes[i].mask + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    h ^= (uint64_t)children[i].first_child_index * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+  }
+  // fold so the low bits used for the table index depend on every input bit
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  return h;
+}
+
+static bool _group_equal(const SvoDag *dag, const DagGroup *g, const Node *nodes, const ChildIndex *children,
+                         uint32_t count) {
+  if (g->count != count)
+    return false;
+  const Node *pool_nodes = (const Node *)dag->nodes.data + g->start;
+  const ChildIndex *pool_children = (const ChildIndex *)dag->child_indices.data + g->start;
+  return memcmp(pool_nodes, nodes, count * sizeof(Node)) == 0 &&
+         memcmp(pool_children, children, count * sizeof(ChildIndex)) == 0;
+}
+
+// Returns the pool address of an identical group, appending the group first if there is none.
+static uint32_t _intern(SvoDag *dag, const Node *nodes, const ChildIndex *children, uint32_t count) {
+  // keep the load factor at or below 1/2
+  if ((dag->group_count + 1u) * 2u > dag->capacity)
+    _grow(dag);
+
+  uint64_t hash = _hash_group(nodes, children, count);
+  uint32_t mask = dag->capacity - 1u;
+  uint32_t i = (uint32_t)hash & mask;
+  for (; dag->table[i].count != 0; i = (i + 1u) & mask) {
+    if (dag->table[i].hash == hash && _group_equal(dag, &dag->table[i], nodes, children, count))
+      return dag->table[i].start;
+  }
+
+  uint32_t start = (uint32_t)dag->nodes.length;
+  vec_reserve(&dag->nodes, start + count);
+  vec_reserve(&dag->child_indices, start + count);
+  memcpy((Node *)dag->nodes.data + start, nodes, count * sizeof(Node));
+  memcpy((ChildIndex *)dag->child_indices.data + start, children, count * sizeof(ChildIndex));
+  dag->nodes.length += count;
+  dag->child_indices.length += count;
+
+  dag->table[i] = (DagGroup){.hash = hash, .start = start, .count = count};
+  dag->group_count++;
+  return start;
+}
+
+static void _grow(SvoDag *dag) {
+  uint32_t old_capacity = dag->capacity;
+  DagGroup *old = dag->table;
+
+  dag->capacity = old_capacity ? old_capacity * 2u : DAG_TABLE_MIN_CAPACITY;
+  dag->table = (DagGroup *)calloc(dag->capacity, sizeof(DagGroup));
+
+  uint32_t mask = dag->capacity - 1u;
+  for (uint32_t j = 0; j < old_capacity; j++) {
+    if (old[j].count == 0)
+      continue;
+    uint32_t i = (uint32_t)old[j].hash & mask;
+    while (dag->table[i].count != 0)
+      i = (i + 1u) & mask;
+    dag->table[i] = old[j];
+  }
+  free(old);
+}
+
+// 0 empty, 1 solid, 2-3 terrain-like, 4 noise, 5 = 2 mirrored in x (same statistics, different subtrees).
+static void _fill_dag_test_chunk(ChunkTree *chunk, uint32_t variant) {
+  int cs = (int)CHUNK_SIZE;
+  switch (variant) {
+  case 0:
+    break;
+  case 1:
+    chunk_fill_box(chunk, (VoxelCoord){0, 0, 0}, (VoxelCoord){cs - 1, cs - 1, cs - 1}, true);
+    break;
+  case 2:
+  case 3:
+  case 5: {
+    chunk_fill_box(chunk, (VoxelCoord){0, 0, 0}, (VoxelCoord){cs - 1, cs / 3 + (int)variant, cs - 1}, true);
+    int x = variant == 5 ? cs - 1 - cs / 3 : cs / 3;
+    chunk_fill_sphere(chunk, (VoxelCoord){x, cs / 2, cs / 2}, cs / 5, true);
+    break;
+  }
+  default: {
+    unsigned int seed = 12345u;
+    for (int i = 0; i < cs * cs * 4; i++) {
+      seed = seed * 1103515245u + 12345u;
+      int x = (int)((seed >> 4) % (unsigned)cs);
+      seed = seed * 1103515245u + 12345u;
+      int y = (int)((seed >> 4) % (unsigned)cs);
+      seed = seed * 1103515245u + 12345u;
+      chunk_set_voxel(chunk, x, y, (int)((seed >> 4) % (unsigned)cs), true);
+    }
+    break;
+  }
+  }
+}
+
+// Every voxel: DAG traversal vs the chunk's own compact tree (LOD 0) vs its voxel bits.
+static bool _check_chunk(const SvoDag *dag, uint32_t root, const ChunkTree *chunk) {
+  int cs = (int)CHUNK_SIZE;
+  for (int z = 0; z < cs; z++) {
+    for (int y = 0; y < cs; y++) {
+      for (int x = 0; x < cs; x++) {
+        bool tree = chunk_lod_get_cell(chunk, 0, x, y, z);
+        if (svo_dag_get_voxel(dag, root, x, y, z) != tree || chunk_get_voxel(chunk, x, y, z) != tree)
+          return false;
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "chunk.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  Shared node pool for many chunks: identical subtrees are stored once (a sparse voxel DAG).
+
+  - Same encoding as ChunkTree (Node + ChildIndex, children of a node contiguous at first_child_index + rank),
+    so traversal code does not change; a chunk is just a root index into the pool instead of node 0.
+  - Dedup unit is the child group (the children of one node): a node is (mask, pool address of its child
+    group), so two subtrees are merged exactly when they are identical all the way down.
+  - Built bottom-up per chunk, leaf groups first. The pool is append-only: chunks that are edited or
+    unloaded leave their old groups behind, svo_dag_clear + re-insert compacts it.
+*/
+
+#define SVO_DAG_NO_ROOT UINT32_MAX // a chunk that is not in the pool
+
+typedef struct DagGroup {
+  uint64_t hash;
+  uint32_t start; // first node of the group in the pool
+  uint32_t count; // 0 = empty table slot
+} DagGroup;
+
+typedef struct SvoDag {
+  Vector nodes;         // Node[]
+  Vector child_indices; // ChildIndex[]
+
+  DagGroup *table; // open addressing on hash, power-of-two capacity
+  uint32_t capacity;
+  uint32_t group_count;
+
+  uint64_t nodes_inserted; // compact-tree nodes fed in, for the compression ratio
+
+  // per-insert scratch
+  Vector remap;        // uint32_t[], pool address of each compact node's child group
+  Vector group_childs; // ChildIndex[], child references of the group being interned
+} SvoDag;
+
+// PUBLIC FUNCTIONS
+void svo_dag_init(SvoDag *dag);
+void svo_dag_destroy(SvoDag *dag);
+void svo_dag_clear(SvoDag *dag);
+
+// Interns a rebuilt chunk's compact tree, returns the pool index of its root.
+uint32_t svo_dag_insert(SvoDag *dag, const ChunkTree *chunk);
+bool svo_dag_get_voxel(const SvoDag *dag, uint32_t root, int x, int y, int z);
+size_t svo_dag_bytes(const SvoDag *dag); // nodes + child indices, what a GPU copy of the pool takes
+
+// tests
+int svo_dag_test(void);
@@ -0,0 +1,733 @@
+/* terrain.c */
+#include "terrain.h"
+#include "jobs.h"
+#include "morton.h"
+#include "simd.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TERRAIN_X86 1
+#endif
+
+// Generation page: the 64 bricks below one level-1 node (the whole chunk when it is smaller than that).
+#define TERRAIN_PAGE_WORDS (WORDS_PER_CHUNK < 64ull ? (uint32_t)WORDS_PER_CHUNK : 64u)
+#define TERRAIN_PAGE_BRICKS (TERRAIN_PAGE_WORDS == 64u ? 4u : 1u) // bricks per page edge
+#define TERRAIN_PAGE_VOXELS (TERRAIN_PAGE_BRICKS * 4u)            // voxels per page edge
+#define TERRAIN_PAGE_COUNT ((uint32_t)(WORDS_PER_CHUNK / TERRAIN_PAGE_WORDS))
+#define TERRAIN_LATTICE_DIM (TERRAIN_PAGE_BRICKS + 1u) // cave density samples per page edge (brick corners)
+#define TERRAIN_LATTICE_POINTS (TERRAIN_LATTICE_DIM * TERRAIN_LATTICE_DIM * TERRAIN_LATTICE_DIM)
+
+#define TERRAIN_OCTAVE_SEED 0x9E3779B9u // added to the seed per octave, so octaves are uncorrelated
+
+// Per-thread generation memory, allocated on first use.
+typedef struct TerrainScratch {
+  int32_t heights[CHUNK_SIZE * CHUNK_SIZE]; // surface per column [z * CHUNK_SIZE + x]: ground is y < height
+  float xs[CHUNK_SIZE];
+  float zs[CHUNK_SIZE];
+  float row[CHUNK_SIZE];
+} TerrainScratch;
+
+// Leaf word bits by local coordinate (bit = x0 y0 z0 x1 y1 z1).
+typedef struct BrickMasks {
+  uint64_t column[16]; // the 4 voxels of column (x, z), index x + 4 * z
+  uint64_t below[5];   // voxels with y < k
+} BrickMasks;
+
+typedef struct TerrainBenchJob {
+  const TerrainParams *params;
+  ChunkTree **trees; // one per worker
+  int span;
+  int cy_lo;
+  bool rebuild;
+} TerrainBenchJob;
+
+// --- Private Prototypes ---
+static inline uint32_t _hash3(int32_t x, int32_t y, int32_t z, uint32_t seed);
+static inline float _lattice_value(uint32_t h);
+static inline float _lerp(float a, float b, float t);
+static inline float _smooth(float t);
+static float _trilerp(const float d[8], float tx, float ty, float tz);
+static void _fbm2(const float *x, const float *z, float *out, uint32_t count, uint32_t seed, uint32_t octaves);
+static void _noise3(const float *x, const float *y, const float *z, float *out, uint32_t count, uint32_t seed);
+static void _fbm2_scalar(const float *x, const float *z, float *out, uint32_t count, uint32_t seed,
+                         uint32_t octaves);
+static void _noise3_scalar(const float *x, const float *y, const float *z, float *out, uint32_t count,
+                           uint32_t seed);
+#if TERRAIN_X86
+static void _fbm2_avx2(const float *x, const float *z, float *out, uint32_t count, uint32_t seed, uint32_t octaves);
+static void _noise3_avx2(const float *x, const float *y, const float *z, float *out, uint32_t count, uint32_t seed);
+#endif
+static TerrainScratch *_thread_scratch(void);
+static void _brick_masks(BrickMasks *m);
+static bool _caves_in(const TerrainParams *params, int y_lo, int y_hi);
+static uint64_t _band_mask(const TerrainParams *params, const BrickMasks *m, int y);
+static uint64_t _carve_brick(const float d[8], float threshold, uint64_t band);
+static TerrainChunkKind _fill_solid(ChunkTree *chunk);
+static bool _reference_voxel(const TerrainParams *params, int gx, int gy, int gz);
+static uint32_t _check_chunk(const TerrainParams *params, int cx, int cy, int cz, const ChunkTree *chunk);
+static void _bench_job(void *user, uint32_t index, uint32_t worker);
+
+void terrain_default_params(TerrainParams *params, uint32_t seed) {
+  *params = (TerrainParams){
+      .seed = seed,
+      .base_height = 0.0f,
+      .height_amplitude = 48.0f,
+      .height_scale = 192.0f,
+      .height_octaves = 5,
+      .cave_scale = 32.0f,
+      .cave_threshold = 0.5f,
+      .cave_min_y = -192,
+      .cave_max_y = -8,
+  };
+}
+
+TerrainChunkKind terrain_generate(const TerrainParams *params, int cx, int cy, int cz, ChunkTree *chunk) {
+  const int cs = (int)CHUNK_SIZE;
+  const int x0 = cx * cs, y0 = cy * cs, z0 = cz * cs;
+  chunk_clear(chunk);
+
+  // the surface stays within base +- amplitude: whole chunks above or below it need no noise at all
+  int top = (int)ceilf(params->base_height + params->height_amplitude);
+  int bottom = (int)ceilf(params->base_height - params->height_amplitude);
+  bool caves = _caves_in(params, y0, y0 + cs);
+  if (y0 >= top)
+    return TERRAIN_CHUNK_EMPTY;
+  if (y0 + cs <= bottom && !caves)
+    return _fill_solid(chunk);
+
+  TerrainScratch *s = _thread_scratch();
+  float inv_scale = 1.0f / params->height_scale;
+  int32_t hmin = INT32_MAX, hmax = INT32_MIN;
+  for (int z = 0; z < cs; z++) {
+    for (int x = 0; x < cs; x++) {
+      s->xs[x] = (float)(x0 + x) * inv_scale;
+      s->zs[x] = (float)(z0 + z) * inv_scale;
+    }
+    _fbm2(s->xs, s->zs, s->row, (uint32_t)cs, params->seed, params->height_octaves);
+
+    int32_t *h = &s->heights[z * cs];
+    for (int x = 0; x < cs; x++) {
+      h[x] = (int32_t)ceilf(params->base_height + params->height_amplitude * s->row[x]);
+      hmin = h[x] < hmin ? h[x] : hmin;
+      hmax = h[x] > hmax ? h[x] : hmax;
+    }
+  }
+
+  if (y0 >= hmax)
+    return TERRAIN_CHUNK_EMPTY;
+  if (y0 + cs <= hmin && !caves)
+    return _fill_solid(chunk);
+
+  BrickMasks m;
+  _brick_masks(&m);
+  float inv_cave = 1.0f / params->cave_scale;
+  const uint32_t ld = TERRAIN_LATTICE_DIM;
+
+  uint64_t words[TERRAIN_PAGE_WORDS];
+  float lx[TERRAIN_LATTICE_POINTS], ly[TERRAIN_LATTICE_POINTS], lz[TERRAIN_LATTICE_POINTS];
+  float lattice[TERRAIN_LATTICE_POINTS];
+  uint64_t all_and = ~0ull, all_or = 0ull;
+
+  for (uint32_t p = 0; p < TERRAIN_PAGE_COUNT; p++) {
+    uint32_t px, py, pz;
+    morton_decode3(p, &px, &py, &pz);
+    int vx = (int)(px * TERRAIN_PAGE_VOXELS), vy = (int)(py * TERRAIN_PAGE_VOXELS);
+    int vz = (int)(pz * TERRAIN_PAGE_VOXELS);
+
+    int32_t pmin = INT32_MAX, pmax = INT32_MIN;
+    for (int z = vz; z < vz + (int)TERRAIN_PAGE_VOXELS; z++) {
+      for (int x = vx; x < vx + (int)TERRAIN_PAGE_VOXELS; x++) {
+        int32_t h = s->heights[z * cs + x];
+        pmin = h < pmin ? h : pmin;
+        pmax = h > pmax ? h : pmax;
+      }
+    }
+
+    int gy = y0 + vy;
+    bool page_caves = _caves_in(params, gy, gy + (int)TERRAIN_PAGE_VOXELS);
+    if (gy >= pmax) {
+      all_and = 0ull;
+      continue;
+    }
+
+    uint64_t page_or = 0ull;
+    if (gy + (int)TERRAIN_PAGE_VOXELS <= pmin) {
+      for (uint32_t i = 0; i < TERRAIN_PAGE_WORDS; i++)
+        words[i] = ~0ull;
+      page_or = ~0ull;
+    } else {
+      // surface: each of the brick's 16 columns contributes its voxels below the height
+      for (uint32_t i = 0; i < TERRAIN_PAGE_WORDS; i++) {
+        uint32_t bx, by, bz;
+        morton_decode3(i, &bx, &by, &bz);
+        int by0 = gy + (int)by * 4;
+        const int32_t *h = &s->heights[(vz + (int)bz * 4) * cs + vx + (int)bx * 4];
+
+        uint64_t word = 0ull;
+        for (int c = 0; c < 16; c++) {
+          int k = h[(c >> 2) * cs + (c & 3)] - by0;
+          word |= m.column[c] & m.below[k < 0 ? 0 : (k > 4 ? 4 : k)];
+        }
+        words[i] = word;
+        page_or |= word;
+      }
+    }
+
+    if (page_caves && page_or != 0ull) {
+      // cave density on the brick corners of the page, one batch
+      uint32_t n = 0;
+      for (uint32_t k = 0; k < ld; k++) {
+        for (uint32_t j = 0; j < ld; j++) {
+          for (uint32_t i = 0; i < ld; i++, n++) {
+            lx[n] = (float)(x0 + vx + (int)i * 4) * inv_cave;
+            ly[n] = (float)(gy + (int)j * 4) * inv_cave;
+            lz[n] = (float)(z0 + vz + (int)k * 4) * inv_cave;
+          }
+        }
+      }
+      _noise3(lx, ly, lz, lattice, n, params->seed);
+
+      page_or = 0ull;
+      for (uint32_t i = 0; i < TERRAIN_PAGE_WORDS; i++) {
+        if (words[i] == 0ull)
+          continue;
+        uint32_t bx, by, bz;
+        morton_decode3(i, &bx, &by, &bz);
+        uint64_t band = _band_mask(params, &m, gy + (int)by * 4);
+        if (band == 0ull)
+          continue;
+
+        float d[8];
+        for (uint32_t c = 0; c < 8u; c++)
+          d[c] = lattice[((bz + (c >> 2)) * ld + by + ((c >> 1) & 1u)) * ld + bx + (c & 1u)];
+        words[i] &= ~_carve_brick(d, params->cave_threshold, band);
+        page_or |= words[i];
+      }
+    }
+
+    for (uint32_t i = 0; i < TERRAIN_PAGE_WORDS; i++)
+      all_and &= words[i];
+    all_or |= page_or;
+    if (page_or != 0ull)
+      chunk_set_words(chunk, (uint64_t)p * TERRAIN_PAGE_WORDS, words, TERRAIN_PAGE_WORDS);
+  }
+
+  if (all_or == 0ull)
+    return TERRAIN_CHUNK_EMPTY;
+  return all_and == ~0ull ? TERRAIN_CHUNK_SOLID : TERRAIN_CHUNK_MIXED;
+}
+
+bool terrain_source(void *user, int cx, int cy, int cz, ChunkTree *out) {
+  return terrain_generate((const TerrainParams *)user, cx, cy, cz, out) != TERRAIN_CHUNK_EMPTY;
+}
+
+// --- Private Functions ---
+
+static inline uint32_t _hash3(int32_t x, int32_t y, int32_t z, uint32_t seed) {
+  uint32_t h = seed ^ ((uint32_t)x * 0x8DA6B343u) ^ ((uint32_t)y * 0xD8163841u) ^ ((uint32_t)z * 0xCB1AB31Fu);
+  h ^= h >> 15;
+  h *= 0x2C1B3C6Du;
+  h ^= h >> 12;
+  h *= 0x297A2D39u;
+  h ^= h >> 15;
+  return h;
+}
+
+// 24 hash bits to [-1, 1), exact in float so every backend gets the same value
+static inline float _lattice_value(uint32_t h) { return (float)(h >> 8) * (1.0f / 8388608.0f) - 1.0f; }
+
+static inline float _lerp(float a, float b, float t) { return a + t * (b - a); }
+
+static inline float _smooth(float t) { return t * t * (3.0f - 2.0f * t); }
+
+// d[c]: corner (c & 1, (c >> 1) & 1, c >> 2)
+static float _trilerp(const float d[8], float tx, float ty, float tz) {
+  float c0 = _lerp(_lerp(d[0], d[1], tx), _lerp(d[2], d[3], tx), ty);
+  float c1 = _lerp(_lerp(d[4], d[5], tx), _lerp(d[6], d[7], tx), ty);
+  return _lerp(c0, c1, tz);
+}
+
+static void _fbm2(const float *x, const float *z, float *out, uint32_t count, uint32_t seed, uint32_t octaves) {
+#if TERRAIN_X86
+  if (simd_backend() == SIMD_BACKEND_AVX2) {
+    _fbm2_avx2(x, z, out, count, seed, octaves);
+    return;
+  }
+#endif
+  _fbm2_scalar(x, z, out, count, seed, octaves);
+}
+
+static void _noise3(const float *x, const float *y, const float *z, float *out, uint32_t count, uint32_t seed) {
+#if TERRAIN_X86
+  if (simd_backend() == SIMD_BACKEND_AVX2) {
+    _noise3_avx2(x, y, z, out, count, seed);
+    return;
+  }
+#endif
+  _noise3_scalar(x, y, z, out, count, seed);
+}
+
+// Value noise summed over octaves, normalized to [-1, 1).
+static void _fbm2_scalar(const float *x, const float *z, float *out, uint32_t count, uint32_t seed,
+                         uint32_t octaves) {
+  float norm = 0.0f;
+  for (uint32_t o = 0; o < octaves; o++)
+    norm += 1.0f / (float)(1u << o);
+  float inv_norm = 1.0f / norm;
+
+  for (uint32_t i = 0; i < count; i++) {
+    float sum = 0.0f, freq = 1.0f, amp = 1.0f;
+    for (uint32_t o = 0; o < octaves; o++) {
+      float fx = x[i] * freq, fz = z[i] * freq;
+      float ox = floorf(fx), oz = floorf(fz);
+      int32_t ix = (int32_t)ox, iz = (int32_t)oz;
+      float sx = _smooth(fx - ox), sz = _smooth(fz - oz);
+      uint32_t os = seed + o * TERRAIN_OCTAVE_SEED;
+
+      float a = _lerp(_lattice_value(_hash3(ix, 0, iz, os)), _lattice_value(_hash3(ix + 1, 0, iz, os)), sx);
+      float b = _lerp(_lattice_value(_hash3(ix, 0, iz + 1, os)), _lattice_value(_hash3(ix + 1, 0, iz + 1, os)), sx);
+      sum += amp * _lerp(a, b, sz);
+      freq *= 2.0f;
+      amp *= 0.5f;
+    }
+    out[i] = sum * inv_norm;
+  }
+}
+
+static void _noise3_scalar(const float *x, const float *y, const float *z, float *out, uint32_t count,
+                           uint32_t seed) {
+  for (uint32_t i = 0; i < count; i++) {
+    float ox = floorf(x[i]), oy = floorf(y[i]), oz = floorf(z[i]);
+    int32_t ix = (int32_t)ox, iy = (int32_t)oy, iz = (int32_t)oz;
+
+    float d[8];
+    for (uint32_t c = 0; c < 8u; c++)
+      d[c] = _lattice_value(
+          _hash3(ix + (int32_t)(c & 1u), iy + (int32_t)((c >> 1) & 1u), iz + (int32_t)(c >> 2), seed));
+    out[i] = _trilerp(d, _smooth(x[i] - ox), _smooth(y[i] - oy), _smooth(z[i] - oz));
+  }
+}
+
+#if TERRAIN_X86
+__attribute__((target("avx2"))) static inline __m256 _lattice_value_avx2(__m256i x, __m256i y, __m256i z,
+                                                                         __m256i seed) {
+  __m256i h = _mm256_xor_si256(seed, _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x8DA6B343u)));
+  h = _mm256_xor_si256(h, _mm256_mullo_epi32(y, _mm256_set1_epi32((int)0xD8163841u)));
+  h = _mm256_xor_si256(h, _mm256_mullo_epi32(z, _mm256_set1_epi32((int)0xCB1AB31Fu)));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+  h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x2C1B3C6D));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 12));
+  h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x297A2D39));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+
+  __m256 v = _mm256_cvtepi32_ps(_mm256_srli_epi32(h, 8));
+  return _mm256_sub_ps(_mm256_mul_ps(v, _mm256_set1_ps(1.0f / 8388608.0f)), _mm256_set1_ps(1.0f));
+}
+
+__attribute__((target("avx2"))) static inline __m256 _lerp_avx2(__m256 a, __m256 b, __m256 t) {
+  return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+__attribute__((target("avx2"))) static inline __m256 _smooth_avx2(__m256 t) {
+  __m256 k = _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(_mm256_set1_ps(2.0f), t));
+  return _mm256_mul_ps(_mm256_mul_ps(t, t), k);
+}
+
+// Same operations in the same order as the scalar kernels (no FMA), so results match bit for bit.
+__attribute__((target("avx2"))) static void _fbm2_avx2(const float *x, const float *z, float *out, uint32_t count,
+                                                       uint32_t seed, uint32_t octaves) {
+  float norm = 0.0f;
+  for (uint32_t o = 0; o < octaves; o++)
+    norm += 1.0f / (float)(1u << o);
+  const __m256 inv_norm = _mm256_set1_ps(1.0f / norm);
+  const __m256i one = _mm256_set1_epi32(1), zero = _mm256_setzero_si256();
+
+  uint32_t i = 0;
+  for (; i + 8u <= count; i += 8u) {
+    __m256 px = _mm256_loadu_ps(x + i), pz = _mm256_loadu_ps(z + i);
+    __m256 sum = _mm256_setzero_ps(), freq = _mm256_set1_ps(1.0f), amp = _mm256_set1_ps(1.0f);
+
+    for (uint32_t o = 0; o < octaves; o++) {
+      __m256 fx = _mm256_mul_ps(px, freq), fz = _mm256_mul_ps(pz, freq);
+      __m256 ox = _mm256_floor_ps(fx), oz = _mm256_floor_ps(fz);
+      __m256i ix = _mm256_cvttps_epi32(ox), iz = _mm256_cvttps_epi32(oz);
+      __m256 sx = _smooth_avx2(_mm256_sub_ps(fx, ox)), sz = _smooth_avx2(_mm256_sub_ps(fz, oz));
+      __m256i os = _mm256_set1_epi32((int)(seed + o * TERRAIN_OCTAVE_SEED));
+      __m256i ix1 = _mm256_add_epi32(ix, one), iz1 = _mm256_add_epi32(iz, one);
+
+      __m256 a = _lerp_avx2(_lattice_value_avx2(ix, zero, iz, os), _lattice_value_avx2(ix1, zero, iz, os), sx);
+      __m256 b = _lerp_avx2(_lattice_value_avx2(ix, zero, iz1, os), _lattice_value_avx2(ix1, zero, iz1, os), sx);
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(amp, _lerp_avx2(a, b, sz)));
+      freq = _mm256_add_ps(freq, freq);
+      amp = _mm256_mul_ps(amp, _mm256_set1_ps(0.5f));
+    }
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(sum, inv_norm));
+  }
+
+  _fbm2_scalar(x + i, z + i, out + i, count - i, seed, octaves);
+}
+
+__attribute__((target("avx2"))) static void _noise3_avx2(const float *x, const float *y, const float *z, float *out,
+                                                         uint32_t count, uint32_t seed) {
+  const __m256i one = _mm256_set1_epi32(1), vseed = _mm256_set1_epi32((int)seed);
+
+  uint32_t i = 0;
+  for (; i + 8u <= count; i += 8u) {
+    __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+    __m256 ox = _mm256_floor_ps(px), oy = _mm256_floor_ps(py), oz = _mm256_floor_ps(pz);
+    __m256i ix[2] = {_mm256_cvttps_epi32(ox)}, iy[2] = {_mm256_cvttps_epi32(oy)}, iz[2] = {_mm256_cvttps_epi32(oz)};
+    ix[1] = _mm256_add_epi32(ix[0], one);
+    iy[1] = _mm256_add_epi32(iy[0], one);
+    iz[1] = _mm256_add_epi32(iz[0], one);
+    __m256 tx = _smooth_avx2(_mm256_sub_ps(px, ox)), ty = _smooth_avx2(_mm256_sub_ps(py, oy));
+    __m256 tz = _smooth_avx2(_mm256_sub_ps(pz, oz));
+
+    __m256 d[8];
+    for (uint32_t c = 0; c < 8u; c++)
+      d[c] = _lattice_value_avx2(ix[c & 1u], iy[(c >> 1) & 1u], iz[c >> 2], vseed);
+
+    __m256 c0 = _lerp_avx2(_lerp_avx2(d[0], d[1], tx), _lerp_avx2(d[2], d[3], tx), ty);
+    __m256 c1 = _lerp_avx2(_lerp_avx2(d[4], d[5], tx), _lerp_avx2(d[6], d[7], tx), ty);
+    _mm256_storeu_ps(out + i, _lerp_avx2(c0, c1, tz));
+  }
+
+  _noise3_scalar(x + i, y + i, z + i, out + i, count - i, seed);
+}
+#endif
+
+static TerrainScratch *_thread_scratch(void) {
+  static _Thread_local TerrainScratch *scratch = NULL;
+  if (!scratch)
+    scratch = (TerrainScratch *)malloc(sizeof(TerrainScratch));
+  return scratch;
+}
+
+static void _brick_masks(BrickMasks *m) {
+  memset(m, 0, sizeof(*m));
+  for (uint32_t b = 0; b < 64u; b++) {
+    uint32_t x = (b & 1u) | ((b >> 2) & 2u);
+    uint32_t y = ((b >> 1) & 1u) | ((b >> 3) & 2u);
+    uint32_t z = ((b >> 2) & 1u) | ((b >> 4) & 2u);
+    m->column[x + 4u * z] |= 1ull << b;
+    for (uint32_t k = y + 1u; k <= 4u; k++)
+      m->below[k] |= 1ull << b;
+  }
+}
+
+// Whether caves can carve anything in voxel rows [y_lo, y_hi).
+static bool _caves_in(const TerrainParams *params, int y_lo, int y_hi) {
+  return params->cave_threshold < 1.0f && y_lo < params->cave_max_y && y_hi > params->cave_min_y;
+}
+
+// Voxels of the brick starting at row y that lie in the cave band.
+static uint64_t _band_mask(const TerrainParams *params, const BrickMasks *m, int y) {
+  int lo = params->cave_min_y - y, hi = params->cave_max_y - y;
+  lo = lo < 0 ? 0 : (lo > 4 ? 4 : lo);
+  hi = hi < 0 ? 0 : (hi > 4 ? 4 : hi);
+  return hi > lo ? m->below[hi] & ~m->below[lo] : 0ull;
+}
+
+// Voxels of a brick (within band) whose interpolated density exceeds the threshold. The interpolation stays
+// between the corner values, so bricks with every corner on one side are decided from the corners alone.
+static uint64_t _carve_brick(const float d[8], float threshold, uint64_t band) {
+  float lo = d[0], hi = d[0];
+  for (uint32_t c = 1; c < 8u; c++) {
+    lo = d[c] < lo ? d[c] : lo;
+    hi = d[c] > hi ? d[c] : hi;
+  }
+  if (hi <= threshold)
+    return 0ull;
+  if (lo > threshold)
+    return band;
+
+  uint64_t carved = 0ull;
+  for (uint32_t b = 0; b < 64u; b++) {
+    if (!(band & (1ull << b)))
+      continue;
+    float tx = (float)((b & 1u) | ((b >> 2) & 2u)) * 0.25f;
+    float ty = (float)(((b >> 1) & 1u) | ((b >> 3) & 2u)) * 0.25f;
+    float tz = (float)(((b >> 2) & 1u) | ((b >> 4) & 2u)) * 0.25f;
+    if (_trilerp(d, tx, ty, tz) > threshold)
+      carved |= 1ull << b;
+  }
+  return carved;
+}
+
+static TerrainChunkKind _fill_solid(ChunkTree *chunk) {
+  int cs = (int)CHUNK_SIZE;
+  chunk_fill_box(chunk, (VoxelCoord){0, 0, 0}, (VoxelCoord){cs - 1, cs - 1, cs - 1}, true);
+  return TERRAIN_CHUNK_SOLID;
+}
+
+// -------------------- Tests/Benchmarks --------------------
+
+// One voxel straight from the definition: no pages, no early outs, scalar noise.
+static bool _reference_voxel(const TerrainParams *params, int gx, int gy, int gz) {
+  float hx = (float)gx * (1.0f / params->height_scale), hz = (float)gz * (1.0f / params->height_scale);
+  float n;
+  _fbm2_scalar(&hx, &hz, &n, 1, params->seed, params->height_octaves);
+  if (gy >= (int)ceilf(params->base_height + params->height_amplitude * n))
+    return false;
+  if (!_caves_in(params, gy, gy + 1))
+    return true;
+
+  // density on the corners of the voxel's brick
+  int bx = gx & ~3, by = gy & ~3, bz = gz & ~3;
+  float inv = 1.0f / params->cave_scale;
+  float d[8];
+  for (uint32_t c = 0; c < 8u; c++) {
+    float px = (float)(bx + 4 * (int)(c & 1u)) * inv;
+    float py = (float)(by + 4 * (int)((c >> 1) & 1u)) * inv;
+    float pz = (float)(bz + 4 * (int)(c >> 2)) * inv;
+    _noise3_scalar(&px, &py, &pz, &d[c], 1, params->seed);
+  }
+  return !(_trilerp(d, (float)(gx - bx) * 0.25f, (float)(gy - by) * 0.25f, (float)(gz - bz) * 0.25f) >
+           params->cave_threshold);
+}
+
+// Voxels that differ from the reference (every voxel for small chunks, a random sample for large ones).
+static uint32_t _check_chunk(const TerrainParams *params, int cx, int cy, int cz, const ChunkTree *chunk) {
+  const int cs = (int)CHUNK_SIZE;
+  const uint64_t samples = VOXELS_PER_CHUNK < (1ull << 18) ? VOXELS_PER_CHUNK : (1ull << 18);
+  uint32_t errors = 0, seed = 7u;
+
+  for (uint64_t i = 0; i < samples; i++) {
+    uint32_t x, y, z;
+    if (samples == VOXELS_PER_CHUNK) {
+      morton_decode3(i, &x, &y, &z);
+    } else {
+      seed = seed * 1664525u + 1013904223u;
+      x = (seed >> 4) & (CHUNK_SIZE - 1u);
+      seed = seed * 1664525u + 1013904223u;
+      y = (seed >> 4) & (CHUNK_SIZE - 1u);
+      seed = seed * 1664525u + 1013904223u;
+      z = (seed >> 4) & (CHUNK_SIZE - 1u);
+    }
+    bool expected = _reference_voxel(params, cx * cs + (int)x, cy * cs + (int)y, cz * cs + (int)z);
+    errors += chunk_get_voxel(chunk, (int)x, (int)y, (int)z) != expected;
+  }
+  return errors;
+}
+
+int terrain_test(void) {
+  LOG_INFO("Terrain Test: noise backend=%s, CHUNK_SIZE=%u\n", simd_backend_name(simd_backend()),
+           (unsigned)CHUNK_SIZE);
+
+  // Test 1: vector kernels match the scalar ones bit for bit (odd count exercises the scalar tail)
+  {
+    LOG_INFO("[Test 1] SIMD noise matches scalar... ");
+#if TERRAIN_X86
+    if (simd_backend() == SIMD_BACKEND_AVX2) {
+      enum { N = 1003 };
+      float *buf = (float *)malloc(7u * N * sizeof(float));
+      float *x = buf, *y = buf + N, *z = buf + 2 * N, *a = buf + 3 * N, *b = buf + 4 * N;
+      float *c = buf + 5 * N, *d = buf + 6 * N;
+      uint32_t seed = 12345u;
+      for (uint32_t i = 0; i < N; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        x[i] = (float)(int32_t)(seed >> 8) / 1024.0f - 8192.0f;
+        seed = seed * 1664525u + 1013904223u;
+        y[i] = (float)(int32_t)(seed >> 8) / 1024.0f - 8192.0f;
+        seed = seed * 1664525u + 1013904223u;
+        z[i] = (float)(int32_t)(seed >> 8) / 1024.0f - 8192.0f;
+      }
+
+      _fbm2_scalar(x, z, a, N, 99u, 5);
+      _fbm2_avx2(x, z, b, N, 99u, 5);
+      _noise3_scalar(x, y, z, c, N, 99u);
+      _noise3_avx2(x, y, z, d, N, 99u);
+      bool ok = memcmp(a, b, N * sizeof(float)) == 0 && memcmp(c, d, N * sizeof(float)) == 0;
+      for (uint32_t i = 0; i < N; i++)
+        ok = ok && a[i] >= -1.0f && a[i] < 1.0f && c[i] >= -1.0f && c[i] < 1.0f;
+      free(buf);
+
+      if (ok)
+        LOG_INFO("PASSED\n");
+      else {
+        LOG_INFO("FAILED (avx2 and scalar noise differ)\n");
+        return 1;
+      }
+    } else
+#endif
+      LOG_INFO("SKIPPED (no vector kernel on this CPU)\n");
+  }
+
+  ChunkTree *chunk = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(chunk);
+  const int cs = (int)CHUNK_SIZE;
+
+  // caves reach the surface here, so surface and cave paths mix inside the same pages
+  TerrainParams params;
+  terrain_default_params(&params, 2024u);
+  params.height_scale = 64.0f;
+  params.cave_scale = 12.0f;
+  params.cave_threshold = 0.3f;
+  params.cave_min_y = -3 * cs / 2;
+  params.cave_max_y = (int)params.height_amplitude;
+
+  // Test 2: generated chunks equal a per-voxel evaluation of the same terrain
+  {
+    LOG_INFO("[Test 2] Generated chunks match the per-voxel reference... ");
+    const int columns[][2] = {{0, 0}, {1, -1}, {-2, 3}, {-1, -1}};
+    uint32_t errors = 0, mixed = 0;
+    for (uint32_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++) {
+      // the chunk holding the surface at the column's corner, and the one below it
+      int cx = columns[i][0], cz = columns[i][1];
+      float hx = (float)(cx * cs) * (1.0f / params.height_scale), hz = (float)(cz * cs) * (1.0f / params.height_scale);
+      float n;
+      _fbm2_scalar(&hx, &hz, &n, 1, params.seed, params.height_octaves);
+      int cy = (int)floorf((params.base_height + params.height_amplitude * n) / (float)cs);
+
+      for (int y = cy - 1; y <= cy; y++) {
+        mixed += terrain_generate(&params, cx, y, cz, chunk) == TERRAIN_CHUNK_MIXED;
+        errors += _check_chunk(&params, cx, y, cz, chunk);
+      }
+    }
+
+    if (errors == 0 && mixed > 0)
+      LOG_INFO("PASSED (%u mixed chunks)\n", mixed);
+    else {
+      LOG_INFO("FAILED (%u voxels differ, %u mixed chunks)\n", errors, mixed);
+      chunk_destroy(chunk);
+      free(chunk);
+      return 1;
+    }
+  }
+
+  // Test 3: chunks above the surface and below the cave band take the early outs and are reported as such
+  {
+    LOG_INFO("[Test 3] Empty and solid chunks... ");
+    int top = (int)ceilf(params.base_height + params.height_amplitude);
+    int bottom = (int)ceilf(params.base_height - params.height_amplitude);
+    int lowest = bottom < params.cave_min_y ? bottom : params.cave_min_y;
+    int cy_empty = top / cs + 1;
+    int cy_solid = lowest / cs - 2; // truncation rounds towards zero, one more chunk of margin
+
+    bool ok = terrain_generate(&params, 5, cy_empty, -3, chunk) == TERRAIN_CHUNK_EMPTY &&
+              !terrain_source(&params, 5, cy_empty, -3, chunk);
+    for (uint64_t w = 0; w < WORDS_PER_CHUNK && ok; w++)
+      ok = chunk_get_word(chunk, w) == 0ull;
+
+    ok = ok && terrain_generate(&params, -4, cy_solid, 2, chunk) == TERRAIN_CHUNK_SOLID;
+    for (uint64_t w = 0; w < WORDS_PER_CHUNK && ok; w++)
+      ok = chunk_get_word(chunk, w) == ~0ull;
+
+    // the kind of a surface chunk agrees with its words
+    TerrainChunkKind kind = terrain_generate(&params, 0, -1, 0, chunk);
+    uint64_t all_and = ~0ull, all_or = 0ull;
+    for (uint64_t w = 0; w < WORDS_PER_CHUNK; w++) {
+      all_and &= chunk_get_word(chunk, w);
+      all_or |= chunk_get_word(chunk, w);
+    }
+    TerrainChunkKind expected =
+        all_or == 0ull ? TERRAIN_CHUNK_EMPTY : (all_and == ~0ull ? TERRAIN_CHUNK_SOLID : TERRAIN_CHUNK_MIXED);
+    ok = ok && kind == expected;
+
+    if (ok)
+      LOG_INFO("PASSED\n");
+    else {
+      LOG_INFO("FAILED\n");
+      chunk_destroy(chunk);
+      free(chunk);
+      return 1;
+    }
+  }
+
+  chunk_destroy(chunk);
+  free(chunk);
+  LOG_INFO("All terrain tests passed.\n");
+  return 0;
+}
+
+static void _bench_job(void *user, uint32_t index, uint32_t worker) {
+  TerrainBenchJob *job = (TerrainBenchJob *)user;
+  uint32_t span = (uint32_t)job->span;
+  int cx = (int)(index % span) - job->span / 2;
+  int cz = (int)((index / span) % span) - job->span / 2;
+  int cy = job->cy_lo + (int)(index / (span * span));
+
+  ChunkTree *tree = job->trees[worker];
+  terrain_generate(job->params, cx, cy, cz, tree);
+  if (job->rebuild)
+    chunk_rebuild(tree);
+}
+
+void terrain_bench(void) {
+  TerrainParams params;
+  terrain_default_params(&params, 1337u);
+  const int cs = (int)CHUNK_SIZE;
+
+  // noise kernels alone
+  {
+    enum { N = 1 << 16 };
+    const uint32_t reps = 16;
+    float *buf = (float *)malloc(3u * N * sizeof(float));
+    for (uint32_t i = 0; i < N; i++) {
+      buf[i] = (float)(i % 256u) * 0.37f;
+      buf[N + i] = (float)(i / 256u) * 0.37f;
+    }
+
+    uint64_t t0 = time_now_ns();
+    for (uint32_t r = 0; r < reps; r++)
+      _fbm2_scalar(buf, buf + N, buf + 2 * N, N, r, params.height_octaves);
+    double scalar_ns = (double)(time_now_ns() - t0) / ((double)N * reps);
+
+    t0 = time_now_ns();
+    for (uint32_t r = 0; r < reps; r++)
+      _fbm2(buf, buf + N, buf + 2 * N, N, r, params.height_octaves);
+    double best_ns = (double)(time_now_ns() - t0) / ((double)N * reps);
+    free(buf);
+
+    LOG_INFO("Terrain Bench: %u-octave fbm, scalar %.2f ns/sample, %s %.2f ns/sample (%.1fx)\n",
+             params.height_octaves, scalar_ns, simd_backend_name(simd_backend()), best_ns, scalar_ns / best_ns);
+  }
+
+  // a 16x16 column of chunks from the solid rock under the caves to the sky above the surface
+  const int span = 16;
+  int cy_lo = (int)floorf((float)(params.cave_min_y - cs) / (float)cs);
+  int cy_hi = (int)floorf((params.base_height + params.height_amplitude) / (float)cs) + 1;
+  uint32_t count = (uint32_t)(span * span * (cy_hi - cy_lo + 1));
+
+  uint32_t max_threads = job_hardware_threads();
+  JobSystem *jobs = job_system_create(max_threads);
+  ChunkTree **trees = (ChunkTree **)malloc(max_threads * sizeof(ChunkTree *));
+  for (uint32_t w = 0; w < max_threads; w++) {
+    trees[w] = (ChunkTree *)malloc(sizeof(ChunkTree));
+    chunk_init(trees[w]);
+  }
+
+  uint32_t kinds[3] = {0, 0, 0};
+  for (uint32_t i = 0; i < count; i++) {
+    int cx = (int)(i % (uint32_t)span) - span / 2, cz = (int)((i / (uint32_t)span) % (uint32_t)span) - span / 2;
+    kinds[terrain_generate(&params, cx, cy_lo + (int)(i / (uint32_t)(span * span)), cz, trees[0])]++;
+  }
+  LOG_INFO("Terrain Bench: %u chunks (CHUNK_SIZE=%u): %u empty, %u solid, %u mixed\n", count, (unsigned)CHUNK_SIZE,
+           kinds[TERRAIN_CHUNK_EMPTY], kinds[TERRAIN_CHUNK_SOLID], kinds[TERRAIN_CHUNK_MIXED]);
+
+  for (uint32_t rebuild = 0; rebuild < 2u; rebuild++) {
+    TerrainBenchJob job = {.params = &params, .trees = trees, .span = span, .cy_lo = cy_lo, .rebuild = rebuild};
+
+    uint64_t t0 = time_now_ns();
+    for (uint32_t i = 0; i < count; i++)
+      _bench_job(&job, i, 0);
+    double single_s = (double)(time_now_ns() - t0) / 1e9;
+
+    t0 = time_now_ns();
+    job_parallel_for(jobs, count, _bench_job, &job);
+    double multi_s = (double)(time_now_ns() - t0) / 1e9;
+
+    LOG_INFO("  %-18s 1 thread %9.1f chunks/s   %2u threads %9.1f chunks/s\n",
+             rebuild ? "generate+rebuild:" : "generate:", count / single_s, job_worker_count(jobs), count / multi_s);
+  }
+
+  for (uint32_t w = 0; w < max_threads; w++) {
+    chunk_destroy(trees[w]);
+    free(trees[w]);
+  }
+  free(trees);
+  job_system_destroy(jobs);
+}
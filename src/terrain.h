@@ -0,0 +1,51 @@
+#pragma once
+
+#include "chunk.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+  Procedural terrain: a heightmap surface (2D fBm value noise) carved by caves (3D value noise), written
+  straight into a chunk's leaf words, one 4x4x4 brick per 64-bit word, page by page in Morton order.
+
+  - Noise runs in batches: 8 lanes with AVX2, scalar otherwise. Both give bit-identical results.
+  - Heights are sampled per voxel column. Cave density is sampled on the brick corners (a 4-voxel lattice)
+    and interpolated trilinearly, so a brick whose corners all agree is decided without looking at its voxels.
+  - Early outs, before any noise: chunks above the highest possible surface are empty, chunks below the lowest
+    one and outside the cave band are solid. Pages (16^3 voxels) and bricks skip the same way once the
+    heights are known.
+*/
+
+typedef enum TerrainChunkKind {
+  TERRAIN_CHUNK_EMPTY,
+  TERRAIN_CHUNK_SOLID,
+  TERRAIN_CHUNK_MIXED,
+} TerrainChunkKind;
+
+typedef struct TerrainParams {
+  uint32_t seed;
+
+  // surface: voxel y is ground if y < base_height + height_amplitude * fbm(x / height_scale, z / height_scale)
+  float base_height;
+  float height_amplitude;
+  float height_scale;      // voxels per lattice cell of the first octave
+  uint32_t height_octaves; // every next octave: twice the frequency, half the amplitude
+
+  // caves: ground voxels with y in [cave_min_y, cave_max_y) and noise(p / cave_scale) > cave_threshold are carved
+  float cave_scale;
+  float cave_threshold; // noise is in [-1, 1): >= 1 disables caves
+  int cave_min_y;
+  int cave_max_y;
+} TerrainParams;
+
+// PUBLIC FUNCTIONS
+void terrain_default_params(TerrainParams *params, uint32_t seed);
+
+// Replaces the voxels of chunk (cx, cy, cz), in chunk coordinates, with generated terrain. Thread safe.
+TerrainChunkKind terrain_generate(const TerrainParams *params, int cx, int cy, int cz, ChunkTree *chunk);
+// ChunkSourceFn (world.h); user is a const TerrainParams *.
+bool terrain_source(void *user, int cx, int cy, int cz, ChunkTree *out);
+
+// tests
+int terrain_test(void);
+void terrain_bench(void);
@@ -13,6 +13,12 @@ void vk_check(VkResult err) {
     abort();
   }
 }
+u64 time_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
 /**
  * Returns a new heap-allocated substring.
  * start: index to begin at
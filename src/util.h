@@ -34,9 +34,18 @@
 
 void vk_check(VkResult err);
 
+/** Monotonic clock in nanoseconds, for timing and benchmarks. */
+u64 time_now_ns(void);
+
 /** * Returns a new heap-allocated substring. * start: index to begin at * len: number of characters to copy */
 /** * Returns a new heap-allocated substring. * start: index to begin at * len: number of characters to copy */ char *
 str_sub(const char *s, int start, int len);
 
 /** * Extract directory from path (Non-destructive) * Example: "src/main.c" -> returns "src/" */ char *
 str_get_dir(const char *path);
+
+/** Integer division rounded toward negative infinity (-1 / 16 is -1, not 0). d must be positive. */
+static inline int floor_div(int v, int d) { return v >= 0 ? v / d : -((-v + d - 1) / d); }
+
+/** v modulo n in [0, n), for negative v too (-1 wraps to n - 1). n must be positive. */
+static inline int wrap(int v, int n) { return (v % n + n) % n; }
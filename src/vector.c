@@ -38,8 +38,24 @@ u32 vec_push(Vector *vec, void *element) {
   return vec->length - 1;
 }
 
+void vec_insert_at(Vector *vec, u32 index, void *element) {
+  if (index >= vec->length) {
+    vec_push(vec, element);
+    return;
+  }
+
+  // grow through push, then open the gap
+  vec_push(vec, element);
+  char *base = (char *)vec->data;
+  memmove(base + (index + 1) * vec->element_size, base + index * vec->element_size,
+          vec->element_size * (vec->length - 1 - index));
+  memcpy(base + index * vec->element_size, element, vec->element_size);
+}
+
 void vec_remove_at(Vector *vec, u32 index) {
-  memmove(&vec->data[index], &vec[index + 1], vec->element_size * (vec->length - index));
+  char *base = (char *)vec->data;
+  memmove(base + index * vec->element_size, base + (index + 1) * vec->element_size,
+          vec->element_size * (vec->length - index - 1));
   vec->length--;
 }
 
@@ -53,6 +69,15 @@ void vec_clear(Vector *vec) {
 void vec_realloc_capacity(Vector *vec, size_t new_cap) {
   vec->data = vec->allocator->realloc(vec->data, vec->element_size * vec->capacity, new_cap * vec->element_size,
                                       vec->allocator->ctx);
+  vec->capacity = new_cap;
+  if (vec->length > new_cap)
+    vec->length = new_cap;
+}
+
+void vec_reserve(Vector *vec, size_t min_cap) {
+  if (min_cap <= vec->capacity)
+    return;
+  vec_realloc_capacity(vec, min_cap);
 }
 
 void *vec_at(Vector *vec, size_t index) {
@@ -32,10 +32,12 @@ void default_free(void *ptr, void *ctx);
 void vec_init(Vector *vec, size_t elem_size, Allocator *allocator);
 void vec_init_with_capacity(Vector *vec, size_t capacity, size_t elem_size, Allocator *allocator);
 u32 vec_push(Vector *vec, void *element);
+void vec_insert_at(Vector *vec, u32 index, void *element);
 void vec_remove_at(Vector *vec, u32 index);
 void vec_free(Vector *vec);
 void vec_clear(Vector *vec);
 void vec_realloc_capacity(Vector *vec, size_t new_cap);
+void vec_reserve(Vector *vec, size_t min_cap);
 void *vec_at(Vector *vec, size_t index);
 u32 vec_len(Vector *vec);
 u32 vec_bytes_len(Vector *vec);
@@ -0,0 +1,517 @@
+/* voxel_import.c */
+#include "voxel_import.h"
+#include "morton.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IMPORT_PAGE_DIM 16    // voxels per axis of one page: 4x4x4 bricks, CHUNK_PAGE_WORDS leaf words
+#define VOX_XYZI_BLOCK 4096u  // XYZI entries read per fread
+#define IMPORT_TEST_THRESHOLD 128u
+
+_Static_assert(CHUNK_PAGE_WORDS == 64u && TREE_LEVELS >= 2, "pages are 16^3 voxels and a chunk holds whole pages");
+
+typedef struct ImportContext {
+  WorldManager *world;
+  int origin[3];
+  uint32_t codes[3][IMPORT_PAGE_DIM]; // Morton code of a page-local coordinate, per axis
+
+  // the volume being converted and the row of chunks in flight: slices [z0, z1) in slab
+  int dims[3];
+  uint8_t threshold;
+  const uint8_t *slab;
+  int z0, z1;
+  int cx0, cy0, cz, ncx;
+  int32_t *slots;  // per job: slot written, IMPORT_SKIPPED or IMPORT_UNCHANGED
+  uint64_t *solid; // per worker
+
+  VoxelImportStats stats;
+} ImportContext;
+
+#define IMPORT_SKIPPED (-1)   // the window does not hold the chunk (world_chunk_slot)
+#define IMPORT_UNCHANGED (-2) // held, but already solid or nothing of the volume is solid there
+
+// --- Private Prototypes ---
+static void _context_init(ImportContext *ctx, WorldManager *world, const int origin[3]);
+static void _context_finish(ImportContext *ctx, uint64_t t0, VoxelImportStats *stats);
+static bool _import_volume(ImportContext *ctx, const int dims[3], uint8_t threshold, FILE *f, const uint8_t *memory);
+static void _chunk_job(void *user, uint32_t index, uint32_t worker);
+static uint32_t _fill_page(const ImportContext *ctx, const int page[3], uint64_t *words);
+static bool _read_u32(FILE *f, uint32_t *out);
+static bool _write_vox(const char *path, const uint8_t (*voxels)[4], uint32_t count, const uint32_t size[3]);
+static uint8_t _test_value(int x, int y, int z);
+
+bool voxel_import_raw(WorldManager *world, const char *path, const VoxelRawDesc *desc, const int origin[3],
+                      VoxelImportStats *stats) {
+  uint64_t t0 = time_now_ns();
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    LOG_WARN("voxel_import_raw: cannot open %s\n", path);
+    return false;
+  }
+  for (int a = 0; a < 3; a++) {
+    if (desc->dims[a] <= 0) {
+      LOG_WARN("voxel_import_raw: bad dimensions %d x %d x %d\n", desc->dims[0], desc->dims[1], desc->dims[2]);
+      fclose(f);
+      return false;
+    }
+  }
+
+  ImportContext ctx;
+  _context_init(&ctx, world, origin);
+  bool ok = fseeko(f, (off_t)desc->header_bytes, SEEK_SET) == 0 &&
+            _import_volume(&ctx, desc->dims, desc->threshold ? desc->threshold : 1u, f, NULL);
+  if (!ok)
+    LOG_WARN("voxel_import_raw: %s is shorter than its volume\n", path);
+  fclose(f);
+  _context_finish(&ctx, t0, stats);
+  return ok;
+}
+
+bool voxel_import_vox(WorldManager *world, const char *path, const int origin[3], VoxelImportStats *stats) {
+  uint64_t t0 = time_now_ns();
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    LOG_WARN("voxel_import_vox: cannot open %s\n", path);
+    return false;
+  }
+
+  ImportContext ctx;
+  _context_init(&ctx, world, origin);
+  uint8_t *model = NULL;
+  uint8_t (*entries)[4] = (uint8_t (*)[4])malloc(VOX_XYZI_BLOCK * 4u);
+  uint32_t size[3] = {0};
+  bool has_size = false;
+
+  // "VOX " version, then MAIN holding every other chunk as its children
+  char id[4];
+  uint32_t version, content, children;
+  bool ok = fread(id, 1, 4, f) == 4 && memcmp(id, "VOX ", 4) == 0 && _read_u32(f, &version) &&
+            fread(id, 1, 4, f) == 4 && memcmp(id, "MAIN", 4) == 0 && _read_u32(f, &content) &&
+            _read_u32(f, &children) && fseeko(f, (off_t)content, SEEK_CUR) == 0;
+
+  while (ok && fread(id, 1, 4, f) == 4) {
+    ok = _read_u32(f, &content) && _read_u32(f, &children);
+    if (!ok)
+      break;
+
+    if (memcmp(id, "SIZE", 4) == 0 && content >= 12u) {
+      ok = _read_u32(f, &size[0]) && _read_u32(f, &size[1]) && _read_u32(f, &size[2]) &&
+           fseeko(f, (off_t)(content - 12u + children), SEEK_CUR) == 0;
+      for (int a = 0; a < 3 && ok; a++)
+        ok = size[a] >= 1u && size[a] <= VOXEL_IMPORT_VOX_MAX_DIM;
+      has_size = ok;
+      continue;
+    }
+    if (memcmp(id, "XYZI", 4) != 0) {
+      ok = fseeko(f, (off_t)content + (off_t)children, SEEK_CUR) == 0;
+      continue;
+    }
+
+    // a model: its size came just before it
+    uint32_t count;
+    ok = has_size && _read_u32(f, &count) && content >= 4u + 4ull * count;
+    if (!ok)
+      break;
+    has_size = false;
+    if (!model) {
+      ctx.stats.buffer_bytes = (size_t)VOXEL_IMPORT_VOX_MAX_DIM * VOXEL_IMPORT_VOX_MAX_DIM * VOXEL_IMPORT_VOX_MAX_DIM;
+      model = (uint8_t *)malloc(ctx.stats.buffer_bytes);
+    }
+    // world y is the model's z
+    int dims[3] = {(int)size[0], (int)size[2], (int)size[1]};
+    memset(model, 0, (size_t)dims[0] * (size_t)dims[1] * (size_t)dims[2]);
+
+    for (uint32_t done = 0; done < count && ok;) {
+      uint32_t n = count - done < VOX_XYZI_BLOCK ? count - done : VOX_XYZI_BLOCK;
+      ok = fread(entries, 4, n, f) == n;
+      for (uint32_t i = 0; i < n && ok; i++) {
+        uint32_t x = entries[i][0], y = entries[i][1], z = entries[i][2];
+        ok = x < size[0] && y < size[1] && z < size[2];
+        if (ok)
+          model[((size_t)y * (size_t)dims[1] + z) * (size_t)dims[0] + x] = 1u;
+      }
+      done += n;
+    }
+    ctx.stats.voxels += count;
+    ok = ok && fseeko(f, (off_t)(content - 4u - 4ull * count) + (off_t)children, SEEK_CUR) == 0 &&
+         _import_volume(&ctx, dims, 1u, NULL, model);
+  }
+
+  if (!ok)
+    LOG_WARN("voxel_import_vox: %s is not a valid .vox file\n", path);
+  free(entries);
+  free(model);
+  fclose(f);
+  _context_finish(&ctx, t0, stats);
+  return ok;
+}
+
+// -------------------- Tests --------------------
+int voxel_import_test(void) {
+  LOG_INFO("Voxel Import Test: CHUNK_SIZE=%u, window of %d chunks per axis\n", (unsigned)CHUNK_SIZE, MAP_DIM);
+  const char *raw_path = "/tmp/vkengine_import_test.raw";
+  const char *vox_path = "/tmp/vkengine_import_test.vox";
+  WorldManager *world = (WorldManager *)malloc(sizeof(WorldManager));
+  world_init(world, 2);
+  int cs = (int)CHUNK_SIZE;
+  bool ok = true;
+
+  // Test 1: a raw volume straddling the window's lower x edge, with a header, lands voxel for voxel
+  LOG_INFO("[Test 1] Raw volume... ");
+  VoxelRawDesc desc = {.dims = {70, 45, 2 * cs + 11}, .header_bytes = 16, .threshold = IMPORT_TEST_THRESHOLD};
+  int origin[3] = {-cs / 4 + 3, 5, cs - 7};
+  size_t total = (size_t)desc.dims[0] * (size_t)desc.dims[1] * (size_t)desc.dims[2];
+  uint8_t *volume = (uint8_t *)malloc(total);
+  uint64_t expected = 0;
+  for (int z = 0; z < desc.dims[2]; z++) {
+    for (int y = 0; y < desc.dims[1]; y++) {
+      for (int x = 0; x < desc.dims[0]; x++) {
+        uint8_t v = _test_value(x, y, z);
+        volume[((size_t)z * (size_t)desc.dims[1] + (size_t)y) * (size_t)desc.dims[0] + (size_t)x] = v;
+        expected += v >= IMPORT_TEST_THRESHOLD && origin[0] + x >= 0;
+      }
+    }
+  }
+  FILE *f = fopen(raw_path, "wb");
+  static const uint8_t header[16] = {0};
+  ok = f && fwrite(header, 1, sizeof(header), f) == sizeof(header) && fwrite(volume, 1, total, f) == total;
+  if (f)
+    ok = fclose(f) == 0 && ok;
+
+  // a voxel below the threshold that is already set stays set
+  int keep[3] = {origin[0] + desc.dims[0] - 8, origin[1] + 1, origin[2] + 2};
+  while (_test_value(keep[0] - origin[0], keep[1] - origin[1], keep[2] - origin[2]) >= IMPORT_TEST_THRESHOLD)
+    keep[0]++;
+  map_insert_voxel(world, keep[0], keep[1], keep[2], true);
+
+  VoxelImportStats stats;
+  ok = ok && voxel_import_raw(world, raw_path, &desc, origin, &stats);
+  ok = ok && stats.voxels == total && stats.solid == expected && stats.chunks > 0u && stats.chunks_skipped > 0u &&
+       stats.buffer_bytes == (size_t)desc.dims[0] * (size_t)desc.dims[1] * CHUNK_SIZE;
+  for (int z = -1; z <= desc.dims[2] && ok; z++) {
+    for (int y = -1; y <= desc.dims[1] && ok; y++) {
+      for (int x = -1; x <= desc.dims[0] && ok; x++) {
+        int g[3] = {origin[0] + x, origin[1] + y, origin[2] + z};
+        if (g[0] < 0)
+          continue;
+        const ChunkTree *tree = &world->chunks[get_chunk_index(g[0], g[1], g[2])].tree;
+        bool inside = x >= 0 && y >= 0 && z >= 0 && x < desc.dims[0] && y < desc.dims[1] && z < desc.dims[2];
+        bool want = (inside && _test_value(x, y, z) >= IMPORT_TEST_THRESHOLD) ||
+                    (g[0] == keep[0] && g[1] == keep[1] && g[2] == keep[2]);
+        ok = !tree->is_dirty && chunk_get_voxel(tree, g[0] % cs, g[1] % cs, g[2] % cs) == want;
+      }
+    }
+  }
+  ok = ok && world_chunk_occupied(world, (origin[0] + 10) / cs, origin[1] / cs, origin[2] / cs);
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED (%u chunks, %u skipped)\n", stats.chunks, stats.chunks_skipped);
+
+  // Test 2: a .vox model with an unknown chunk to skip, z up, across a chunk corner
+  LOG_INFO("[Test 2] MagicaVoxel model... ");
+  const uint32_t size[3] = {5, 6, 9};
+  uint8_t voxels[40][4];
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < 40u; i++) {
+    uint8_t v[4] = {(uint8_t)(i % 5u), (uint8_t)(i * 7u % 6u), (uint8_t)(i * 5u % 9u), 1u};
+    bool dup = false;
+    for (uint32_t j = 0; j < count && !dup; j++)
+      dup = memcmp(voxels[j], v, 3) == 0;
+    if (!dup)
+      memcpy(voxels[count++], v, 4);
+  }
+  int vox_origin[3] = {cs - 2, 4 * cs - 3, 2 * cs - 4}; // clear of the raw volume
+  ok = _write_vox(vox_path, (const uint8_t (*)[4])voxels, count, size) &&
+       voxel_import_vox(world, vox_path, vox_origin, &stats) && stats.voxels == count && stats.solid == count;
+  for (uint32_t x = 0; x < size[0] && ok; x++) {
+    for (uint32_t y = 0; y < size[1] && ok; y++) {
+      for (uint32_t z = 0; z < size[2] && ok; z++) {
+        bool want = false;
+        for (uint32_t j = 0; j < count && !want; j++)
+          want = voxels[j][0] == x && voxels[j][1] == y && voxels[j][2] == z;
+        int g[3] = {vox_origin[0] + (int)x, vox_origin[1] + (int)z, vox_origin[2] + (int)y};
+        const ChunkTree *tree = &world->chunks[get_chunk_index(g[0], g[1], g[2])].tree;
+        ok = chunk_get_voxel(tree, g[0] % cs, g[1] % cs, g[2] % cs) == want;
+      }
+    }
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 3: truncated and malformed inputs are refused
+  LOG_INFO("[Test 3] Bad inputs... ");
+  VoxelRawDesc big = desc;
+  big.dims[2] += 1;
+  uint8_t bad[40][4];
+  memcpy(bad, voxels, sizeof(bad));
+  bad[3][2] = (uint8_t)size[2]; // z out of the model
+  ok = !voxel_import_raw(world, raw_path, &big, origin, NULL) &&
+       !voxel_import_raw(world, "/tmp/vkengine_import_missing.raw", &desc, origin, NULL) &&
+       !voxel_import_vox(world, raw_path, vox_origin, NULL) &&
+       _write_vox(vox_path, (const uint8_t (*)[4])bad, count, size) &&
+       !voxel_import_vox(world, vox_path, vox_origin, NULL);
+  if (!ok)
+    LOG_INFO("FAILED\n");
+  else
+    LOG_INFO("PASSED\n");
+
+done:
+  remove(raw_path);
+  remove(vox_path);
+  free(volume);
+  world_destroy(world);
+  free(world);
+  return ok ? 0 : 1;
+}
+
+// -------------------- Benchmarks --------------------
+// Import of a generated raw volume (a noisy ball) into a static window: voxels per second, end to end.
+void voxel_import_bench(void) {
+  const char *path = "/tmp/vkengine_import_bench.raw";
+  int window = MAP_DIM * (int)CHUNK_SIZE;
+  int d = window < 512 ? window : 512;
+  VoxelRawDesc desc = {.dims = {d, d / 2, d}, .header_bytes = 0, .threshold = IMPORT_TEST_THRESHOLD};
+
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return;
+  uint8_t *row = (uint8_t *)malloc((size_t)desc.dims[0]);
+  for (int z = 0; z < desc.dims[2]; z++) {
+    for (int y = 0; y < desc.dims[1]; y++) {
+      for (int x = 0; x < desc.dims[0]; x++) {
+        int dx = 2 * x - d, dy = 4 * y - d, dz = 2 * z - d;
+        int r2 = dx * dx + dy * dy + dz * dz;
+        row[x] = r2 < d * d ? (uint8_t)(200 - (_test_value(x, y, z) & 127u)) : _test_value(x, y, z) >> 2;
+      }
+      fwrite(row, 1, (size_t)desc.dims[0], f);
+    }
+  }
+  fclose(f);
+  free(row);
+
+  WorldManager *world = (WorldManager *)malloc(sizeof(WorldManager));
+  world_init(world, 0);
+  int origin[3] = {0, 0, 0};
+  VoxelImportStats stats;
+  if (voxel_import_raw(world, path, &desc, origin, &stats)) {
+    LOG_INFO("Voxel Import Bench: %d x %d x %d raw volume, %u workers (CHUNK_SIZE=%u)\n", desc.dims[0],
+             desc.dims[1], desc.dims[2], job_worker_count(world->jobs), (unsigned)CHUNK_SIZE);
+    LOG_INFO("  %.1f ms, %.1f Mvoxels/s, %.1f%% solid, %u chunks, %.1f MiB buffered\n", (double)stats.ns / 1e6,
+             (double)stats.voxels * 1e3 / (double)stats.ns, 100.0 * (double)stats.solid / (double)stats.voxels,
+             stats.chunks, (double)stats.buffer_bytes / (1024.0 * 1024.0));
+  }
+  world_destroy(world);
+  free(world);
+  remove(path);
+}
+
+// --- Private Functions ---
+
+static void _context_init(ImportContext *ctx, WorldManager *world, const int origin[3]) {
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->world = world;
+  memcpy(ctx->origin, origin, sizeof(ctx->origin));
+
+  // page-local coordinates are 4 bits per axis: one batch gives every axis its 16 codes
+  uint32_t c[IMPORT_PAGE_DIM], zero[IMPORT_PAGE_DIM] = {0};
+  uint64_t codes[IMPORT_PAGE_DIM];
+  for (uint32_t i = 0; i < IMPORT_PAGE_DIM; i++)
+    c[i] = i;
+  morton_encode3_batch(c, zero, zero, codes, IMPORT_PAGE_DIM);
+  for (uint32_t i = 0; i < IMPORT_PAGE_DIM; i++) {
+    for (uint32_t a = 0; a < 3u; a++)
+      ctx->codes[a][i] = (uint32_t)codes[i] << a;
+  }
+  ctx->solid = (uint64_t *)calloc(job_worker_count(world->jobs), sizeof(uint64_t));
+}
+
+static void _context_finish(ImportContext *ctx, uint64_t t0, VoxelImportStats *stats) {
+  for (uint32_t w = 0; w < job_worker_count(ctx->world->jobs); w++)
+    ctx->stats.solid += ctx->solid[w];
+  free(ctx->solid);
+  ctx->stats.ns = time_now_ns() - t0;
+  if (stats)
+    *stats = ctx->stats;
+}
+
+// One row of chunks at a time, bottom to top in z: from f (read as it goes) or from a volume already in memory.
+static bool _import_volume(ImportContext *ctx, const int dims[3], uint8_t threshold, FILE *f, const uint8_t *memory) {
+  int cs = (int)CHUNK_SIZE;
+  memcpy(ctx->dims, dims, sizeof(ctx->dims));
+  ctx->threshold = threshold;
+
+  int c0[3], c1[3];
+  for (int a = 0; a < 3; a++) {
+    c0[a] = floor_div(ctx->origin[a], cs);
+    c1[a] = floor_div(ctx->origin[a] + dims[a] - 1, cs);
+  }
+  ctx->cx0 = c0[0];
+  ctx->cy0 = c0[1];
+  ctx->ncx = c1[0] - c0[0] + 1;
+  uint32_t jobs = (uint32_t)ctx->ncx * (uint32_t)(c1[1] - c0[1] + 1);
+  ctx->slots = (int32_t *)malloc(jobs * sizeof(int32_t));
+
+  size_t slice = (size_t)dims[0] * (size_t)dims[1];
+  uint8_t *buffer = NULL;
+  if (f) {
+    buffer = (uint8_t *)malloc(slice * CHUNK_SIZE);
+    if (slice * CHUNK_SIZE > ctx->stats.buffer_bytes)
+      ctx->stats.buffer_bytes = slice * CHUNK_SIZE;
+    ctx->stats.voxels += slice * (size_t)dims[2];
+  }
+
+  bool ok = true;
+  for (int cz = c0[2]; cz <= c1[2] && ok; cz++) {
+    ctx->cz = cz;
+    ctx->z0 = cz * cs - ctx->origin[2] > 0 ? cz * cs - ctx->origin[2] : 0;
+    ctx->z1 = (cz + 1) * cs - ctx->origin[2] < dims[2] ? (cz + 1) * cs - ctx->origin[2] : dims[2];
+    size_t bytes = slice * (size_t)(ctx->z1 - ctx->z0);
+    if (f) {
+      ok = fread(buffer, 1, bytes, f) == bytes;
+      ctx->slab = buffer;
+    } else {
+      ctx->slab = memory + slice * (size_t)ctx->z0;
+    }
+    if (!ok)
+      break;
+
+    job_parallel_for(ctx->world->jobs, jobs, _chunk_job, ctx);
+    for (uint32_t i = 0; i < jobs; i++) {
+      if (ctx->slots[i] >= 0) {
+        world_occupancy_set_slot(ctx->world, (uint32_t)ctx->slots[i]);
+        ctx->stats.chunks++;
+      } else if (ctx->slots[i] == IMPORT_SKIPPED) {
+        ctx->stats.chunks_skipped++;
+      }
+    }
+  }
+
+  free(buffer);
+  free(ctx->slots);
+  ctx->slots = NULL;
+  return ok;
+}
+
+static void _chunk_job(void *user, uint32_t index, uint32_t worker) {
+  ImportContext *ctx = (ImportContext *)user;
+  int c[3] = {ctx->cx0 + (int)(index % (uint32_t)ctx->ncx), ctx->cy0 + (int)(index / (uint32_t)ctx->ncx), ctx->cz};
+  int32_t slot = world_chunk_slot(ctx->world, c[0], c[1], c[2]);
+  ctx->slots[index] = slot;
+  if (slot < 0)
+    return;
+  ChunkTree *tree = &ctx->world->chunks[slot].tree;
+  if (tree->fill == CHUNK_FILL_SOLID) {
+    ctx->slots[index] = IMPORT_UNCHANGED;
+    return;
+  }
+
+  // only the pages the volume (this row of it) reaches
+  int p0[3], p1[3];
+  int lo[3] = {ctx->origin[0], ctx->origin[1], ctx->origin[2] + ctx->z0};
+  int hi[3] = {ctx->origin[0] + ctx->dims[0], ctx->origin[1] + ctx->dims[1], ctx->origin[2] + ctx->z1};
+  for (int a = 0; a < 3; a++) {
+    int base = c[a] * (int)CHUNK_SIZE;
+    p0[a] = (lo[a] > base ? lo[a] - base : 0) / IMPORT_PAGE_DIM;
+    p1[a] = ((hi[a] < base + (int)CHUNK_SIZE ? hi[a] - base : (int)CHUNK_SIZE) - 1) / IMPORT_PAGE_DIM;
+  }
+
+  uint64_t words[CHUNK_PAGE_WORDS];
+  uint64_t solid = 0;
+  for (int pz = p0[2]; pz <= p1[2]; pz++) {
+    for (int py = p0[1]; py <= p1[1]; py++) {
+      for (int px = p0[0]; px <= p1[0]; px++) {
+        int page[3] = {c[0] * (int)CHUNK_SIZE + px * IMPORT_PAGE_DIM, c[1] * (int)CHUNK_SIZE + py * IMPORT_PAGE_DIM,
+                       c[2] * (int)CHUNK_SIZE + pz * IMPORT_PAGE_DIM};
+        uint32_t n = _fill_page(ctx, page, words);
+        if (n == 0)
+          continue;
+        solid += n;
+
+        uint64_t first = morton_encode3((uint32_t)px, (uint32_t)py, (uint32_t)pz) * CHUNK_PAGE_WORDS;
+        if (tree->fill == CHUNK_FILL_MIXED) {
+          for (uint32_t i = 0; i < CHUNK_PAGE_WORDS; i++)
+            words[i] |= chunk_get_word(tree, first + i);
+        }
+        chunk_set_words(tree, first, words, CHUNK_PAGE_WORDS);
+      }
+    }
+  }
+  ctx->solid[worker] += solid;
+
+  if (!tree->is_dirty) {
+    ctx->slots[index] = IMPORT_UNCHANGED;
+    return;
+  }
+  // slots are disjoint and each worker owns its scratch, as in world_rebuild_dirty
+  chunk_rebuild_with(tree, ctx->world->scratch[worker], false);
+  tree->pending_edits = 0;
+}
+
+// The 64 leaf words of the page at global voxel `page`, from the slab; returns the solid voxels.
+static uint32_t _fill_page(const ImportContext *ctx, const int page[3], uint64_t *words) {
+  memset(words, 0, CHUNK_PAGE_WORDS * sizeof(uint64_t));
+  int lo[3], hi[3];
+  for (int a = 0; a < 3; a++) {
+    int v_lo = a == 2 ? ctx->z0 : 0, v_hi = a == 2 ? ctx->z1 : ctx->dims[a];
+    int p = page[a] - ctx->origin[a];
+    lo[a] = p > v_lo ? p : v_lo;
+    hi[a] = p + IMPORT_PAGE_DIM < v_hi ? p + IMPORT_PAGE_DIM : v_hi;
+    if (lo[a] >= hi[a])
+      return 0;
+  }
+
+  // volume coordinates of the page's first voxel
+  int p[3] = {page[0] - ctx->origin[0], page[1] - ctx->origin[1], page[2] - ctx->origin[2]};
+  size_t dx = (size_t)ctx->dims[0];
+  for (int z = lo[2]; z < hi[2]; z++) {
+    for (int y = lo[1]; y < hi[1]; y++) {
+      const uint8_t *row = ctx->slab + ((size_t)(z - ctx->z0) * (size_t)ctx->dims[1] + (size_t)y) * dx;
+      uint32_t base = ctx->codes[1][y - p[1]] | ctx->codes[2][z - p[2]];
+      for (int x = lo[0]; x < hi[0]; x++) {
+        uint32_t code = base | ctx->codes[0][x - p[0]];
+        words[code >> 6] |= (uint64_t)(row[x] >= ctx->threshold) << (code & 63u);
+      }
+    }
+  }
+
+  uint32_t solid = 0;
+  for (uint32_t i = 0; i < CHUNK_PAGE_WORDS; i++)
+    solid += (uint32_t)__builtin_popcountll(words[i]);
+  return solid;
+}
+
+// .vox is little endian, as is every target
+static bool _read_u32(FILE *f, uint32_t *out) { return fread(out, sizeof(uint32_t), 1, f) == 1; }
+
+// A minimal .vox: MAIN with a palette-less RGBA stand-in (to be skipped), SIZE and XYZI.
+static bool _write_vox(const char *path, const uint8_t (*voxels)[4], uint32_t count, const uint32_t size[3]) {
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return false;
+  uint32_t extra = 16u;
+  uint32_t children = (12u + extra) + (12u + 12u) + (12u + 4u + 4u * count);
+  uint32_t head[] = {150u, 0u, children};
+  uint32_t skip[] = {extra, 0u}, size_chunk[] = {12u, 0u, size[0], size[1], size[2]};
+  uint32_t xyzi[] = {4u + 4u * count, 0u, count};
+  static const uint8_t filler[16] = {0};
+  bool ok = fwrite("VOX ", 1, 4, f) == 4 && fwrite(&head[0], 4, 1, f) == 1 && fwrite("MAIN", 1, 4, f) == 4 &&
+            fwrite(&head[1], 4, 2, f) == 2 && fwrite("RGBX", 1, 4, f) == 4 && fwrite(skip, 4, 2, f) == 2 &&
+            fwrite(filler, 1, extra, f) == extra && fwrite("SIZE", 1, 4, f) == 4 && fwrite(size_chunk, 4, 5, f) == 5 &&
+            fwrite("XYZI", 1, 4, f) == 4 && fwrite(xyzi, 4, 3, f) == 3 && fwrite(voxels, 4, count, f) == count;
+  return fclose(f) == 0 && ok;
+}
+
+// Deterministic voxel values, about half of them at or above IMPORT_TEST_THRESHOLD.
+static uint8_t _test_value(int x, int y, int z) {
+  uint32_t h = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u;
+  h ^= h >> 13;
+  h *= 0x5bd1e995u;
+  return (uint8_t)(h >> 24);
+}
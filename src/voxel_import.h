@@ -0,0 +1,51 @@
+#pragma once
+
+#include "world.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+  Volume importers: dense uint8 volumes (CT / scan dumps) and MagicaVoxel .vox models, written straight into the
+  world window's chunk trees.
+
+  - The volume is read one row of chunks at a time: the slices covering one chunk layer along z, so memory holds
+    dims[0] * dims[1] * CHUNK_SIZE bytes however long the file is (a .vox model, at most 256^3, is read whole).
+  - The chunks of a row are converted on the world's job workers, one chunk per job: every 16^3 page of the chunk
+    that meets the volume is assembled into its 64 leaf words through per-axis Morton tables (one batch encode
+    per import, no per-voxel encode), stored with chunk_set_words, and the chunk is rebuilt in the same job.
+  - Imports add voxels: solid ones are set, nothing is cleared, so volumes can be layered (clear the slots first to
+    replace). Chunks the window does not hold are skipped, as with map_insert_voxel: before the first recenter
+    the window is chunks [0, MAP_DIM) per axis, afterwards a slot only takes the chunk it holds (and is not
+    loading).
+*/
+
+#define VOXEL_IMPORT_VOX_MAX_DIM 256 // MagicaVoxel's own model limit, and the bound on the model buffer
+
+typedef struct VoxelRawDesc {
+  int dims[3];           // x fastest, then y, then z; volume axes are world axes (y up)
+  uint64_t header_bytes; // skipped before the first voxel
+  uint8_t threshold;     // a voxel is solid if its value is at least this (1: any non-zero)
+} VoxelRawDesc;
+
+typedef struct VoxelImportStats {
+  uint64_t voxels;         // volume voxels read
+  uint64_t solid;          // solid voxels written into held chunks
+  uint32_t chunks;         // chunks written and rebuilt
+  uint32_t chunks_skipped; // chunks of the volume the window does not hold
+  size_t buffer_bytes;     // largest volume buffer held at once
+  uint64_t ns;             // whole import: reads, conversion, rebuilds
+} VoxelImportStats;
+
+// PUBLIC FUNCTIONS
+
+// origin: global voxel coordinates of volume voxel (0, 0, 0). stats may be NULL. On a read error the chunk rows
+// already imported stay in the world and false is returned.
+bool voxel_import_raw(WorldManager *world, const char *path, const VoxelRawDesc *desc, const int origin[3],
+                      VoxelImportStats *stats);
+// Every model of the file (SIZE/XYZI pairs) is placed at origin; the scene graph (nTRN/nGRP/nSHP), palette and
+// materials are ignored. MagicaVoxel's z is up: model (x, y, z) lands on world (x, z, y).
+bool voxel_import_vox(WorldManager *world, const char *path, const int origin[3], VoxelImportStats *stats);
+
+// tests
+int voxel_import_test(void);
+void voxel_import_bench(void);
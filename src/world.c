@@ -1,44 +1,145 @@
+#include "world.h"
 #include "cglm/types.h"
 #include "chunk.h"
+#include "chunk_mesh.h"
+#include "region.h"
+#include "system_manager.h"
+#include "terrain.h"
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector.h>
 
-// -----------------------------------------------------------------------------
-// CONSTANTS & CONFIGURATION
-// -----------------------------------------------------------------------------
+// A slot waiting for its chunk. priority = squared chunk distance to the window center, smallest first.
+typedef struct LoadRequest {
+  uint32_t slot;
+  uint32_t ticket;
+  int cx, cy, cz;
+  int64_t priority;
+  ChunkBuildMode build_mode; // the slot's, so a GPU-built slot is not flattened on the loader thread
+} LoadRequest;
 
-// The "Active Window" around the player.
-// A 16x16x16 grid means we track 4,096 chunks total.
-// This acts as a Ring Buffer (Toroidal).
-#define MAP_DIM 16
+typedef struct LoadResult {
+  uint32_t slot;
+  uint32_t ticket;
+  ChunkTree *tree; // staging tree, rebuilt; recycled through free_trees after the commit
+} LoadResult;
 
-typedef struct ChunkSlot {
-  ChunkTree tree;   // The actual voxel data and SVO logic
-  ivec3 global_pos; // Current world position (e.g., 64, 0, -128)
-  bool is_active;   // Is this slot currently used?
-} ChunkSlot;
+// One region file world_region_source keeps open on a loader thread.
+typedef struct OpenRegion {
+  char path[512];
+  RegionFile file;
+  uint64_t last_use; // 0 = unused
+} OpenRegion;
 
-typedef struct WorldManager {
-  // A 3D array of slots: [MAP_DIM][MAP_DIM][MAP_DIM]
-  ChunkSlot *chunks;
+typedef struct LoaderThread {
+  WorldManager *world;
+  ChunkStreamer *st;
+  ChunkScratch *scratch;
+  pthread_t handle;
 
-  // Total size of the world in voxels (e.g., 16 * 64 = 1024)
-  int world_voxel_dim;
-} WorldManager;
-// Maps any global voxel coordinate to the correct Chunk Index in the ring
-// buffer
+  // least recently used goes first; only this thread touches them until _streamer_destroy closes them
+  OpenRegion regions[WORLD_OPEN_REGIONS];
+  uint64_t region_clock;
+} LoaderThread;
+
+struct ChunkStreamer {
+  LoaderThread threads[WORLD_LOADER_THREADS];
+
+  // everything below is guarded by mutex, and so are the slots' load_ticket fields
+  pthread_mutex_t mutex;
+  pthread_cond_t wake; // new requests, a staging slot freed, or quit
+  bool quit;
+
+  Vector queue;      // LoadRequest[], binary min-heap on priority
+  Vector done;       // LoadResult[], oldest first
+  Vector free_trees; // ChunkTree*[], staging trees ready for reuse
+  uint32_t staged;   // loads in flight + done, at most WORLD_MAX_STAGED
+
+  ChunkSourceFn source;
+  void *user;
+};
+
+// the loader a thread runs, so world_region_source can reach its open files
+static _Thread_local LoaderThread *s_loader = NULL;
+
+// --- Private Prototypes ---
+static void _rebuild_job(void *user, uint32_t index, uint32_t worker);
+static ChunkStreamer *_streamer_create(WorldManager *world);
+static void _streamer_destroy(ChunkStreamer *st);
+static void *_loader_main(void *arg);
+static const RegionFile *_loader_region(LoaderThread *t, const char *path);
+static void _heap_push(Vector *heap, const LoadRequest *req);
+static LoadRequest _heap_pop(Vector *heap);
+static void _heap_sift_down(LoadRequest *h, uint32_t n, uint32_t i);
+static int64_t _chunk_distance2(const ivec3 center, int cx, int cy, int cz);
+static bool _test_source(void *user, int cx, int cy, int cz, ChunkTree *out);
+static bool _terrain_source(void *user, int cx, int cy, int cz, ChunkTree *out);
+static bool _check_window(WorldManager *world);
+static void _drain_loads(WorldManager *world);
+
+void world_init(WorldManager *world, uint32_t worker_count) {
+  memset(world, 0, sizeof(*world));
+  world->chunks = (ChunkSlot *)calloc(WORLD_CHUNK_COUNT, sizeof(ChunkSlot));
+  world->world_voxel_dim = MAP_DIM * (int)CHUNK_SIZE;
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++)
+    chunk_init(&world->chunks[i].tree);
+
+  world->jobs = job_system_create(worker_count);
+  uint32_t workers = job_worker_count(world->jobs);
+  world->scratch = (ChunkScratch **)calloc(workers, sizeof(ChunkScratch *));
+  for (uint32_t w = 0; w < workers; w++)
+    world->scratch[w] = chunk_scratch_create();
+
+  world->rebuild_list = (uint32_t *)malloc(WORLD_CHUNK_COUNT * sizeof(uint32_t));
+  world->commit_budget = WORLD_COMMIT_BUDGET;
+  world->lod_step = WORLD_LOD_STEP;
+  svo_dag_init(&world->dag);
+  world_update_occupancy(world);
+  world->streamer = _streamer_create(world);
+}
+
+void world_destroy(WorldManager *world) {
+  // loader threads read the slots' tickets, stop them first
+  _streamer_destroy(world->streamer);
+
+  if (world->jobs) {
+    for (uint32_t w = 0; w < job_worker_count(world->jobs); w++)
+      chunk_scratch_destroy(world->scratch[w]);
+    job_system_destroy(world->jobs);
+  }
+
+  if (world->chunks) {
+    for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++)
+      chunk_destroy(&world->chunks[i].tree);
+  }
+
+  svo_dag_destroy(&world->dag);
+  // its buffers belong to the resource manager
+  free(world->gpu_builder);
+  // the slots' bitsets just went back to the shared pool, let go of whatever nothing else uses
+  chunk_pool_trim();
+  free(world->chunks);
+  free(world->scratch);
+  free(world->rebuild_list);
+  memset(world, 0, sizeof(*world));
+}
 
 int get_chunk_index(int gx, int gy, int gz) {
-  // 1. Convert voxel to chunk-space
-  int cx = (gx / CHUNK_SIZE);
-  int cy = (gy / CHUNK_SIZE);
-  int cz = (gz / CHUNK_SIZE);
+  // 1. Convert voxel to chunk-space (floored, so -1 is in chunk -1 and not chunk 0)
+  int cx = floor_div(gx, (int)CHUNK_SIZE);
+  int cy = floor_div(gy, (int)CHUNK_SIZE);
+  int cz = floor_div(gz, (int)CHUNK_SIZE);
 
   // 2. Wrap using modulo for toroidal effect
-  // We add MAP_DIM to handle negative coordinates correctly in C
-  int lx = (cx % MAP_DIM + MAP_DIM) % MAP_DIM;
-  int ly = (cy % MAP_DIM + MAP_DIM) % MAP_DIM;
-  int lz = (cz % MAP_DIM + MAP_DIM) % MAP_DIM;
+  int lx = wrap(cx, MAP_DIM);
+  int ly = wrap(cy, MAP_DIM);
+  int lz = wrap(cz, MAP_DIM);
 
   // 3. Flatten to 1D array index
   return lx + (ly * MAP_DIM) + (lz * MAP_DIM * MAP_DIM);
@@ -50,10 +151,937 @@ void map_insert_voxel(WorldManager *world, int x, int y, int z, bool active) {
   ChunkSlot *slot = &world->chunks[slot_idx];
 
   // 2. Find local voxel coords inside that chunk (0-63)
-  int lx = (x % CHUNK_SIZE + CHUNK_SIZE) % CHUNK_SIZE;
-  int ly = (y % CHUNK_SIZE + CHUNK_SIZE) % CHUNK_SIZE;
-  int lz = (z % CHUNK_SIZE + CHUNK_SIZE) % CHUNK_SIZE;
+  int cs = (int)CHUNK_SIZE;
+  int lx = wrap(x, cs);
+  int ly = wrap(y, cs);
+  int lz = wrap(z, cs);
+
+  // the ring slot may still hold (or be loading) another chunk with the same wrapped position
+  if (world->has_center && (!slot->is_active || slot->global_pos[0] != x - lx || slot->global_pos[1] != y - ly ||
+                            slot->global_pos[2] != z - lz))
+    return;
 
   // 3. Update the bits inside the ChunkTree
   chunk_set_voxel(&slot->tree, lx, ly, lz, active);
 }
+
+int world_chunk_slot(const WorldManager *world, int cx, int cy, int cz) {
+  int cs = (int)CHUNK_SIZE;
+  int slot_idx = get_chunk_index(cx * cs, cy * cs, cz * cs);
+  if (!world->has_center)
+    return (cx >= 0 && cx < MAP_DIM && cy >= 0 && cy < MAP_DIM && cz >= 0 && cz < MAP_DIM) ? slot_idx : -1;
+
+  const ChunkSlot *slot = &world->chunks[slot_idx];
+  if (!slot->is_active || slot->is_loading || slot->global_pos[0] != cx * cs || slot->global_pos[1] != cy * cs ||
+      slot->global_pos[2] != cz * cs)
+    return -1;
+  return slot_idx;
+}
+
+uint32_t world_rebuild_dirty(WorldManager *world, uint32_t threshold) {
+  // collected in slot order so the batch (and its split across workers) is the same every run
+  world->rebuild_count = 0;
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++) {
+    ChunkTree *tree = &world->chunks[i].tree;
+    // a loading slot's contents are about to be replaced
+    if (world->chunks[i].is_loading)
+      continue;
+    chunk_concurrent_flush(tree);
+    if (tree->is_dirty && tree->pending_edits >= threshold)
+      world->rebuild_list[world->rebuild_count++] = i;
+  }
+
+  job_parallel_for(world->jobs, world->rebuild_count, _rebuild_job, world);
+  for (uint32_t i = 0; i < world->rebuild_count; i++)
+    world_occupancy_set_slot(world, world->rebuild_list[i]);
+  return world->rebuild_count;
+}
+
+void world_upload(WorldManager *world, M_GPU *gpu, M_Resource *rm, CmdBuffer cmd) {
+  // command recording stays on the calling thread
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++) {
+    ChunkTree *tree = &world->chunks[i].tree;
+    if (!tree->need_upload)
+      continue;
+    if (!chunk_uses_gpu_build(tree)) {
+      chunk_upload(tree, gpu, rm, cmd);
+      continue;
+    }
+
+    if (!world->gpu_builder) {
+      auto *pr = SYSTEM_GET(SYSTEM_TYPE_HOTRELOAD, M_HotReload);
+      world->gpu_builder = (ChunkGpuBuilder *)malloc(sizeof(ChunkGpuBuilder));
+      chunk_gpu_builder_init(world->gpu_builder, rm, pr);
+    }
+    chunk_gpu_build(world->gpu_builder, tree, gpu, rm, cmd);
+  }
+  world_upload_occupancy(world, gpu, rm, cmd);
+}
+
+void world_update(WorldManager *world, M_GPU *gpu, M_Resource *rm, CmdBuffer cmd, uint32_t threshold) {
+  world_commit_loads(world, world->commit_budget);
+  world_rebuild_dirty(world, threshold);
+  world_select_lods(world);
+  world_upload(world, gpu, rm, cmd);
+}
+
+void world_set_source(WorldManager *world, ChunkSourceFn source, void *user) {
+  ChunkStreamer *st = world->streamer;
+  pthread_mutex_lock(&st->mutex);
+  st->source = source;
+  st->user = user;
+  pthread_mutex_unlock(&st->mutex);
+}
+
+uint32_t world_recenter(WorldManager *world, const vec3 camera_pos) {
+  int cs = (int)CHUNK_SIZE;
+  ivec3 center = {floor_div((int)floorf(camera_pos[0]), cs), floor_div((int)floorf(camera_pos[1]), cs),
+                  floor_div((int)floorf(camera_pos[2]), cs)};
+  if (world->has_center && center[0] == world->center_chunk[0] && center[1] == world->center_chunk[1] &&
+      center[2] == world->center_chunk[2])
+    return 0;
+
+  world->center_chunk[0] = center[0];
+  world->center_chunk[1] = center[1];
+  world->center_chunk[2] = center[2];
+  world->has_center = true;
+
+  ChunkStreamer *st = world->streamer;
+  int lo[3] = {center[0] - MAP_DIM / 2, center[1] - MAP_DIM / 2, center[2] - MAP_DIM / 2};
+  uint32_t queued = 0;
+
+  pthread_mutex_lock(&st->mutex);
+
+  // requests still queued from an older window get their distance to the new center
+  LoadRequest *h = (LoadRequest *)st->queue.data;
+  uint32_t n = (uint32_t)st->queue.length;
+  for (uint32_t i = 0; i < n; i++)
+    h[i].priority = _chunk_distance2(center, h[i].cx, h[i].cy, h[i].cz);
+  for (uint32_t i = n / 2; i-- > 0;)
+    _heap_sift_down(h, n, i);
+
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++) {
+    ChunkSlot *slot = &world->chunks[i];
+    int l[3] = {(int)(i % MAP_DIM), (int)((i / MAP_DIM) % MAP_DIM), (int)(i / (MAP_DIM * MAP_DIM))};
+
+    // the one chunk of the window that wraps onto this slot
+    int c[3];
+    for (int a = 0; a < 3; a++)
+      c[a] = lo[a] + wrap(l[a] - lo[a], MAP_DIM);
+
+    if ((slot->is_active || slot->is_loading) && slot->global_pos[0] == c[0] * cs && slot->global_pos[1] == c[1] * cs &&
+        slot->global_pos[2] == c[2] * cs)
+      continue;
+
+    // evict: the old contents stay in place (and keep their GPU buffers) until the new chunk is committed
+    slot->is_active = false;
+    slot->is_loading = true;
+    slot->load_ticket++;
+    slot->global_pos[0] = c[0] * cs;
+    slot->global_pos[1] = c[1] * cs;
+    slot->global_pos[2] = c[2] * cs;
+
+    LoadRequest req = {.slot = i,
+                       .ticket = slot->load_ticket,
+                       .cx = c[0],
+                       .cy = c[1],
+                       .cz = c[2],
+                       .priority = _chunk_distance2(center, c[0], c[1], c[2]),
+                       .build_mode = slot->tree.build_mode};
+    _heap_push(&st->queue, &req);
+    queued++;
+  }
+
+  if (queued > 0)
+    pthread_cond_broadcast(&st->wake);
+  pthread_mutex_unlock(&st->mutex);
+
+  // the window moved under the occupancy tree, and the retargeted slots are empty until their loads land
+  world_update_occupancy(world);
+  return queued;
+}
+
+uint32_t world_commit_loads(WorldManager *world, uint32_t budget) {
+  ChunkStreamer *st = world->streamer;
+  LoadResult batch[WORLD_MAX_STAGED];
+
+  pthread_mutex_lock(&st->mutex);
+  uint32_t n = (uint32_t)st->done.length;
+  if (n > budget)
+    n = budget;
+  if (n > WORLD_MAX_STAGED)
+    n = WORLD_MAX_STAGED;
+  if (n > 0) {
+    LoadResult *done = (LoadResult *)st->done.data;
+    memcpy(batch, done, n * sizeof(LoadResult));
+    memmove(done, done + n, (st->done.length - n) * sizeof(LoadResult));
+    st->done.length -= n;
+  }
+  pthread_mutex_unlock(&st->mutex);
+  if (n == 0)
+    return 0;
+
+  // only the main thread writes slots, so the swaps need no lock; tickets are only written here and in recenter
+  uint32_t committed = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    ChunkSlot *slot = &world->chunks[batch[i].slot];
+    if (batch[i].ticket != slot->load_ticket)
+      continue;
+
+    // swap contents, but the slot keeps its GPU buffers
+    ChunkTree old = slot->tree;
+    slot->tree = *batch[i].tree;
+    slot->tree.gpu_node = old.gpu_node;
+    slot->tree.gpu_child_indices = old.gpu_child_indices;
+#if CHUNK_DISTANCE_FIELD
+    slot->tree.gpu_distance = old.gpu_distance;
+    slot->tree.distance_changed = true;
+#endif
+    slot->tree.build_mode = old.build_mode;
+    slot->tree.need_upload = true;
+    *batch[i].tree = old;
+
+    slot->is_loading = false;
+    slot->is_active = true;
+    world_occupancy_set_slot(world, batch[i].slot);
+    committed++;
+  }
+
+  pthread_mutex_lock(&st->mutex);
+  for (uint32_t i = 0; i < n; i++)
+    vec_push(&st->free_trees, &batch[i].tree);
+  st->staged -= n;
+  pthread_cond_broadcast(&st->wake);
+  pthread_mutex_unlock(&st->mutex);
+
+  return committed;
+}
+
+uint32_t world_pending_loads(WorldManager *world) {
+  ChunkStreamer *st = world->streamer;
+  pthread_mutex_lock(&st->mutex);
+  uint32_t n = (uint32_t)st->queue.length + st->staged;
+  pthread_mutex_unlock(&st->mutex);
+  return n;
+}
+
+void world_select_lods(WorldManager *world) {
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++) {
+    ChunkSlot *slot = &world->chunks[i];
+    if (!slot->is_active)
+      continue;
+
+    uint32_t dist = 0;
+    for (int a = 0; a < 3 && world->has_center; a++) {
+      int d = abs(floor_div(slot->global_pos[a], (int)CHUNK_SIZE) - world->center_chunk[a]);
+      dist = (uint32_t)d > dist ? (uint32_t)d : dist;
+    }
+    // chunk_set_lod clamps to what the chunk has, and only flags an upload on a change
+    chunk_set_lod(&slot->tree, world->lod_step ? dist / world->lod_step : 0u);
+  }
+}
+
+size_t world_build_dag(WorldManager *world) {
+  // the pool is append-only, so start over rather than leave stale subtrees of edited chunks behind
+  svo_dag_clear(&world->dag);
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++) {
+    ChunkSlot *slot = &world->chunks[i];
+    // a GPU-built tree never reaches the CPU, interning it would store the chunk as empty
+    bool interned = slot->is_active && !slot->tree.is_dirty && !chunk_uses_gpu_build(&slot->tree);
+    slot->dag_root = interned ? svo_dag_insert(&world->dag, &slot->tree) : SVO_DAG_NO_ROOT;
+  }
+  return svo_dag_bytes(&world->dag);
+}
+
+void world_mesh_slot(WorldManager *world, uint32_t slot_index, uint32_t section, ChunkMesh *mesh) {
+  const ChunkSlot *slot = &world->chunks[slot_index];
+  const ChunkTree *neighbors[CHUNK_MESH_FACE_COUNT];
+  int cs = (int)CHUNK_SIZE;
+
+  // before the first recenter the window is static: slot i holds chunk i, global_pos is unused
+  ivec3 origin = {slot->global_pos[0], slot->global_pos[1], slot->global_pos[2]};
+  if (!world->has_center) {
+    origin[0] = (int)(slot_index % MAP_DIM) * cs;
+    origin[1] = (int)(slot_index / MAP_DIM % MAP_DIM) * cs;
+    origin[2] = (int)(slot_index / (MAP_DIM * MAP_DIM)) * cs;
+  }
+
+  for (uint32_t f = 0; f < CHUNK_MESH_FACE_COUNT; f++) {
+    ivec3 pos = {origin[0], origin[1], origin[2]};
+    pos[f / 2] += (f & 1u) ? -cs : cs;
+    const ChunkSlot *n = &world->chunks[get_chunk_index(pos[0], pos[1], pos[2])];
+
+    // the ring slot on that side may hold another chunk (window edge) or one still loading: treat it as empty
+    bool valid;
+    if (world->has_center)
+      valid = n->is_active && !n->is_loading && n->global_pos[0] == pos[0] && n->global_pos[1] == pos[1] &&
+              n->global_pos[2] == pos[2];
+    else
+      valid = pos[f / 2] >= 0 && pos[f / 2] < world->world_voxel_dim;
+    neighbors[f] = valid ? &n->tree : NULL;
+  }
+  chunk_mesh_build(mesh, &slot->tree, neighbors, section);
+}
+
+bool world_region_source(void *user, int cx, int cy, int cz, ChunkTree *out) {
+  const char *dir = (const char *)user;
+  int rx, ry, rz;
+  region_coord(cx, cy, cz, &rx, &ry, &rz);
+
+  char path[512];
+  region_path(path, sizeof(path), dir, rx, ry, rz);
+
+  // on a loader thread the file stays mapped for the next chunks of its region
+  if (s_loader) {
+    const RegionFile *rf = _loader_region(s_loader, path);
+    return rf && region_load_chunk(rf, region_local_index(cx, cy, cz), out);
+  }
+
+  RegionFile rf;
+  if (!region_open(&rf, path))
+    return false;
+  bool ok = region_load_chunk(&rf, region_local_index(cx, cy, cz), out);
+  region_close(&rf);
+  return ok;
+}
+
+// -------------------- Tests --------------------
+
+int world_test(void) {
+  WorldManager *world = (WorldManager *)malloc(sizeof(WorldManager));
+  world_init(world, 4);
+  LOG_INFO("World Test: %u chunks, %u workers\n", (unsigned)WORLD_CHUNK_COUNT, job_worker_count(world->jobs));
+
+  ChunkTree *ref = (ChunkTree *)malloc(sizeof(ChunkTree));
+  chunk_init(ref);
+  bool ok = true;
+
+  LOG_INFO("[Test 1] Parallel rebuild matches serial rebuild... ");
+  for (uint32_t round = 0; round < 3u && ok; round++) {
+    // round 0 builds from scratch, later rounds patch a few voxels so the incremental path runs too
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i += 11u) {
+      ChunkTree *tree = &world->chunks[i].tree;
+      if (round == 0) {
+        chunk_fill_test_chunk(tree, i);
+      } else {
+        for (uint32_t k = 0; k < round * 5u; k++)
+          chunk_set_voxel(tree, (int)((i * 7u + k * 13u) % CHUNK_SIZE), (int)((k * 29u) % CHUNK_SIZE),
+                          (int)((i + k) % CHUNK_SIZE), (k & 1u) != 0u);
+      }
+      expected += tree->is_dirty ? 1u : 0u;
+    }
+
+    uint32_t rebuilt = world_rebuild_dirty(world, 0);
+    ok = rebuilt == expected;
+
+    for (uint32_t i = 0; i < WORLD_CHUNK_COUNT && ok; i++) {
+      const ChunkTree *tree = &world->chunks[i].tree;
+      if (tree->is_dirty) {
+        ok = false;
+        break;
+      }
+      if (tree->nodes.length == 0)
+        continue;
+
+      chunk_clear(ref);
+      chunk_stamp(ref, tree, CHUNK_STAMP_UNION);
+      chunk_rebuild(ref);
+      ok = ref->nodes.length == tree->nodes.length &&
+           memcmp(ref->nodes.data, tree->nodes.data, tree->nodes.length * sizeof(Node)) == 0 &&
+           memcmp(ref->child_indices.data, tree->child_indices.data, tree->nodes.length * sizeof(ChildIndex)) == 0;
+    }
+  }
+
+  chunk_destroy(ref);
+  free(ref);
+
+  if (!ok) {
+    LOG_INFO("FAILED (parallel result differs)\n");
+    world_destroy(world);
+    free(world);
+    return 1;
+  }
+  LOG_INFO("PASSED\n");
+
+  LOG_INFO("[Test 2] Recentering reloads only the exposed slabs... ");
+  int cs = (int)CHUNK_SIZE;
+  world_set_source(world, _test_source, NULL);
+  struct {
+    vec3 camera;
+    uint32_t expected;
+  } steps[] = {
+      {{0.5f, 0.5f, 0.5f}, WORLD_CHUNK_COUNT},                                  // first window loads everything
+      {{(float)cs + 0.5f, 0.5f, 0.5f}, MAP_DIM * MAP_DIM},                      // +1 chunk in x: one slab
+      {{(float)cs + 3.0f, 5.0f, 7.0f}, 0},                                      // same chunk: nothing
+      {{2.0f * cs, -1.0f, 0.5f}, WORLD_CHUNK_COUNT - (MAP_DIM - 1) * (MAP_DIM - 1) * MAP_DIM}, // x and y
+      {{-3.0f * cs - 1.0f, -2.0f * cs, -1.0f}, WORLD_CHUNK_COUNT - (MAP_DIM - 6) * (MAP_DIM - 1) * (MAP_DIM - 1)},
+  };
+  for (uint32_t i = 0; i < sizeof(steps) / sizeof(steps[0]) && ok; i++) {
+    ok = world_recenter(world, steps[i].camera) == steps[i].expected;
+    _drain_loads(world);
+    ok = ok && _check_window(world);
+  }
+
+  if (ok) {
+    // outside the window: the slot it wraps onto holds another chunk, so the edit is dropped
+    int x = (world->center_chunk[0] + MAP_DIM) * cs;
+    int slot = get_chunk_index(x, 0, 0);
+    bool was_dirty = world->chunks[slot].tree.is_dirty;
+    map_insert_voxel(world, x, 0, 0, true);
+    ok = world->chunks[slot].tree.is_dirty == was_dirty;
+  }
+
+  if (!ok) {
+    LOG_INFO("FAILED (wrong slots reloaded or wrong contents)\n");
+    world_destroy(world);
+    free(world);
+    return 1;
+  }
+  LOG_INFO("PASSED\n");
+
+  LOG_INFO("[Test 3] Stale loads are dropped when the window moves back... ");
+  for (uint32_t round = 0; round < 4u && ok; round++) {
+    // far away and straight back before the far loads can all land
+    vec3 far = {1000.0f * cs, 0.0f, -1000.0f * cs};
+    vec3 home = {0.5f, 0.5f, 0.5f};
+    world_recenter(world, far);
+    world_commit_loads(world, 2);
+    world_recenter(world, home);
+    _drain_loads(world);
+    ok = _check_window(world);
+  }
+
+  world_destroy(world);
+  free(world);
+
+  if (!ok) {
+    LOG_INFO("FAILED (a stale chunk was committed)\n");
+    return 1;
+  }
+  LOG_INFO("PASSED\n");
+
+  LOG_INFO("[Test 4] Uniform chunks keep no voxel storage... ");
+  world = (WorldManager *)malloc(sizeof(WorldManager));
+  world_init(world, 2);
+  world_set_source(world, _terrain_source, NULL);
+  world_recenter(world, (vec3){0.5f, 0.5f, 0.5f});
+  _drain_loads(world);
+
+  // _terrain_source: solid below chunk -1, mixed in it, empty above
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT && ok; i++) {
+    const ChunkTree *tree = &world->chunks[i].tree;
+    int cy = floor_div(world->chunks[i].global_pos[1], cs);
+    ChunkFill expected = cy < -1 ? CHUNK_FILL_SOLID : (cy == -1 ? CHUNK_FILL_MIXED : CHUNK_FILL_EMPTY);
+    ok = tree->fill == expected && (expected == CHUNK_FILL_MIXED) == (chunk_storage_bytes(tree) > 0);
+  }
+
+  // a hole in solid rock materializes the slot's storage, filling it again drops it on the next rebuild
+  const ChunkTree *rock = &world->chunks[get_chunk_index(0, -3 * cs, 0)].tree;
+  map_insert_voxel(world, 1, -3 * cs + 2, 3, false);
+  world_rebuild_dirty(world, 0);
+  ok = ok && rock->fill == CHUNK_FILL_MIXED && !chunk_get_voxel(rock, 1, 2, 3);
+  map_insert_voxel(world, 1, -3 * cs + 2, 3, true);
+  world_rebuild_dirty(world, 0);
+  ok = ok && rock->fill == CHUNK_FILL_SOLID && chunk_storage_bytes(rock) == 0;
+  ok = ok && rock->level_count[0] == WORDS_PER_CHUNK;
+
+  world_destroy(world);
+  free(world);
+
+  if (!ok) {
+    LOG_INFO("FAILED (uniform chunk kept or lost its storage)\n");
+    return 1;
+  }
+  LOG_INFO("PASSED\n");
+
+  LOG_INFO("[Test 5] GPU-built slots stay out of the DAG... ");
+  world = (WorldManager *)malloc(sizeof(WorldManager));
+  world_init(world, 2);
+  world_set_source(world, _terrain_source, NULL);
+  world_recenter(world, (vec3){0.5f, 0.5f, 0.5f});
+  _drain_loads(world);
+
+  // the mixed ground layer: its CPU tree is stale once the slot builds on the GPU
+  ChunkSlot *ground = &world->chunks[get_chunk_index(0, -cs, 0)];
+  ground->tree.build_mode = CHUNK_BUILD_GPU;
+  world_build_dag(world);
+  ok = (ground->dag_root == SVO_DAG_NO_ROOT) == chunk_uses_gpu_build(&ground->tree);
+  ok = ok && world->chunks[get_chunk_index(cs, -cs, 0)].dag_root != SVO_DAG_NO_ROOT;
+  ok = ok && svo_dag_get_voxel(&world->dag, world->chunks[get_chunk_index(0, -3 * cs, 0)].dag_root, 1, 2, 3);
+
+  world_destroy(world);
+  free(world);
+
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    return 1;
+  }
+  LOG_INFO("PASSED\n");
+
+  LOG_INFO("[Test 6] Region files stream through the loaders' open files... ");
+  {
+    // every third chunk of region (0, 0, 0) is stored; the other regions the window reaches have no file
+    const char *dir = "/tmp/vkengine_world_regions";
+    mkdir(dir, 0755);
+    char path[512];
+    region_path(path, sizeof(path), dir, 0, 0, 0);
+    ChunkTree *stored[REGION_CHUNKS] = {0};
+    for (int c = 0; c < REGION_CHUNKS; c += 3) {
+      int x = c % REGION_DIM, y = c / REGION_DIM % REGION_DIM, z = c / (REGION_DIM * REGION_DIM);
+      stored[region_local_index(x, y, z)] = (ChunkTree *)malloc(sizeof(ChunkTree));
+      ChunkTree *tree = stored[region_local_index(x, y, z)];
+      chunk_init(tree);
+      chunk_fill_test_chunk(tree, (unsigned)c);
+      chunk_rebuild(tree);
+    }
+    ok = region_write(path, (const ChunkTree *const *)stored);
+
+    world = (WorldManager *)malloc(sizeof(WorldManager));
+    world_init(world, 2);
+    world_set_source(world, world_region_source, (void *)dir);
+    // the second window shares most regions with the first, so its loads hit files the loaders kept open
+    vec3 cameras[2] = {{0.5f, 0.5f, 0.5f}, {(float)cs * 3.0f, 0.5f, (float)cs * -2.0f}};
+    for (uint32_t step = 0; step < 2u && ok; step++) {
+      world_recenter(world, cameras[step]);
+      _drain_loads(world);
+      for (uint32_t i = 0; i < WORLD_CHUNK_COUNT && ok; i++) {
+        const ChunkSlot *slot = &world->chunks[i];
+        int c[3] = {floor_div(slot->global_pos[0], cs), floor_div(slot->global_pos[1], cs),
+                    floor_div(slot->global_pos[2], cs)};
+        bool in_region = c[0] >= 0 && c[0] < REGION_DIM && c[1] >= 0 && c[1] < REGION_DIM && c[2] >= 0 &&
+                         c[2] < REGION_DIM;
+        const ChunkTree *src = in_region ? stored[region_local_index(c[0], c[1], c[2])] : NULL;
+        ok = slot->is_active && !slot->tree.is_dirty;
+        if (ok && src)
+          ok = slot->tree.nodes.length == src->nodes.length &&
+               memcmp(slot->tree.nodes.data, src->nodes.data, src->nodes.length * sizeof(Node)) == 0;
+        else if (ok)
+          ok = slot->tree.fill == CHUNK_FILL_EMPTY;
+      }
+    }
+
+    world_destroy(world);
+    free(world);
+    for (uint32_t i = 0; i < REGION_CHUNKS; i++) {
+      if (stored[i]) {
+        chunk_destroy(stored[i]);
+        free(stored[i]);
+      }
+    }
+    remove(path);
+    rmdir(dir);
+  }
+
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    return 1;
+  }
+  LOG_INFO("PASSED\n");
+  return 0;
+}
+
+// -------------------- Benchmarks --------------------
+
+void world_bench(void) {
+  const uint32_t burst = 512;
+  const uint32_t reps = 8;
+  uint32_t max_threads = job_hardware_threads();
+
+  LOG_INFO("World Bench: streaming burst of %u dirty chunks (CHUNK_SIZE=%u), full rebuild\n", burst,
+           (unsigned)CHUNK_SIZE);
+
+  WorldManager *world = (WorldManager *)malloc(sizeof(WorldManager));
+  double base_ms = 0.0;
+
+  // 1, 2, 4, ... and finally every CPU
+  for (uint32_t threads = 1;; threads *= 2u) {
+    if (threads > max_threads)
+      threads = max_threads;
+    world_init(world, threads);
+
+    uint64_t total_ns = 0;
+    for (uint32_t r = 0; r < reps; r++) {
+      // re-dirty the burst outside the timed region
+      for (uint32_t b = 0; b < burst; b++) {
+        uint32_t slot = (b * 7u) % WORLD_CHUNK_COUNT;
+        chunk_clear(&world->chunks[slot].tree);
+        chunk_fill_test_chunk(&world->chunks[slot].tree, slot);
+      }
+
+      uint64_t t0 = time_now_ns();
+      world_rebuild_dirty(world, 0);
+      total_ns += time_now_ns() - t0;
+    }
+
+    double ms = (double)total_ns / reps / 1e6;
+    if (threads == 1)
+      base_ms = ms;
+    LOG_INFO("  %2u threads: %8.2f ms/burst  %7.1f chunks/s  speedup %.2fx\n", threads, ms, burst / (ms / 1e3),
+             base_ms / ms);
+
+    world_destroy(world);
+    if (threads == max_threads)
+      break;
+  }
+
+  // streaming: walk the camera along +x and time the main-thread part (recenter + budgeted commit) of each frame
+  const uint32_t frames = 256;
+  const int cs = (int)CHUNK_SIZE;
+  world_init(world, 0);
+  world_set_source(world, _test_source, NULL);
+  vec3 camera = {0.5f, 0.5f, 0.5f};
+  world_recenter(world, camera);
+  _drain_loads(world);
+
+  uint64_t frame_total = 0, frame_worst = 0;
+  uint32_t queued = 0;
+  uint64_t walk0 = time_now_ns();
+  for (uint32_t f = 0; f < frames; f++) {
+    if (f % 4u == 0u)
+      camera[0] += (float)cs;
+    uint64_t t0 = time_now_ns();
+    queued += world_recenter(world, camera);
+    world_commit_loads(world, world->commit_budget);
+    uint64_t dt = time_now_ns() - t0;
+    frame_total += dt;
+    frame_worst = dt > frame_worst ? dt : frame_worst;
+  }
+  _drain_loads(world);
+  double walk_s = (double)(time_now_ns() - walk0) / 1e9;
+
+  LOG_INFO("World Bench: streaming walk, %u chunks crossed, %u loader threads, budget %u/frame\n", frames / 4u,
+           (unsigned)WORLD_LOADER_THREADS, world->commit_budget);
+  LOG_INFO("  frame (main thread): avg %.1f us  worst %.1f us;  %u loads, %.1f chunks/s\n",
+           (double)frame_total / frames / 1e3, (double)frame_worst / 1e3, queued, queued / walk_s);
+
+  world_destroy(world);
+
+  // LOD: GPU bytes and upload cost (memcpy into mapped memory, like cmd_buffer_upload) for the whole window
+  world_init(world, 0);
+  world_set_source(world, _terrain_source, NULL);
+  world_recenter(world, (vec3){0.5f, 0.5f, 0.5f});
+  _drain_loads(world);
+
+  size_t full_bytes = 0;
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++)
+    full_bytes += chunk_gpu_bytes(&world->chunks[i].tree, 0);
+  uint8_t *mapped = (uint8_t *)malloc(full_bytes);
+
+  LOG_INFO("World Bench: %u^3 window of terrain, GPU bytes and upload per LOD policy\n", (unsigned)MAP_DIM);
+  const uint32_t steps[] = {0, WORLD_LOD_STEP};
+  for (uint32_t s = 0; s < 2u; s++) {
+    world->lod_step = steps[s];
+    world_select_lods(world);
+
+    size_t bytes = 0;
+    uint64_t t0 = time_now_ns();
+    for (uint32_t r = 0; r < reps; r++) {
+      bytes = 0;
+      for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++) {
+        const ChunkTree *tree = &world->chunks[i].tree;
+        uint32_t count;
+        const Node *nodes = chunk_lod_nodes(tree, tree->lod, &count);
+        memcpy(mapped + bytes, nodes, count * sizeof(Node));
+        bytes += count * sizeof(Node);
+        memcpy(mapped + bytes, chunk_lod_child_indices(tree, tree->lod), count * sizeof(ChildIndex));
+        bytes += count * sizeof(ChildIndex);
+      }
+    }
+    double ms = (double)(time_now_ns() - t0) / reps / 1e6;
+
+    if (steps[s] == 0)
+      LOG_INFO("  full resolution:      %8.2f MiB resident, %7.2f ms full upload\n", bytes / 1048576.0, ms);
+    else
+      LOG_INFO("  LOD step %u chunks:    %8.2f MiB resident, %7.2f ms full upload (%.1fx smaller)\n", steps[s],
+               bytes / 1048576.0, ms, (double)full_bytes / (double)bytes);
+  }
+
+  // DAG: the same window with identical subtrees shared across all chunks
+  world->lod_step = 0;
+  world_select_lods(world);
+  uint64_t t0 = time_now_ns();
+  size_t dag_bytes = world_build_dag(world);
+  double dag_ms = (double)(time_now_ns() - t0) / 1e6;
+  LOG_INFO("  DAG (full resolution): %7.2f MiB resident, %.1fx smaller, %llu -> %zu nodes, built in %.1f ms\n",
+           dag_bytes / 1048576.0, (double)full_bytes / (double)dag_bytes,
+           (unsigned long long)world->dag.nodes_inserted, world->dag.nodes.length, dag_ms);
+
+  free(mapped);
+  world_destroy(world);
+
+  // voxel storage of a generated window: uniform chunks elided vs one bitset per slot (inline before ChunkFill)
+  TerrainParams params;
+  terrain_default_params(&params, 1337u);
+  world_init(world, 0);
+  world_set_source(world, terrain_source, &params);
+  world_recenter(world, (vec3){0.5f, params.base_height, 0.5f});
+  _drain_loads(world);
+
+  uint32_t fills[3] = {0};
+  size_t storage = 0;
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++) {
+    fills[world->chunks[i].tree.fill]++;
+    storage += chunk_storage_bytes(&world->chunks[i].tree);
+  }
+  ChunkPoolStats pool;
+  chunk_pool_stats(&pool);
+
+  size_t slot_bytes = WORLD_CHUNK_COUNT * sizeof(ChunkSlot);
+  size_t before = slot_bytes + WORLD_CHUNK_COUNT * (size_t)BYTES_PER_CHUNK_BITSET;
+  size_t after = slot_bytes + (CHUNK_SPARSE_STORAGE ? storage : pool.bytes);
+  LOG_INFO("World Bench: %u^3 window of generated terrain, voxel storage (%u empty, %u solid, %u mixed chunks)\n",
+           (unsigned)MAP_DIM, fills[CHUNK_FILL_EMPTY], fills[CHUNK_FILL_SOLID], fills[CHUNK_FILL_MIXED]);
+  LOG_INFO("  bitset per slot:  %8.2f MiB resident\n", before / 1048576.0);
+  LOG_INFO("  uniform elided:   %8.2f MiB resident (%.2f MiB in mixed chunks, pool %u/%u bitsets), %.1fx smaller\n",
+           after / 1048576.0, storage / 1048576.0, pool.used, pool.capacity, (double)before / (double)after);
+
+  world_destroy(world);
+  free(world);
+}
+
+// --- Private Functions ---
+
+static void _rebuild_job(void *user, uint32_t index, uint32_t worker) {
+  WorldManager *world = (WorldManager *)user;
+  ChunkTree *tree = &world->chunks[world->rebuild_list[index]].tree;
+
+  // slots are disjoint and each worker owns its scratch, so jobs share nothing
+  chunk_rebuild_with(tree, world->scratch[worker], true);
+  tree->pending_edits = 0;
+}
+
+static ChunkStreamer *_streamer_create(WorldManager *world) {
+  ChunkStreamer *st = (ChunkStreamer *)calloc(1, sizeof(ChunkStreamer));
+  pthread_mutex_init(&st->mutex, NULL);
+  pthread_cond_init(&st->wake, NULL);
+  vec_init(&st->queue, sizeof(LoadRequest), NULL);
+  vec_init(&st->done, sizeof(LoadResult), NULL);
+  vec_init(&st->free_trees, sizeof(ChunkTree *), NULL);
+
+  for (uint32_t i = 0; i < WORLD_LOADER_THREADS; i++) {
+    LoaderThread *t = &st->threads[i];
+    t->world = world;
+    t->st = st;
+    t->scratch = chunk_scratch_create();
+    if (pthread_create(&t->handle, NULL, _loader_main, t) != 0) {
+      LOG_ERROR("Failed to create chunk loader %u", i);
+      abort();
+    }
+  }
+
+  return st;
+}
+
+static void _streamer_destroy(ChunkStreamer *st) {
+  if (!st)
+    return;
+
+  pthread_mutex_lock(&st->mutex);
+  st->quit = true;
+  pthread_cond_broadcast(&st->wake);
+  pthread_mutex_unlock(&st->mutex);
+
+  for (uint32_t i = 0; i < WORLD_LOADER_THREADS; i++) {
+    LoaderThread *t = &st->threads[i];
+    pthread_join(t->handle, NULL);
+    chunk_scratch_destroy(t->scratch);
+    for (uint32_t r = 0; r < WORLD_OPEN_REGIONS; r++) {
+      if (t->regions[r].last_use)
+        region_close(&t->regions[r].file);
+    }
+  }
+
+  for (uint32_t i = 0; i < st->done.length; i++)
+    vec_push(&st->free_trees, &VEC_AT(&st->done, i, LoadResult)->tree);
+  for (uint32_t i = 0; i < st->free_trees.length; i++) {
+    ChunkTree *tree = *VEC_AT(&st->free_trees, i, ChunkTree *);
+    chunk_destroy(tree);
+    free(tree);
+  }
+
+  vec_destroy(&st->queue);
+  vec_destroy(&st->done);
+  vec_destroy(&st->free_trees);
+  pthread_mutex_destroy(&st->mutex);
+  pthread_cond_destroy(&st->wake);
+  free(st);
+}
+
+static void *_loader_main(void *arg) {
+  LoaderThread *t = (LoaderThread *)arg;
+  ChunkStreamer *st = t->st;
+  const ChunkSlot *slots = t->world->chunks;
+  s_loader = t;
+
+  pthread_mutex_lock(&st->mutex);
+  for (;;) {
+    while (!st->quit && (st->queue.length == 0 || st->staged >= WORLD_MAX_STAGED))
+      pthread_cond_wait(&st->wake, &st->mutex);
+    if (st->quit)
+      break;
+
+    LoadRequest req = _heap_pop(&st->queue);
+    // retargeted before anyone started on it
+    if (req.ticket != slots[req.slot].load_ticket)
+      continue;
+
+    st->staged++;
+    ChunkTree *tree = NULL;
+    if (st->free_trees.length > 0)
+      tree = ((ChunkTree **)st->free_trees.data)[--st->free_trees.length];
+    ChunkSourceFn source = st->source;
+    void *user = st->user;
+    pthread_mutex_unlock(&st->mutex);
+
+    if (!tree) {
+      tree = (ChunkTree *)malloc(sizeof(ChunkTree));
+      chunk_init(tree);
+    }
+
+    chunk_clear(tree);
+    tree->build_mode = req.build_mode;
+    bool loaded = source && source(user, req.cx, req.cy, req.cz, tree);
+    if (!loaded)
+      chunk_clear(tree);
+
+    // region loads arrive with their tree; everything else is built here, off the main thread
+    if (!loaded || tree->is_dirty) {
+      tree->is_dirty = true;
+      chunk_rebuild_with(tree, t->scratch, false);
+    }
+    tree->pending_edits = 0;
+
+    LoadResult result = {.slot = req.slot, .ticket = req.ticket, .tree = tree};
+    pthread_mutex_lock(&st->mutex);
+    vec_push(&st->done, &result);
+  }
+  pthread_mutex_unlock(&st->mutex);
+  return NULL;
+}
+
+// A request order of nearest first walks the window in shells, so a few open files cover most consecutive loads.
+// A missing file is not remembered: it may still be written.
+static const RegionFile *_loader_region(LoaderThread *t, const char *path) {
+  OpenRegion *victim = &t->regions[0];
+  for (uint32_t r = 0; r < WORLD_OPEN_REGIONS; r++) {
+    OpenRegion *open = &t->regions[r];
+    if (open->last_use && strcmp(open->path, path) == 0) {
+      open->last_use = ++t->region_clock;
+      return &open->file;
+    }
+    if (open->last_use < victim->last_use)
+      victim = open;
+  }
+
+  if (victim->last_use)
+    region_close(&victim->file);
+  victim->last_use = 0;
+  if (!region_open(&victim->file, path))
+    return NULL;
+  snprintf(victim->path, sizeof(victim->path), "%s", path);
+  victim->last_use = ++t->region_clock;
+  return &victim->file;
+}
+
+static void _heap_push(Vector *heap, const LoadRequest *req) {
+  vec_push(heap, (void *)req);
+  LoadRequest *h = (LoadRequest *)heap->data;
+  uint32_t i = (uint32_t)heap->length - 1u;
+  while (i > 0) {
+    uint32_t parent = (i - 1u) / 2u;
+    if (h[parent].priority <= h[i].priority)
+      break;
+    LoadRequest tmp = h[parent];
+    h[parent] = h[i];
+    h[i] = tmp;
+    i = parent;
+  }
+}
+
+static LoadRequest _heap_pop(Vector *heap) {
+  LoadRequest *h = (LoadRequest *)heap->data;
+  LoadRequest top = h[0];
+  h[0] = h[--heap->length];
+  _heap_sift_down(h, (uint32_t)heap->length, 0);
+  return top;
+}
+
+static void _heap_sift_down(LoadRequest *h, uint32_t n, uint32_t i) {
+  for (;;) {
+    uint32_t best = i;
+    uint32_t l = 2u * i + 1u;
+    uint32_t r = l + 1u;
+    if (l < n && h[l].priority < h[best].priority)
+      best = l;
+    if (r < n && h[r].priority < h[best].priority)
+      best = r;
+    if (best == i)
+      return;
+    LoadRequest tmp = h[best];
+    h[best] = h[i];
+    h[i] = tmp;
+    i = best;
+  }
+}
+
+static int64_t _chunk_distance2(const ivec3 center, int cx, int cy, int cz) {
+  int64_t dx = cx - center[0], dy = cy - center[1], dz = cz - center[2];
+  return dx * dx + dy * dy + dz * dz;
+}
+
+// Ground below y = 0 and one marker voxel whose position encodes the chunk coordinate.
+static bool _test_source(void *user, int cx, int cy, int cz, ChunkTree *out) {
+  (void)user;
+  int cs = (int)CHUNK_SIZE;
+  if (cy < 0)
+    chunk_fill_box(out, (VoxelCoord){0, 0, 0}, (VoxelCoord){cs - 1, cs / 2, cs - 1}, true);
+  chunk_set_voxel(out, wrap(cx * 7, cs), cs - 1 - wrap(cy, cs / 4), wrap(cz * 3, cs), true);
+  return true;
+}
+
+// Solid below y = -CHUNK_SIZE, chunk_fill_test_chunk ground in the chunk layer just below 0, air above.
+static bool _terrain_source(void *user, int cx, int cy, int cz, ChunkTree *out) {
+  (void)user;
+  int cs = (int)CHUNK_SIZE;
+  if (cy >= 0)
+    return false;
+  if (cy < -1)
+    chunk_fill_box(out, (VoxelCoord){0, 0, 0}, (VoxelCoord){cs - 1, cs - 1, cs - 1}, true);
+  else
+    chunk_fill_test_chunk(out, (unsigned int)(cx * 73856093) ^ (unsigned int)(cz * 83492791));
+  return true;
+}
+
+// Every slot is committed, holds the chunk of the window that wraps onto it, and that chunk's contents.
+static bool _check_window(WorldManager *world) {
+  int cs = (int)CHUNK_SIZE;
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++) {
+    const ChunkSlot *slot = &world->chunks[i];
+    if (!slot->is_active || slot->is_loading || slot->tree.is_dirty)
+      return false;
+
+    int c[3];
+    for (int a = 0; a < 3; a++) {
+      c[a] = floor_div(slot->global_pos[a], cs);
+      int lo = world->center_chunk[a] - MAP_DIM / 2;
+      if (c[a] < lo || c[a] >= lo + MAP_DIM)
+        return false;
+    }
+    if (get_chunk_index(slot->global_pos[0], slot->global_pos[1], slot->global_pos[2]) != (int)i)
+      return false;
+
+    if (!chunk_get_voxel(&slot->tree, wrap(c[0] * 7, cs), cs - 1 - wrap(c[1], cs / 4), wrap(c[2] * 3, cs)))
+      return false;
+    if (chunk_get_voxel(&slot->tree, cs / 2, 0, cs / 2) != (c[1] < 0))
+      return false;
+  }
+  return true;
+}
+
+static void _drain_loads(WorldManager *world) {
+  while (world_pending_loads(world) > 0) {
+    if (world_commit_loads(world, WORLD_COMMIT_BUDGET) == 0)
+      sched_yield();
+  }
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "cglm/types.h"
+#include "chunk.h"
+#include "chunk_gpu.h"
+#include "chunk_mesh.h"
+#include "jobs.h"
+#include "svo_dag.h"
+#include <stdint.h>
+
+// -----------------------------------------------------------------------------
+// CONSTANTS & CONFIGURATION
+// -----------------------------------------------------------------------------
+
+// The "Active Window" around the player.
+// A 16x16x16 grid means we track 4,096 chunks total.
+// This acts as a Ring Buffer (Toroidal).
+#define MAP_DIM 16
+#define WORLD_CHUNK_COUNT (MAP_DIM * MAP_DIM * MAP_DIM)
+
+// Streaming: background loader threads, finished chunks committed on the main thread.
+#define WORLD_LOADER_THREADS 2
+#define WORLD_MAX_STAGED 64     // chunks being loaded or waiting for a commit (bounds staging memory)
+#define WORLD_OPEN_REGIONS 8    // region files each loader thread keeps mapped for world_region_source
+#define WORLD_COMMIT_BUDGET 8   // default chunks committed per world_update
+#define WORLD_LOD_STEP 3        // default ring width, in chunks, of each LOD band around the center
+
+// Fills `out` (cleared, voxel bits only) with chunk (cx, cy, cz), in chunk coordinates.
+// Called on loader threads, so it must be thread safe. Returning false leaves the chunk empty.
+typedef bool (*ChunkSourceFn)(void *user, int cx, int cy, int cz, ChunkTree *out);
+
+typedef struct ChunkStreamer ChunkStreamer;
+
+// World-level 64-tree over the window (world_occupancy.c), indexed by window cell: cell (0,0,0) is the chunk at
+// `origin`, whatever slot it wraps onto. Two dense levels for MAP_DIM = 16: nodes[0] has a bit per 4x4x4 block of
+// chunks, nodes[1 + b] a bit per chunk of block b (bit order of the chunk trees' child slots).
+// A chunk counts as occupied when its slot holds it (not loading) and its rebuilt root mask is non-zero.
+#define WORLD_OCCUPANCY_NODES (1 + WORLD_CHUNK_COUNT / 64)
+
+typedef struct WorldOccupancy {
+  uint64_t nodes[WORLD_OCCUPANCY_NODES];
+  ivec3 origin;     // chunk coordinates of window cell (0,0,0)
+  bool changed;     // the GPU copy is out of date
+  bool has_buffer;  // buffer is created by the first world_upload
+  ResHandle buffer; // nodes[] as uploaded (shaders/world_occupancy.glsl)
+} WorldOccupancy;
+
+typedef struct WorldRayHit {
+  bool hit;
+  ivec3 voxel;  // global voxel coordinates of the solid voxel that was hit
+  ivec3 normal; // face the ray entered through (see ChunkRayHit)
+  float t;
+  uint32_t slot; // slot holding the voxel
+} WorldRayHit;
+
+typedef struct ChunkSlot {
+  ChunkTree tree;   // The actual voxel data and SVO logic
+  ivec3 global_pos; // Current world position (e.g., 64, 0, -128)
+  bool is_active;   // Is this slot currently used?
+  bool is_loading;  // global_pos is requested, the old contents are stale until the load is committed
+  uint32_t load_ticket; // bumped whenever the slot is retargeted; older loads for it are dropped
+  uint32_t dag_root;    // root of this chunk in WorldManager.dag after world_build_dag, SVO_DAG_NO_ROOT if left out
+} ChunkSlot;
+
+typedef struct WorldManager {
+  // A 3D array of slots: [MAP_DIM][MAP_DIM][MAP_DIM]
+  ChunkSlot *chunks;
+
+  // Total size of the world in voxels (e.g., 16 * 64 = 1024)
+  int world_voxel_dim;
+
+  // Parallel rebuild: one scratch arena per job worker, indexed by the worker id.
+  JobSystem *jobs;
+  ChunkScratch **scratch;
+  uint32_t *rebuild_list; // slot indices picked by the last world_rebuild_dirty, ascending
+  uint32_t rebuild_count;
+
+  // Window position: slots hold chunks [center - MAP_DIM/2, center + MAP_DIM/2) on every axis.
+  ivec3 center_chunk;
+  bool has_center; // false until the first world_recenter; the window is static (no streaming) until then
+  uint32_t commit_budget;
+  ChunkStreamer *streamer;
+
+  // LOD band = (Chebyshev chunk distance to the center) / lod_step, clamped to CHUNK_LOD_COUNT; 0 = always full.
+  uint32_t lod_step;
+
+  // Deduplicated copy of every active chunk's tree (identical subtrees stored once), see world_build_dag.
+  SvoDag dag;
+
+  // Which chunks of the window are worth visiting; kept current by rebuilds, commits and recenters.
+  WorldOccupancy occupancy;
+
+  // Builds the slots in CHUNK_BUILD_GPU mode, created by the first world_upload that needs it.
+  // A slot's build_mode survives streaming: loads are rebuilt the way the slot they go to is.
+  ChunkGpuBuilder *gpu_builder;
+} WorldManager;
+
+// PUBLIC FUNCTIONS
+void world_init(WorldManager *world, uint32_t worker_count); // worker_count 0 = one per CPU
+void world_destroy(WorldManager *world);
+
+// Maps any global voxel coordinate to the correct Chunk Index in the ring buffer
+int get_chunk_index(int gx, int gy, int gz);
+// Once streaming, edits to a slot that does not (yet) hold the voxel's chunk are dropped.
+void map_insert_voxel(WorldManager *world, int x, int y, int z, bool active);
+// Slot holding chunk (cx, cy, cz), -1 if none: the static window (before the first recenter) is chunks [0, MAP_DIM)
+// per axis, afterwards only a slot that holds the chunk (active, not loading) counts. For bulk writers, which clip
+// where map_insert_voxel wraps.
+int world_chunk_slot(const WorldManager *world, int cx, int cy, int cz);
+
+// Streaming. The source is only read by loader threads; set it before the first world_recenter.
+void world_set_source(WorldManager *world, ChunkSourceFn source, void *user);
+// Moves the window so the camera's chunk is at its center. Only the slots whose chunk changed (the newly
+// exposed slabs) are retargeted and queued, nearest first. Returns the number of slots queued.
+uint32_t world_recenter(WorldManager *world, const vec3 camera_pos);
+// Moves up to `budget` finished loads into their slots. Loads retargeted in the meantime are dropped.
+uint32_t world_commit_loads(WorldManager *world, uint32_t budget);
+// Loads queued, in flight or waiting for a commit.
+uint32_t world_pending_loads(WorldManager *world);
+// Picks every active slot's LOD from its distance to the window center (full resolution before the first recenter).
+void world_select_lods(WorldManager *world);
+// Rebuilds world->dag from every active, rebuilt slot and sets their dag_root. GPU-built mixed slots have no CPU tree
+// and are left out (SVO_DAG_NO_ROOT), like inactive and dirty ones. Returns the pool size in bytes.
+size_t world_build_dag(WorldManager *world);
+// Meshes one section of a slot for the raster path, culling its borders against the neighbouring slots (chunks
+// outside the window or still loading count as empty).
+void world_mesh_slot(WorldManager *world, uint32_t slot_index, uint32_t section, ChunkMesh *mesh);
+// ChunkSourceFn reading region files; user is the directory (const char *). Loader threads keep the last
+// WORLD_OPEN_REGIONS files they read from open (until world_destroy), so a file rewritten meanwhile may be read as
+// it was when first opened.
+bool world_region_source(void *user, int cx, int cy, int cz, ChunkTree *out);
+
+// Rebuilds every dirty slot with at least `threshold` pending edits on the job workers.
+// Returns once all of them are done (join point), with the number of rebuilt slots.
+uint32_t world_rebuild_dirty(WorldManager *world, uint32_t threshold);
+void world_upload(WorldManager *world, M_GPU *gpu, M_Resource *rm, CmdBuffer cmd);
+// Per-frame step: commit up to commit_budget loads, parallel rebuild, join, LOD selection, then serial uploads on
+// the caller's command buffer.
+void world_update(WorldManager *world, M_GPU *gpu, M_Resource *rm, CmdBuffer cmd, uint32_t threshold);
+
+// Occupancy (world_occupancy.c). Rebuilds, commits and recenters keep it current on their own; call this after
+// rebuilding slots directly (chunk_rebuild on a slot's tree).
+void world_update_occupancy(WorldManager *world);
+void world_occupancy_set_slot(WorldManager *world, uint32_t slot_index); // refresh one slot's bit
+bool world_chunk_occupied(const WorldManager *world, int cx, int cy, int cz); // false outside the window
+// Ray against every chunk of the window, in global voxel units (dir as in chunk_raycast). Empty blocks of chunks
+// and empty chunks are crossed in one step each; only occupied chunks are traced.
+bool world_raycast(const WorldManager *world, const vec3 origin, const vec3 dir, float max_t, WorldRayHit *out);
+void world_upload_occupancy(WorldManager *world, M_GPU *gpu, M_Resource *rm, CmdBuffer cmd); // if it changed
+
+// tests
+int world_test(void);
+void world_bench(void);
+int world_occupancy_test(void);
+void world_occupancy_bench(void);
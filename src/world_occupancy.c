@@ -0,0 +1,438 @@
+/* world_occupancy.c */
+#include "chunk_ray.h"
+#include "shaders/world_occupancy.glsl"
+#include "world.h"
+
+#include <math.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(MAP_DIM == WORLD_OCCUPANCY_BLOCK_DIM * WORLD_OCCUPANCY_BLOCK_DIM, "two levels cover the window");
+
+// --- Private Prototypes ---
+static inline uint32_t _cell_bit(int x, int y, int z);
+static bool _slot_holds_chunk(const WorldManager *world, uint32_t slot_index);
+static bool _slot_occupied(const WorldManager *world, uint32_t slot_index);
+static void _slot_cell(const WorldManager *world, uint32_t slot_index, int cell[3]);
+static bool _raycast(const WorldManager *world, const vec3 origin, const vec3 dir, float max_t, bool skip,
+                     WorldRayHit *out, uint32_t *visits);
+static bool _reference_raycast(const WorldManager *world, const vec3 origin, const vec3 dir, float max_t,
+                               WorldRayHit *out);
+static bool _check_occupancy(const WorldManager *world);
+static void _random_ray(const WorldManager *world, unsigned int *seed, vec3 o, vec3 d);
+static bool _sparse_source(void *user, int cx, int cy, int cz, ChunkTree *out);
+static void _drain(WorldManager *world);
+
+void world_update_occupancy(WorldManager *world) {
+  WorldOccupancy *occ = &world->occupancy;
+
+  // before the first recenter slot i holds chunk i, afterwards the window starts half a window below the center
+  for (int a = 0; a < 3; a++)
+    occ->origin[a] = world->has_center ? world->center_chunk[a] - MAP_DIM / 2 : 0;
+
+  memset(occ->nodes, 0, sizeof(occ->nodes));
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++) {
+    if (!_slot_occupied(world, i))
+      continue;
+    int c[3];
+    _slot_cell(world, i, c);
+    uint32_t block = _cell_bit(c[0] >> 2, c[1] >> 2, c[2] >> 2);
+    occ->nodes[0] |= 1ull << block;
+    occ->nodes[1 + block] |= 1ull << _cell_bit(c[0] & 3, c[1] & 3, c[2] & 3);
+  }
+  occ->changed = true;
+}
+
+void world_occupancy_set_slot(WorldManager *world, uint32_t slot_index) {
+  WorldOccupancy *occ = &world->occupancy;
+  int c[3];
+  _slot_cell(world, slot_index, c);
+  uint32_t block = _cell_bit(c[0] >> 2, c[1] >> 2, c[2] >> 2);
+  uint64_t bit = 1ull << _cell_bit(c[0] & 3, c[1] & 3, c[2] & 3);
+
+  uint64_t leaf = occ->nodes[1 + block];
+  leaf = _slot_occupied(world, slot_index) ? leaf | bit : leaf & ~bit;
+  if (leaf == occ->nodes[1 + block])
+    return;
+
+  occ->nodes[1 + block] = leaf;
+  occ->nodes[0] = leaf ? occ->nodes[0] | (1ull << block) : occ->nodes[0] & ~(1ull << block);
+  occ->changed = true;
+}
+
+bool world_chunk_occupied(const WorldManager *world, int cx, int cy, int cz) {
+  const WorldOccupancy *occ = &world->occupancy;
+  int c[3] = {cx - occ->origin[0], cy - occ->origin[1], cz - occ->origin[2]};
+  for (int a = 0; a < 3; a++)
+    if (c[a] < 0 || c[a] >= MAP_DIM)
+      return false;
+
+  uint32_t block = _cell_bit(c[0] >> 2, c[1] >> 2, c[2] >> 2);
+  return (occ->nodes[1 + block] >> _cell_bit(c[0] & 3, c[1] & 3, c[2] & 3)) & 1ull;
+}
+
+bool world_raycast(const WorldManager *world, const vec3 origin, const vec3 dir, float max_t, WorldRayHit *out) {
+  return _raycast(world, origin, dir, max_t, true, out, NULL);
+}
+
+void world_upload_occupancy(WorldManager *world, M_GPU *gpu, M_Resource *rm, CmdBuffer cmd) {
+  WorldOccupancy *occ = &world->occupancy;
+  if (!occ->changed)
+    return;
+
+  if (!occ->has_buffer) {
+    RGBufferInfo info = {
+        .name = "WorldOccupancy",
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .capacity = (u32)sizeof(occ->nodes),
+        .mem = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    };
+    occ->buffer = rm_create_buffer(rm, &info);
+    occ->has_buffer = true;
+  }
+
+  // the raycast shaders of the last frame may still read the old map
+  cmd_sync_buffer(cmd.buffer, rm, occ->buffer, STATE_TRANSFER, ACCESS_WRITE);
+  cmd_buffer_upload(cmd, gpu, rm, occ->buffer, occ->nodes, (u32)sizeof(occ->nodes));
+  cmd_sync_buffer(cmd.buffer, rm, occ->buffer, STATE_SHADER, ACCESS_READ);
+  occ->changed = false;
+}
+
+// -------------------- Tests --------------------
+
+int world_occupancy_test(void) {
+  WorldManager *world = (WorldManager *)malloc(sizeof(WorldManager));
+  world_init(world, 2);
+  world_set_source(world, _sparse_source, NULL);
+  LOG_INFO("World Occupancy Test: %u^3 window, %u nodes\n", (unsigned)MAP_DIM, (unsigned)WORLD_OCCUPANCY_NODES);
+
+  int cs = (int)CHUNK_SIZE;
+  bool ok = true;
+
+  // Test 1: a streamed-in window, then one recenter: retargeted slots drop out until their loads land
+  LOG_INFO("[Test 1] Occupancy follows loads and recenters... ");
+  world_recenter(world, (vec3){0.5f, 0.5f, 0.5f});
+  ok = world->occupancy.nodes[0] == 0ull;
+  _drain(world);
+  ok = ok && world->occupancy.nodes[0] != 0ull && _check_occupancy(world);
+
+  world_recenter(world, (vec3){(float)cs + 0.5f, 0.5f, 0.5f});
+  int exposed = world->center_chunk[0] + MAP_DIM / 2 - 1;
+  for (int cy = -MAP_DIM / 2; cy < MAP_DIM / 2 && ok; cy++)
+    for (int cz = -MAP_DIM / 2; cz < MAP_DIM / 2 && ok; cz++)
+      ok = !world_chunk_occupied(world, exposed, cy, cz);
+  ok = ok && _check_occupancy(world);
+  _drain(world);
+  ok = ok && _check_occupancy(world);
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 2: rebuilds flip single chunks (and their block) on and off
+  LOG_INFO("[Test 2] Rebuilds update single chunks... ");
+  {
+    // a chunk of open air, and the occupied chunk of its block if there is one
+    int air[3] = {world->center_chunk[0], MAP_DIM / 2 - 1, world->center_chunk[2]};
+    int gx = air[0] * cs, gy = air[1] * cs, gz = air[2] * cs;
+    ok = !world_chunk_occupied(world, air[0], air[1], air[2]);
+    map_insert_voxel(world, gx + 3, gy + 5, gz + 7, true);
+    world_rebuild_dirty(world, 0);
+    ok = ok && world_chunk_occupied(world, air[0], air[1], air[2]) && _check_occupancy(world);
+    map_insert_voxel(world, gx + 3, gy + 5, gz + 7, false);
+    world_rebuild_dirty(world, 0);
+    ok = ok && !world_chunk_occupied(world, air[0], air[1], air[2]) && _check_occupancy(world);
+  }
+  if (!ok) {
+    LOG_INFO("FAILED\n");
+    goto done;
+  }
+  LOG_INFO("PASSED\n");
+
+  // Test 3: rays through the window hit what tracing every chunk hits
+  LOG_INFO("[Test 3] World rays vs every chunk... ");
+  {
+    unsigned int seed = 2024u;
+    uint32_t hits = 0, rays = 300u;
+    for (uint32_t r = 0; r < rays && ok; r++) {
+      vec3 o, d;
+      _random_ray(world, &seed, o, d);
+      WorldRayHit a, b;
+      bool ha = world_raycast(world, o, d, 1e30f, &a);
+      bool hb = _reference_raycast(world, o, d, 1e30f, &b);
+      ok = ha == hb && (!ha || (memcmp(a.voxel, b.voxel, sizeof(ivec3)) == 0 &&
+                                memcmp(a.normal, b.normal, sizeof(ivec3)) == 0 && a.slot == b.slot));
+      hits += ha ? 1u : 0u;
+    }
+    if (ok)
+      LOG_INFO("PASSED (%u/%u hits)\n", hits, rays);
+    else
+      LOG_INFO("FAILED\n");
+  }
+
+done:
+  world_destroy(world);
+  free(world);
+  return ok ? 0 : 1;
+}
+
+// -------------------- Benchmarks --------------------
+
+void world_occupancy_bench(void) {
+  WorldManager *world = (WorldManager *)malloc(sizeof(WorldManager));
+  world_init(world, 0);
+  world_set_source(world, _sparse_source, NULL);
+  world_recenter(world, (vec3){0.5f, 0.5f, 0.5f});
+  _drain(world);
+
+  uint32_t occupied = 0;
+  for (uint32_t b = 0; b < WORLD_CHUNK_COUNT / 64; b++)
+    occupied += (uint32_t)__builtin_popcountll(world->occupancy.nodes[1 + b]);
+  LOG_INFO("World Occupancy Bench: %u^3 window, %u occupied chunks\n", (unsigned)MAP_DIM, occupied);
+
+  enum { N = 1 << 14 };
+  const char *names[] = {"every chunk", "occupancy"};
+  for (uint32_t skip = 0; skip < 2u; skip++) {
+    unsigned int seed = 77u;
+    uint32_t visits = 0, hits = 0;
+    uint64_t t0 = time_now_ns();
+    for (uint32_t i = 0; i < N; i++) {
+      vec3 o, d;
+      _random_ray(world, &seed, o, d);
+      WorldRayHit h;
+      hits += _raycast(world, o, d, 1e30f, skip != 0u, &h, &visits) ? 1u : 0u;
+    }
+    uint64_t t1 = time_now_ns();
+    LOG_INFO("  %-11s: %6.2f cells/ray, %7.3f Mrays/s (%u%% hit)\n", names[skip], (double)visits / N,
+             N / ((double)(t1 - t0) / 1e9) / 1e6, hits * 100u / N);
+  }
+
+  world_destroy(world);
+  free(world);
+}
+
+// --- Private Functions ---
+
+// Child slot of (x, y, z), each 0..3, in the chunk trees' bit order (x0 y0 z0 x1 y1 z1).
+static inline uint32_t _cell_bit(int x, int y, int z) {
+  uint32_t ux = (uint32_t)x, uy = (uint32_t)y, uz = (uint32_t)z;
+  return (ux & 1u) | ((uy & 1u) << 1) | ((uz & 1u) << 2) | ((ux & 2u) << 2) | ((uy & 2u) << 3) | ((uz & 2u) << 4);
+}
+
+// Once streaming, a slot that is loading (or was never filled) holds nothing of the window yet.
+static bool _slot_holds_chunk(const WorldManager *world, uint32_t slot_index) {
+  const ChunkSlot *slot = &world->chunks[slot_index];
+  return !world->has_center || (slot->is_active && !slot->is_loading);
+}
+
+static bool _slot_occupied(const WorldManager *world, uint32_t slot_index) {
+  if (!_slot_holds_chunk(world, slot_index))
+    return false;
+  const ChunkTree *tree = &world->chunks[slot_index].tree;
+  // a GPU-built tree never reaches the CPU: a mixed chunk may hold anything
+  if (chunk_uses_gpu_build(tree))
+    return true;
+  return tree->nodes.length > 0 && ((const Node *)tree->nodes.data)[0].mask != 0ull;
+}
+
+// Window cell of the chunk a slot is for: slots wrap, cells count from the window origin.
+static void _slot_cell(const WorldManager *world, uint32_t slot_index, int cell[3]) {
+  int l[3] = {(int)(slot_index % MAP_DIM), (int)(slot_index / MAP_DIM % MAP_DIM),
+              (int)(slot_index / (MAP_DIM * MAP_DIM))};
+  for (int a = 0; a < 3; a++)
+    cell[a] = wrap(l[a] - world->occupancy.origin[a], MAP_DIM);
+}
+
+// DDA over window cells in voxel units: an empty block of 4^3 cells or an empty chunk is one step, an occupied
+// chunk is traced with chunk_raycast. skip = false visits every cell the ray crosses (the baseline).
+static bool _raycast(const WorldManager *world, const vec3 origin, const vec3 dir, float max_t, bool skip,
+                     WorldRayHit *out, uint32_t *visits) {
+  const WorldOccupancy *occ = &world->occupancy;
+  int cs = (int)CHUNK_SIZE;
+  float span = (float)(MAP_DIM * cs);
+  memset(out, 0, sizeof(*out));
+
+  // relative to the window origin, so the floats stay small however far the window has moved
+  float o[3], inv[3];
+  for (int a = 0; a < 3; a++) {
+    o[a] = origin[a] - (float)(occ->origin[a] * cs);
+    inv[a] = dir[a] != 0.0f ? 1.0f / dir[a] : INFINITY;
+  }
+
+  float t = 0.0f, t_end = max_t;
+  int axis = -1;
+  for (int a = 0; a < 3; a++) {
+    if (dir[a] == 0.0f) {
+      if (o[a] < 0.0f || o[a] >= span)
+        return false;
+      continue;
+    }
+    float ta = (0.0f - o[a]) * inv[a], tb = (span - o[a]) * inv[a];
+    float near = fminf(ta, tb), far = fmaxf(ta, tb);
+    if (near > t) {
+      t = near;
+      axis = a;
+    }
+    t_end = fminf(t_end, far);
+  }
+  if (t > t_end)
+    return false;
+
+  int c[3];
+  for (int a = 0; a < 3; a++) {
+    int v = (int)floorf((o[a] + dir[a] * t) / (float)cs);
+    c[a] = v < 0 ? 0 : (v > MAP_DIM - 1 ? MAP_DIM - 1 : v);
+  }
+  if (axis >= 0)
+    c[axis] = dir[axis] > 0.0f ? 0 : MAP_DIM - 1;
+
+  for (;;) {
+    if (visits)
+      (*visits)++;
+
+    uint32_t block = _cell_bit(c[0] >> 2, c[1] >> 2, c[2] >> 2);
+    int size = WORLD_OCCUPANCY_BLOCK_DIM;
+    if (!skip || ((occ->nodes[0] >> block) & 1ull)) {
+      size = 1;
+      bool occupied = !skip || ((occ->nodes[1 + block] >> _cell_bit(c[0] & 3, c[1] & 3, c[2] & 3)) & 1ull);
+      int chunk[3] = {occ->origin[0] + c[0], occ->origin[1] + c[1], occ->origin[2] + c[2]};
+      uint32_t slot = (uint32_t)get_chunk_index(chunk[0] * cs, chunk[1] * cs, chunk[2] * cs);
+
+      if (occupied && _slot_holds_chunk(world, slot)) {
+        vec3 local = {o[0] - (float)(c[0] * cs), o[1] - (float)(c[1] * cs), o[2] - (float)(c[2] * cs)};
+        ChunkRayHit h;
+        if (chunk_raycast(&world->chunks[slot].tree, local, dir, t_end, &h)) {
+          out->hit = true;
+          for (int a = 0; a < 3; a++) {
+            out->voxel[a] = chunk[a] * cs + h.voxel[a];
+            out->normal[a] = h.normal[a];
+          }
+          out->t = h.t;
+          out->slot = slot;
+          return true;
+        }
+      }
+    }
+
+    // leave the empty block, or the chunk that was empty or missed
+    int lo[3], hi[3];
+    float t_next = INFINITY;
+    int exit_axis = -1;
+    for (int a = 0; a < 3; a++) {
+      lo[a] = c[a] & ~(size - 1);
+      hi[a] = lo[a] + size;
+      if (dir[a] == 0.0f)
+        continue;
+      float edge = (float)((dir[a] > 0.0f ? hi[a] : lo[a]) * cs);
+      float ta = (edge - o[a]) * inv[a];
+      if (ta < t_next) {
+        t_next = ta;
+        exit_axis = a;
+      }
+    }
+    if (exit_axis < 0 || t_next > t_end)
+      return false;
+
+    int n[3];
+    for (int a = 0; a < 3; a++) {
+      if (a == exit_axis) {
+        n[a] = dir[a] > 0.0f ? hi[a] : lo[a] - 1;
+        continue;
+      }
+      int v = (int)floorf((o[a] + dir[a] * t_next) / (float)cs);
+      n[a] = v < lo[a] ? lo[a] : (v > hi[a] - 1 ? hi[a] - 1 : v);
+    }
+    if (n[exit_axis] < 0 || n[exit_axis] >= MAP_DIM)
+      return false;
+
+    memcpy(c, n, sizeof(c));
+    t = t_next;
+  }
+}
+
+// Every slot that holds its chunk, traced in full; the nearest hit wins.
+static bool _reference_raycast(const WorldManager *world, const vec3 origin, const vec3 dir, float max_t,
+                               WorldRayHit *out) {
+  const WorldOccupancy *occ = &world->occupancy;
+  int cs = (int)CHUNK_SIZE;
+  memset(out, 0, sizeof(*out));
+  out->t = INFINITY;
+
+  for (uint32_t i = 0; i < WORLD_CHUNK_COUNT; i++) {
+    if (!_slot_holds_chunk(world, i))
+      continue;
+    int c[3];
+    _slot_cell(world, i, c);
+    int chunk[3] = {occ->origin[0] + c[0], occ->origin[1] + c[1], occ->origin[2] + c[2]};
+    vec3 local = {origin[0] - (float)(chunk[0] * cs), origin[1] - (float)(chunk[1] * cs),
+                  origin[2] - (float)(chunk[2] * cs)};
+
+    ChunkRayHit h;
+    if (!chunk_raycast(&world->chunks[i].tree, local, dir, max_t, &h) || h.t >= out->t)
+      continue;
+    out->hit = true;
+    for (int a = 0; a < 3; a++) {
+      out->voxel[a] = chunk[a] * cs + h.voxel[a];
+      out->normal[a] = h.normal[a];
+    }
+    out->t = h.t;
+    out->slot = i;
+  }
+  return out->hit;
+}
+
+// Every window cell against the slot it wraps onto, and every block bit against its leaf.
+static bool _check_occupancy(const WorldManager *world) {
+  const WorldOccupancy *occ = &world->occupancy;
+  int cs = (int)CHUNK_SIZE;
+  for (int z = 0; z < MAP_DIM; z++)
+    for (int y = 0; y < MAP_DIM; y++)
+      for (int x = 0; x < MAP_DIM; x++) {
+        int chunk[3] = {occ->origin[0] + x, occ->origin[1] + y, occ->origin[2] + z};
+        uint32_t slot = (uint32_t)get_chunk_index(chunk[0] * cs, chunk[1] * cs, chunk[2] * cs);
+        if (world_chunk_occupied(world, chunk[0], chunk[1], chunk[2]) != _slot_occupied(world, slot))
+          return false;
+      }
+
+  for (uint32_t b = 0; b < WORLD_CHUNK_COUNT / 64; b++)
+    if (((occ->nodes[0] >> b) & 1ull) != (occ->nodes[1 + b] != 0ull))
+      return false;
+  return true;
+}
+
+// From anywhere in the window towards anywhere in it, long enough to cross many chunks.
+static void _random_ray(const WorldManager *world, unsigned int *seed, vec3 o, vec3 d) {
+  float span = (float)(MAP_DIM * (int)CHUNK_SIZE);
+  for (int a = 0; a < 3; a++) {
+    float base = (float)(world->occupancy.origin[a] * (int)CHUNK_SIZE);
+    *seed = *seed * 1103515245u + 12345u;
+    o[a] = base + (float)(*seed >> 8) / 16777216.0f * span;
+    *seed = *seed * 1103515245u + 12345u;
+    d[a] = base + (float)(*seed >> 8) / 16777216.0f * span - o[a];
+  }
+}
+
+// Mostly air: ground in the chunk layer below y = 0, and a floating sphere in one chunk out of eleven above it.
+static bool _sparse_source(void *user, int cx, int cy, int cz, ChunkTree *out) {
+  (void)user;
+  int cs = (int)CHUNK_SIZE;
+  if (cy == -1) {
+    chunk_fill_box(out, (VoxelCoord){0, 0, 0}, (VoxelCoord){cs - 1, cs / 2 + wrap(cx * 5 + cz * 3, cs / 4), cs - 1},
+                   true);
+    return true;
+  }
+  unsigned int h = (unsigned int)(cx * 73856093) ^ (unsigned int)(cy * 19349663) ^ (unsigned int)(cz * 83492791);
+  if (cy < -1 || cy > MAP_DIM / 2 - 2 || h % 11u != 0u)
+    return false;
+  chunk_fill_sphere(out, (VoxelCoord){cs / 2, cs / 2, cs / 2}, cs / 4, true);
+  return true;
+}
+
+static void _drain(WorldManager *world) {
+  while (world_pending_loads(world) > 0) {
+    if (world_commit_loads(world, WORLD_COMMIT_BUDGET) == 0)
+      sched_yield();
+  }
+}